@@ -20,6 +20,7 @@
 
 #include <assert.h>
 #include <limits.h>
+#include <pthread.h>
 #include <stdlib.h>
 #include <string.h>
 
@@ -1015,6 +1016,134 @@ int trie_apply(trie_t *tbl, int (*f)(trie_val_t *, void *), void *d)
 	return apply_nodes(&tbl->root, f, d);
 }
 
+struct trie_parts {
+	node_t **nodes; /*!< Roots of the subtries, in order. */
+	size_t count;   /*!< Number of the subtries. */
+	size_t next;    /*!< Next unclaimed subtrie. */
+#ifndef HAVE_ATOMIC
+	pthread_mutex_t lock; /*!< Lock of the next subtrie if no atomic operations. */
+#endif
+};
+
+trie_parts_t *trie_parts_new(trie_t *tbl, size_t count)
+{
+	trie_parts_t *parts = calloc(1, sizeof(*parts));
+	if (parts == NULL)
+		return NULL;
+#ifndef HAVE_ATOMIC
+	pthread_mutex_init(&parts->lock, NULL);
+#endif
+	if (tbl == NULL || !tbl->weight)
+		return parts;
+
+	parts->nodes = malloc(sizeof(node_t *));
+	if (parts->nodes == NULL) {
+		trie_parts_free(parts);
+		return NULL;
+	}
+	parts->nodes[0] = &tbl->root;
+	parts->count = 1;
+
+	/* Replace the branches by their twigs, level by level. */
+	while (parts->count < count) {
+		size_t new_count = 0;
+		for (size_t i = 0; i < parts->count; ++i) {
+			node_t *t = parts->nodes[i];
+			new_count += isbranch(t) ? branch_weight(t) : 1;
+		}
+		if (new_count == parts->count)
+			break; // Only leaves.
+
+		node_t **nodes = malloc(new_count * sizeof(node_t *));
+		if (nodes == NULL) {
+			trie_parts_free(parts);
+			return NULL;
+		}
+		size_t pos = 0;
+		for (size_t i = 0; i < parts->count; ++i) {
+			node_t *t = parts->nodes[i];
+			if (!isbranch(t)) {
+				nodes[pos++] = t;
+				continue;
+			}
+			uint n = branch_weight(t);
+			for (uint j = 0; j < n; ++j)
+				nodes[pos++] = twig(t, j);
+		}
+		assert(pos == new_count);
+
+		free(parts->nodes);
+		parts->nodes = nodes;
+		parts->count = new_count;
+	}
+
+	return parts;
+}
+
+/*! \brief Claims the next subtrie. */
+static size_t parts_claim(trie_parts_t *parts)
+{
+#ifdef HAVE_ATOMIC
+	return __atomic_fetch_add(&parts->next, 1, __ATOMIC_RELAXED);
+#else
+	pthread_mutex_lock(&parts->lock);
+	size_t next = parts->next++;
+	pthread_mutex_unlock(&parts->lock);
+	return next;
+#endif
+}
+
+/*! \brief Makes all the remaining subtries claimed. */
+static void parts_stop(trie_parts_t *parts)
+{
+#ifdef HAVE_ATOMIC
+	__atomic_store_n(&parts->next, parts->count, __ATOMIC_RELAXED);
+#else
+	pthread_mutex_lock(&parts->lock);
+	parts->next = parts->count;
+	pthread_mutex_unlock(&parts->lock);
+#endif
+}
+
+int trie_parts_apply(trie_parts_t *parts, int (*f)(trie_val_t *, void *), void *d)
+{
+	assert(parts && f);
+	while (true) {
+		size_t i = parts_claim(parts);
+		if (i >= parts->count)
+			return KNOT_EOK;
+		int ret = apply_nodes(parts->nodes[i], f, d);
+		if (ret != KNOT_EOK) {
+			parts_stop(parts);
+			return ret;
+		}
+	}
+}
+
+size_t trie_parts_count(const trie_parts_t *parts)
+{
+	assert(parts);
+	return parts->count;
+}
+
+int trie_parts_apply_part(trie_parts_t *parts, size_t part,
+                          int (*f)(trie_val_t *, void *), void *d)
+{
+	assert(parts && f && part < parts->count);
+	return apply_nodes(parts->nodes[part], f, d);
+}
+
+void trie_parts_free(trie_parts_t *parts)
+{
+	if (parts == NULL)
+		return;
+#ifndef HAVE_ATOMIC
+	pthread_mutex_destroy(&parts->lock);
+#endif
+	free(parts->nodes);
+	free(parts);
+}
+
 /* These are all thin wrappers around static Tns* functions. */
 trie_it_t* trie_it_begin(trie_t *tbl)
 {
@@ -107,6 +107,52 @@ int trie_get_leq(trie_t *tbl, const trie_key_t *key, uint32_t len, trie_val_t **
  */
 int trie_apply(trie_t *tbl, int (*f)(trie_val_t *, void *), void *d);
 
+/*! \brief Trie split into contiguous parts for parallel processing. */
+typedef struct trie_parts trie_parts_t;
+
+/*!
+ * \brief Split the trie into at least 'count' parts (if possible).
+ *
+ * Each part is a subtrie, covering a contiguous range of keys. The parts are
+ * claimed by trie_parts_apply() callers one by one, so that the work is
+ * balanced among threads even if the parts differ in size.
+ *
+ * \note The trie must not be modified until the parts are freed.
+ *
+ * \param tbl    Trie, NULL is handled as an empty trie.
+ * \param count  Requested number of parts.
+ *
+ * \return Trie parts or NULL if out of memory.
+ */
+trie_parts_t *trie_parts_new(trie_t *tbl, size_t count);
+
+/*!
+ * \brief Apply a function to every trie_val_t in the unclaimed parts, in order
+ *        within each part.
+ *
+ * It's supposed to be called by each of the cooperating threads. Upon an error,
+ * the remaining parts aren't claimed by any thread.
+ *
+ * \return KNOT_EOK if success or KNOT_E* if error.
+ */
+int trie_parts_apply(trie_parts_t *parts, int (*f)(trie_val_t *, void *), void *d);
+
+/*! \brief Return the number of the trie parts. */
+size_t trie_parts_count(const trie_parts_t *parts);
+
+/*!
+ * \brief Apply a function to every trie_val_t in the given part, in order.
+ *
+ * It's an alternative to trie_parts_apply() if the caller distributes the parts.
+ *
+ * \return KNOT_EOK if success or KNOT_E* if error.
+ */
+int trie_parts_apply_part(trie_parts_t *parts, size_t part,
+                          int (*f)(trie_val_t *, void *), void *d);
+
+/*! \brief Free the trie parts. */
+void trie_parts_free(trie_parts_t *parts);
+
 /*!
  * \brief Remove an item, returning KNOT_EOK if succeeded or KNOT_ENOENT if not found.
  *
@@ -1,4 +1,4 @@
-/*  Copyright (C) 2011 CZ.NIC, z.s.p.o. <knot-dns@labs.nic.cz>
+/*  Copyright (C) 2020 CZ.NIC, z.s.p.o. <knot-dns@labs.nic.cz>
 
     This program is free software: you can redistribute it and/or modify
     it under the terms of the GNU General Public License as published by
@@ -14,14 +14,19 @@
     along with this program.  If not, see <https://www.gnu.org/licenses/>.
  */
 
+#include <assert.h>
+#include <limits.h>
 #include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
 #include <time.h>
 #include "knot/common/fdset.h"
+#include "contrib/macros.h"
 #include "contrib/time.h"
 #include "libknot/errcode.h"
 
+#define HEAP_NONE UINT_MAX /* Index without active watchdog. */
+
 /* Realloc memory or return error (part of fdset_resize). */
 #define MEM_RESIZE(tmp, p, n) \
 	if ((tmp = realloc((p), (n) * sizeof(*p))) == NULL) \
@@ -32,12 +37,107 @@ static int fdset_resize(fdset_t *set, unsigned size)
 {
 	void *tmp = NULL;
 	MEM_RESIZE(tmp, set->ctx, size);
+#ifdef ENABLE_EPOLL
+	MEM_RESIZE(tmp, set->fd, size);
+	MEM_RESIZE(tmp, set->events, size);
+	MEM_RESIZE(tmp, set->recv_ev, size);
+#else
 	MEM_RESIZE(tmp, set->pfd, size);
+#endif
 	MEM_RESIZE(tmp, set->timeout, size);
+	MEM_RESIZE(tmp, set->heap, size);
+	MEM_RESIZE(tmp, set->heap_pos, size);
 	set->size = size;
 	return KNOT_EOK;
 }
 
+/* -- watchdog heap -------------------------------------------------------- */
+
+static void heap_swap(fdset_t *set, unsigned a, unsigned b)
+{
+	unsigned tmp = set->heap[a];
+	set->heap[a] = set->heap[b];
+	set->heap[b] = tmp;
+	set->heap_pos[set->heap[a]] = a;
+	set->heap_pos[set->heap[b]] = b;
+}
+
+static bool heap_less(const fdset_t *set, unsigned a, unsigned b)
+{
+	return set->timeout[set->heap[a]] < set->timeout[set->heap[b]];
+}
+
+static void heap_up(fdset_t *set, unsigned pos)
+{
+	while (pos > 0) {
+		unsigned parent = (pos - 1) / 2;
+		if (!heap_less(set, pos, parent)) {
+			break;
+		}
+		heap_swap(set, pos, parent);
+		pos = parent;
+	}
+}
+
+static void heap_down(fdset_t *set, unsigned pos)
+{
+	for (;;) {
+		unsigned min = pos;
+		unsigned left = 2 * pos + 1;
+		unsigned right = left + 1;
+		if (left < set->heap_n && heap_less(set, left, min)) {
+			min = left;
+		}
+		if (right < set->heap_n && heap_less(set, right, min)) {
+			min = right;
+		}
+		if (min == pos) {
+			break;
+		}
+		heap_swap(set, pos, min);
+		pos = min;
+	}
+}
+
+static void heap_update(fdset_t *set, unsigned i)
+{
+	if (set->heap_pos[i] == HEAP_NONE) {
+		set->heap[set->heap_n] = i;
+		set->heap_pos[i] = set->heap_n++;
+	}
+	heap_up(set, set->heap_pos[i]);
+	heap_down(set, set->heap_pos[i]);
+}
+
+static void heap_delete(fdset_t *set, unsigned i)
+{
+	unsigned pos = set->heap_pos[i];
+	if (pos == HEAP_NONE) {
+		return;
+	}
+
+	set->heap_pos[i] = HEAP_NONE;
+	if (pos != --set->heap_n) {
+		set->heap[pos] = set->heap[set->heap_n];
+		set->heap_pos[set->heap[pos]] = pos;
+		heap_up(set, pos);
+		heap_down(set, pos);
+	}
+}
+
+/* -- backend specific operations ------------------------------------------ */
+
+#ifdef ENABLE_EPOLL
+static void epoll_watch(fdset_t *set, unsigned i, int op)
+{
+	struct epoll_event ev = {
+		.events = (i < set->offset) ? 0 : set->events[i],
+		.data.u32 = i
+	};
+	(void)epoll_ctl(set->efd, op, set->fd[i], &ev);
+}
+#endif
+
 int fdset_init(fdset_t *set, unsigned size)
 {
 	if (set == NULL) {
@@ -45,7 +145,19 @@ int fdset_init(fdset_t *set, unsigned size)
 	}
 
 	memset(set, 0, sizeof(fdset_t));
-	return fdset_resize(set, size);
+
+#ifdef ENABLE_EPOLL
+	set->efd = epoll_create1(EPOLL_CLOEXEC);
+	if (set->efd < 0) {
+		return knot_map_errno();
+	}
+#endif
+
+	int ret = fdset_resize(set, size);
+	if (ret != KNOT_EOK) {
+		fdset_clear(set);
+	}
+	return ret;
 }
 
 int fdset_clear(fdset_t* set)
@@ -55,13 +167,27 @@ int fdset_clear(fdset_t* set)
 	}
 
 	free(set->ctx);
+#ifdef ENABLE_EPOLL
+	free(set->fd);
+	free(set->events);
+	free(set->recv_ev);
+	if (set->efd >= 0) {
+		close(set->efd);
+	}
+#else
 	free(set->pfd);
+#endif
 	free(set->timeout);
+	free(set->heap);
+	free(set->heap_pos);
 	memset(set, 0, sizeof(fdset_t));
+#ifdef ENABLE_EPOLL
+	set->efd = -1;
+#endif
 	return KNOT_EOK;
 }
 
-int fdset_add(fdset_t *set, int fd, unsigned events, void *ctx)
+int fdset_add(fdset_t *set, int fd, fdset_event_t events, void *ctx)
 {
 	if (set == NULL || fd < 0) {
 		return KNOT_EINVAL;
@@ -73,11 +199,25 @@ int fdset_add(fdset_t *set, int fd, unsigned events, void *ctx)
 
 	/* Initialize. */
 	int i = set->n++;
+#ifdef ENABLE_EPOLL
+	set->fd[i] = fd;
+	set->events[i] = events;
+	struct epoll_event ev = {
+		.events = events,
+		.data.u32 = i
+	};
+	if (epoll_ctl(set->efd, EPOLL_CTL_ADD, fd, &ev) != 0) {
+		set->n--;
+		return knot_map_errno();
+	}
+#else
 	set->pfd[i].fd = fd;
 	set->pfd[i].events = events;
 	set->pfd[i].revents = 0;
+#endif
 	set->ctx[i] = ctx;
 	set->timeout[i] = 0;
+	set->heap_pos[i] = HEAP_NONE;
 
 	/* Return index to this descriptor. */
 	return i;
@@ -89,6 +229,15 @@ int fdset_remove(fdset_t *set, unsigned i)
 		return KNOT_EINVAL;
 	}
 
+	heap_delete(set, i);
+
+#ifdef ENABLE_EPOLL
+	/* Already closed descriptors are removed from epoll automatically. */
+	if (set->fd[i] >= 0) {
+		(void)epoll_ctl(set->efd, EPOLL_CTL_DEL, set->fd[i], NULL);
+	}
+#endif
+
 	/* Decrement number of elms. */
 	--set->n;
 
@@ -96,23 +245,182 @@ int fdset_remove(fdset_t *set, unsigned i)
 	 * Move last -> i if some remain. */
 	unsigned last = set->n; /* Already decremented */
 	if (i < last) {
+#ifdef ENABLE_EPOLL
+		set->fd[i] = set->fd[last];
+		set->events[i] = set->events[last];
+		if (set->fd[i] >= 0) {
+			epoll_watch(set, i, EPOLL_CTL_MOD);
+		}
+#else
 		set->pfd[i] = set->pfd[last];
+#endif
 		set->timeout[i] = set->timeout[last];
 		set->ctx[i] = set->ctx[last];
+		set->heap_pos[i] = set->heap_pos[last];
+		if (set->heap_pos[i] != HEAP_NONE) {
+			set->heap[set->heap_pos[i]] = i;
+		}
 	}
 
 	return KNOT_EOK;
 }
 
-int fdset_set_watchdog(fdset_t* set, int i, int interval)
+int fdset_set_events(fdset_t *set, unsigned i, fdset_event_t events)
 {
 	if (set == NULL || i >= set->n) {
 		return KNOT_EINVAL;
 	}
 
+#ifdef ENABLE_EPOLL
+	if (set->events[i] != events) {
+		set->events[i] = events;
+		if (i >= set->offset) {
+			epoll_watch(set, i, EPOLL_CTL_MOD);
+		}
+	}
+#else
+	set->pfd[i].events = events;
+#endif
+
+	return KNOT_EOK;
+}
+
+int fdset_poll(fdset_t *set, fdset_it_t *it, unsigned offset, int timeout_ms)
+{
+	if (set == NULL || it == NULL || offset > set->n) {
+		return KNOT_EINVAL;
+	}
+
+	memset(it, 0, sizeof(*it));
+	it->set = set;
+
+#ifdef ENABLE_EPOLL
+	/* Stop or restart watching the leading descriptors. */
+	if (offset != set->offset) {
+		unsigned from = MIN(offset, set->offset);
+		unsigned to = MAX(offset, set->offset);
+		set->offset = offset;
+		for (unsigned i = from; i < to && i < set->n; i++) {
+			epoll_watch(set, i, EPOLL_CTL_MOD);
+		}
+	}
+
+	int ret = epoll_wait(set->efd, set->recv_ev, MAX(set->n, 1), timeout_ms);
+	if (ret < 0) {
+		return knot_map_errno();
+	}
+	it->idx = 0;
+	it->end = ret;
+#else
+	int ret = poll(&set->pfd[offset], set->n - offset, timeout_ms);
+	if (ret < 0) {
+		return knot_map_errno();
+	}
+	it->idx = offset;
+	it->end = set->n;
+
+	/* Skip to the first fd with an event. */
+	while (ret > 0 && it->idx < it->end && set->pfd[it->idx].revents == 0) {
+		it->idx++;
+	}
+#endif
+	it->unprocessed = ret;
+
+	return ret;
+}
+
+void fdset_it_next(fdset_it_t *it)
+{
+	assert(it != NULL);
+
+	if (--it->unprocessed <= 0) {
+		return;
+	}
+
+#ifdef ENABLE_EPOLL
+	it->idx++;
+#else
+	do {
+		it->idx++;
+	} while (it->idx < it->end && it->set->pfd[it->idx].revents == 0);
+#endif
+}
+
+void fdset_it_remove(fdset_it_t *it)
+{
+	assert(it != NULL && !fdset_it_done(it));
+
+	fdset_t *set = it->set;
+	unsigned i = fdset_it_get_idx(it);
+
+	heap_delete(set, i);
+#ifdef ENABLE_EPOLL
+	(void)epoll_ctl(set->efd, EPOLL_CTL_DEL, set->fd[i], NULL);
+	set->fd[i] = -1;
+#else
+	set->pfd[i].fd = -1;
+#endif
+	it->removed = true;
+}
+
+#ifdef ENABLE_EPOLL
+static int cmp_idx_desc(const void *a, const void *b)
+{
+	unsigned ia = ((const struct epoll_event *)a)->data.u32;
+	unsigned ib = ((const struct epoll_event *)b)->data.u32;
+	return (ia < ib) - (ia > ib);
+}
+#endif
+
+void fdset_it_commit(fdset_it_t *it)
+{
+	assert(it != NULL);
+
+	if (!it->removed) {
+		return;
+	}
+
+	fdset_t *set = it->set;
+
+#ifdef ENABLE_EPOLL
+	/* Only polled descriptors can be removed, collect them. */
+	unsigned count = 0;
+	for (unsigned k = 0; k < it->end; k++) {
+		if (set->fd[set->recv_ev[k].data.u32] < 0) {
+			set->recv_ev[count++] = set->recv_ev[k];
+		}
+	}
+
+	/* Removing from the highest index never moves a removed descriptor. */
+	qsort(set->recv_ev, count, sizeof(*set->recv_ev), cmp_idx_desc);
+	for (unsigned k = 0; k < count; k++) {
+		(void)fdset_remove(set, set->recv_ev[k].data.u32);
+	}
+#else
+	unsigned i = 0;
+	while (i < set->n) {
+		if (set->pfd[i].fd < 0) {
+			(void)fdset_remove(set, i);
+		} else {
+			++i;
+		}
+	}
+#endif
+
+	it->removed = false;
+	it->unprocessed = 0;
+}
+
+int fdset_set_watchdog(fdset_t* set, int i, int interval)
+{
+	if (set == NULL || i < 0 || i >= set->n) {
+		return KNOT_EINVAL;
+	}
+
 	/* Lift watchdog if interval is negative. */
 	if (interval < 0) {
 		set->timeout[i] = 0;
+		heap_delete(set, i);
 		return KNOT_EOK;
 	}
 
@@ -120,6 +428,7 @@ int fdset_set_watchdog(fdset_t* set, int i, int interval)
 	struct timespec now = time_now();
 
 	set->timeout[i] = now.tv_sec + interval; /* Only seconds precision. */
+	heap_update(set, i);
 	return KNOT_EOK;
 }
 
@@ -132,20 +441,26 @@ int fdset_sweep(fdset_t* set, fdset_sweep_cb_t cb, void *data)
 	/* Get time threshold. */
 	struct timespec now = time_now();
 
-	unsigned i = 0;
-	while (i < set->n) {
+	/* Visit only the expired descriptors, the earliest is on the top. */
+	int sweeped = 0;
+	while (set->heap_n > 0) {
+		unsigned i = set->heap[0];
+		if (set->timeout[i] > now.tv_sec) {
+			break;
+		}
 
 		/* Check sweep state, remove if requested. */
-		if (set->timeout[i] > 0 && set->timeout[i] <= now.tv_sec) {
-			if (cb(set, i, data) == FDSET_SWEEP) {
-				if (fdset_remove(set, i) == KNOT_EOK)
-					continue; /* Stay on the index. */
+		if (cb(set, i, data) == FDSET_SWEEP) {
+			if (fdset_remove(set, i) == KNOT_EOK) {
+				sweeped++;
+				continue;
 			}
 		}
 
-		/* Next descriptor. */
-		++i;
+		/* Kept descriptor, disable its watchdog. */
+		set->timeout[i] = 0;
+		heap_delete(set, i);
 	}
 
-	return KNOT_EOK;
+	return sweeped;
 }
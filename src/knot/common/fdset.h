@@ -1,4 +1,4 @@
-/*  Copyright (C) 2017 CZ.NIC, z.s.p.o. <knot-dns@labs.nic.cz>
+/*  Copyright (C) 2020 CZ.NIC, z.s.p.o. <knot-dns@labs.nic.cz>
 
     This program is free software: you can redistribute it and/or modify
     it under the terms of the GNU General Public License as published by
@@ -16,26 +16,67 @@
 
 /*!
  * \brief I/O multiplexing with context and timeouts for each fd.
+ *
+ * The set is backed by epoll() if available, otherwise by poll(). Watchdog
+ * timeouts are kept in a binary heap so that sweeping only visits expired
+ * descriptors.
  */
 
 #pragma once
 
+#include <stdbool.h>
 #include <stddef.h>
 #include <poll.h>
 #include <sys/time.h>
 #include <signal.h>
+#ifdef ENABLE_EPOLL
+#include <sys/epoll.h>
+#endif
 
 #define FDSET_INIT_SIZE 256 /* Resize step. */
 
+/*! \brief Watched events. */
+#ifdef ENABLE_EPOLL
+typedef enum {
+	FDSET_POLLIN  = EPOLLIN,
+	FDSET_POLLOUT = EPOLLOUT,
+} fdset_event_t;
+#else
+typedef enum {
+	FDSET_POLLIN  = POLLIN,
+	FDSET_POLLOUT = POLLOUT,
+} fdset_event_t;
+#endif
+
 /*! \brief Set of filedescriptors with associated context and timeouts. */
 typedef struct fdset {
-	unsigned n;          /*!< Active fds. */
-	unsigned size;       /*!< Array size (allocated). */
-	void* *ctx;          /*!< Context for each fd. */
-	struct pollfd *pfd;  /*!< poll state for each fd */
-	time_t *timeout;     /*!< Timeout for each fd (seconds precision). */
+	unsigned n;                  /*!< Active fds. */
+	unsigned size;               /*!< Array size (allocated). */
+	void* *ctx;                  /*!< Context for each fd. */
+#ifdef ENABLE_EPOLL
+	int efd;                     /*!< epoll file descriptor. */
+	int *fd;                     /*!< File descriptor for each index. */
+	unsigned *events;            /*!< Watched events for each fd. */
+	struct epoll_event *recv_ev; /*!< Events returned by the last poll. */
+	unsigned offset;             /*!< Number of leading fds currently not watched. */
+#else
+	struct pollfd *pfd;          /*!< poll state for each fd */
+#endif
+	time_t *timeout;             /*!< Timeout for each fd (seconds precision). */
+	unsigned *heap;              /*!< Min-heap of indices with active watchdog. */
+	unsigned *heap_pos;          /*!< Position in the heap for each fd. */
+	unsigned heap_n;             /*!< Number of active watchdogs. */
 } fdset_t;
 
+/*! \brief State of an iteration over the polled events. */
+typedef struct {
+	fdset_t *set;       /*!< Source set. */
+	unsigned idx;       /*!< Current index (poll) or event position (epoll). */
+	unsigned end;       /*!< End of the iteration. */
+	int unprocessed;    /*!< Number of unprocessed events. */
+	bool removed;       /*!< Some fd was removed during the iteration. */
+} fdset_it_t;
+
 /*! \brief Mark-and-sweep state. */
 enum fdset_sweep_state {
 	FDSET_KEEP,
@@ -69,11 +110,14 @@ int fdset_clear(fdset_t* set);
  * \retval index of the added fd if successful.
  * \retval -1 on errors.
  */
-int fdset_add(fdset_t *set, int fd, unsigned events, void *ctx);
+int fdset_add(fdset_t *set, int fd, fdset_event_t events, void *ctx);
 
 /*!
  * \brief Remove file descriptor from watched set.
  *
+ * \note Must not be called while iterating over polled events,
+ *       use fdset_it_remove() instead.
+ *
  * \param set Target set.
  * \param i Index of the removed fd.
  *
@@ -82,6 +126,30 @@ int fdset_add(fdset_t *set, int fd, unsigned events, void *ctx);
  */
 int fdset_remove(fdset_t *set, unsigned i);
 
+/*!
+ * \brief Change the mask of watched events.
+ *
+ * \param set Target set.
+ * \param i Index of the fd.
+ * \param events New mask of watched events.
+ *
+ * \retval 0 if successful.
+ * \retval -1 on errors.
+ */
+int fdset_set_events(fdset_t *set, unsigned i, fdset_event_t events);
+
+/*!
+ * \brief Wait for events on the watched descriptors.
+ *
+ * \param set Target set.
+ * \param it Output iterator over the polled events.
+ * \param offset Number of leading descriptors to ignore.
+ * \param timeout_ms Timeout of the operation (-1 for infinity).
+ *
+ * \return Number of events or negative error code.
+ */
+int fdset_poll(fdset_t *set, fdset_it_t *it, unsigned offset, int timeout_ms);
+
 /*!
  * \brief Set file descriptor watchdog interval.
  *
@@ -111,3 +179,117 @@ int fdset_set_watchdog(fdset_t* set, int i, int interval);
  * \retval -1 on errors.
  */
 int fdset_sweep(fdset_t* set, fdset_sweep_cb_t cb, void *data);
+
+/*!
+ * \brief Returns file descriptor for the given index.
+ */
+inline static int fdset_get_fd(const fdset_t *set, unsigned i)
+{
+#ifdef ENABLE_EPOLL
+	return set->fd[i];
+#else
+	return set->pfd[i].fd;
+#endif
+}
+
+/*!
+ * \brief Returns context for the given index.
+ */
+inline static void *fdset_get_ctx(const fdset_t *set, unsigned i)
+{
+	return set->ctx[i];
+}
+
+/*!
+ * \brief Returns the index of the current event.
+ */
+inline static unsigned fdset_it_get_idx(const fdset_it_t *it)
+{
+#ifdef ENABLE_EPOLL
+	return it->set->recv_ev[it->idx].data.u32;
+#else
+	return it->idx;
+#endif
+}
+
+/*!
+ * \brief Returns the file descriptor of the current event.
+ */
+inline static int fdset_it_get_fd(const fdset_it_t *it)
+{
+	return fdset_get_fd(it->set, fdset_it_get_idx(it));
+}
+
+/*!
+ * \brief Returns the context of the current event.
+ */
+inline static void *fdset_it_get_ctx(const fdset_it_t *it)
+{
+	return fdset_get_ctx(it->set, fdset_it_get_idx(it));
+}
+
+/*!
+ * \brief Returns the returned events of the current event.
+ */
+inline static unsigned fdset_it_get_revents(const fdset_it_t *it)
+{
+#ifdef ENABLE_EPOLL
+	return it->set->recv_ev[it->idx].events;
+#else
+	return it->set->pfd[it->idx].revents;
+#endif
+}
+
+/*!
+ * \brief Checks if the current fd is readable.
+ */
+inline static bool fdset_it_is_pollin(const fdset_it_t *it)
+{
+	return fdset_it_get_revents(it) & FDSET_POLLIN;
+}
+
+/*!
+ * \brief Checks if the current fd is writable.
+ */
+inline static bool fdset_it_is_pollout(const fdset_it_t *it)
+{
+	return fdset_it_get_revents(it) & FDSET_POLLOUT;
+}
+
+/*!
+ * \brief Checks if an error or hang-up occurred on the current fd.
+ */
+inline static bool fdset_it_is_error(const fdset_it_t *it)
+{
+#ifdef ENABLE_EPOLL
+	return fdset_it_get_revents(it) & (EPOLLERR | EPOLLHUP);
+#else
+	return fdset_it_get_revents(it) & (POLLERR | POLLHUP | POLLNVAL);
+#endif
+}
+
+/*!
+ * \brief Checks if all the polled events were processed.
+ */
+inline static bool fdset_it_done(const fdset_it_t *it)
+{
+	return it->unprocessed <= 0 || it->idx >= it->end;
+}
+
+/*!
+ * \brief Moves the iterator to the next polled event.
+ */
+void fdset_it_next(fdset_it_t *it);
+
+/*!
+ * \brief Removes the current fd from the set.
+ *
+ * The removal is finished by fdset_it_commit(), so that indices of the
+ * remaining events don't change during the iteration.
+ */
+void fdset_it_remove(fdset_it_t *it);
+
+/*!
+ * \brief Finishes the iteration, compacts the set if some fd was removed.
+ */
+void fdset_it_commit(fdset_it_t *it);
@@ -15,6 +15,7 @@
  */
 
 #include <inttypes.h>
+#include <stddef.h>
 #include <sys/stat.h>
 #include <time.h>
 #include <unistd.h>
@@ -51,8 +52,37 @@ uint64_t server_zone_count(server_t *server)
 	return knot_zonedb_size(server->zone_db);
 }
 
+static uint64_t udp_stats_sum(server_t *server, size_t offset)
+{
+	uint64_t res = 0;
+	for (unsigned i = 0; server->udp_stats != NULL &&
+	                     i < server->handlers[IO_UDP].size; i++) {
+		uint64_t *ctr = (uint64_t *)((uint8_t *)&server->udp_stats[i] + offset);
+		res += ATOMIC_GET(*ctr);
+	}
+	return res;
+}
+
+uint64_t server_udp_batches(server_t *server)
+{
+	return udp_stats_sum(server, offsetof(udp_stats_t, batches));
+}
+
+uint64_t server_udp_batch_msgs(server_t *server)
+{
+	return udp_stats_sum(server, offsetof(udp_stats_t, msgs));
+}
+
+uint64_t server_udp_batch_full(server_t *server)
+{
+	return udp_stats_sum(server, offsetof(udp_stats_t, full));
+}
+
 const stats_item_t server_stats[] = {
 	{ "zone-count", server_zone_count },
+	{ "udp-batches", server_udp_batches },
+	{ "udp-batch-messages", server_udp_batch_msgs },
+	{ "udp-batch-full", server_udp_batch_full },
 	{ 0 }
 };
 
@@ -181,6 +211,18 @@ static void dump_to_file(FILE *fd, server_t *server)
 		DUMP_CTR(fd, 1, "%s", item->name, item->val(server));
 	}
 
+	// Dump receive batch statistics of each UDP worker.
+	if (server->udp_stats != NULL) {
+		DUMP_STR(fd, 1, "udp-worker", "");
+		for (unsigned i = 0; i < server->handlers[IO_UDP].size; i++) {
+			const udp_stats_t *udp = &server->udp_stats[i];
+			DUMP_STR(fd, 2, "%u", i, "");
+			DUMP_CTR(fd, 3, "batches", ATOMIC_GET(udp->batches));
+			DUMP_CTR(fd, 3, "messages", ATOMIC_GET(udp->msgs));
+			DUMP_CTR(fd, 3, "full", ATOMIC_GET(udp->full));
+		}
+	}
+
 	dump_ctx_t ctx = {
 		.fd = fd,
 		.query_modules = conf()->query_modules,
@@ -125,17 +125,27 @@ static void init_cache(
 	static bool   first_init = true;
 	static bool   running_tcp_reuseport;
 	static bool   running_socket_affinity;
+	static bool   running_topology_affinity;
+	static bool   running_udp_gso;
+	static size_t running_udp_batch_size;
+	static int    running_udp_busy_poll;
 	static size_t running_udp_threads;
 	static size_t running_tcp_threads;
 	static size_t running_xdp_threads;
+	static bool   running_xdp_inplace_reply;
 	static size_t running_bg_threads;
 
 	if (first_init || reinit_cache) {
 		running_tcp_reuseport = conf_tcp_reuseport(conf);
 		running_socket_affinity = conf_socket_affinity(conf);
+		running_topology_affinity = conf_topology_affinity(conf);
+		running_udp_gso = conf_udp_gso(conf);
+		running_udp_batch_size = conf_udp_batch_size(conf);
+		running_udp_busy_poll = conf_udp_busy_poll(conf);
 		running_udp_threads = conf_udp_threads(conf);
 		running_tcp_threads = conf_tcp_threads(conf);
 		running_xdp_threads = conf_xdp_threads(conf);
+		running_xdp_inplace_reply = conf_xdp_inplace_reply(conf);
 		running_bg_threads = conf_bg_threads(conf);
 
 		first_init = false;
@@ -187,16 +197,29 @@ static void init_cache(
 
 	conf->cache.srv_socket_affinity = running_socket_affinity;
 
+	conf->cache.srv_topology_affinity = running_topology_affinity;
+
+	conf->cache.srv_udp_gso = running_udp_gso;
+
+	conf->cache.srv_udp_batch_size = running_udp_batch_size;
+
+	conf->cache.srv_udp_busy_poll = running_udp_busy_poll;
+
 	conf->cache.srv_udp_threads = running_udp_threads;
 
 	conf->cache.srv_tcp_threads = running_tcp_threads;
 
 	conf->cache.srv_xdp_threads = running_xdp_threads;
 
+	conf->cache.srv_xdp_inplace_reply = running_xdp_inplace_reply;
+
 	conf->cache.srv_bg_threads = running_bg_threads;
 
 	conf->cache.srv_tcp_max_clients = conf_tcp_max_clients(conf);
 
+	val = conf_get(conf, C_SRV, C_TCP_XFR_PEER_LIMIT);
+	conf->cache.srv_tcp_xfr_peer_limit = conf_int(&val);
+
 	val = conf_get(conf, C_CTL, C_TIMEOUT);
 	conf->cache.ctl_timeout = conf_int(&val) * 1000;
 	/* infinite_adjust() call isn't needed, 0 is adjusted later anyway. */
@@ -115,11 +115,17 @@ typedef struct {
 		int srv_tcp_remote_io_timeout;
 		bool srv_tcp_reuseport;
 		bool srv_socket_affinity;
+		bool srv_topology_affinity;
+		bool srv_udp_gso;
+		size_t srv_udp_batch_size;
+		int srv_udp_busy_poll;
 		size_t srv_udp_threads;
 		size_t srv_tcp_threads;
 		size_t srv_xdp_threads;
+		bool srv_xdp_inplace_reply;
 		size_t srv_bg_threads;
 		size_t srv_tcp_max_clients;
+		size_t srv_tcp_xfr_peer_limit;
 		int ctl_timeout;
 		conf_val_t srv_nsid;
 		bool srv_ecs;
@@ -1182,6 +1182,38 @@ bool conf_socket_affinity_txn(
 	return conf_bool(&val);
 }
 
+bool conf_topology_affinity_txn(
+	conf_t *conf,
+	knot_db_txn_t *txn)
+{
+	conf_val_t val = conf_get_txn(conf, txn, C_SRV, C_TOPOLOGY_AFFINITY);
+	return conf_bool(&val);
+}
+
+bool conf_udp_gso_txn(
+	conf_t *conf,
+	knot_db_txn_t *txn)
+{
+	conf_val_t val = conf_get_txn(conf, txn, C_SRV, C_UDP_GSO);
+	return conf_bool(&val);
+}
+
+size_t conf_udp_batch_size_txn(
+	conf_t *conf,
+	knot_db_txn_t *txn)
+{
+	conf_val_t val = conf_get_txn(conf, txn, C_SRV, C_UDP_BATCH_SIZE);
+	return conf_int(&val);
+}
+
+int conf_udp_busy_poll_txn(
+	conf_t *conf,
+	knot_db_txn_t *txn)
+{
+	conf_val_t val = conf_get_txn(conf, txn, C_SRV, C_UDP_BUSY_POLL);
+	return conf_int(&val);
+}
+
 size_t conf_udp_threads_txn(
 	conf_t *conf,
 	knot_db_txn_t *txn)
@@ -1228,6 +1260,14 @@ size_t conf_xdp_threads_txn(
 	return workers;
 }
 
+bool conf_xdp_inplace_reply_txn(
+	conf_t *conf,
+	knot_db_txn_t *txn)
+{
+	conf_val_t val = conf_get_txn(conf, txn, C_SRV, C_XDP_INPLACE_REPLY);
+	return conf_bool(&val);
+}
+
 size_t conf_bg_threads_txn(
 	conf_t *conf,
 	knot_db_txn_t *txn)
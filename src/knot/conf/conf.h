@@ -704,6 +704,78 @@ static inline bool conf_socket_affinity(
 	return conf_socket_affinity_txn(conf, &conf->read_txn);
 }
 
+/*!
+ * Gets the configured setting of the topology-aware affinity switch.
+ *
+ * \param[in] conf  Configuration.
+ * \param[in] txn   Configuration DB transaction.
+ *
+ * \return True if enabled, false otherwise.
+ */
+bool conf_topology_affinity_txn(
+	conf_t *conf,
+	knot_db_txn_t *txn
+);
+static inline bool conf_topology_affinity(
+	conf_t *conf)
+{
+	return conf_topology_affinity_txn(conf, &conf->read_txn);
+}
+
+/*!
+ * Gets the configured setting of the UDP GSO switch.
+ *
+ * \param[in] conf  Configuration.
+ * \param[in] txn   Configuration DB transaction.
+ *
+ * \return True if enabled, false otherwise.
+ */
+bool conf_udp_gso_txn(
+	conf_t *conf,
+	knot_db_txn_t *txn
+);
+static inline bool conf_udp_gso(
+	conf_t *conf)
+{
+	return conf_udp_gso_txn(conf, &conf->read_txn);
+}
+
+/*!
+ * Gets the configured maximum size of UDP receive batches.
+ *
+ * \param[in] conf  Configuration.
+ * \param[in] txn   Configuration DB transaction.
+ *
+ * \return Batch size.
+ */
+size_t conf_udp_batch_size_txn(
+	conf_t *conf,
+	knot_db_txn_t *txn
+);
+static inline size_t conf_udp_batch_size(
+	conf_t *conf)
+{
+	return conf_udp_batch_size_txn(conf, &conf->read_txn);
+}
+
+/*!
+ * Gets the configured UDP busy polling time.
+ *
+ * \param[in] conf  Configuration.
+ * \param[in] txn   Configuration DB transaction.
+ *
+ * \return Busy polling time in microseconds, 0 if disabled.
+ */
+int conf_udp_busy_poll_txn(
+	conf_t *conf,
+	knot_db_txn_t *txn
+);
+static inline int conf_udp_busy_poll(
+	conf_t *conf)
+{
+	return conf_udp_busy_poll_txn(conf, &conf->read_txn);
+}
+
 /*!
  * Gets the configured number of UDP threads.
  *
@@ -758,6 +830,24 @@ static inline size_t conf_xdp_threads(
 	return conf_xdp_threads_txn(conf, &conf->read_txn);
 }
 
+/*!
+ * Gets the configured setting of the XDP in-place reply switch.
+ *
+ * \param[in] conf  Configuration.
+ * \param[in] txn   Configuration DB transaction.
+ *
+ * \return True if enabled, false otherwise.
+ */
+bool conf_xdp_inplace_reply_txn(
+	conf_t *conf,
+	knot_db_txn_t *txn
+);
+static inline bool conf_xdp_inplace_reply(
+	conf_t *conf)
+{
+	return conf_xdp_inplace_reply_txn(conf, &conf->read_txn);
+}
+
 /*!
  * Gets the configured number of worker threads.
  *
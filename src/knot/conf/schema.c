@@ -23,6 +23,7 @@
 #include "knot/conf/confio.h"
 #include "knot/conf/tools.h"
 #include "knot/common/log.h"
+#include "knot/server/udp-handler.h"
 #include "knot/updates/acl.h"
 #include "libknot/rrtype/opt.h"
 #include "libdnssec/tsig.h"
@@ -170,8 +171,13 @@ static const yp_item_t desc_server[] = {
 	{ C_TCP_IO_TIMEOUT,       YP_TINT,  YP_VINT = { 0, INT32_MAX, 500 } },
 	{ C_TCP_RMT_IO_TIMEOUT,   YP_TINT,  YP_VINT = { 0, INT32_MAX, 5000 } },
 	{ C_TCP_MAX_CLIENTS,      YP_TINT,  YP_VINT = { 0, INT32_MAX, YP_NIL } },
+	{ C_TCP_XFR_PEER_LIMIT,   YP_TINT,  YP_VINT = { 0, UINT16_MAX, 0 } },
 	{ C_TCP_REUSEPORT,        YP_TBOOL, YP_VNONE },
 	{ C_SOCKET_AFFINITY,      YP_TBOOL, YP_VNONE },
+	{ C_TOPOLOGY_AFFINITY,    YP_TBOOL, YP_VNONE },
+	{ C_UDP_GSO,              YP_TBOOL, YP_VNONE },
+	{ C_UDP_BATCH_SIZE,       YP_TINT,  YP_VINT = { 1, RECVMMSG_BATCHMAX, RECVMMSG_BATCHLEN } },
+	{ C_UDP_BUSY_POLL,        YP_TINT,  YP_VINT = { 0, UINT16_MAX, 0 } },
 	{ C_UDP_MAX_PAYLOAD,      YP_TINT,  YP_VINT = { KNOT_EDNS_MIN_DNSSEC_PAYLOAD,
 	                                                KNOT_EDNS_MAX_UDP_PAYLOAD,
 	                                                1232, YP_SSIZE } },
@@ -185,6 +191,13 @@ static const yp_item_t desc_server[] = {
 	{ C_ANS_ROTATION,         YP_TBOOL, YP_VNONE },
 	{ C_LISTEN,               YP_TADDR, YP_VADDR = { 53 }, YP_FMULTI, { check_listen } },
 	{ C_LISTEN_XDP,           YP_TADDR, YP_VADDR = { 53 }, YP_FMULTI, { check_xdp } },
+	{ C_XDP_INPLACE_REPLY,    YP_TBOOL, YP_VNONE },
+	{ C_XDP_RX_FRAMES,        YP_TINT,  YP_VINT = { 1, 1 << 20, 4096 } },
+	{ C_XDP_TX_FRAMES,        YP_TINT,  YP_VINT = { 1, 1 << 16, 4096 } },
+	{ C_XDP_FILL_RING,        YP_TINT,  YP_VINT = { 0, 1 << 22, 0 }, YP_FNONE, { check_xdp_ring } },
+	{ C_XDP_COMP_RING,        YP_TINT,  YP_VINT = { 0, 1 << 22, 0 }, YP_FNONE, { check_xdp_ring } },
+	{ C_XDP_RX_RING,          YP_TINT,  YP_VINT = { 0, 1 << 22, 0 }, YP_FNONE, { check_xdp_ring } },
+	{ C_XDP_TX_RING,          YP_TINT,  YP_VINT = { 0, 1 << 22, 0 }, YP_FNONE, { check_xdp_ring } },
 	{ C_COMMENT,              YP_TSTR,  YP_VNONE },
 	// Legacy items.
 	{ C_MAX_TCP_CLIENTS,      YP_TINT,  YP_VINT = { 0, INT32_MAX, YP_NIL } },
@@ -233,6 +246,7 @@ static const yp_item_t desc_database[] = {
 	{ C_JOURNAL_DB_MODE,     YP_TOPT,  YP_VOPT = { journal_modes, JOURNAL_MODE_ROBUST } },
 	{ C_JOURNAL_DB_MAX_SIZE, YP_TINT,  YP_VINT = { MEGA(1), VIRT_MEM_LIMIT(TERA(100)),
 	                                               VIRT_MEM_LIMIT(GIGA(20)), YP_SSIZE } },
+	{ C_JOURNAL_DB_DELAY,    YP_TINT,  YP_VINT = { 0, 1000000, 0 } },
 	{ C_KASP_DB,             YP_TSTR,  YP_VSTR = { "keys" } },
 	{ C_KASP_DB_MAX_SIZE,    YP_TINT,  YP_VINT = { MEGA(5), VIRT_MEM_LIMIT(GIGA(100)),
 	                                               MEGA(500), YP_SSIZE } },
@@ -360,11 +374,16 @@ static const yp_item_t desc_policy[] = {
 	{ C_SEM_CHECKS,          YP_TBOOL, YP_VNONE, FLAGS }, \
 	{ C_ZONEFILE_SYNC,       YP_TINT,  YP_VINT = { -1, INT32_MAX, 0, YP_STIME } }, \
 	{ C_ZONEFILE_LOAD,       YP_TOPT,  YP_VOPT = { zonefile_load, ZONEFILE_LOAD_WHOLE } }, \
+	{ C_ZONEFILE_THR,        YP_TINT,  YP_VINT = { 1, UINT16_MAX, 1 } }, \
+	{ C_ZONEFILE_SNAP,       YP_TBOOL, YP_VNONE }, \
 	{ C_JOURNAL_CONTENT,     YP_TOPT,  YP_VOPT = { journal_content, JOURNAL_CONTENT_CHANGES }, FLAGS }, \
 	{ C_JOURNAL_MAX_USAGE,   YP_TINT,  YP_VINT = { KILO(40), SSIZE_MAX, MEGA(100), YP_SSIZE } }, \
 	{ C_JOURNAL_MAX_DEPTH,   YP_TINT,  YP_VINT = { 2, SSIZE_MAX, SSIZE_MAX } }, \
+	{ C_JOURNAL_COMPRESSION, YP_TBOOL, YP_VNONE }, \
 	{ C_ZONE_MAX_SIZE,       YP_TINT,  YP_VINT = { 0, SSIZE_MAX, SSIZE_MAX, YP_SSIZE }, FLAGS }, \
 	{ C_ADJUST_THR,          YP_TINT,  YP_VINT = { 1, UINT16_MAX, 1 } }, \
+	{ C_ANSWER_CACHE,        YP_TINT,  YP_VINT = { 0, UINT32_MAX, 0 }, FLAGS }, \
+	{ C_AXFR_CACHE,          YP_TINT,  YP_VINT = { 0, SSIZE_MAX, 0, YP_SSIZE } }, \
 	{ C_DNSSEC_SIGNING,      YP_TBOOL, YP_VNONE, FLAGS }, \
 	{ C_DNSSEC_VALIDATION,   YP_TBOOL, YP_VNONE, FLAGS }, \
 	{ C_DNSSEC_POLICY,       YP_TREF,  YP_VREF = { C_POLICY }, FLAGS, { check_ref_dflt } }, \
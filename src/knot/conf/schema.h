@@ -24,10 +24,12 @@
 #define C_ADDR			"\x07""address"
 #define C_ADJUST_THR		"\x0E""adjust-threads"
 #define C_ALG			"\x09""algorithm"
+#define C_ANSWER_CACHE		"\x0C""answer-cache"
 #define C_ANS_ROTATION		"\x0F""answer-rotation"
 #define C_ANY			"\x03""any"
 #define C_APPEND		"\x06""append"
 #define C_ASYNC_START		"\x0B""async-start"
+#define C_AXFR_CACHE		"\x0A""axfr-cache"
 #define C_BACKEND		"\x07""backend"
 #define C_BG_WORKERS		"\x12""background-workers"
 #define C_BLOCK_NOTIFY_XFR	"\x1B""block-notify-after-transfer"
@@ -57,8 +59,10 @@
 #define C_ID			"\x02""id"
 #define C_IDENT			"\x08""identity"
 #define C_INCL			"\x07""include"
+#define C_JOURNAL_COMPRESSION	"\x13""journal-compression"
 #define C_JOURNAL_CONTENT	"\x0F""journal-content"
 #define C_JOURNAL_DB		"\x0A""journal-db"
+#define C_JOURNAL_DB_DELAY	"\x17""journal-db-commit-delay"
 #define C_JOURNAL_DB_MAX_SIZE	"\x13""journal-db-max-size"
 #define C_JOURNAL_DB_MODE	"\x0F""journal-db-mode"
 #define C_JOURNAL_MAX_DEPTH	"\x11""journal-max-depth"
@@ -116,11 +120,16 @@
 #define C_TCP_REUSEPORT		"\x0D""tcp-reuseport"
 #define C_TCP_RMT_IO_TIMEOUT	"\x15""tcp-remote-io-timeout"
 #define C_TCP_WORKERS		"\x0B""tcp-workers"
+#define C_TCP_XFR_PEER_LIMIT	"\x12""tcp-xfr-peer-limit"
 #define C_TIMEOUT		"\x07""timeout"
 #define C_TIMER			"\x05""timer"
 #define C_TIMER_DB		"\x08""timer-db"
 #define C_TIMER_DB_MAX_SIZE	"\x11""timer-db-max-size"
+#define C_TOPOLOGY_AFFINITY	"\x11""topology-affinity"
 #define C_TPL			"\x08""template"
+#define C_UDP_BATCH_SIZE	"\x0E""udp-batch-size"
+#define C_UDP_BUSY_POLL		"\x0D""udp-busy-poll"
+#define C_UDP_GSO		"\x07""udp-gso"
 #define C_UDP_MAX_PAYLOAD	"\x0F""udp-max-payload"
 #define C_UDP_MAX_PAYLOAD_IPV4	"\x14""udp-max-payload-ipv4"
 #define C_UDP_MAX_PAYLOAD_IPV6	"\x14""udp-max-payload-ipv6"
@@ -132,9 +141,18 @@
 #define C_USER			"\x04""user"
 #define C_VERSION		"\x07""version"
 #define C_VIA			"\x03""via"
+#define C_XDP_COMP_RING		"\x12""xdp-comp-ring-size"
+#define C_XDP_FILL_RING		"\x12""xdp-fill-ring-size"
+#define C_XDP_INPLACE_REPLY	"\x11""xdp-inplace-reply"
+#define C_XDP_RX_FRAMES		"\x0D""xdp-rx-frames"
+#define C_XDP_RX_RING		"\x10""xdp-rx-ring-size"
+#define C_XDP_TX_FRAMES		"\x0D""xdp-tx-frames"
+#define C_XDP_TX_RING		"\x10""xdp-tx-ring-size"
 #define C_ZONE			"\x04""zone"
 #define C_ZONEFILE_LOAD		"\x0D""zonefile-load"
+#define C_ZONEFILE_SNAP		"\x11""zonefile-snapshot"
 #define C_ZONEFILE_SYNC		"\x0D""zonefile-sync"
+#define C_ZONEFILE_THR		"\x10""zonefile-threads"
 #define C_ZONE_MAX_SIZE		"\x0D""zone-max-size"
 #define C_ZONE_MAX_TLL		"\x0C""zone-max-ttl"
 #define C_ZSK_LIFETIME		"\x0C""zsk-lifetime"
@@ -278,6 +278,18 @@ int check_xdp(
 #endif
 }
 
+int check_xdp_ring(
+	knotd_conf_check_args_t *args)
+{
+	int64_t size = yp_int(args->data);
+	if ((size & (size - 1)) != 0) {
+		args->err_str = "ring size must be a power of 2";
+		return KNOT_EINVAL;
+	}
+
+	return KNOT_EOK;
+}
+
 int check_modref(
 	knotd_conf_check_args_t *args)
 {
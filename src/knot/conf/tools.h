@@ -74,6 +74,10 @@ int check_xdp(
 	knotd_conf_check_args_t *args
 );
 
+int check_xdp_ring(
+	knotd_conf_check_args_t *args
+);
+
 int check_modref(
 	knotd_conf_check_args_t *args
 );
@@ -0,0 +1,189 @@
+/*  Copyright (C) 2020 CZ.NIC, z.s.p.o. <knot-dns@labs.nic.cz>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "knot/dnssec/nsec3-cache.h"
+#include "knot/dnssec/zone-nsec.h"
+#include "contrib/qp-trie/trie.h"
+#include "libdnssec/error.h"
+#include "libknot/error.h"
+
+struct nsec3_cache {
+	pthread_mutex_t lock;         /*!< Lock for the names and parameters. */
+	trie_t *names;                /*!< Owner name -> NSEC3 owner name. */
+	size_t max_size;              /*!< Maximum number of names. */
+	dnssec_nsec3_params_t params; /*!< Parameters of the cached names. */
+};
+
+nsec3_cache_t *nsec3_cache_new(size_t max_size)
+{
+	nsec3_cache_t *cache = calloc(1, sizeof(*cache));
+	if (cache == NULL) {
+		return NULL;
+	}
+
+	cache->names = trie_create(NULL);
+	if (cache->names == NULL) {
+		free(cache);
+		return NULL;
+	}
+	pthread_mutex_init(&cache->lock, NULL);
+	cache->max_size = max_size;
+
+	return cache;
+}
+
+static int free_name(trie_val_t *val, void *ctx)
+{
+	knot_dname_free(*val, NULL);
+	return KNOT_EOK;
+}
+
+static void cache_clear(nsec3_cache_t *cache)
+{
+	(void)trie_apply(cache->names, free_name, NULL);
+	trie_clear(cache->names);
+}
+
+void nsec3_cache_free(nsec3_cache_t *cache)
+{
+	if (cache == NULL) {
+		return;
+	}
+
+	cache_clear(cache);
+	trie_free(cache->names);
+	dnssec_binary_free(&cache->params.salt);
+	pthread_mutex_destroy(&cache->lock);
+	free(cache);
+}
+
+size_t nsec3_cache_size(nsec3_cache_t *cache)
+{
+	if (cache == NULL) {
+		return 0;
+	}
+
+	pthread_mutex_lock(&cache->lock);
+	size_t size = trie_weight(cache->names);
+	pthread_mutex_unlock(&cache->lock);
+
+	return size;
+}
+
+bool nsec3_params_equal(const dnssec_nsec3_params_t *a,
+                        const dnssec_nsec3_params_t *b)
+{
+	return a->algorithm == b->algorithm &&
+	       a->iterations == b->iterations &&
+	       dnssec_binary_cmp(&a->salt, &b->salt) == 0;
+}
+
+static int set_params(nsec3_cache_t *cache, const dnssec_nsec3_params_t *params)
+{
+	cache_clear(cache);
+	dnssec_binary_free(&cache->params.salt);
+	cache->params = *params;
+	memset(&cache->params.salt, 0, sizeof(cache->params.salt));
+
+	int ret = dnssec_binary_dup(&params->salt, &cache->params.salt);
+	if (ret != DNSSEC_EOK) {
+		// Never matching parameters.
+		cache->params.algorithm = 0;
+		return knot_error_from_libdnssec(ret);
+	}
+
+	return KNOT_EOK;
+}
+
+/*! \brief Looks up the cached name, the cache must be locked. */
+static int cache_get(nsec3_cache_t *cache, uint8_t *out, size_t out_size,
+                     const uint8_t *lf, const dnssec_nsec3_params_t *params)
+{
+	if (!nsec3_params_equal(&cache->params, params)) {
+		return KNOT_ENOENT;
+	}
+
+	trie_val_t *val = trie_get_try(cache->names, lf + 1, *lf);
+	if (val == NULL) {
+		return KNOT_ENOENT;
+	}
+
+	size_t size = knot_dname_size(*val);
+	if (size > out_size) {
+		return KNOT_ESPACE;
+	}
+	memcpy(out, *val, size);
+
+	return KNOT_EOK;
+}
+
+/*! \brief Stores the hashed name, the cache must be locked. */
+static void cache_put(nsec3_cache_t *cache, const uint8_t *hashed,
+                      const uint8_t *lf, const dnssec_nsec3_params_t *params)
+{
+	if (!nsec3_params_equal(&cache->params, params) &&
+	    set_params(cache, params) != KNOT_EOK) {
+		return;
+	}
+
+	if (trie_weight(cache->names) >= cache->max_size) {
+		cache_clear(cache);
+	}
+
+	trie_val_t *val = trie_get_ins(cache->names, lf + 1, *lf);
+	if (val == NULL || *val != NULL) {
+		return; // Not cached or already cached meanwhile.
+	}
+	*val = knot_dname_copy(hashed, NULL);
+	if (*val == NULL) {
+		(void)trie_del(cache->names, lf + 1, *lf, NULL);
+	}
+}
+
+int nsec3_cache_owner(nsec3_cache_t *cache, uint8_t *out, size_t out_size,
+                      const knot_dname_t *owner, const knot_dname_t *zone_apex,
+                      const dnssec_nsec3_params_t *params)
+{
+	if (cache == NULL || out == NULL || owner == NULL || params == NULL) {
+		return knot_create_nsec3_owner(out, out_size, owner, zone_apex, params);
+	}
+
+	knot_dname_storage_t lf_storage;
+	uint8_t *lf = knot_dname_lf(owner, lf_storage);
+
+	pthread_mutex_lock(&cache->lock);
+	int ret = cache_get(cache, out, out_size, lf, params);
+	pthread_mutex_unlock(&cache->lock);
+	if (ret != KNOT_ENOENT) {
+		return ret;
+	}
+
+	// Hash without the lock held.
+	ret = knot_create_nsec3_owner(out, out_size, owner, zone_apex, params);
+	if (ret != KNOT_EOK) {
+		return ret;
+	}
+
+	pthread_mutex_lock(&cache->lock);
+	cache_put(cache, out, lf, params);
+	pthread_mutex_unlock(&cache->lock);
+
+	return KNOT_EOK;
+}
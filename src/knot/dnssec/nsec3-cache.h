@@ -0,0 +1,80 @@
+/*  Copyright (C) 2020 CZ.NIC, z.s.p.o. <knot-dns@labs.nic.cz>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/*!
+ * \brief Cache of NSEC3 owner names of the zone.
+ *
+ * The cache keeps the NSEC3 owner names hashed during incremental signing of
+ * the zone across the zone updates, so that names changed repeatedly (e.g. by
+ * dynamic updates) are hashed just once. The cache is bound to the NSEC3
+ * parameters, it's emptied when they change or when it gets full.
+ *
+ * \note The cache is locked internally, the zone updates signed from
+ *       the zone events and from the control may use it concurrently.
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "libdnssec/nsec.h"
+#include "libknot/dname.h"
+
+/*! \brief Maximum number of NSEC3 owner names cached per zone. */
+#define NSEC3_CACHE_SIZE 65536
+
+typedef struct nsec3_cache nsec3_cache_t;
+
+/*!
+ * \brief Creates an empty cache.
+ *
+ * \param max_size  Maximum number of cached names.
+ */
+nsec3_cache_t *nsec3_cache_new(size_t max_size);
+
+/*!
+ * \brief Frees the cache.
+ */
+void nsec3_cache_free(nsec3_cache_t *cache);
+
+/*!
+ * \brief Returns the number of cached names.
+ */
+size_t nsec3_cache_size(nsec3_cache_t *cache);
+
+/*!
+ * \brief Compares NSEC3 parameters relevant for the hashing.
+ */
+bool nsec3_params_equal(const dnssec_nsec3_params_t *a,
+                        const dnssec_nsec3_params_t *b);
+
+/*!
+ * \brief Creates NSEC3 owner name from regular owner name, using the cache.
+ *
+ * \param cache      Cache (the name is just hashed if NULL).
+ * \param out        Output buffer.
+ * \param out_size   Size of the output buffer.
+ * \param owner      Node owner name.
+ * \param zone_apex  Zone apex name.
+ * \param params     Params for NSEC3 hashing function.
+ *
+ * \return Error code, KNOT_EOK if successful.
+ */
+int nsec3_cache_owner(nsec3_cache_t *cache, uint8_t *out, size_t out_size,
+                      const knot_dname_t *owner, const knot_dname_t *zone_apex,
+                      const dnssec_nsec3_params_t *params);
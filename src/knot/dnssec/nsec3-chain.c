@@ -18,6 +18,7 @@
 
 #include "libknot/dname.h"
 #include "knot/dnssec/nsec-chain.h"
+#include "knot/dnssec/nsec3-cache.h"
 #include "knot/dnssec/nsec3-chain.h"
 #include "knot/dnssec/zone-sign.h"
 #include "knot/dnssec/zone-nsec.h"
@@ -239,6 +240,7 @@ static zone_node_t *create_nsec3_node(const knot_dname_t *owner,
  * \brief Create new NSEC3 node for given regular node.
  *
  * \param node       Node for which the NSEC3 node is created.
+ * \param owner      NSEC3 owner name (computed if NULL).
  * \param apex       Zone apex node.
  * \param params     NSEC3 hash function parameters.
  * \param ttl        TTL of the new NSEC3 node.
@@ -246,6 +248,7 @@ static zone_node_t *create_nsec3_node(const knot_dname_t *owner,
  * \return Error code, KNOT_EOK if successful.
  */
 static zone_node_t *create_nsec3_node_for_node(const zone_node_t *node,
+                                               const knot_dname_t *owner,
                                                zone_node_t *apex,
                                                const dnssec_nsec3_params_t *params,
                                                uint32_t ttl)
@@ -255,10 +258,13 @@ static zone_node_t *create_nsec3_node_for_node(const zone_node_t *node,
 	assert(params);
 
 	knot_dname_storage_t nsec3_owner;
-	int ret = knot_create_nsec3_owner(nsec3_owner, sizeof(nsec3_owner),
-	                                  node->owner, apex->owner, params);
-	if (ret != KNOT_EOK) {
-		return NULL;
+	if (owner == NULL) {
+		int ret = knot_create_nsec3_owner(nsec3_owner, sizeof(nsec3_owner),
+		                                  node->owner, apex->owner, params);
+		if (ret != KNOT_EOK) {
+			return NULL;
+		}
+		owner = nsec3_owner;
 	}
 
 	dnssec_nsec_bitmap_t *rr_types = dnssec_nsec_bitmap_new();
@@ -274,7 +280,7 @@ static zone_node_t *create_nsec3_node_for_node(const zone_node_t *node,
 		dnssec_nsec_bitmap_add(rr_types, KNOT_RRTYPE_NSEC3PARAM);
 	}
 
-	zone_node_t *nsec3_node = create_nsec3_node(nsec3_owner, params, apex,
+	zone_node_t *nsec3_node = create_nsec3_node(owner, params, apex,
 	                                            rr_types, ttl);
 	dnssec_nsec_bitmap_free(rr_types);
 
@@ -456,7 +462,7 @@ static int create_nsec3_nodes(const zone_contents_t *zone,
 		}
 
 		zone_node_t *nsec3_node;
-		nsec3_node = create_nsec3_node_for_node(node, zone->apex,
+		nsec3_node = create_nsec3_node_for_node(node, NULL, zone->apex,
 							params, ttl);
 		if (!nsec3_node) {
 			result = KNOT_ENOMEM;
@@ -476,6 +482,30 @@ static int create_nsec3_nodes(const zone_contents_t *zone,
 	return result;
 }
 
+/*!
+ * \brief Get the NSEC3 owner name for a changed node, hashing it only if not known.
+ *
+ * The name is taken from the NSEC3 node of the old node, or from the zone's
+ * NSEC3 name cache.
+ */
+static int nsec3_owner_for_node(zone_update_t *update, const dnssec_nsec3_params_t *params,
+                                const knot_dname_t *for_node, const zone_node_t *old_n,
+                                uint8_t *out, size_t out_size)
+{
+	if (old_n != NULL && old_n->nsec3_node != NULL &&
+	    (old_n->flags & NODE_FLAGS_NSEC3_NODE) &&
+	    nsec3_params_equal(&update->zone->contents->nsec3_params, params)) {
+		size_t size = knot_dname_size(old_n->nsec3_node->owner);
+		if (size <= out_size) {
+			memcpy(out, old_n->nsec3_node->owner, size);
+			return KNOT_EOK;
+		}
+	}
+
+	return nsec3_cache_owner(update->zone->nsec3_cache, out, out_size, for_node,
+	                         update->new_cont->apex->owner, params);
+}
+
 /*!
  * \brief For given dname, check if anything changed in zone_update, and recreate (possibly unconnected) NSEC3 nodes appropriately.
  *
@@ -502,8 +532,8 @@ static int fix_nsec3_for_node(zone_update_t *update, const dnssec_nsec3_params_t
 	}
 
 	knot_dname_storage_t for_node_hashed;
-	int ret = knot_create_nsec3_owner(for_node_hashed, sizeof(for_node_hashed),
-	                                  for_node, update->new_cont->apex->owner, params);
+	int ret = nsec3_owner_for_node(update, params, for_node, old_n,
+	                               for_node_hashed, sizeof(for_node_hashed));
 	if (ret != KNOT_EOK) {
 		return ret;
 	}
@@ -531,7 +561,8 @@ static int fix_nsec3_for_node(zone_update_t *update, const dnssec_nsec3_params_t
 
 	// add NSEC3 with correct bitmap
 	if (!shall_no_nsec && ret == KNOT_EOK) {
-		zone_node_t *new_nsec3_n = create_nsec3_node_for_node(new_n, update->new_cont->apex, params, ttl);
+		zone_node_t *new_nsec3_n = create_nsec3_node_for_node(new_n, for_node_hashed,
+		                                                      update->new_cont->apex, params, ttl);
 		if (new_nsec3_n == NULL) {
 			return KNOT_ENOMEM;
 		}
@@ -820,7 +851,12 @@ int knot_nsec3_fix_chain(zone_update_t *update,
 
 	// ensure that nsec3 node for zone root is in list of changed nodes
 	const zone_node_t *nsec3_for_root = NULL, *unused;
-	ret = zone_contents_find_nsec3_for_name(update->new_cont, update->zone->name, &nsec3_for_root, &unused);
+	knot_dname_storage_t root_hashed;
+	ret = nsec3_cache_owner(update->zone->nsec3_cache, root_hashed, sizeof(root_hashed),
+	                        update->zone->name, update->zone->name, params);
+	if (ret == KNOT_EOK) {
+		ret = zone_contents_find_nsec3(update->new_cont, root_hashed, &nsec3_for_root, &unused);
+	}
 	if (ret >= 0) {
 		assert(ret == ZONE_NAME_FOUND);
 		assert(!(nsec3_for_root->flags & NODE_FLAGS_DELETED));
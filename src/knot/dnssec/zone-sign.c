@@ -526,13 +526,11 @@ static int sign_node_rrsets(const zone_node_t *node,
  */
 typedef struct {
 	zone_tree_t *tree;
+	trie_parts_t *parts;
 	zone_sign_ctx_t *sign_ctx;
 	changeset_t changeset;
 	knot_time_t expires_at;
 	dnssec_validation_hint_t *hint;
-	size_t num_threads;
-	size_t thread_index;
-	size_t rrset_index;
 	int errcode;
 	int thread_init_errcode;
 	pthread_t thread;
@@ -555,10 +553,6 @@ static int sign_node(zone_node_t *node, void *data)
 		return KNOT_EOK;
 	}
 
-	if (args->rrset_index++ % args->num_threads != args->thread_index) {
-		return KNOT_EOK;
-	}
-
 	int result = sign_node_rrsets(node, args->sign_ctx,
 	                              &args->changeset, &args->expires_at,
 	                              args->hint);
@@ -569,7 +563,7 @@ static int sign_node(zone_node_t *node, void *data)
 static void *tree_sign_thread(void *_arg)
 {
 	node_sign_args_t *arg = _arg;
-	arg->errcode = zone_tree_apply(arg->tree, sign_node, _arg);
+	arg->errcode = zone_tree_parts_apply(arg->tree, arg->parts, sign_node, _arg);
 	return NULL;
 }
 
@@ -608,9 +602,15 @@ static int zone_tree_sign(zone_tree_t *tree,
 	memset(args, 0, sizeof(args));
 	*expires_at = knot_time_plus(dnssec_ctx->now, dnssec_ctx->policy->rrsig_lifetime);
 
+	trie_parts_t *parts = zone_tree_parts_new(tree, num_threads);
+	if (parts == NULL) {
+		return KNOT_ENOMEM;
+	}
+
 	// init context structures
 	for (size_t i = 0; i < num_threads; i++) {
 		args[i].tree = tree;
+		args[i].parts = parts;
 		args[i].sign_ctx = dnssec_ctx->validation_mode
 		                 ? zone_validation_ctx(dnssec_ctx)
 		                 : zone_sign_ctx(zone_keys, dnssec_ctx);
@@ -624,9 +624,6 @@ static int zone_tree_sign(zone_tree_t *tree,
 		}
 		args[i].expires_at = 0;
 		args[i].hint = &update->validation_hint;
-		args[i].num_threads = num_threads;
-		args[i].thread_index = i;
-		args[i].rrset_index = 0;
 		args[i].errcode = KNOT_EOK;
 		args[i].thread_init_errcode = -1;
 	}
@@ -635,6 +632,7 @@ static int zone_tree_sign(zone_tree_t *tree,
 			changeset_clear(&args[i].changeset);
 			zone_sign_ctx_free(args[i].sign_ctx);
 		}
+		trie_parts_free(parts);
 		return ret;
 	}
 
@@ -674,6 +672,8 @@ static int zone_tree_sign(zone_tree_t *tree,
 		zone_sign_ctx_free(args[i].sign_ctx);
 	}
 
+	trie_parts_free(parts);
+
 	return ret;
 }
 
@@ -114,6 +114,8 @@ struct refresh_data {
 
 	struct {
 		zone_contents_t *zone;    //!< AXFR result, new zone.
+		zone_adjust_stream_t adjust; //!< Adjusting the zone while received.
+		journal_zone_stream_t *journal; //!< Zone-in-journal written while received.
 	} axfr;
 
 	struct {
@@ -192,11 +194,34 @@ static int axfr_init(struct refresh_data *data)
 	}
 
 	data->axfr.zone = new_zone;
+
+	// Signing changes the zone after the transfer, nothing to do in advance.
+	conf_val_t val = conf_zone_get(data->conf, C_DNSSEC_SIGNING, data->zone->name);
+	if (conf_bool(&val)) {
+		return KNOT_EOK;
+	}
+
+	zone_adjust_stream_init(&data->axfr.adjust, new_zone);
+
+	val = conf_zone_get(data->conf, C_JOURNAL_CONTENT, data->zone->name);
+	if (conf_opt(&val) == JOURNAL_CONTENT_ALL &&
+	    journal_zone_stream_begin(zone_journal(data->zone), &data->axfr.journal) != KNOT_EOK) {
+		data->axfr.journal = NULL; // The zone is stored at once on commit.
+	}
+
 	return KNOT_EOK;
 }
 
+static void axfr_stream_cancel(struct refresh_data *data)
+{
+	zone_adjust_stream_cancel(&data->axfr.adjust);
+	journal_zone_stream_free(data->axfr.journal);
+	data->axfr.journal = NULL;
+}
+
 static void axfr_cleanup(struct refresh_data *data)
 {
+	axfr_stream_cancel(data);
 	zone_contents_deep_free(data->axfr.zone);
 	data->axfr.zone = NULL;
 }
@@ -238,13 +263,20 @@ static int axfr_finalize(struct refresh_data *data)
 		axfr_slave_sign_serial(new_zone, data->zone, data->conf, &master_serial);
 	}
 
+	zone_update_flags_t flags = UPDATE_FULL;
+	if (!dnssec_enable && zone_adjust_stream_finish(&data->axfr.adjust) == KNOT_EOK) {
+		flags |= UPDATE_ADJUSTED;
+	}
+
 	zone_update_t up = { 0 };
-	int ret = zone_update_from_contents(&up, data->zone, new_zone, UPDATE_FULL);
+	int ret = zone_update_from_contents(&up, data->zone, new_zone, flags);
 	if (ret != KNOT_EOK) {
 		return ret;
 	}
 	// Seized by zone_update. Don't free the contents again in axfr_cleanup.
 	data->axfr.zone = NULL;
+	// Still freed in axfr_cleanup.
+	up.zij_stream = data->axfr.journal;
 
 	ret = zone_update_semcheck(&up);
 	if (ret != KNOT_EOK) {
@@ -308,6 +340,19 @@ static int axfr_consume_rr(const knot_rrset_t *rr, struct refresh_data *data)
 		return KNOT_STATE_FAIL;
 	}
 
+	if (zc.node == NULL) {
+		// Record not added as it is, the zone must be processed at once.
+		axfr_stream_cancel(data);
+	} else {
+		zone_adjust_stream_node(&data->axfr.adjust, zc.node,
+		                        knot_rrset_is_nsec3rel(rr));
+		if (data->axfr.journal != NULL &&
+		    journal_zone_stream_add(data->axfr.journal, rr) != KNOT_EOK) {
+			journal_zone_stream_free(data->axfr.journal);
+			data->axfr.journal = NULL;
+		}
+	}
+
 	data->change_size += knot_rrset_size(rr);
 	if (data->change_size > data->max_zone_size) {
 		AXFRIN_LOG(LOG_WARNING, data->zone->name, data->remote,
@@ -394,6 +394,7 @@ typedef enum {
 	KNOTD_QUERY_FLAG_NO_IXFR    = 1 << 1, /*!< Don't process IXFR. */
 	KNOTD_QUERY_FLAG_LIMIT_SIZE = 1 << 2, /*!< Apply UDP size limit. */
 	KNOTD_QUERY_FLAG_COOKIE     = 1 << 3, /*!< Valid DNS Cookie indication. */
+	KNOTD_QUERY_FLAG_XFR_LIMIT  = 1 << 4, /*!< Refuse authorized transfers (over the limit). */
 } knotd_query_flag_t;
 
 /*! Query processing data context parameters. */
@@ -404,6 +405,7 @@ typedef struct {
 	unsigned thread_id;                    /*!< Current thread id. */
 	void *server;                          /*!< Server object private item. */
 	struct knot_xdp_msg *xdp_msg;          /*!< Possible XDP message context. */
+	const struct sockaddr_storage *local;  /*!< Current local address (optional). */
 } knotd_qdata_params_t;
 
 /*! Query processing data context. */
@@ -14,6 +14,10 @@
     along with this program.  If not, see <https://www.gnu.org/licenses/>.
  */
 
+#ifdef HAVE_ZLIB
+#include <zlib.h>
+#endif
+
 #include "knot/journal/journal_basic.h"
 
 #include "knot/conf/conf.h"
@@ -38,11 +42,13 @@ MDB_val journal_changeset_to_chunk_key(const changeset_t *ch, uint32_t chunk_id)
 	}
 }
 
-void journal_make_header(void *chunk, uint32_t ch_serial_to)
+void journal_make_header(void *chunk, uint32_t ch_serial_to, uint32_t flags,
+                         uint32_t size)
 {
-	knot_lmdb_make_key_part(chunk, JOURNAL_HEADER_SIZE, "IILLL", ch_serial_to,
+	knot_lmdb_make_key_part(chunk, JOURNAL_HEADER_SIZE, "IIIILL", ch_serial_to,
 	                        (uint32_t)0 /* we no longer care for # of chunks */,
-	                        (uint64_t)0, (uint64_t)0, (uint64_t)0);
+	                        flags, (flags & JOURNAL_CHUNK_COMPRESSED) ? size : 0,
+	                        (uint64_t)0, (uint64_t)0);
 }
 
 uint32_t journal_next_serial(const MDB_val *chunk)
@@ -50,6 +56,57 @@ uint32_t journal_next_serial(const MDB_val *chunk)
 	return be32toh(*(uint32_t *)chunk->mv_data);
 }
 
+uint32_t journal_chunk_flags(const MDB_val *chunk)
+{
+	return be32toh(*((uint32_t *)chunk->mv_data + 2));
+}
+
+uint32_t journal_chunk_raw_size(const MDB_val *chunk)
+{
+	return be32toh(*((uint32_t *)chunk->mv_data + 3));
+}
+
+int journal_chunk_compress(uint8_t *dst, size_t *dst_size,
+                           const uint8_t *src, size_t src_size)
+{
+#ifdef HAVE_ZLIB
+	uLongf size = *dst_size;
+	int ret = compress2(dst, &size, src, src_size, Z_BEST_SPEED);
+	switch (ret) {
+	case Z_OK:
+		*dst_size = size;
+		return KNOT_EOK;
+	case Z_BUF_ERROR:
+		return KNOT_ESPACE;
+	case Z_MEM_ERROR:
+		return KNOT_ENOMEM;
+	default:
+		return KNOT_ERROR;
+	}
+#else
+	return KNOT_ENOTSUP;
+#endif
+}
+
+int journal_chunk_decompress(uint8_t *dst, size_t dst_size,
+                             const uint8_t *src, size_t src_size)
+{
+#ifdef HAVE_ZLIB
+	uLongf size = dst_size;
+	int ret = uncompress(dst, &size, src, src_size);
+	switch (ret) {
+	case Z_OK:
+		return (size == dst_size) ? KNOT_EOK : KNOT_EMALF;
+	case Z_MEM_ERROR:
+		return KNOT_ENOMEM;
+	default:
+		return KNOT_EMALF;
+	}
+#else
+	return KNOT_ENOTSUP;
+#endif
+}
+
 bool journal_serial_to(knot_lmdb_txn_t *txn, bool zij, uint32_t serial,
                        const knot_dname_t *zone, uint32_t *serial_to)
 {
@@ -77,6 +134,12 @@ size_t journal_conf_max_usage(zone_journal_t j)
 	return conf_int(&val);
 }
 
+bool journal_conf_compression(zone_journal_t j)
+{
+	conf_val_t val = conf_zone_get(conf(), C_JOURNAL_COMPRESSION, j.zone);
+	return conf_bool(&val);
+}
+
 size_t journal_conf_max_changesets(zone_journal_t j)
 {
 	conf_val_t val = conf_zone_get(conf(), C_JOURNAL_MAX_DEPTH, j.zone);
@@ -29,11 +29,19 @@ typedef struct {
 #define JOURNAL_CHUNK_MAX (70 * 1024)
 #define JOURNAL_HEADER_SIZE (32)
 
-/*! \brief Convert journal_mode to LMDB environment flags. */
+/*! \brief Chunk header flag: the chunk payload is compressed. */
+#define JOURNAL_CHUNK_COMPRESSED (1 << 0)
+
+/*!
+ * \brief Convert journal_mode to LMDB environment flags.
+ *
+ * \note Read transactions aren't bound to threads (MDB_NOTLS) as outgoing
+ *       IXFRs interleaved in one TCP worker keep their own ones open.
+ */
 inline static unsigned journal_env_flags(int journal_mode, bool readonly)
 {
 	return (journal_mode == JOURNAL_MODE_ASYNC ? (MDB_WRITEMAP | MDB_MAPASYNC) : 0) |
-	       (readonly ? MDB_RDONLY : 0);
+	       (readonly ? MDB_RDONLY : 0) | MDB_NOTLS;
 }
 
 /*!
@@ -62,8 +70,11 @@ MDB_val journal_changeset_to_chunk_key(const changeset_t *ch, uint32_t chunk_id)
  *
  * \param chunk   Pointer to the changeset chunk. It must be at least JOURNAL_HEADER_SIZE, perhaps more.
  * \param ch      Serial-to of the changeset being serialized.
+ * \param flags   Chunk flags (JOURNAL_CHUNK_*).
+ * \param size    Uncompressed payload size if compressed, otherwise ignored.
  */
-void journal_make_header(void *chunk, uint32_t ch_serial_to);
+void journal_make_header(void *chunk, uint32_t ch_serial_to, uint32_t flags,
+                         uint32_t size);
 
 /*!
  * \brief Obtain serial-to of the serialized changeset.
@@ -74,6 +85,45 @@ void journal_make_header(void *chunk, uint32_t ch_serial_to);
  */
 uint32_t journal_next_serial(const MDB_val *chunk);
 
+/*!
+ * \brief Obtain flags (JOURNAL_CHUNK_*) of the chunk.
+ */
+uint32_t journal_chunk_flags(const MDB_val *chunk);
+
+/*!
+ * \brief Obtain uncompressed payload size of a compressed chunk.
+ */
+uint32_t journal_chunk_raw_size(const MDB_val *chunk);
+
+/*!
+ * \brief Compress chunk payload.
+ *
+ * \param dst        Output buffer.
+ * \param dst_size   In: output buffer size, out: compressed size.
+ * \param src        Payload to be compressed.
+ * \param src_size   Payload size.
+ *
+ * \retval KNOT_ENOTSUP if built without compression support.
+ * \retval KNOT_ESPACE if the payload doesn't fit into the output buffer.
+ * \return KNOT_E*
+ */
+int journal_chunk_compress(uint8_t *dst, size_t *dst_size,
+                           const uint8_t *src, size_t src_size);
+
+/*!
+ * \brief Decompress chunk payload.
+ *
+ * \param dst        Output buffer.
+ * \param dst_size   Expected uncompressed size.
+ * \param src        Compressed payload.
+ * \param src_size   Compressed payload size.
+ *
+ * \retval KNOT_ENOTSUP if built without compression support.
+ * \return KNOT_E*
+ */
+int journal_chunk_decompress(uint8_t *dst, size_t dst_size,
+                             const uint8_t *src, size_t src_size);
+
 /*!
  * \brief Obtain serial-to of a changeset stored in journal.
  *
@@ -100,5 +150,8 @@ bool journal_allow_flush(zone_journal_t j);
 /*! \brief Return configured maximal per-zone usage of journal DB. */
 size_t journal_conf_max_usage(zone_journal_t j);
 
+/*! \brief Return true if the zone's journal chunks shall be compressed. */
+bool journal_conf_compression(zone_journal_t j);
+
 /*! \brief Return configured maximal depth of journal. */
 size_t journal_conf_max_changesets(zone_journal_t j);
@@ -32,6 +32,7 @@ struct journal_read {
 	const knot_dname_t *zone;
 	wire_ctx_t wire;
 	uint32_t next;
+	uint8_t *buf; // Decompressed chunk payload.
 };
 
 int journal_read_get_error(const journal_read_t *ctx, int another_error)
@@ -39,10 +40,29 @@ int journal_read_get_error(const journal_read_t *ctx, int another_error)
 	return (ctx == NULL || ctx->txn.ret == KNOT_EOK ? another_error : ctx->txn.ret);
 }
 
-static void update_ctx_wire(journal_read_t *ctx)
+static bool update_ctx_wire(journal_read_t *ctx)
 {
-	ctx->wire = wire_ctx_init_const(ctx->txn.cur_val.mv_data, ctx->txn.cur_val.mv_size);
-	wire_ctx_skip(&ctx->wire, JOURNAL_HEADER_SIZE);
+	const MDB_val *chunk = &ctx->txn.cur_val;
+	if (!(journal_chunk_flags(chunk) & JOURNAL_CHUNK_COMPRESSED)) {
+		ctx->wire = wire_ctx_init_const(chunk->mv_data, chunk->mv_size);
+		wire_ctx_skip(&ctx->wire, JOURNAL_HEADER_SIZE);
+		return true;
+	}
+
+	uint32_t size = journal_chunk_raw_size(chunk);
+	if (size == 0 || size > JOURNAL_CHUNK_MAX - JOURNAL_HEADER_SIZE) {
+		ctx->txn.ret = KNOT_EMALF;
+		return false;
+	}
+	if (ctx->buf == NULL && (ctx->buf = malloc(JOURNAL_CHUNK_MAX)) == NULL) {
+		ctx->txn.ret = KNOT_ENOMEM;
+		return false;
+	}
+	ctx->txn.ret = journal_chunk_decompress(ctx->buf, size,
+	                                        chunk->mv_data + JOURNAL_HEADER_SIZE,
+	                                        chunk->mv_size - JOURNAL_HEADER_SIZE);
+	ctx->wire = wire_ctx_init_const(ctx->buf, size);
+	return ctx->txn.ret == KNOT_EOK;
 }
 
 static bool go_next_changeset(journal_read_t *ctx, bool go_zone, const knot_dname_t *zone)
@@ -57,8 +77,7 @@ static bool go_next_changeset(journal_read_t *ctx, bool go_zone, const knot_dnam
 		return false;
 	}
 	ctx->next = journal_next_serial(&ctx->txn.cur_val);
-	update_ctx_wire(ctx);
-	return true;
+	return update_ctx_wire(ctx);
 }
 
 int journal_read_begin(zone_journal_t j, bool read_zone, uint32_t serial_from, journal_read_t **ctx)
@@ -82,8 +101,10 @@ int journal_read_begin(zone_journal_t j, bool read_zone, uint32_t serial_from, j
 		*ctx = newctx;
 		return KNOT_EOK;
 	} else {
+		// Unreadable chunk is an error, missing or looping changeset is not.
+		int ret = newctx->txn.ret;
 		journal_read_end(newctx);
-		return KNOT_ENOENT;
+		return (ret == KNOT_EOK || ret == KNOT_ELOOP) ? KNOT_ENOENT : ret;
 	}
 }
 
@@ -92,6 +113,7 @@ void journal_read_end(journal_read_t *ctx)
 	if (ctx != NULL) {
 		free(ctx->key_prefix.mv_data);
 		knot_lmdb_abort(&ctx->txn);
+		free(ctx->buf);
 		free(ctx);
 	}
 }
@@ -105,7 +127,7 @@ static bool make_data_available(journal_read_t *ctx)
 		if (!knot_lmdb_is_prefix_of(&ctx->key_prefix, &ctx->txn.cur_key)) {
 			return false;
 		}
-		update_ctx_wire(ctx);
+		return update_ctx_wire(ctx);
 	}
 	return true;
 }
@@ -21,41 +21,98 @@
 #include "knot/journal/journal_read.h"
 #include "knot/journal/serialization.h"
 #include "libknot/error.h"
+#include "libknot/rrtype/soa.h"
 
-static void journal_write_serialize(knot_lmdb_txn_t *txn, serialize_ctx_t *ser, const changeset_t *ch, uint32_t ch_serial_to)
+/*! \brief Compression buffers, allocated only if the compression is enabled. */
+typedef struct {
+	uint8_t *raw;
+	uint8_t *out;
+	size_t out_size;
+} compress_buf_t;
+
+static bool compress_buf_init(compress_buf_t *buf, bool enabled)
+{
+	memset(buf, 0, sizeof(*buf));
+	if (!enabled) {
+		return true;
+	}
+	// Incompressible data would expand slightly, such chunks are stored raw.
+	buf->out_size = JOURNAL_CHUNK_MAX - JOURNAL_HEADER_SIZE;
+	buf->raw = malloc(JOURNAL_CHUNK_MAX);
+	buf->out = malloc(buf->out_size);
+	return buf->raw != NULL && buf->out != NULL;
+}
+
+static void compress_buf_deinit(compress_buf_t *buf)
 {
+	free(buf->raw);
+	free(buf->out);
+}
+
+static void journal_write_serialize(knot_lmdb_txn_t *txn, serialize_ctx_t *ser,
+                                    const changeset_t *ch, uint32_t ch_serial_to,
+                                    bool compress)
+{
+	compress_buf_t buf;
+	if (!compress_buf_init(&buf, compress && txn->ret == KNOT_EOK)) {
+		compress_buf_deinit(&buf);
+		serialize_deinit(ser);
+		txn->ret = KNOT_ENOMEM;
+		return;
+	}
+
 	MDB_val chunk;
 	uint32_t i = 0;
 	while (serialize_unfinished(ser) && txn->ret == KNOT_EOK) {
-		serialize_prepare(ser, JOURNAL_CHUNK_MAX - JOURNAL_HEADER_SIZE, &chunk.mv_size);
-		if (chunk.mv_size == 0) {
+		size_t raw_size;
+		serialize_prepare(ser, JOURNAL_CHUNK_MAX - JOURNAL_HEADER_SIZE, &raw_size);
+		if (raw_size == 0) {
 			break; // beware! If this is ommited, it creates empty chunk => EMALF when reading.
 		}
+		uint32_t flags = 0;
+		chunk.mv_size = raw_size;
+		if (buf.raw != NULL) {
+			serialize_chunk(ser, buf.raw, raw_size);
+			size_t comp_size = MIN(raw_size - 1, buf.out_size);
+			if (journal_chunk_compress(buf.out, &comp_size, buf.raw, raw_size) == KNOT_EOK) {
+				flags |= JOURNAL_CHUNK_COMPRESSED;
+				chunk.mv_size = comp_size;
+			}
+		}
 		chunk.mv_size += JOURNAL_HEADER_SIZE;
 		chunk.mv_data = NULL;
 		MDB_val key = journal_changeset_to_chunk_key(ch, i);
 		if (knot_lmdb_insert(txn, &key, &chunk)) {
-			journal_make_header(chunk.mv_data, ch_serial_to);
-			serialize_chunk(ser, chunk.mv_data + JOURNAL_HEADER_SIZE, chunk.mv_size - JOURNAL_HEADER_SIZE);
+			uint8_t *payload = chunk.mv_data + JOURNAL_HEADER_SIZE;
+			size_t payload_size = chunk.mv_size - JOURNAL_HEADER_SIZE;
+			journal_make_header(chunk.mv_data, ch_serial_to, flags, raw_size);
+			if (flags & JOURNAL_CHUNK_COMPRESSED) {
+				memcpy(payload, buf.out, payload_size);
+			} else if (buf.raw != NULL) {
+				memcpy(payload, buf.raw, payload_size);
+			} else {
+				serialize_chunk(ser, payload, payload_size);
+			}
 		}
 		free(key.mv_data);
 		i++;
 	}
+	compress_buf_deinit(&buf);
 	serialize_deinit(ser);
 	// return value is in the txn
 }
 
-void journal_write_changeset(knot_lmdb_txn_t *txn, const changeset_t *ch)
+void journal_write_changeset(knot_lmdb_txn_t *txn, const changeset_t *ch, bool compress)
 {
 	serialize_ctx_t *ser = serialize_init(ch);
 	if (ser == NULL) {
 		txn->ret = KNOT_ENOMEM;
 		return;
 	}
-	journal_write_serialize(txn, ser, ch, changeset_to(ch));
+	journal_write_serialize(txn, ser, ch, changeset_to(ch), compress);
 }
 
-void journal_write_zone(knot_lmdb_txn_t *txn, const zone_contents_t *z)
+void journal_write_zone(knot_lmdb_txn_t *txn, const zone_contents_t *z, bool compress)
 {
 	serialize_ctx_t *ser = serialize_zone_init(z);
 	if (ser == NULL) {
@@ -65,7 +122,7 @@ void journal_write_zone(knot_lmdb_txn_t *txn, const zone_contents_t *z)
 	changeset_t fake_ch;
 	fake_ch.soa_from = NULL;
 	fake_ch.add = (zone_contents_t *)z;
-	journal_write_serialize(txn, ser, &fake_ch, zone_contents_serial(z));
+	journal_write_serialize(txn, ser, &fake_ch, zone_contents_serial(z), compress);
 }
 
 static int merge_cb(bool remove, const knot_rrset_t *rr, void *ctx)
@@ -90,7 +147,7 @@ void journal_merge(zone_journal_t j, knot_lmdb_txn_t *txn, bool merge_zij,
 		*original_serial_to = changeset_to(&merge);
 	}
 	txn->ret = journal_read_rrsets(read, merge_cb, &merge);
-	journal_write_changeset(txn, &merge);
+	journal_write_changeset(txn, &merge, journal_conf_compression(j));
 	//knot_rrset_clear(&rr, NULL);
 	journal_read_clear_changeset(&merge);
 }
@@ -214,7 +271,7 @@ int journal_insert_zone(zone_journal_t j, const zone_contents_t *z)
 	MDB_val prefix = { knot_dname_size(j.zone), (void *)j.zone };
 	knot_lmdb_del_prefix(&txn, &prefix);
 
-	journal_write_zone(&txn, z);
+	journal_write_zone(&txn, z, journal_conf_compression(j));
 
 	journal_metadata_t md = { 0 };
 	md.flags = JOURNAL_SERIAL_TO_VALID;
@@ -226,67 +283,333 @@ int journal_insert_zone(zone_journal_t j, const zone_contents_t *z)
 	return txn.ret;
 }
 
-int journal_insert(zone_journal_t j, const changeset_t *ch, const changeset_t *extra)
+/*! \brief Count of chunks written to DB by one write transaction while streaming. */
+#define JOURNAL_STREAM_BATCH 16
+
+struct journal_zone_stream {
+	zone_journal_t j;
+	uint32_t serial;         // Serial of the SOA written first.
+	uint8_t *raw;            // Payload of the chunk being filled.
+	size_t used;
+	uint8_t *out;            // Compression output, NULL if compression disabled.
+	MDB_val pending[JOURNAL_STREAM_BATCH]; // Complete chunks not written yet.
+	unsigned npending;
+	uint32_t chunks;         // Count of complete chunks.
+	bool staged;             // Some chunks may have been written to DB.
+	int ret;
+};
+
+static MDB_val stream_chunk_key(const knot_dname_t *zone, bool staged, uint32_t chunk_id)
 {
-	size_t ch_size = changeset_serialized_size(ch);
-	size_t max_usage = journal_conf_max_usage(j);
-	if (ch_size >= max_usage) {
-		return KNOT_ESPACE;
+	return knot_lmdb_make_key("NISI", zone, (uint32_t)0,
+	                          staged ? "incoming" : "bootstrap", chunk_id);
+}
+
+static void stream_del_staged(knot_lmdb_txn_t *txn, const knot_dname_t *zone)
+{
+	MDB_val prefix = knot_lmdb_make_key("NIS", zone, (uint32_t)0, "incoming");
+	if (prefix.mv_data == NULL) {
+		txn->ret = KNOT_ENOMEM;
+		return;
 	}
-	if (extra != NULL && (changeset_to(extra) != changeset_to(ch) ||
-	     changeset_from(extra) == changeset_from(ch))) {
-		return KNOT_EINVAL;
+	knot_lmdb_del_prefix(txn, &prefix);
+	free(prefix.mv_data);
+}
+
+static void stream_write_pending(journal_zone_stream_t *ctx, knot_lmdb_txn_t *txn)
+{
+	if (!ctx->staged) {
+		// Leftover of an interrupted transfer.
+		stream_del_staged(txn, ctx->j.zone);
+		ctx->staged = true;
+	}
+
+	uint32_t chunk_id = ctx->chunks - ctx->npending;
+	for (unsigned i = 0; i < ctx->npending; i++) {
+		MDB_val key = stream_chunk_key(ctx->j.zone, true, chunk_id + i);
+		MDB_val chunk = { ctx->pending[i].mv_size, NULL };
+		if (knot_lmdb_insert(txn, &key, &chunk)) {
+			memcpy(chunk.mv_data, ctx->pending[i].mv_data, chunk.mv_size);
+		}
+		free(key.mv_data);
+		free(ctx->pending[i].mv_data);
+		ctx->pending[i].mv_data = NULL;
+	}
+	ctx->npending = 0;
+}
+
+static void stream_flush(journal_zone_stream_t *ctx)
+{
+	knot_lmdb_txn_t txn = { 0 };
+	knot_lmdb_begin(ctx->j.db, &txn, true);
+	stream_write_pending(ctx, &txn);
+	knot_lmdb_commit(&txn);
+	ctx->ret = txn.ret;
+}
+
+static void stream_finish_chunk(journal_zone_stream_t *ctx)
+{
+	uint32_t flags = 0;
+	const uint8_t *payload = ctx->raw;
+	size_t payload_size = ctx->used;
+	if (ctx->out != NULL) {
+		size_t comp_size = MIN(ctx->used - 1, JOURNAL_CHUNK_MAX - JOURNAL_HEADER_SIZE);
+		if (journal_chunk_compress(ctx->out, &comp_size, ctx->raw, ctx->used) == KNOT_EOK) {
+			flags |= JOURNAL_CHUNK_COMPRESSED;
+			payload = ctx->out;
+			payload_size = comp_size;
+		}
+	}
+
+	MDB_val *chunk = &ctx->pending[ctx->npending];
+	chunk->mv_size = JOURNAL_HEADER_SIZE + payload_size;
+	chunk->mv_data = malloc(chunk->mv_size);
+	if (chunk->mv_data == NULL) {
+		ctx->ret = KNOT_ENOMEM;
+		return;
 	}
+	journal_make_header(chunk->mv_data, ctx->serial, flags, ctx->used);
+	memcpy((uint8_t *)chunk->mv_data + JOURNAL_HEADER_SIZE, payload, payload_size);
+
+	ctx->npending++;
+	ctx->chunks++;
+	ctx->used = 0;
+
+	if (ctx->npending == JOURNAL_STREAM_BATCH) {
+		stream_flush(ctx);
+	}
+}
+
+int journal_zone_stream_begin(zone_journal_t j, journal_zone_stream_t **out)
+{
 	int ret = knot_lmdb_open(j.db);
 	if (ret != KNOT_EOK) {
 		return ret;
 	}
+
+	journal_zone_stream_t *ctx = calloc(1, sizeof(*ctx));
+	if (ctx == NULL) {
+		return KNOT_ENOMEM;
+	}
+	ctx->j = j;
+	// The buffer is reused for moving whole chunks when published.
+	ctx->raw = malloc(JOURNAL_CHUNK_MAX);
+	if (journal_conf_compression(j)) {
+		ctx->out = malloc(JOURNAL_CHUNK_MAX - JOURNAL_HEADER_SIZE);
+		if (ctx->out == NULL) {
+			free(ctx->raw);
+			ctx->raw = NULL;
+		}
+	}
+	if (ctx->raw == NULL) {
+		free(ctx);
+		return KNOT_ENOMEM;
+	}
+
+	*out = ctx;
+	return KNOT_EOK;
+}
+
+int journal_zone_stream_add(journal_zone_stream_t *ctx, const knot_rrset_t *rr)
+{
+	if (ctx->ret != KNOT_EOK) {
+		return ctx->ret;
+	}
+
+	bool first = (ctx->chunks == 0 && ctx->used == 0);
+	if (first != (rr->type == KNOT_RRTYPE_SOA)) {
+		ctx->ret = KNOT_EMALF;
+		return ctx->ret;
+	} else if (first) {
+		ctx->serial = knot_soa_serial(rr->rrs.rdata);
+	}
+
+	const size_t max_size = JOURNAL_CHUNK_MAX - JOURNAL_HEADER_SIZE;
+	size_t size = rrset_serialized_size(rr);
+	if (size > max_size) {
+		ctx->ret = KNOT_ESPACE;
+		return ctx->ret;
+	}
+	if (ctx->used + size > max_size) {
+		stream_finish_chunk(ctx);
+		if (ctx->ret != KNOT_EOK) {
+			return ctx->ret;
+		}
+	}
+
+	wire_ctx_t wire = wire_ctx_init(ctx->raw + ctx->used, size);
+	ctx->ret = serialize_rrset(&wire, rr);
+	ctx->used += size;
+
+	return ctx->ret;
+}
+
+int journal_zone_stream_publish(journal_zone_stream_t *ctx, const zone_contents_t *z)
+{
+	if (ctx->ret == KNOT_EOK && ctx->serial != zone_contents_serial(z)) {
+		ctx->ret = KNOT_ESEMCHECK;
+	}
+	if (ctx->ret == KNOT_EOK && ctx->used > 0) {
+		stream_finish_chunk(ctx);
+	}
+	if (ctx->ret != KNOT_EOK) {
+		return ctx->ret;
+	}
+
 	knot_lmdb_txn_t txn = { 0 };
+	knot_lmdb_begin(ctx->j.db, &txn, true);
+	stream_write_pending(ctx, &txn);
+
+	update_last_inserter(&txn, ctx->j.zone);
+
+	// Drop anything of the zone but the records just written.
+	MDB_val prefix = { knot_dname_size(ctx->j.zone), (void *)ctx->j.zone };
+	MDB_val staged = knot_lmdb_make_key("NIS", ctx->j.zone, (uint32_t)0, "incoming");
+	if (staged.mv_data == NULL) {
+		txn.ret = KNOT_ENOMEM;
+	}
+	knot_lmdb_foreach(&txn, &prefix) {
+		if (!knot_lmdb_is_prefix_of(&staged, &txn.cur_key)) {
+			knot_lmdb_del_cur(&txn);
+		}
+	}
+	free(staged.mv_data);
+
+	// Turn them into the zone-in-journal, the chunks are moved as they are.
+	for (uint32_t i = 0; i < ctx->chunks && txn.ret == KNOT_EOK; i++) {
+		MDB_val from = stream_chunk_key(ctx->j.zone, true, i);
+		MDB_val to = stream_chunk_key(ctx->j.zone, false, i);
+		if (knot_lmdb_find(&txn, &from, KNOT_LMDB_EXACT | KNOT_LMDB_FORCE)) {
+			MDB_val chunk = { txn.cur_val.mv_size, NULL };
+			memcpy(ctx->raw, txn.cur_val.mv_data, chunk.mv_size);
+			knot_lmdb_del_cur(&txn);
+			if (knot_lmdb_insert(&txn, &to, &chunk)) {
+				memcpy(chunk.mv_data, ctx->raw, chunk.mv_size);
+			}
+		}
+		free(from.mv_data);
+		free(to.mv_data);
+	}
+
 	journal_metadata_t md = { 0 };
-	knot_lmdb_begin(j.db, &txn, true);
-	journal_load_metadata(&txn, j.zone, &md);
+	md.flags = JOURNAL_SERIAL_TO_VALID;
+	md.serial_to = ctx->serial;
+	md.first_serial = md.serial_to;
+	journal_store_metadata(&txn, ctx->j.zone, &md);
 
-	update_last_inserter(&txn, j.zone);
+	knot_lmdb_commit(&txn);
+	if (txn.ret == KNOT_EOK) {
+		ctx->staged = false;
+	}
+	ctx->ret = txn.ret;
+	return txn.ret;
+}
+
+void journal_zone_stream_free(journal_zone_stream_t *ctx)
+{
+	if (ctx == NULL) {
+		return;
+	}
+
+	if (ctx->staged) {
+		knot_lmdb_txn_t txn = { 0 };
+		knot_lmdb_begin(ctx->j.db, &txn, true);
+		stream_del_staged(&txn, ctx->j.zone);
+		knot_lmdb_commit(&txn);
+	}
+
+	for (unsigned i = 0; i < ctx->npending; i++) {
+		free(ctx->pending[i].mv_data);
+	}
+	free(ctx->raw);
+	free(ctx->out);
+	free(ctx);
+}
+
+typedef struct {
+	zone_journal_t j;
+	const changeset_t *ch;
+	const changeset_t *extra;
+	size_t ch_size;
+	size_t max_usage;
+} insert_ctx_t;
+
+static void journal_insert_txn(knot_lmdb_txn_t *txn, void *ctx)
+{
+	insert_ctx_t *ins = ctx;
+	zone_journal_t j = ins->j;
+	const changeset_t *ch = ins->ch, *extra = ins->extra;
+	size_t ch_size = ins->ch_size;
+
+	journal_metadata_t md = { 0 };
+	journal_load_metadata(txn, j.zone, &md);
+
+	update_last_inserter(txn, j.zone);
 
 	if (extra != NULL) {
-		if (journal_contains(&txn, true, 0, j.zone)) {
-			txn.ret = KNOT_ESEMCHECK;
+		if (journal_contains(txn, true, 0, j.zone)) {
+			txn->ret = KNOT_ESEMCHECK;
 		}
 		uint64_t merged_freed = 0;
-		delete_merged(&txn, j.zone, &md, &merged_freed);
+		delete_merged(txn, j.zone, &md, &merged_freed);
 		ch_size += changeset_serialized_size(extra);
 		ch_size -= merged_freed;
 		md.flushed_upto = md.serial_to; // set temporarily
 		md.flags |= JOURNAL_LAST_FLUSHED_VALID;
 	}
 
-	journal_fix_occupation(j, &txn, &md, max_usage - ch_size, journal_conf_max_changesets(j) - 1);
+	journal_fix_occupation(j, txn, &md, ins->max_usage - ch_size, journal_conf_max_changesets(j) - 1);
 
 	// avoid discontinuity
 	if ((md.flags & JOURNAL_SERIAL_TO_VALID) && md.serial_to != changeset_from(ch)) {
-		if (journal_contains(&txn, true, 0, j.zone)) {
-			txn.ret = KNOT_ESEMCHECK;
+		if (journal_contains(txn, true, 0, j.zone)) {
+			txn->ret = KNOT_ESEMCHECK;
 		} else {
 			MDB_val prefix = { knot_dname_size(j.zone), (void *)j.zone };
-			knot_lmdb_del_prefix(&txn, &prefix);
+			knot_lmdb_del_prefix(txn, &prefix);
 			memset(&md, 0, sizeof(md));
 		}
 	}
 
 	// avoid cycle
-	if (journal_contains(&txn, false, changeset_to(ch), j.zone)) {
-		journal_fix_occupation(j, &txn, &md, INT64_MAX, 1);
+	if (journal_contains(txn, false, changeset_to(ch), j.zone)) {
+		journal_fix_occupation(j, txn, &md, INT64_MAX, 1);
 	}
 
-	journal_write_changeset(&txn, ch);
+	bool compress = journal_conf_compression(j);
+	journal_write_changeset(txn, ch, compress);
 	journal_metadata_after_insert(&md, changeset_from(ch), changeset_to(ch));
 
 	if (extra != NULL) {
-		journal_write_changeset(&txn, extra);
+		journal_write_changeset(txn, extra, compress);
 		journal_metadata_after_extra(&md, changeset_from(extra), changeset_to(extra));
 	}
 
-	journal_store_metadata(&txn, j.zone, &md);
-	knot_lmdb_commit(&txn);
-	return txn.ret;
+	journal_store_metadata(txn, j.zone, &md);
+}
+
+int journal_insert(zone_journal_t j, const changeset_t *ch, const changeset_t *extra)
+{
+	size_t ch_size = changeset_serialized_size(ch);
+	size_t max_usage = journal_conf_max_usage(j);
+	if (ch_size >= max_usage) {
+		return KNOT_ESPACE;
+	}
+	if (extra != NULL && (changeset_to(extra) != changeset_to(ch) ||
+	     changeset_from(extra) == changeset_from(ch))) {
+		return KNOT_EINVAL;
+	}
+	int ret = knot_lmdb_open(j.db);
+	if (ret != KNOT_EOK) {
+		return ret;
+	}
+
+	insert_ctx_t ctx = {
+		.j = j,
+		.ch = ch,
+		.extra = extra,
+		.ch_size = ch_size,
+		.max_usage = max_usage
+	};
+	return knot_lmdb_group_write(j.db, journal_insert_txn, &ctx);
 }
@@ -22,18 +22,20 @@
 /*!
  * \brief Serialize a changeset into chunks and write it into DB with no checks and metadata update.
  *
- * \param txn   Journal DB transaction.
- * \param ch    Changeset to be written.
+ * \param txn        Journal DB transaction.
+ * \param ch         Changeset to be written.
+ * \param compress   Compress the chunks.
  */
-void journal_write_changeset(knot_lmdb_txn_t *txn, const changeset_t *ch);
+void journal_write_changeset(knot_lmdb_txn_t *txn, const changeset_t *ch, bool compress);
 
 /*!
  * \brief Serialize zone contents aka "bootstrap" changeset into journal, no checks.
  *
- * \param txn   Journal DB transaction.
- * \param z     Zone contents to be written.
+ * \param txn        Journal DB transaction.
+ * \param z          Zone contents to be written.
+ * \param compress   Compress the chunks.
  */
-void journal_write_zone(knot_lmdb_txn_t *txn, const zone_contents_t *z);
+void journal_write_zone(knot_lmdb_txn_t *txn, const zone_contents_t *z, bool compress);
 
 /*!
  * \brief Merge all following changeset into one of journal changeset.
@@ -101,6 +103,50 @@ void journal_fix_occupation(zone_journal_t j, knot_lmdb_txn_t *txn, journal_meta
  */
 int journal_insert_zone(zone_journal_t j, const zone_contents_t *z);
 
+/*! \brief Zone-in-journal being written while the zone is received. */
+typedef struct journal_zone_stream journal_zone_stream_t;
+
+/*!
+ * \brief Start writing zone-in-journal record by record.
+ *
+ * The records are serialized into chunks written aside of the current
+ * zone-in-journal in small batches, so that the complete zone needn't be
+ * serialized at once when stored.
+ *
+ * \param j     Zone journal.
+ * \param out   Output: new stream context.
+ *
+ * \return KNOT_E*
+ */
+int journal_zone_stream_begin(zone_journal_t j, journal_zone_stream_t **out);
+
+/*!
+ * \brief Append a record to the zone-in-journal being written.
+ *
+ * \note The first record must be the SOA, no other SOA may follow.
+ *
+ * \param ctx   Stream context.
+ * \param rr    Record (RRSet) added to the zone.
+ *
+ * \return KNOT_E*, the stream is unusable after a failure.
+ */
+int journal_zone_stream_add(journal_zone_stream_t *ctx, const knot_rrset_t *rr);
+
+/*!
+ * \brief Replace the zone-in-journal and changesets by the written records, update metadata.
+ *
+ * \param ctx   Stream context.
+ * \param z     Zone contents consisting of exactly the written records.
+ *
+ * \return KNOT_E*
+ */
+int journal_zone_stream_publish(journal_zone_stream_t *ctx, const zone_contents_t *z);
+
+/*!
+ * \brief Free the stream context, dropping the written records unless published.
+ */
+void journal_zone_stream_free(journal_zone_stream_t *ctx);
+
 /*!
  * \brief Store changeset into journal, fulfilling quotas and updating metadata.
  *
@@ -20,6 +20,7 @@
 #include <stdio.h> // snprintf
 #include <stdlib.h>
 #include <sys/stat.h>
+#include <time.h>
 #include <unistd.h>
 
 #include "contrib/wire_ctx.h"
@@ -79,6 +80,11 @@ void knot_lmdb_init(knot_lmdb_db_t *db, const char *path, size_t mapsize, unsign
 	pthread_mutex_init(&db->opening_mutex, NULL);
 	db->maxdbs = 2;
 	db->maxreaders = 126/* = contrib/lmdb/mdb.c DEFAULT_READERS */;
+	db->commit_delay = 0;
+	pthread_mutex_init(&db->group_mutex, NULL);
+	pthread_cond_init(&db->group_cond, NULL);
+	db->group_queue = NULL;
+	db->group_busy = false;
 }
 
 static bool lmdb_stat(const char *lmdb_path, struct stat *st)
@@ -258,6 +264,8 @@ void knot_lmdb_deinit(knot_lmdb_db_t *db)
 {
 	knot_lmdb_close(db);
 	pthread_mutex_destroy(&db->opening_mutex);
+	pthread_mutex_destroy(&db->group_mutex);
+	pthread_cond_destroy(&db->group_cond);
 	free(db->path);
 }
 
@@ -310,6 +318,116 @@ void knot_lmdb_commit(knot_lmdb_txn_t *txn)
 	txn->opened = false;
 }
 
+struct knot_lmdb_group_req {
+	knot_lmdb_write_cb cb;
+	void *ctx;
+	int ret;
+	bool done;
+	struct knot_lmdb_group_req *next;
+};
+
+static void group_commit(knot_lmdb_db_t *db, struct knot_lmdb_group_req *batch)
+{
+	knot_lmdb_txn_t parent = { 0 };
+	knot_lmdb_begin(db, &parent, true);
+
+	for (struct knot_lmdb_group_req *req = batch; req != NULL; req = req->next) {
+		knot_lmdb_txn_t child = { 0 };
+		if (parent.ret == KNOT_EOK) {
+			child.ret = mdb_txn_begin(db->env, parent.txn, 0, &child.txn);
+			err_to_knot(&child.ret);
+		} else {
+			child.ret = parent.ret;
+		}
+		if (child.ret == KNOT_EOK) {
+			child.opened = true;
+			child.db = db;
+			child.is_rw = true;
+			req->cb(&child, req->ctx);
+			knot_lmdb_commit(&child); // Into the parent, or abort if failed.
+		}
+		req->ret = child.ret;
+	}
+
+	knot_lmdb_commit(&parent);
+	for (struct knot_lmdb_group_req *req = batch; req != NULL; req = req->next) {
+		if (req->ret == KNOT_EOK) {
+			req->ret = parent.ret;
+		}
+	}
+}
+
+static void group_delay(unsigned usecs)
+{
+	struct timespec delay = {
+		.tv_sec = usecs / 1000000,
+		.tv_nsec = (usecs % 1000000) * 1000
+	};
+	(void)nanosleep(&delay, NULL);
+}
+
+int knot_lmdb_group_write(knot_lmdb_db_t *db, knot_lmdb_write_cb cb, void *ctx)
+{
+	if (db->env_flags & MDB_WRITEMAP) {
+		knot_lmdb_txn_t txn = { 0 };
+		knot_lmdb_begin(db, &txn, true);
+		if (txn.ret == KNOT_EOK) {
+			cb(&txn, ctx);
+		}
+		knot_lmdb_commit(&txn);
+		return txn.ret;
+	}
+
+	struct knot_lmdb_group_req req = { .cb = cb, .ctx = ctx };
+
+	pthread_mutex_lock(&db->group_mutex);
+	struct knot_lmdb_group_req **tail = &db->group_queue;
+	while (*tail != NULL) {
+		tail = &(*tail)->next;
+	}
+	*tail = &req;
+
+	while (!req.done) {
+		if (db->group_busy) {
+			pthread_cond_wait(&db->group_cond, &db->group_mutex);
+			continue;
+		}
+
+		// Lead the next batch, which contains this request.
+		db->group_busy = true;
+		unsigned delay = db->commit_delay;
+		if (delay > 0) {
+			pthread_mutex_unlock(&db->group_mutex);
+			group_delay(delay);
+			pthread_mutex_lock(&db->group_mutex);
+		}
+		struct knot_lmdb_group_req *batch = db->group_queue;
+		db->group_queue = NULL;
+		pthread_mutex_unlock(&db->group_mutex);
+
+		group_commit(db, batch);
+
+		pthread_mutex_lock(&db->group_mutex);
+		while (batch != NULL) {
+			struct knot_lmdb_group_req *next = batch->next;
+			batch->done = true;
+			batch = next;
+		}
+		db->group_busy = false;
+		pthread_cond_broadcast(&db->group_cond);
+	}
+	pthread_mutex_unlock(&db->group_mutex);
+
+	return req.ret;
+}
+
+void knot_lmdb_set_commit_delay(knot_lmdb_db_t *db, unsigned delay)
+{
+	pthread_mutex_lock(&db->group_mutex);
+	db->commit_delay = delay;
+	pthread_mutex_unlock(&db->group_mutex);
+}
+
 // save the programmer's frequent checking for ENOMEM when creating search keys
 static bool txn_enomem(knot_lmdb_txn_t *txn, const MDB_val *tocheck)
 {
@@ -23,6 +23,8 @@
 #include <stdlib.h>
 #include <pthread.h>
 
+struct knot_lmdb_group_req;
+
 typedef struct knot_lmdb_db {
 	MDB_dbi dbi;
 	MDB_env *env;
@@ -32,6 +34,13 @@ typedef struct knot_lmdb_db {
 	unsigned maxdbs;
 	unsigned maxreaders;
 
+	// group commit state, see knot_lmdb_group_write()
+	unsigned commit_delay; // Group commit latency budget in microseconds.
+	pthread_mutex_t group_mutex;
+	pthread_cond_t group_cond;
+	struct knot_lmdb_group_req *group_queue;
+	bool group_busy;
+
 	// those are internal options. Please don't touch them directly.
 	size_t mapsize;
 	unsigned env_flags; // MDB_NOTLS, MDB_RDONLY, MDB_WRITEMAP, MDB_DUPSORT, MDB_NOSYNC, MDB_MAPASYNC
@@ -186,6 +195,40 @@ void knot_lmdb_abort(knot_lmdb_txn_t *txn);
  */
 void knot_lmdb_commit(knot_lmdb_txn_t *txn);
 
+/*!
+ * \brief Callback performing the operations of a (possibly shared) write transaction.
+ *
+ * \note The callback doesn't commit the transaction, but it may fail it by setting txn->ret.
+ */
+typedef void (*knot_lmdb_write_cb)(knot_lmdb_txn_t *txn, void *ctx);
+
+/*!
+ * \brief Perform a write transaction, group-committed with concurrent ones.
+ *
+ * Concurrent callers are batched into one DB transaction, each of them operating
+ * in its own nested transaction, so a failure of one doesn't affect the others.
+ * The caller is blocked until the whole batch is committed. If db->commit_delay
+ * is set, the batch waits up to that long for more callers before being started.
+ *
+ * \note Nested transactions aren't supported with MDB_WRITEMAP, such writes
+ *       aren't grouped (they are cheap as MDB_WRITEMAP goes with MDB_MAPASYNC).
+ *
+ * \param db    The database.
+ * \param cb    Callback performing the operations.
+ * \param ctx   Callback context.
+ *
+ * \return KNOT_E* of the callback operations or of the commit.
+ */
+int knot_lmdb_group_write(knot_lmdb_db_t *db, knot_lmdb_write_cb cb, void *ctx);
+
+/*!
+ * \brief Set the group commit latency budget, see knot_lmdb_group_write().
+ *
+ * \param db     The database.
+ * \param delay  Delay in microseconds.
+ */
+void knot_lmdb_set_commit_delay(knot_lmdb_db_t *db, unsigned delay);
+
 /*!
  * \brief Find a key in database. The matched key will be in txn->cur_key and its value in txn->cur_val.
  *
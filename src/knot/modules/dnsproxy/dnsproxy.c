@@ -14,7 +14,14 @@
     along with this program.  If not, see <https://www.gnu.org/licenses/>.
  */
 
+#include <errno.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
 #include "contrib/net.h"
+#include "contrib/time.h"
+#include "libdnssec/random.h"
 #include "knot/include/module.h"
 #include "knot/conf/schema.h"
 #include "knot/query/capture.h" // Forces static module!
@@ -46,14 +53,199 @@ int dnsproxy_conf_check(knotd_conf_check_args_t *args)
 	return KNOT_EOK;
 }
 
+/*! \brief Maximum number of answers deferred by one thread within a batch. */
+#define DNSPROXY_PENDING_MAX 64
+
+/*! \brief Size of the message header and question, enough for a SERVFAIL. */
+#define DNSPROXY_HEAD_MAX (KNOT_WIRE_HEADER_SIZE + KNOT_DNAME_MAXLEN + 2 * sizeof(uint16_t))
+
+/*! \brief Query forwarded over UDP, its answer deferred to the end of the batch. */
+typedef struct {
+	uint8_t *wire;     /*!< Answer wire, valid until the batch is sent. */
+	size_t max_size;   /*!< Answer wire capacity. */
+	size_t *size;      /*!< Answer size to be set. */
+	uint16_t id;       /*!< Message ID of the forwarded query. */
+	bool done;         /*!< Answered by the remote or not sent at all. */
+	bool answered;     /*!< Answered by the remote. */
+	size_t head_size;
+	uint8_t head[DNSPROXY_HEAD_MAX]; /*!< SERVFAIL answer if the remote fails. */
+} dnsproxy_pending_t;
+
+/*! \brief Per-thread forwarding state, accessed only by the owning thread. */
+typedef struct {
+	int fd;            /*!< UDP socket connected to the remote. */
+	int timeout;       /*!< Remote response timeout per batch. */
+	unsigned count;    /*!< Number of pending answers. */
+	dnsproxy_pending_t pending[DNSPROXY_PENDING_MAX];
+	uint8_t buf[KNOT_WIRE_MAX_PKTSIZE]; /*!< Buffer for the remote answers. */
+} dnsproxy_thread_t;
+
 typedef struct {
 	struct sockaddr_storage remote;
 	struct sockaddr_storage via;
 	bool fallback;
 	bool catch_nxdomain;
 	int timeout;
+	unsigned threads;
+	dnsproxy_thread_t **thread;
 } dnsproxy_t;
 
+static dnsproxy_thread_t *thread_get(dnsproxy_t *proxy, unsigned thread_id)
+{
+	if (thread_id >= proxy->threads) {
+		return NULL;
+	}
+
+	dnsproxy_thread_t *thr = proxy->thread[thread_id];
+	if (thr == NULL) {
+		thr = calloc(1, sizeof(*thr));
+		if (thr == NULL) {
+			return NULL;
+		}
+		thr->fd = net_connected_socket(SOCK_DGRAM, &proxy->remote, &proxy->via);
+		if (thr->fd < 0) {
+			free(thr);
+			return NULL;
+		}
+		thr->timeout = proxy->timeout;
+		proxy->thread[thread_id] = thr;
+	}
+
+	return thr;
+}
+
+static dnsproxy_pending_t *pending_find(dnsproxy_thread_t *thr, uint16_t id)
+{
+	for (unsigned i = 0; i < thr->count; i++) {
+		if (thr->pending[i].id == id) {
+			return &thr->pending[i];
+		}
+	}
+	return NULL;
+}
+
+static void pending_answer(dnsproxy_thread_t *thr, size_t len)
+{
+	const uint8_t *wire = thr->buf;
+	if (len < KNOT_WIRE_HEADER_SIZE || !knot_wire_get_qr(wire)) {
+		return;
+	}
+
+	/* The question must be echoed as it was sent. */
+	dnsproxy_pending_t *p = pending_find(thr, knot_wire_get_id(wire));
+	if (p == NULL || p->done || len > p->max_size || len < p->head_size ||
+	    memcmp(wire + KNOT_WIRE_HEADER_SIZE, p->head + KNOT_WIRE_HEADER_SIZE,
+	           p->head_size - KNOT_WIRE_HEADER_SIZE) != 0) {
+		return;
+	}
+
+	memcpy(p->wire, wire, len);
+	knot_wire_set_id(p->wire, knot_wire_get_id(p->head));
+	*p->size = len;
+	p->done = true;
+	p->answered = true;
+}
+
+static unsigned pending_done(dnsproxy_thread_t *thr)
+{
+	unsigned done = 0;
+	for (unsigned i = 0; i < thr->count; i++) {
+		done += thr->pending[i].done;
+	}
+	return done;
+}
+
+/*! \brief Wait for the remote answers of the batch, at most the timeout. */
+static void dnsproxy_resume(void *ctx)
+{
+	dnsproxy_thread_t *thr = ctx;
+
+	struct timespec begin = time_now();
+	while (pending_done(thr) < thr->count) {
+		struct timespec now = time_now();
+		int remaining = thr->timeout - (int)time_diff_ms(&begin, &now);
+		if (remaining <= 0) {
+			break;
+		}
+		struct pollfd pfd = { .fd = thr->fd, .events = POLLIN };
+		int ret = poll(&pfd, 1, remaining);
+		if (ret < 0 && errno == EINTR) {
+			continue;
+		} else if (ret <= 0) {
+			break;
+		}
+
+		ssize_t len;
+		while ((len = recv(thr->fd, thr->buf, sizeof(thr->buf), MSG_DONTWAIT)) > 0) {
+			pending_answer(thr, len);
+		}
+	}
+
+	for (unsigned i = 0; i < thr->count; i++) {
+		dnsproxy_pending_t *p = &thr->pending[i];
+		/* Forwarding failed, SERVFAIL. Keep the answer dropped if it was. */
+		if (!p->answered && *p->size > 0) {
+			memcpy(p->wire, p->head, p->head_size);
+			*p->size = p->head_size;
+		}
+	}
+	thr->count = 0;
+}
+
+/*! \brief Send the query to the remote and leave its answer to the end of the batch. */
+static bool dnsproxy_defer(dnsproxy_t *proxy, knot_pkt_t *pkt, knotd_qdata_t *qdata)
+{
+	const knot_pkt_t *query = qdata->query;
+	size_t head_size = KNOT_WIRE_HEADER_SIZE + query->qname_size + 2 * sizeof(uint16_t);
+	if (query->tsig_rr != NULL || knot_wire_get_qdcount(query->wire) != 1 ||
+	    query->size < head_size || pkt->max_size < head_size) {
+		return false;
+	}
+
+	dnsproxy_thread_t *thr = thread_get(proxy, qdata->params->thread_id);
+	if (thr == NULL || thr->count == DNSPROXY_PENDING_MAX) {
+		return false;
+	}
+	dnsproxy_pending_t *p = &thr->pending[thr->count];
+
+	/* Not possible if the answer is sent immediately (e.g. over XDP). */
+	p->size = process_query_defer(qdata, dnsproxy_resume, thr);
+	if (p->size == NULL) {
+		return false;
+	}
+	p->wire = pkt->wire;
+	p->max_size = pkt->max_size;
+	p->answered = false;
+
+	/* Original QNAME case, new message ID unique among the pending queries. */
+	uint8_t *wire = thr->buf;
+	memcpy(wire, query->wire, query->size);
+	process_query_qname_case_restore(&(knot_pkt_t){ .wire = wire }, qdata);
+	do {
+		p->id = dnssec_random_uint16_t();
+	} while (pending_find(thr, p->id) != NULL);
+	knot_wire_set_id(wire, p->id);
+
+	/* Not waited for if not sent, SERVFAIL. */
+	ssize_t sent = send(thr->fd, wire, query->size, MSG_DONTWAIT);
+	p->done = (sent != (ssize_t)query->size);
+
+	/* SERVFAIL to the query if no answer from the remote. */
+	p->head_size = head_size;
+	memcpy(p->head, wire, head_size);
+	knot_wire_set_id(p->head, knot_wire_get_id(query->wire));
+	knot_wire_set_qr(p->head);
+	knot_wire_clear_aa(p->head);
+	knot_wire_clear_tc(p->head);
+	knot_wire_set_rcode(p->head, KNOT_RCODE_SERVFAIL);
+	knot_wire_set_ancount(p->head, 0);
+	knot_wire_set_nscount(p->head, 0);
+	knot_wire_set_arcount(p->head, 0);
+
+	thr->count++;
+	return true;
+}
+
 static knotd_state_t dnsproxy_fwd(knotd_state_t state, knot_pkt_t *pkt,
                                   knotd_qdata_t *qdata, knotd_mod_t *mod)
 {
@@ -67,6 +259,12 @@ static knotd_state_t dnsproxy_fwd(knotd_state_t state, knot_pkt_t *pkt,
 		return state;
 	}
 
+	/* Over UDP within a batch, the answer is completed after the batch. */
+	bool is_tcp = net_is_stream(qdata->params->socket);
+	if (!is_tcp && dnsproxy_defer(proxy, pkt, qdata)) {
+		return (proxy->fallback ? KNOTD_STATE_DONE : KNOTD_STATE_FINAL);
+	}
+
 	/* Forward also original TSIG. */
 	if (qdata->query->tsig_rr != NULL && !proxy->fallback) {
 		knot_tsig_append(qdata->query->wire, &qdata->query->size,
@@ -87,7 +285,6 @@ static knotd_state_t dnsproxy_fwd(knotd_state_t state, knot_pkt_t *pkt,
 		return state; /* Ignore, not enough memory. */
 	}
 
-	bool is_tcp = net_is_stream(qdata->params->socket);
 	const struct sockaddr_storage *dst = &proxy->remote;
 	const struct sockaddr_storage *src = &proxy->via;
 	knot_request_t *req = knot_request_make(re.mm, dst, src, qdata->query, NULL,
@@ -147,6 +344,13 @@ int dnsproxy_load(knotd_mod_t *mod)
 	conf = knotd_conf_mod(mod, MOD_CATCH_NXDOMAIN);
 	proxy->catch_nxdomain = conf.single.boolean;
 
+	proxy->threads = knotd_mod_threads(mod);
+	proxy->thread = calloc(proxy->threads, sizeof(*proxy->thread));
+	if (proxy->thread == NULL) {
+		free(proxy);
+		return KNOT_ENOMEM;
+	}
+
 	knotd_mod_ctx_set(mod, proxy);
 
 	if (proxy->fallback) {
@@ -158,7 +362,15 @@ int dnsproxy_load(knotd_mod_t *mod)
 
 void dnsproxy_unload(knotd_mod_t *mod)
 {
-	free(knotd_mod_ctx(mod));
+	dnsproxy_t *proxy = knotd_mod_ctx(mod);
+	for (unsigned i = 0; i < proxy->threads; i++) {
+		if (proxy->thread[i] != NULL) {
+			close(proxy->thread[i]->fd);
+			free(proxy->thread[i]);
+		}
+	}
+	free(proxy->thread);
+	free(proxy);
 }
 
 KNOTD_MOD_API(dnsproxy, KNOTD_MOD_FLAG_SCOPE_ANY,
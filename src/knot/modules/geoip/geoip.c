@@ -22,12 +22,14 @@
 #include "knot/include/module.h"
 #include "knot/modules/geoip/geodb.h"
 #include "libknot/libknot.h"
+#include "contrib/openbsd/siphash.h"
 #include "contrib/qp-trie/trie.h"
 #include "contrib/ucw/lists.h"
 #include "contrib/macros.h"
 #include "contrib/sockaddr.h"
 #include "contrib/string.h"
 #include "contrib/strtonum.h"
+#include "libdnssec/error.h"
 #include "libdnssec/random.h"
 #include "libzscanner/scanner.h"
 
@@ -37,6 +39,9 @@
 #define MOD_GEODB_FILE	"\x0A""geodb-file"
 #define MOD_GEODB_KEY	"\x09""geodb-key"
 
+// Number of cached geodb mode results per thread.
+#define GEO_CACHE_SIZE	1024
+
 enum operation_mode {
 	MODE_SUBNET,
 	MODE_GEODB,
@@ -87,6 +92,8 @@ int geoip_conf_check(knotd_conf_check_args_t *args)
 	return KNOT_EOK;
 }
 
+struct geo_cache_slot;
+
 typedef struct {
 	enum operation_mode mode;
 	uint32_t ttl;
@@ -96,6 +103,11 @@ typedef struct {
 	geodb_t *geodb;
 	geodb_path_t paths[GEODB_MAX_DEPTH];
 	uint16_t path_count;
+
+	// Per-thread caches of geodb mode results.
+	struct geo_cache_slot *cache;
+	unsigned cache_threads;
+	SIPHASH_KEY cache_key;
 } geoip_ctx_t;
 
 typedef struct {
@@ -119,12 +131,31 @@ typedef struct {
 	knot_dname_t *cname;
 } geo_view_t;
 
+// Address range with the same best view in subnet mode.
+typedef struct {
+	uint8_t start[16]; // First address of the range (IPv4 zero padded).
+	int view;          // Index of the view or -1 if none.
+} geo_range_t;
+
 typedef struct {
 	size_t count, avail;
 	geo_view_t *views;
 	uint16_t total_weight;
+
+	// Compiled longest prefix match in subnet mode (IPv4 and IPv6).
+	geo_range_t *ranges[2];
+	size_t range_count[2];
 } geo_trie_val_t;
 
+typedef struct geo_cache_slot {
+	uint64_t hash;
+	const geo_trie_val_t *data;
+	const geo_view_t *view; // NULL if no suitable view.
+	uint16_t netmask;
+	uint16_t family;
+	uint8_t addr[16];
+} geo_cache_slot_t;
+
 typedef int (*view_cmp_t)(const void *a, const void *b);
 
 int geodb_view_cmp(const void *a, const void *b)
@@ -327,6 +358,27 @@ static void clear_geo_view(geo_view_t *view)
 	view->cname = NULL;
 }
 
+static size_t addr_len(int family)
+{
+	return (family == AF_INET) ? sizeof(struct in_addr) : sizeof(struct in6_addr);
+}
+
+static uint8_t *addr_bytes(const struct sockaddr_storage *ss)
+{
+	if (ss->ss_family == AF_INET) {
+		return (uint8_t *)&((struct sockaddr_in *)ss)->sin_addr;
+	} else {
+		return (uint8_t *)&((struct sockaddr_in6 *)ss)->sin6_addr;
+	}
+}
+
+// Mask of the address byte for the prefix length.
+static uint8_t prefix_mask(uint8_t prefix, size_t byte)
+{
+	int bits = prefix - 8 * (int)byte;
+	return (bits >= 8) ? 0xff : (bits <= 0) ? 0 : (0xff << (8 - bits));
+}
+
 static int parse_origin(yp_parser_t *yp, zs_scanner_t *scanner)
 {
 	char *set_origin = sprintf_alloc("$ORIGIN %s%s\n", yp->key,
@@ -416,6 +468,12 @@ static int parse_view(knotd_mod_t *mod, geoip_ctx_t *ctx, yp_parser_t *yp, geo_v
 				              yp->line_count);
 			}
 		}
+
+		// Clear the host bits so that the sorted subnets nest properly.
+		uint8_t *addr = addr_bytes(view->subnet);
+		for (size_t i = 0; i < addr_len(view->subnet->ss_family); i++) {
+			addr[i] &= prefix_mask(view->subnet_prefix, i);
+		}
 	} else if (ctx->mode == MODE_WEIGHTED) {
 		uint8_t weight;
 		ret = str_to_u8(yp->data, &weight);
@@ -630,6 +688,8 @@ static void clear_geo_trie(trie_t *trie)
 			clear_geo_view(&val->views[i]);
 		}
 		free(val->views);
+		free(val->ranges[0]);
+		free(val->ranges[1]);
 		free(val);
 		trie_it_next(it);
 	}
@@ -643,6 +703,7 @@ static void free_geoip_ctx(geoip_ctx_t *ctx)
 	free(ctx->geodb);
 	clear_geo_trie(ctx->geo_trie);
 	trie_free(ctx->geo_trie);
+	free(ctx->cache);
 	for (int i = 0; i < ctx->path_count; i++) {
 		for (int j = 0; j < GEODB_MAX_PATH_LEN; j++) {
 			free(ctx->paths[i].path[j]);
@@ -749,6 +810,158 @@ static geo_view_t *find_best_view(geo_view_t *dummy, geo_trie_val_t *data, geoip
 	return &data->views[idx];
 }
 
+static int range_start_cmp(const void *a, const void *b)
+{
+	return memcmp(a, b, sizeof(((geo_range_t *)NULL)->start));
+}
+
+// Compute the first and the after-last address of the (masked) subnet.
+static bool subnet_bounds(const geo_view_t *view, uint8_t first[16], uint8_t after[16])
+{
+	size_t len = addr_len(view->subnet->ss_family);
+	memset(first, 0, 16);
+	memcpy(first, addr_bytes(view->subnet), len);
+	for (size_t i = 0; i < len; i++) {
+		after[i] = first[i] | ~prefix_mask(view->subnet_prefix, i);
+	}
+	memset(after + len, 0, 16 - len);
+
+	// Increment the last address, there is none after the highest one.
+	for (int i = len - 1; i >= 0; i--) {
+		if (++after[i] != 0) {
+			return true;
+		}
+	}
+	return false;
+}
+
+static int compile_ranges(geo_trie_val_t *val, int family, geoip_ctx_t *ctx)
+{
+	int idx = (family == AF_INET6);
+
+	// Collect the addresses where the longest prefix match may change.
+	geo_range_t *bounds = calloc(2 * val->count + 1, sizeof(geo_range_t));
+	if (bounds == NULL) {
+		return KNOT_ENOMEM;
+	}
+	size_t count = 1; // The lowest address.
+	for (size_t i = 0; i < val->count; i++) {
+		if (val->views[i].subnet->ss_family != family) {
+			continue;
+		}
+		if (subnet_bounds(&val->views[i], bounds[count].start, bounds[count + 1].start)) {
+			count += 2;
+		} else {
+			count += 1;
+		}
+	}
+	qsort(bounds, count, sizeof(geo_range_t), range_start_cmp);
+
+	// Resolve each range with the view search and merge equal neighbours.
+	size_t out = 0;
+	for (size_t i = 0; i < count; i++) {
+		if (i > 0 && range_start_cmp(bounds[i].start, bounds[i - 1].start) == 0) {
+			continue;
+		}
+
+		struct sockaddr_storage addr = { .ss_family = family };
+		memcpy(addr_bytes(&addr), bounds[i].start, addr_len(family));
+		geo_view_t dummy = {
+			.subnet = &addr,
+			.subnet_prefix = 8 * addr_len(family)
+		};
+		geo_view_t *view = find_best_view(&dummy, val, ctx);
+		int view_idx = (view != NULL) ? view - val->views : -1;
+		if (out > 0 && bounds[out - 1].view == view_idx) {
+			continue;
+		}
+
+		memmove(bounds[out].start, bounds[i].start, sizeof(bounds[i].start));
+		bounds[out].view = view_idx;
+		out++;
+	}
+
+	val->ranges[idx] = bounds;
+	val->range_count[idx] = out;
+
+	return KNOT_EOK;
+}
+
+static int geo_compile_ranges(geoip_ctx_t *ctx)
+{
+	int ret = KNOT_EOK;
+
+	trie_it_t *it = trie_it_begin(ctx->geo_trie);
+	while (!trie_it_finished(it) && ret == KNOT_EOK) {
+		geo_trie_val_t *val = (geo_trie_val_t *) (*trie_it_val(it));
+		ret = compile_ranges(val, AF_INET, ctx);
+		if (ret == KNOT_EOK) {
+			ret = compile_ranges(val, AF_INET6, ctx);
+		}
+		trie_it_next(it);
+	}
+	trie_it_free(it);
+
+	return ret;
+}
+
+static geo_view_t *find_subnet_view(const geo_trie_val_t *data,
+                                    const struct sockaddr_storage *remote)
+{
+	if (remote->ss_family != AF_INET && remote->ss_family != AF_INET6) {
+		return NULL;
+	}
+
+	int idx = (remote->ss_family == AF_INET6);
+	uint8_t key[16] = { 0 };
+	memcpy(key, addr_bytes(remote), addr_len(remote->ss_family));
+
+	// Find the last range starting at or below the address.
+	const geo_range_t *ranges = data->ranges[idx];
+	size_t l = 0, r = data->range_count[idx];
+	while (l < r) {
+		size_t m = (l + r) / 2;
+		if (range_start_cmp(ranges[m].start, key) <= 0) {
+			l = m + 1;
+		} else {
+			r = m;
+		}
+	}
+
+	// The first range starts at the lowest address, so there is always one.
+	if (l == 0 || ranges[l - 1].view < 0) {
+		return NULL;
+	}
+	return &data->views[ranges[l - 1].view];
+}
+
+static geo_cache_slot_t *cache_slot(geoip_ctx_t *ctx, knotd_qdata_t *qdata,
+                                    const geo_trie_val_t *data,
+                                    const struct sockaddr_storage *remote, uint64_t *hash)
+{
+	unsigned thread = qdata->params->thread_id;
+	if (ctx->cache == NULL || thread >= ctx->cache_threads ||
+	    (remote->ss_family != AF_INET && remote->ss_family != AF_INET6)) {
+		return NULL;
+	}
+
+	SIPHASH_CTX hctx;
+	SipHash24_Init(&hctx, &ctx->cache_key);
+	SipHash24_Update(&hctx, &data, sizeof(data));
+	SipHash24_Update(&hctx, addr_bytes(remote), addr_len(remote->ss_family));
+	*hash = SipHash24_End(&hctx);
+
+	return &ctx->cache[thread * GEO_CACHE_SIZE + *hash % GEO_CACHE_SIZE];
+}
+
+static bool cache_match(const geo_cache_slot_t *slot, uint64_t hash,
+                        const geo_trie_val_t *data, const struct sockaddr_storage *remote)
+{
+	return slot->hash == hash && slot->data == data &&
+	       slot->family == remote->ss_family &&
+	       memcmp(slot->addr, addr_bytes(remote), addr_len(remote->ss_family)) == 0;
+}
+
 static void find_rr_in_view(uint16_t qtype, geo_view_t *view,
                             knot_rrset_t **rr, knot_rrset_t **rrsig)
 {
@@ -810,15 +1023,23 @@ static knotd_in_state_t geoip_process(knotd_in_state_t state, knot_pkt_t *pkt,
 
 	uint16_t netmask = 0;
 	geodb_data_t entries[ctx->path_count];
+	geo_cache_slot_t *slot = NULL;
+	uint64_t hash = 0;
 
 	// Create dummy view and fill it with data about the current remote.
 	geo_view_t dummy = { 0 };
+	geo_view_t *view = NULL;
 	switch(ctx->mode) {
 	case MODE_SUBNET:
-		dummy.subnet = (struct sockaddr_storage *)remote;
-		dummy.subnet_prefix = (remote->ss_family == AF_INET) ? 32 : 128;
+		view = find_subnet_view(data, remote);
 		break;
 	case MODE_GEODB:
+		slot = cache_slot(ctx, qdata, data, remote, &hash);
+		if (slot != NULL && cache_match(slot, hash, data, remote)) {
+			view = (geo_view_t *)slot->view;
+			netmask = slot->netmask;
+			break;
+		}
 		if (geodb_query(ctx->geodb, entries, (struct sockaddr *)remote,
 		                ctx->paths, ctx->path_count, &netmask) != 0) {
 			return state;
@@ -829,17 +1050,27 @@ static knotd_in_state_t geoip_process(knotd_in_state_t state, knot_pkt_t *pkt,
 		}
 		geodb_fill_geodata(entries, ctx->path_count,
 		                   dummy.geodata, dummy.geodata_len, &dummy.geodepth);
+		// Find last lower or equal view.
+		view = find_best_view(&dummy, data, ctx);
+		if (slot != NULL) {
+			slot->hash = hash;
+			slot->data = data;
+			slot->view = view;
+			slot->netmask = netmask;
+			slot->family = remote->ss_family;
+			memcpy(slot->addr, addr_bytes(remote), addr_len(remote->ss_family));
+		}
 		break;
 	case MODE_WEIGHTED:
 		dummy.weight = dnssec_random_uint16_t() % data->total_weight;
+		// Find last lower or equal view.
+		view = find_best_view(&dummy, data, ctx);
 		break;
 	default:
 		assert(0);
 		break;
 	}
 
-	// Find last lower or equal view.
-	geo_view_t *view = find_best_view(&dummy, data, ctx);
 	if (view == NULL) { // No suitable view was found.
 		return state;
 	}
@@ -961,6 +1192,23 @@ int geoip_load(knotd_mod_t *mod)
 	// Prepare geo views for faster search.
 	geo_sort_and_link(ctx);
 
+	if (ctx->mode == MODE_SUBNET) {
+		ret = geo_compile_ranges(ctx);
+		if (ret != KNOT_EOK) {
+			free_geoip_ctx(ctx);
+			return ret;
+		}
+	} else if (ctx->mode == MODE_GEODB) {
+		ctx->cache_threads = knotd_mod_threads(mod);
+		ctx->cache = calloc(ctx->cache_threads * GEO_CACHE_SIZE, sizeof(geo_cache_slot_t));
+		if (ctx->cache == NULL ||
+		    dnssec_random_buffer((uint8_t *)&ctx->cache_key,
+		                         sizeof(ctx->cache_key)) != DNSSEC_EOK) {
+			free_geoip_ctx(ctx);
+			return KNOT_ENOMEM;
+		}
+	}
+
 	knotd_mod_ctx_set(mod, ctx);
 
 	return knotd_mod_in_hook(mod, KNOTD_STAGE_PREANSWER, geoip_process);
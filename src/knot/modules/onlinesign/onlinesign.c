@@ -22,6 +22,7 @@
 #include "libdnssec/error.h"
 #include "knot/include/module.h"
 #include "knot/modules/onlinesign/nsec_next.h"
+#include "knot/modules/onlinesign/rrsig_cache.h"
 // Next dependencies force static module!
 #include "knot/dnssec/ds_query.h"
 #include "knot/dnssec/key-events.h"
@@ -34,6 +35,7 @@
 
 #define MOD_POLICY	"\x06""policy"
 #define MOD_NSEC_BITMAP	"\x0B""nsec-bitmap"
+#define MOD_CACHE_SIZE	"\x0A""cache-size"
 
 int policy_check(knotd_conf_check_args_t *args)
 {
@@ -60,6 +62,7 @@ int bitmap_check(knotd_conf_check_args_t *args)
 const yp_item_t online_sign_conf[] = {
 	{ MOD_POLICY,      YP_TREF, YP_VREF = { C_POLICY }, YP_FNONE, { policy_check } },
 	{ MOD_NSEC_BITMAP, YP_TSTR, YP_VNONE, YP_FMULTI, { bitmap_check } },
+	{ MOD_CACHE_SIZE,  YP_TINT, YP_VINT = { 0, 1000000, 1000 } },
 	{ NULL }
 };
 
@@ -87,9 +90,26 @@ typedef struct {
 
 	uint16_t *nsec_force_types;
 
+	rrsig_cache_t **rrsig_caches; /*!< Signature caches of the worker threads. */
+	unsigned rrsig_cache_count;
+	uint32_t keyset_gen;          /*!< Generation of the loaded keyset. */
+
 	bool zone_doomed;
 } online_sign_ctx_t;
 
+/*! \brief Gets the keyset generation, it's updated under the signing lock. */
+static uint32_t keyset_gen(online_sign_ctx_t *ctx)
+{
+#ifdef HAVE_ATOMIC
+	return __atomic_load_n(&ctx->keyset_gen, __ATOMIC_ACQUIRE);
+#else
+	pthread_rwlock_rdlock(&ctx->signing_mutex);
+	uint32_t gen = ctx->keyset_gen;
+	pthread_rwlock_unlock(&ctx->signing_mutex);
+	return gen;
+#endif
+}
+
 static bool want_dnssec(knotd_qdata_t *qdata)
 {
 	return knot_pkt_has_dnssec(qdata->query);
@@ -233,7 +253,8 @@ static knot_rrset_t *synth_nsec(knot_pkt_t *pkt, knotd_qdata_t *qdata, knotd_mod
 static knot_rrset_t *sign_rrset(const knot_dname_t *owner,
                                 const knot_rrset_t *cover,
                                 knotd_mod_t *mod,
-                                zone_sign_ctx_t *sign_ctx,
+                                zone_sign_ctx_t **sign_ctx,
+                                rrsig_cache_t *cache,
                                 knot_mm_t *mm)
 {
 	// copy of RR set with replaced owner name
@@ -258,11 +279,32 @@ static knot_rrset_t *sign_rrset(const knot_dname_t *owner,
 		return NULL;
 	}
 
+	// reuse cached signatures
+
 	online_sign_ctx_t *ctx = knotd_mod_ctx(mod);
+	uint32_t gen = keyset_gen(ctx);
+	if (rrsig_cache_get(cache, gen, knot_time(), copy, &rrsig->rrs, mm) == KNOT_EOK) {
+		knot_rrset_free(copy, NULL);
+		return rrsig;
+	}
+
+	if (*sign_ctx == NULL) {
+		*sign_ctx = zone_sign_ctx(mod->keyset, mod->dnssec);
+		if (*sign_ctx == NULL) {
+			knot_rrset_free(copy, NULL);
+			knot_rrset_free(rrsig, mm);
+			return NULL;
+		}
+	}
+
 	pthread_rwlock_rdlock(&ctx->signing_mutex);
-	int ret = knot_sign_rrset2(rrsig, copy, sign_ctx, mm);
+	gen = ctx->keyset_gen;
+	int ret = knot_sign_rrset2(rrsig, copy, *sign_ctx, mm);
 	pthread_rwlock_unlock(&ctx->signing_mutex);
-	if (ret != KNOT_EOK) {
+	if (ret == KNOT_EOK) {
+		rrsig_cache_put(cache, gen, copy, &rrsig->rrs,
+		                mod->dnssec->policy->rrsig_refresh_before);
+	} else {
 		knot_rrset_free(copy, NULL);
 		knot_rrset_free(rrsig, mm);
 		return NULL;
@@ -313,9 +355,12 @@ static knotd_in_state_t sign_section(knotd_in_state_t state, knot_pkt_t *pkt,
 	const knot_pktsection_t *section = knot_pkt_section(pkt, pkt->current);
 	assert(section);
 
-	zone_sign_ctx_t *sign_ctx = zone_sign_ctx(mod->keyset, mod->dnssec);
-	if (sign_ctx == NULL) {
-		return KNOTD_IN_STATE_ERROR;
+	// the signing context is created only if anything isn't cached
+	online_sign_ctx_t *ctx = knotd_mod_ctx(mod);
+	zone_sign_ctx_t *sign_ctx = NULL;
+	rrsig_cache_t *cache = NULL;
+	if (qdata->params->thread_id < ctx->rrsig_cache_count) {
+		cache = ctx->rrsig_caches[qdata->params->thread_id];
 	}
 
 	uint16_t count_unsigned = section->count;
@@ -331,7 +376,7 @@ static knotd_in_state_t sign_section(knotd_in_state_t state, knot_pkt_t *pkt,
 		knot_dname_unpack(owner, pkt->wire + rr_pos, sizeof(owner), pkt->wire);
 		knot_dname_to_lower(owner);
 
-		knot_rrset_t *rrsig = sign_rrset(owner, rr, mod, sign_ctx, &pkt->mm);
+		knot_rrset_t *rrsig = sign_rrset(owner, rr, mod, &sign_ctx, cache, &pkt->mm);
 		if (!rrsig) {
 			state = KNOTD_IN_STATE_ERROR;
 			break;
@@ -515,6 +560,11 @@ static knotd_in_state_t pre_routine(knotd_in_state_t state, knot_pkt_t *pkt,
 		pthread_rwlock_wrlock(&ctx->signing_mutex);
 		knotd_mod_dnssec_unload_keyset(mod);
 		ret = knotd_mod_dnssec_load_keyset(mod, true);
+#ifdef HAVE_ATOMIC
+		__atomic_add_fetch(&ctx->keyset_gen, 1, __ATOMIC_RELEASE);
+#else
+		ctx->keyset_gen++;
+#endif
 		if (ret != KNOT_EOK) {
 			ctx->zone_doomed = true;
 			state = KNOTD_IN_STATE_ERROR;
@@ -605,6 +655,11 @@ static void online_sign_ctx_free(online_sign_ctx_t *ctx)
 	pthread_mutex_destroy(&ctx->event_mutex);
 	pthread_rwlock_destroy(&ctx->signing_mutex);
 
+	for (unsigned i = 0; i < ctx->rrsig_cache_count; i++) {
+		rrsig_cache_free(ctx->rrsig_caches[i]);
+	}
+	free(ctx->rrsig_caches);
+
 	free(ctx->nsec_force_types);
 	free(ctx);
 }
@@ -681,6 +736,29 @@ int load_nsec_bitmap(online_sign_ctx_t *ctx, knotd_conf_t *conf)
 	return KNOT_EOK;
 }
 
+static int load_rrsig_caches(online_sign_ctx_t *ctx, knotd_mod_t *mod, size_t size)
+{
+	if (size == 0) {
+		return KNOT_EOK;
+	}
+
+	unsigned count = knotd_mod_threads(mod);
+	ctx->rrsig_caches = calloc(count, sizeof(rrsig_cache_t *));
+	if (ctx->rrsig_caches == NULL) {
+		return KNOT_ENOMEM;
+	}
+	ctx->rrsig_cache_count = count;
+
+	for (unsigned i = 0; i < count; i++) {
+		ctx->rrsig_caches[i] = rrsig_cache_new(size);
+		if (ctx->rrsig_caches[i] == NULL) {
+			return KNOT_ENOMEM;
+		}
+	}
+
+	return KNOT_EOK;
+}
+
 int online_sign_load(knotd_mod_t *mod)
 {
 	knotd_conf_t conf = knotd_conf_zone(mod, C_DNSSEC_SIGNING,
@@ -706,6 +784,13 @@ int online_sign_load(knotd_mod_t *mod)
 		return ret;
 	}
 
+	conf = knotd_conf_mod(mod, MOD_CACHE_SIZE);
+	ret = load_rrsig_caches(ctx, mod, conf.single.integer);
+	if (ret != KNOT_EOK) {
+		online_sign_ctx_free(ctx);
+		return ret;
+	}
+
 	knotd_mod_ctx_set(mod, ctx);
 
 	knotd_mod_in_hook(mod, KNOTD_STAGE_ANSWER, pre_routine);
@@ -0,0 +1,182 @@
+/*  Copyright (C) 2020 CZ.NIC, z.s.p.o. <knot-dns@labs.nic.cz>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "knot/modules/onlinesign/rrsig_cache.h"
+#include "contrib/openbsd/siphash.h"
+#include "libdnssec/error.h"
+#include "libdnssec/random.h"
+#include "libknot/errcode.h"
+#include "libknot/rrtype/rrsig.h"
+
+/*! \brief Cached signatures. */
+typedef struct {
+	uint64_t hash;      /*!< Hash of the covered RRSet. */
+	uint32_t gen;       /*!< Generation of the signing keys. */
+	knot_time_t expire; /*!< Expiration of the entry. */
+	uint32_t ttl;
+	uint16_t type;
+	uint16_t count;     /*!< Number of covered records. */
+	uint32_t size;      /*!< Size of covered records. */
+	uint16_t sig_count; /*!< Number of signatures. */
+	uint32_t sig_size;  /*!< Size of signatures. */
+	uint8_t data[];     /*!< Covered records, signatures and owner. */
+} rrsig_entry_t;
+
+struct rrsig_cache {
+	SIPHASH_KEY key;       /*!< Hashing secret. */
+	size_t size;           /*!< Number of slots. */
+	rrsig_entry_t **slots; /*!< Cached signatures. */
+};
+
+static uint64_t rrset_hash(const rrsig_cache_t *cache, const knot_rrset_t *rrset)
+{
+	uint32_t fields[] = { rrset->type, rrset->ttl, rrset->rrs.count };
+
+	SIPHASH_CTX ctx;
+	SipHash24_Init(&ctx, &cache->key);
+	SipHash24_Update(&ctx, rrset->owner, knot_dname_size(rrset->owner));
+	SipHash24_Update(&ctx, fields, sizeof(fields));
+	SipHash24_Update(&ctx, rrset->rrs.rdata, rrset->rrs.size);
+
+	return SipHash24_End(&ctx);
+}
+
+static bool entry_match(const rrsig_entry_t *entry, uint64_t hash, uint32_t gen,
+                        const knot_rrset_t *rrset)
+{
+	const uint8_t *owner = entry->data + entry->size + entry->sig_size;
+
+	return entry->hash == hash && entry->gen == gen &&
+	       entry->type == rrset->type && entry->ttl == rrset->ttl &&
+	       entry->count == rrset->rrs.count && entry->size == rrset->rrs.size &&
+	       memcmp(entry->data, rrset->rrs.rdata, entry->size) == 0 &&
+	       knot_dname_is_equal(owner, rrset->owner);
+}
+
+rrsig_cache_t *rrsig_cache_new(size_t size)
+{
+	if (size == 0) {
+		return NULL;
+	}
+
+	rrsig_cache_t *cache = calloc(1, sizeof(*cache));
+	if (cache == NULL) {
+		return NULL;
+	}
+
+	cache->slots = calloc(size, sizeof(*cache->slots));
+	if (cache->slots == NULL ||
+	    dnssec_random_buffer((uint8_t *)&cache->key, sizeof(cache->key)) != DNSSEC_EOK) {
+		free(cache->slots);
+		free(cache);
+		return NULL;
+	}
+
+	cache->size = size;
+
+	return cache;
+}
+
+void rrsig_cache_free(rrsig_cache_t *cache)
+{
+	if (cache == NULL) {
+		return;
+	}
+
+	for (size_t i = 0; i < cache->size; i++) {
+		free(cache->slots[i]);
+	}
+	free(cache->slots);
+	free(cache);
+}
+
+int rrsig_cache_get(rrsig_cache_t *cache, uint32_t gen, knot_time_t now,
+                    const knot_rrset_t *covered, knot_rdataset_t *rrsigs,
+                    knot_mm_t *mm)
+{
+	if (cache == NULL || covered == NULL || rrsigs == NULL) {
+		return KNOT_EINVAL;
+	}
+
+	uint64_t hash = rrset_hash(cache, covered);
+	const rrsig_entry_t *entry = cache->slots[hash % cache->size];
+	if (entry == NULL || !entry_match(entry, hash, gen, covered) ||
+	    knot_time_cmp(now, entry->expire) >= 0) {
+		return KNOT_ENOENT;
+	}
+
+	knot_rdataset_t cached = {
+		.count = entry->sig_count,
+		.size = entry->sig_size,
+		.rdata = (knot_rdata_t *)(entry->data + entry->size)
+	};
+
+	return knot_rdataset_copy(rrsigs, &cached, mm);
+}
+
+static knot_time_t rrsigs_expire(const knot_rdataset_t *rrsigs)
+{
+	knot_time_t expire = 0;
+
+	knot_rdata_t *rr = rrsigs->rdata;
+	for (uint16_t i = 0; i < rrsigs->count; i++) {
+		expire = knot_time_min(expire, knot_rrsig_sig_expiration(rr));
+		rr = knot_rdataset_next(rr);
+	}
+
+	return expire;
+}
+
+void rrsig_cache_put(rrsig_cache_t *cache, uint32_t gen,
+                     const knot_rrset_t *covered, const knot_rdataset_t *rrsigs,
+                     uint32_t refresh_before)
+{
+	if (cache == NULL || covered == NULL || rrsigs == NULL || rrsigs->count == 0) {
+		return;
+	}
+
+	knot_time_t expire = rrsigs_expire(rrsigs);
+	if (expire <= refresh_before) {
+		return;
+	}
+
+	size_t owner_size = knot_dname_size(covered->owner);
+	rrsig_entry_t *entry = malloc(sizeof(*entry) + covered->rrs.size +
+	                              rrsigs->size + owner_size);
+	if (entry == NULL) {
+		return;
+	}
+
+	entry->hash = rrset_hash(cache, covered);
+	entry->gen = gen;
+	entry->expire = expire - refresh_before;
+	entry->ttl = covered->ttl;
+	entry->type = covered->type;
+	entry->count = covered->rrs.count;
+	entry->size = covered->rrs.size;
+	entry->sig_count = rrsigs->count;
+	entry->sig_size = rrsigs->size;
+	memcpy(entry->data, covered->rrs.rdata, covered->rrs.size);
+	memcpy(entry->data + covered->rrs.size, rrsigs->rdata, rrsigs->size);
+	memcpy(entry->data + covered->rrs.size + rrsigs->size, covered->owner, owner_size);
+
+	rrsig_entry_t **slot = &cache->slots[entry->hash % cache->size];
+	free(*slot);
+	*slot = entry;
+}
@@ -0,0 +1,75 @@
+/*  Copyright (C) 2020 CZ.NIC, z.s.p.o. <knot-dns@labs.nic.cz>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+#include "contrib/time.h"
+#include "libknot/mm_ctx.h"
+#include "libknot/rrset.h"
+
+/*!
+ * \brief Cache of generated signatures.
+ *
+ * The signatures are keyed by the whole covered RRSet (owner, type, TTL and
+ * records) and by the generation of the signing keys. The cache is direct
+ * mapped and not thread-safe, one is used per worker thread.
+ */
+typedef struct rrsig_cache rrsig_cache_t;
+
+/*!
+ * \brief Creates an empty cache.
+ *
+ * \param size  Number of cached RRSets.
+ */
+rrsig_cache_t *rrsig_cache_new(size_t size);
+
+/*!
+ * \brief Frees the cache.
+ */
+void rrsig_cache_free(rrsig_cache_t *cache);
+
+/*!
+ * \brief Looks up the signatures of the RRSet.
+ *
+ * \param cache    Cache.
+ * \param gen      Current generation of the signing keys.
+ * \param now      Current time.
+ * \param covered  Covered RRSet with lower-case owner.
+ * \param rrsigs   Output signatures.
+ * \param mm       Memory context for the output.
+ *
+ * \retval KNOT_ENOENT if not cached or expired.
+ * \return KNOT_E*
+ */
+int rrsig_cache_get(rrsig_cache_t *cache, uint32_t gen, knot_time_t now,
+                    const knot_rrset_t *covered, knot_rdataset_t *rrsigs,
+                    knot_mm_t *mm);
+
+/*!
+ * \brief Stores the signatures of the RRSet, replacing another RRSet if needed.
+ *
+ * \param cache           Cache.
+ * \param gen             Generation of the signing keys.
+ * \param covered         Covered RRSet with lower-case owner.
+ * \param rrsigs          Signatures.
+ * \param refresh_before  The signatures expire from the cache this number of
+ *                        seconds before the earliest of them expires.
+ */
+void rrsig_cache_put(rrsig_cache_t *cache, uint32_t gen,
+                     const knot_rrset_t *covered, const knot_rdataset_t *rrsigs,
+                     uint32_t refresh_before);
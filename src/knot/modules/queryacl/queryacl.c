@@ -53,16 +53,10 @@ static knotd_state_t queryacl_process(knotd_state_t state, knot_pkt_t *pkt,
 	if (ctx->allow_iface.count > 0) {
 		struct sockaddr_storage iface;
 		socklen_t iface_len = sizeof(iface);
-		struct sockaddr_storage *iface_ptr;
+		const struct sockaddr_storage *iface_ptr = qdata->params->local;
 
-		if (qdata->params->xdp_msg != NULL) {
-#ifdef ENABLE_XDP
-			iface_ptr = (struct sockaddr_storage *)&qdata->params->xdp_msg->ip_to;
-#else
-			assert(0);
-			return KNOTD_STATE_FAIL;
-#endif
-		} else {
+		// Use the local address cached by the network handler if possible.
+		if (iface_ptr == NULL) {
 			if (getsockname(qdata->params->socket, (struct sockaddr *)&iface,
 			                &iface_len) != 0) {
 				knotd_mod_log(mod, LOG_ERR, "failed to get interface address");
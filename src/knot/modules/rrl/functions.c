@@ -15,17 +15,21 @@
  */
 
 #include <assert.h>
+#include <stdlib.h>
+#include <string.h>
 #include <time.h>
 
 #include "knot/modules/rrl/functions.h"
+#include "contrib/macros.h"
 #include "contrib/openbsd/strlcat.h"
 #include "contrib/sockaddr.h"
 #include "contrib/time.h"
 #include "libdnssec/error.h"
 #include "libdnssec/random.h"
 
-/* Hopscotch defines. */
-#define HOP_LEN (sizeof(unsigned)*8)
+/* Set associativity (buckets per cache line). */
+#define RRL_WAYS 8
+#define RRL_LINE (RRL_WAYS * sizeof(rrl_item_t))
 /* Limits (class, ipv6 remote, dname) */
 #define RRL_CLSBLK_MAXLEN (1 + 8 + 255)
 /* CIDR block prefix lengths for v4/v6 */
@@ -34,8 +38,6 @@
 /* Defaults */
 #define RRL_SSTART 2 /* 1/Nth of the rate for slow start */
 #define RRL_PSIZE_LARGE 1024
-#define RRL_CAPACITY 4 /* Window size in seconds */
-#define RRL_LOCK_GRANULARITY 32 /* Last digit granularity */
 
 /* Classification */
 enum {
@@ -187,79 +189,51 @@ static int rrl_classify(uint8_t *dst, size_t maxlen, const struct sockaddr_stora
 	return blklen;
 }
 
-static int bucket_free(rrl_item_t *bucket, uint32_t now)
+static inline rrl_item_t bucket_load(rrl_table_t *tbl, rrl_item_t *bucket)
 {
-	return bucket->cls == CLS_NULL || (bucket->time + 1 < now);
+	rrl_item_t val;
+#ifdef HAVE_ATOMIC_LOCK_FREE_64
+	__atomic_load(bucket, &val, __ATOMIC_RELAXED);
+#else
+	pthread_mutex_lock(&tbl->lock);
+	val = *bucket;
+	pthread_mutex_unlock(&tbl->lock);
+#endif
+	return val;
 }
 
-static int bucket_match(rrl_item_t *bucket, rrl_item_t *match)
+static inline bool bucket_cas(rrl_table_t *tbl, rrl_item_t *bucket,
+                              rrl_item_t *expected, rrl_item_t *desired)
 {
-	return bucket->cls    == match->cls &&
-	       bucket->netblk == match->netblk &&
-	       bucket->qname  == match->qname;
-}
-
-static int find_free(rrl_table_t *tbl, unsigned id, uint32_t now)
-{
-	for (int i = id; i < tbl->size; i++) {
-		if (bucket_free(&tbl->arr[i], now)) {
-			return i - id;
-		}
-	}
-	for (int i = 0; i < id; i++) {
-		if (bucket_free(&tbl->arr[i], now)) {
-			return i + (tbl->size - id);
-		}
+#ifdef HAVE_ATOMIC_LOCK_FREE_64
+	return __atomic_compare_exchange(bucket, expected, desired, false,
+	                                 __ATOMIC_RELAXED, __ATOMIC_RELAXED);
+#else
+	pthread_mutex_lock(&tbl->lock);
+	bool equal = (memcmp(bucket, expected, sizeof(*bucket)) == 0);
+	if (equal) {
+		*bucket = *desired;
+	} else {
+		*expected = *bucket;
 	}
-
-	/* this happens if table is full... force vacate current elm */
-	return id;
+	pthread_mutex_unlock(&tbl->lock);
+	return equal;
+#endif
 }
 
-static inline unsigned find_match(rrl_table_t *tbl, uint32_t id, rrl_item_t *m)
+/*! \brief Seconds since the last bucket update, empty buckets are the oldest. */
+static inline unsigned bucket_age(const rrl_item_t *bucket, uint16_t now)
 {
-	unsigned new_id = 0;
-	unsigned hop = 0;
-	unsigned match_bitmap = tbl->arr[id].hop;
-	while (match_bitmap != 0) {
-		hop = __builtin_ctz(match_bitmap); /* offset of next potential match */
-		new_id = (id + hop) % tbl->size;
-		if (bucket_match(&tbl->arr[new_id], m)) {
-			return hop;
-		} else {
-			match_bitmap &= ~(1 << hop); /* clear potential match */
-		}
+	if (bucket->key == 0) {
+		return UINT16_MAX + 1;
 	}
 
-	return HOP_LEN + 1;
+	return (uint16_t)(now - bucket->time);
 }
 
-static inline unsigned reduce_dist(rrl_table_t *tbl, unsigned id, unsigned dist, unsigned *free_id)
+static inline uint16_t bucket_capacity(rrl_table_t *tbl)
 {
-	unsigned rd = HOP_LEN - 1;
-	while (rd > 0) {
-		unsigned vacate_id = (tbl->size + *free_id - rd) % tbl->size; /* bucket to be vacated */
-		if (tbl->arr[vacate_id].hop != 0) {
-			unsigned hop = __builtin_ctz(tbl->arr[vacate_id].hop);  /* offset of first valid bucket */
-			if (hop < rd) { /* only offsets in <vacate_id, free_id> are interesting */
-				unsigned new_id = (vacate_id + hop) % tbl->size; /* this item will be displaced to [free_id] */
-				unsigned keep_hop = tbl->arr[*free_id].hop; /* unpredictable padding */
-				memcpy(tbl->arr + *free_id, tbl->arr + new_id, sizeof(rrl_item_t));
-				tbl->arr[*free_id].hop = keep_hop;
-				tbl->arr[new_id].cls = CLS_NULL;
-				tbl->arr[vacate_id].hop &= ~(1 << hop);
-				tbl->arr[vacate_id].hop |= 1 << rd;
-				*free_id = new_id;
-				return dist - (rd - hop);
-			}
-		}
-		--rd;
-	}
-
-	assert(rd == 0); /* this happens with p=1/fact(HOP_LEN) */
-	*free_id = id;
-	dist = 0; /* force vacate initial element */
-	return dist;
+	return RRL_CAPACITY * tbl->rate;
 }
 
 static void subnet_tostr(char *dst, size_t maxlen, const struct sockaddr_storage *ss)
@@ -301,67 +275,17 @@ static void rrl_log_state(knotd_mod_t *mod, const struct sockaddr_storage *ss,
 	              addr_str, rrl_clsstr(cls), what);
 }
 
-static void rrl_lock(rrl_table_t *tbl, int lk_id)
-{
-	assert(lk_id > -1);
-	pthread_mutex_lock(tbl->lk + lk_id);
-}
-
-static void rrl_unlock(rrl_table_t *tbl, int lk_id)
-{
-	assert(lk_id > -1);
-	pthread_mutex_unlock(tbl->lk + lk_id);
-}
-
-static int rrl_setlocks(rrl_table_t *tbl, uint32_t granularity)
-{
-	assert(!tbl->lk); /* Cannot change while locks are used. */
-	assert(granularity <= tbl->size / 10); /* Due to int. division err. */
-
-	if (pthread_mutex_init(&tbl->ll, NULL) < 0) {
-		return KNOT_ENOMEM;
-	}
-
-	/* Alloc new locks. */
-	tbl->lk = malloc(granularity * sizeof(pthread_mutex_t));
-	if (!tbl->lk) {
-		return KNOT_ENOMEM;
-	}
-	memset(tbl->lk, 0, granularity * sizeof(pthread_mutex_t));
-
-	/* Initialize. */
-	for (size_t i = 0; i < granularity; ++i) {
-		if (pthread_mutex_init(tbl->lk + i, NULL) < 0) {
-			break;
-		}
-		++tbl->lk_count;
-	}
-
-	/* Incomplete initialization */
-	if (tbl->lk_count != granularity) {
-		for (size_t i = 0; i < tbl->lk_count; ++i) {
-			pthread_mutex_destroy(tbl->lk + i);
-		}
-		free(tbl->lk);
-		tbl->lk_count = 0;
-		return KNOT_ERROR;
-	}
-
-	return KNOT_EOK;
-}
-
 rrl_table_t *rrl_create(size_t size, uint32_t rate)
 {
-	if (size == 0) {
+	if (size == 0 || rate > RRL_RATE_MAX) {
 		return NULL;
 	}
 
-	const size_t tbl_len = sizeof(rrl_table_t) + size * sizeof(rrl_item_t);
-	rrl_table_t *tbl = calloc(1, tbl_len);
+	rrl_table_t *tbl = calloc(1, sizeof(rrl_table_t));
 	if (!tbl) {
 		return NULL;
 	}
-	tbl->size = size;
+	tbl->size = (size + RRL_WAYS - 1) / RRL_WAYS * RRL_WAYS;
 	tbl->rate = rate;
 
 	if (dnssec_random_buffer((uint8_t *)&tbl->key, sizeof(tbl->key)) != DNSSEC_EOK) {
@@ -369,18 +293,30 @@ rrl_table_t *rrl_create(size_t size, uint32_t rate)
 		return NULL;
 	}
 
-	if (rrl_setlocks(tbl, RRL_LOCK_GRANULARITY) != KNOT_EOK) {
+	/* Align the buckets so that each set occupies exactly one cache line. */
+	const size_t arr_len = tbl->size * sizeof(rrl_item_t);
+	if (posix_memalign((void **)&tbl->arr, RRL_LINE, arr_len) != 0) {
 		free(tbl);
 		return NULL;
 	}
+	memset(tbl->arr, 0, arr_len);
+
+#ifndef HAVE_ATOMIC_LOCK_FREE_64
+	pthread_mutex_init(&tbl->lock, NULL);
+#endif
 
 	return tbl;
 }
 
-/*! \brief Get bucket for current combination of parameters. */
+/*!
+ * \brief Get bucket for current combination of parameters.
+ *
+ * \param old     Current content of the returned bucket.
+ * \param bucket  Bucket state to be updated and stored if unchanged meanwhile.
+ */
 static rrl_item_t *rrl_hash(rrl_table_t *tbl, const struct sockaddr_storage *remote,
                             rrl_req_t *req, const knot_dname_t *zone, uint32_t stamp,
-                            int *lock)
+                            rrl_item_t *old, rrl_item_t *bucket)
 {
 	uint8_t buf[RRL_CLSBLK_MAXLEN];
 	int len = rrl_classify(buf, sizeof(buf), remote, req, zone);
@@ -388,63 +324,50 @@ static rrl_item_t *rrl_hash(rrl_table_t *tbl, const struct sockaddr_storage *rem
 		return NULL;
 	}
 
-	uint32_t id = SipHash24(&tbl->key, buf, len) % tbl->size;
+	uint64_t hash = SipHash24(&tbl->key, buf, len);
+	uint32_t key = hash >> 40;
+	if (key == 0) {
+		key = 1;
+	}
 
-	/* Lock for lookup. */
-	pthread_mutex_lock(&tbl->ll);
+	/* Find an exact match or the least recently used bucket in the set. */
+	rrl_item_t *set = tbl->arr + (hash % (tbl->size / RRL_WAYS)) * RRL_WAYS;
+	rrl_item_t *lru = NULL;
+	unsigned lru_age = 0;
+	for (unsigned i = 0; i < RRL_WAYS; i++) {
+		*old = bucket_load(tbl, &set[i]);
+		if (old->key == key) {
+			*bucket = *old;
+			return &set[i];
+		}
+		unsigned age = bucket_age(old, stamp);
+		if (lru == NULL || age > lru_age) {
+			lru = &set[i];
+			lru_age = age;
+		}
+	}
+	*old = bucket_load(tbl, lru);
 
-	/* Find an exact match in <id, id + HOP_LEN). */
-	knot_dname_t *qname = buf + sizeof(uint8_t) + sizeof(uint64_t);
-	uint64_t netblk;
-	memcpy(&netblk, buf + sizeof(uint8_t), sizeof(netblk));
-	rrl_item_t match = {
-		.hop = 0,
-		.netblk = netblk,
-		.ntok = tbl->rate * RRL_CAPACITY,
-		.cls = buf[0],
+	*bucket = (rrl_item_t) {
+		.ntok = bucket_capacity(tbl),
+		.time = stamp,
 		.flags = RRL_BF_NULL,
-		.qname = SipHash24(&tbl->key, qname, knot_dname_size(qname)),
-		.time = stamp
+		.key = key
 	};
 
-	unsigned dist = find_match(tbl, id, &match);
-	if (dist > HOP_LEN) { /* not an exact match, find free element [f] */
-		dist = find_free(tbl, id, stamp);
-	}
-
-	/* Reduce distance to fit <id, id + HOP_LEN) */
-	unsigned free_id = (id + dist) % tbl->size;
-	while (dist >= HOP_LEN) {
-		dist = reduce_dist(tbl, id, dist, &free_id);
-	}
-
-	/* Assign granular lock and unlock lookup. */
-	*lock = free_id % tbl->lk_count;
-	rrl_lock(tbl, *lock);
-	pthread_mutex_unlock(&tbl->ll);
-
-	/* found free bucket which is in <id, id + HOP_LEN) */
-	tbl->arr[id].hop |= (1 << dist);
-	rrl_item_t *bucket = &tbl->arr[free_id];
-	assert(free_id == (id + dist) % tbl->size);
-
-	/* Inspect bucket state. */
-	unsigned hop = bucket->hop;
-	if (bucket->cls == CLS_NULL) {
-		memcpy(bucket, &match, sizeof(rrl_item_t));
-		bucket->hop = hop;
-	}
-	/* Check for collisions. */
-	if (!bucket_match(bucket, &match)) {
-		if (!(bucket->flags & RRL_BF_SSTART)) {
-			memcpy(bucket, &match, sizeof(rrl_item_t));
-			bucket->hop = hop;
+	/* Check for collisions (reused bucket still active). */
+	if (bucket_age(old, stamp) <= 1) {
+		if (old->flags & RRL_BF_SSTART) {
+			bucket->ntok = old->ntok;
+			bucket->time = old->time;
+			bucket->flags = old->flags;
+		} else {
 			bucket->ntok = tbl->rate + tbl->rate / RRL_SSTART;
-			bucket->flags |= RRL_BF_SSTART;
+			bucket->flags = RRL_BF_SSTART;
 		}
 	}
 
-	return bucket;
+	return lru;
 }
 
 int rrl_query(rrl_table_t *rrl, const struct sockaddr_storage *remote,
@@ -454,60 +377,62 @@ int rrl_query(rrl_table_t *rrl, const struct sockaddr_storage *remote,
 		return KNOT_EINVAL;
 	}
 
-	/* Calculate hash and fetch */
-	int ret = KNOT_EOK;
-	int lock = -1;
 	uint32_t now = time_now().tv_sec;
-	rrl_item_t *bucket = rrl_hash(rrl, remote, req, zone, now, &lock);
-	if (!bucket) {
-		if (lock > -1) {
-			rrl_unlock(rrl, lock);
+
+	rrl_item_t *slot, old, bucket;
+	uint8_t log_flags;
+	int ret;
+	do {
+		/* Calculate hash and fetch */
+		slot = rrl_hash(rrl, remote, req, zone, now, &old, &bucket);
+		if (!slot) {
+			return KNOT_ERROR;
 		}
-		return KNOT_ERROR;
-	}
+		ret = KNOT_EOK;
+		log_flags = bucket.flags;
 
-	/* Calculate rate for dT */
-	uint32_t dt = now - bucket->time;
-	if (dt > RRL_CAPACITY) {
-		dt = RRL_CAPACITY;
-	}
-	/* Visit bucket. */
-	bucket->time = now;
-	if (dt > 0) { /* Window moved. */
-
-		/* Check state change. */
-		if ((bucket->ntok > 0 || dt > 1) && (bucket->flags & RRL_BF_ELIMIT)) {
-			bucket->flags &= ~RRL_BF_ELIMIT;
-			rrl_log_state(mod, remote, bucket->flags, bucket->cls);
+		/* Calculate rate for dT */
+		uint32_t dt = (uint16_t)(now - bucket.time);
+		if (dt > RRL_CAPACITY) {
+			dt = RRL_CAPACITY;
 		}
+		/* Visit bucket. */
+		bucket.time = now;
+		if (dt > 0) { /* Window moved. */
 
-		/* Add new tokens. */
-		uint32_t dn = rrl->rate * dt;
-		if (bucket->flags & RRL_BF_SSTART) { /* Bucket in slow-start. */
-			bucket->flags &= ~RRL_BF_SSTART;
+			/* Check state change. */
+			if ((bucket.ntok > 0 || dt > 1) && (bucket.flags & RRL_BF_ELIMIT)) {
+				bucket.flags &= ~RRL_BF_ELIMIT;
+			}
+
+			/* Add new tokens. */
+			uint32_t dn = rrl->rate * dt;
+			if (bucket.flags & RRL_BF_SSTART) { /* Bucket in slow-start. */
+				bucket.flags &= ~RRL_BF_SSTART;
+			}
+			bucket.ntok = MIN(bucket.ntok + dn, bucket_capacity(rrl));
 		}
-		bucket->ntok += dn;
-		if (bucket->ntok > RRL_CAPACITY * rrl->rate) {
-			bucket->ntok = RRL_CAPACITY * rrl->rate;
+
+		/* Last item taken. */
+		if (bucket.ntok == 1 && !(bucket.flags & RRL_BF_ELIMIT)) {
+			bucket.flags |= RRL_BF_ELIMIT;
 		}
-	}
 
-	/* Last item taken. */
-	if (bucket->ntok == 1 && !(bucket->flags & RRL_BF_ELIMIT)) {
-		bucket->flags |= RRL_BF_ELIMIT;
-		rrl_log_state(mod, remote, bucket->flags, bucket->cls);
-	}
+		/* Decay current bucket. */
+		if (bucket.ntok > 0) {
+			--bucket.ntok;
+		} else if (bucket.ntok == 0) {
+			ret = KNOT_ELIMIT;
+		}
 
-	/* Decay current bucket. */
-	if (bucket->ntok > 0) {
-		--bucket->ntok;
-	} else if (bucket->ntok == 0) {
-		ret = KNOT_ELIMIT;
-	}
+		/* Store the bucket, retry if updated by another thread meanwhile. */
+	} while (!bucket_cas(rrl, slot, &old, &bucket));
 
-	if (lock > -1) {
-		rrl_unlock(rrl, lock);
+	/* Log the state change once it's stored. */
+	if ((log_flags ^ bucket.flags) & RRL_BF_ELIMIT) {
+		rrl_log_state(mod, remote, bucket.flags, rrl_clsid(req));
 	}
+
 	return ret;
 }
 
@@ -526,13 +451,10 @@ bool rrl_slip_roll(int n_slip)
 void rrl_destroy(rrl_table_t *rrl)
 {
 	if (rrl) {
-		if (rrl->lk_count > 0) {
-			pthread_mutex_destroy(&rrl->ll);
-		}
-		for (size_t i = 0; i < rrl->lk_count; ++i) {
-			pthread_mutex_destroy(rrl->lk + i);
-		}
-		free(rrl->lk);
+#ifndef HAVE_ATOMIC_LOCK_FREE_64
+		pthread_mutex_destroy(&rrl->lock);
+#endif
+		free(rrl->arr);
 	}
 
 	free(rrl);
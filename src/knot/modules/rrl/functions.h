@@ -16,8 +16,8 @@
 
 #pragma once
 
-#include <stdint.h>
 #include <pthread.h>
+#include <stdint.h>
 #include <sys/socket.h>
 
 #include "libknot/libknot.h"
@@ -26,37 +26,41 @@
 
 /*!
  * \brief RRL hash bucket.
+ *
+ * The bucket fits into one machine word, which is updated atomically
+ * using compare-and-swap, so no locking is needed (unless atomic operations
+ * aren't available).
  */
 typedef struct {
-	unsigned hop;        /* Hop bitmap. */
-	uint64_t netblk;     /* Prefix associated. */
 	uint16_t ntok;       /* Tokens available. */
-	uint8_t  cls;        /* Bucket class. */
-	uint8_t  flags;      /* Flags. */
-	uint32_t qname;      /* imputed(QNAME) hash. */
-	uint32_t time;       /* Timestamp. */
+	uint16_t time;       /* Timestamp (seconds, wraps around). */
+	uint32_t flags : 8;  /* Flags. */
+	uint32_t key   : 24; /* Fingerprint of (class, netblock, name), 0 if empty. */
 } rrl_item_t;
 
+/*! \brief Window size in seconds. */
+#define RRL_CAPACITY 4
+
+/*! \brief Maximum rate, so that the bucket capacity fits into the tokens. */
+#define RRL_RATE_MAX (UINT16_MAX / RRL_CAPACITY)
+
 /*!
  * \brief RRL hash bucket table.
  *
- * Table is fixed size, so collisions may occur and are dealt with
- * in a way, that hashbucket rate is reset and enters slow-start for 1 dt.
+ * Table is fixed size and set-associative, a bucket can be stored only in one
+ * set of RRL_WAYS buckets, which fits into one cache line. If the set is full,
+ * the least recently used bucket is reused and enters slow-start for 1 dt.
  * When a bucket is in a slow-start mode, it cannot reset again for the time
  * period.
- *
- * To avoid lock contention, N locks are created and distributed amongst buckets.
- * As of now lock K for bucket N is calculated as K = N % (num_buckets).
  */
-
 typedef struct {
 	SIPHASH_KEY key;     /* Siphash key. */
 	uint32_t rate;       /* Configured RRL limit. */
-	pthread_mutex_t ll;
-	pthread_mutex_t *lk; /* Table locks. */
-	unsigned lk_count;   /* Table lock count (granularity). */
 	size_t size;         /* Number of buckets. */
-	rrl_item_t arr[];    /* Buckets. */
+	rrl_item_t *arr;     /* Buckets. */
+#ifndef HAVE_ATOMIC_LOCK_FREE_64
+	pthread_mutex_t lock; /* Buckets lock if no atomic operations. */
+#endif
 } rrl_table_t;
 
 /*! \brief RRL request flags. */
@@ -78,7 +82,7 @@ typedef struct {
 /*!
  * \brief Create a RRL table.
  * \param size Fixed hashtable size (reasonable large prime is recommended).
- * \param rate Rate (in pkts/sec).
+ * \param rate Rate (in pkts/sec), at most RRL_RATE_MAX.
  * \return created table or NULL.
  */
 rrl_table_t *rrl_create(size_t size, uint32_t rate);
@@ -24,7 +24,7 @@
 #define MOD_WHITELIST		"\x09""whitelist"
 
 const yp_item_t rrl_conf[] = {
-	{ MOD_RATE_LIMIT, YP_TINT, YP_VINT = { 1, INT32_MAX } },
+	{ MOD_RATE_LIMIT, YP_TINT, YP_VINT = { 1, RRL_RATE_MAX } },
 	{ MOD_SLIP,       YP_TINT, YP_VINT = { 0, 100, 1 } },
 	{ MOD_TBL_SIZE,   YP_TINT, YP_VINT = { 1, INT32_MAX, 393241 } },
 	{ MOD_WHITELIST,  YP_TNET, YP_VNONE, YP_FMULTI },
@@ -16,12 +16,16 @@
 
 #include <urcu.h>
 
+#include "contrib/macros.h"
 #include "contrib/mempattern.h"
 #include "contrib/sockaddr.h"
+#include "knot/conf/conf.h"
 #include "knot/nameserver/axfr.h"
 #include "knot/nameserver/internet.h"
 #include "knot/nameserver/log.h"
 #include "knot/nameserver/xfr.h"
+#include "knot/server/server.h"
+#include "knot/zone/axfr-cache.h"
 #include "libknot/libknot.h"
 
 #define ZONE_NAME(qdata) knot_pkt_qname((qdata)->query)
@@ -31,12 +35,18 @@
 	ns_log(priority, ZONE_NAME(qdata), LOG_OPERATION_AXFR, \
 	       LOG_DIRECTION_OUT, REMOTE(qdata), fmt)
 
+/*! \brief Space left in the pre-rendered messages for OPT and TSIG. */
+#define AXFR_CACHE_RESERVE 1024
+
 /* AXFR context. @note aliasing the generic xfr_proc */
 struct axfr_proc {
 	struct xfr_proc proc;
 	trie_it_t *i;
 	zone_tree_it_t it;
 	unsigned cur_rrset;
+	const axfr_cache_t *cache;
+	size_t cache_pos;
+	axfr_cache_t *build;
 };
 
 static int axfr_put_rrsets(knot_pkt_t *pkt, zone_node_t *node,
@@ -95,22 +105,141 @@ static int axfr_process_node_tree(knot_pkt_t *pkt, const void *item,
 	return ret;
 }
 
+/*!
+ * \brief Looks up the pre-rendered messages, or claims building them.
+ *
+ * The claiming transfer stores the messages it sends, these are composed
+ * with a larger space reserved for OPT and TSIG of the future queries.
+ * The concurrent transfers render the messages themselves meanwhile.
+ */
+static void axfr_cache_prepare(knot_pkt_t *pkt, struct axfr_proc *axfr,
+                               knotd_qdata_t *qdata)
+{
+	const zone_contents_t *contents = qdata->extra->contents;
+
+	conf_val_t val = conf_zone_get(conf(), C_AXFR_CACHE, qdata->extra->zone->name);
+	size_t limit = conf_int(&val);
+	if (limit == 0) {
+		return;
+	}
+
+	axfr->cache = axfr_cache_get(contents);
+	if (axfr->cache == NULL && pkt->reserved <= AXFR_CACHE_RESERVE &&
+	    axfr_cache_claim(contents)) {
+		axfr->build = axfr_cache_new(limit);
+		if (axfr->build == NULL) {
+			axfr_cache_release(contents);
+		}
+	}
+}
+
+/*!
+ * \brief Stores the answer section of the message being sent, publishes the
+ *        pre-rendered messages after the last one.
+ */
+static void axfr_cache_build(knot_pkt_t *pkt, struct axfr_proc *axfr,
+                             knotd_qdata_t *qdata, int state)
+{
+	const zone_contents_t *contents = qdata->extra->contents;
+	if (contents == NULL) { // Replaced meanwhile, the cache was freed with them.
+		axfr_cache_free(axfr->build);
+		axfr->build = NULL;
+		return;
+	}
+
+	if (state == KNOT_EOK || state == KNOT_ESPACE) {
+		size_t offset = KNOT_WIRE_HEADER_SIZE + knot_pkt_question_size(pkt);
+		int ret = axfr_cache_add(axfr->build, pkt->wire + offset, pkt->size - offset,
+		                         knot_wire_get_ancount(pkt->wire));
+		if (ret != KNOT_EOK) {
+			state = (ret == KNOT_ESPACE) ? KNOT_ELIMIT : ret;
+		}
+	}
+
+	switch (state) {
+	case KNOT_ESPACE: /* More messages to come. */
+		return;
+	case KNOT_EOK:
+		axfr_cache_publish(contents, axfr->build);
+		AXFROUT_LOG(LOG_DEBUG, qdata, "pre-rendered, serial %u, %zu bytes",
+		            zone_contents_serial(contents), axfr_cache_size(axfr->build));
+		axfr->build = NULL; // Owned by the contents.
+		return;
+	case KNOT_ELIMIT: /* Not to be repeated for these contents. */
+		axfr_cache_publish(contents, NULL);
+		AXFROUT_LOG(LOG_DEBUG, qdata, "not pre-rendered, serial %u, "
+		            "size limit exceeded", zone_contents_serial(contents));
+		break;
+	default:
+		axfr_cache_release(contents);
+		AXFROUT_LOG(LOG_DEBUG, qdata, "not pre-rendered, serial %u (%s)",
+		            zone_contents_serial(contents), knot_strerror(state));
+		break;
+	}
+
+	axfr_cache_free(axfr->build);
+	axfr->build = NULL;
+}
+
+/*!
+ * \brief Releases the claim of an interrupted building so that a later
+ *        transfer can retry it.
+ *
+ * The contents aren't locked between the messages, so they are looked up
+ * again and the claim is released only if they haven't been replaced.
+ */
+static void axfr_cache_abandon(struct axfr_proc *axfr, knotd_qdata_t *qdata)
+{
+	server_t *server = qdata->params->server;
+
+	rcu_read_lock();
+	zone_t *zone = knot_zonedb_find(server->zone_db, ZONE_NAME(qdata));
+	if (zone != NULL && zone->contents != NULL &&
+	    zone->contents->gen == qdata->extra->contents_gen) {
+		axfr_cache_release(zone->contents);
+	}
+	rcu_read_unlock();
+
+	axfr_cache_free(axfr->build);
+	axfr->build = NULL;
+}
+
+/*!
+ * \brief Puts the next pre-rendered message into the answer.
+ */
+static int axfr_put_cached(knot_pkt_t *pkt, struct axfr_proc *axfr, knotd_qdata_t *qdata)
+{
+	const uint8_t *data;
+	uint16_t size, ancount;
+	bool more = axfr_cache_next(axfr->cache, &axfr->cache_pos, &data, &size, &ancount);
+
+	assert(pkt->size + size <= pkt->max_size - pkt->reserved);
+	memcpy(pkt->wire + pkt->size, data, size);
+	pkt->size += size;
+	knot_wire_set_ancount(pkt->wire, ancount);
+
+	xfr_stats_add(&axfr->proc.stats, pkt->size + knot_rrset_size(&qdata->opt_rr));
+
+	return more ? KNOT_ESPACE : KNOT_EOK;
+}
+
 static void axfr_query_cleanup(knotd_qdata_t *qdata)
 {
 	struct axfr_proc *axfr = (struct axfr_proc *)qdata->extra->ext;
 
+	if (axfr->build != NULL) {
+		axfr_cache_abandon(axfr, qdata);
+	}
 	zone_tree_it_free(&axfr->it);
 	ptrlist_free(&axfr->proc.nodes, qdata->mm);
 	mm_free(qdata->mm, axfr);
-
-	/* Allow zone changes (finished). */
-	rcu_read_unlock();
 }
 
 static int axfr_query_check(knotd_qdata_t *qdata)
 {
 	NS_NEED_ZONE(qdata, KNOT_RCODE_NOTAUTH);
 	NS_NEED_AUTH(qdata, ACL_ACTION_TRANSFER);
+	NS_NEED_XFR_SLOT(qdata);
 	NS_NEED_ZONE_CONTENTS(qdata, KNOT_RCODE_SERVFAIL);
 
 	return KNOT_STATE_DONE;
@@ -153,9 +282,6 @@ static int axfr_query_init(knotd_qdata_t *qdata)
 	qdata->extra->ext = axfr;
 	qdata->extra->ext_cleanup = &axfr_query_cleanup;
 
-	/* No zone changes during multipacket answer (unlocked in axfr_answer_cleanup) */
-	rcu_read_lock();
-
 	return KNOT_EOK;
 }
 
@@ -199,8 +325,30 @@ int axfr_process_query(knot_pkt_t *pkt, knotd_qdata_t *qdata)
 		return KNOT_STATE_FAIL;
 	}
 
-	/* Answer current packet (or continue). */
-	ret = xfr_process_list(pkt, &axfr_process_node_tree, qdata);
+	/* Use the pre-rendered messages if they fit with this OPT and TSIG. */
+	if (axfr->proc.stats.messages == 0) {
+		axfr_cache_prepare(pkt, axfr, qdata);
+		if (axfr->cache != NULL &&
+		    pkt->size + axfr_cache_max_msg(axfr->cache) > pkt->max_size - pkt->reserved) {
+			axfr->cache = NULL;
+		}
+	}
+
+	/* Answer current packet (or continue), fails if the contents were replaced. */
+	if (axfr->cache != NULL && qdata->extra->contents != NULL) {
+		ret = axfr_put_cached(pkt, axfr, qdata);
+	} else if (axfr->build != NULL) {
+		/* Compose the message as if the OPT and TSIG were the largest. */
+		uint16_t extra = AXFR_CACHE_RESERVE - MIN(pkt->reserved, AXFR_CACHE_RESERVE);
+		ret = knot_pkt_reserve(pkt, extra);
+		if (ret == KNOT_EOK) {
+			ret = xfr_process_list(pkt, &axfr_process_node_tree, qdata);
+			(void)knot_pkt_reclaim(pkt, extra);
+		}
+		axfr_cache_build(pkt, axfr, qdata, ret);
+	} else {
+		ret = xfr_process_list(pkt, &axfr_process_node_tree, qdata);
+	}
 	switch (ret) {
 	case KNOT_ESPACE: /* Couldn't write more, send packet and continue. */
 		return KNOT_STATE_PRODUCE; /* Check for more. */
@@ -66,6 +66,13 @@ int internet_process_query(knot_pkt_t *pkt, knotd_qdata_t *qdata);
 		return KNOT_STATE_FAIL; \
 	}
 
+/*! \brief Require the transfer not to be over the limit (after authorization). */
+#define NS_NEED_XFR_SLOT(qdata) \
+	if ((qdata)->params->flags & KNOTD_QUERY_FLAG_XFR_LIMIT) { \
+		(qdata)->rcode = KNOT_RCODE_REFUSED; \
+		return KNOT_STATE_FAIL; \
+	}
+
 /*! \brief Require the zone not to be frozen. */
 #define NS_NEED_NOT_FROZEN(qdata, error_rcode) \
 	if ((qdata)->extra->zone->events.ufrozen) { \
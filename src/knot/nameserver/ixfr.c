@@ -14,8 +14,6 @@
     along with this program.  If not, see <https://www.gnu.org/licenses/>.
  */
 
-#include <urcu.h>
-
 #include "contrib/mempattern.h"
 #include "contrib/sockaddr.h"
 #include "knot/journal/journal_metadata.h"
@@ -132,6 +130,7 @@ static int ixfr_query_check(knotd_qdata_t *qdata)
 {
 	NS_NEED_ZONE(qdata, KNOT_RCODE_NOTAUTH);
 	NS_NEED_AUTH(qdata, ACL_ACTION_TRANSFER);
+	NS_NEED_XFR_SLOT(qdata);
 	NS_NEED_ZONE_CONTENTS(qdata, KNOT_RCODE_SERVFAIL);
 
 	/* Need SOA authority record. */
@@ -156,9 +155,6 @@ static void ixfr_answer_cleanup(knotd_qdata_t *qdata)
 	ptrlist_free(&ixfr->proc.nodes, mm);
 	journal_read_end(ixfr->journal_ctx);
 	mm_free(mm, qdata->extra->ext);
-
-	/* Allow zone changes (finished). */
-	rcu_read_unlock();
 }
 
 static int ixfr_answer_init(knotd_qdata_t *qdata, uint32_t *serial_from)
@@ -205,9 +201,6 @@ static int ixfr_answer_init(knotd_qdata_t *qdata, uint32_t *serial_from)
 	qdata->extra->ext = xfer;
 	qdata->extra->ext_cleanup = &ixfr_answer_cleanup;
 
-	/* No zone changes during multipacket answer (unlocked in ixfr_answer_cleanup) */
-	rcu_read_lock();
-
 	return KNOT_EOK;
 }
 
@@ -65,6 +65,7 @@ static void query_data_init(knot_layer_t *ctx, knotd_qdata_params_t *params,
 
 	/* Initialize lists. */
 	memset(extra, 0, sizeof(*extra));
+	extra->batch = ctx->batch;
 	init_list(&extra->wildcards);
 	init_list(&extra->rrsigs);
 }
@@ -180,12 +181,57 @@ static int query_chaos(knot_pkt_t *pkt, knot_layer_t *ctx)
 	return KNOT_STATE_DONE;
 }
 
+/*! \brief Find zone for given name, reuse the lookups within the batch. */
+static const zone_t *zonedb_find(process_query_batch_t *batch, knot_zonedb_t *zonedb,
+                                 const knot_dname_t *name, bool exact)
+{
+	if (batch == NULL) {
+		return exact ? knot_zonedb_find(zonedb, name) :
+		               knot_zonedb_find_suffix(zonedb, name);
+	}
+
+	if (batch->zonedb != zonedb) {
+		batch->zonedb = zonedb;
+		batch->count = 0;
+		batch->next = 0;
+	}
+
+	for (unsigned i = 0; i < batch->count; i++) {
+		if (batch->lookups[i].exact != exact) {
+			continue;
+		}
+		if (knot_dname_is_equal(batch->lookups[i].name, name)) {
+			return batch->lookups[i].zone;
+		}
+		/* Any name below a zone without subzones belongs to that zone. */
+		if (!exact && batch->lookups[i].leaf &&
+		    knot_dname_in_bailiwick(name, batch->lookups[i].zone->name) >= 0) {
+			return batch->lookups[i].zone;
+		}
+	}
+
+	const zone_t *zone = exact ? knot_zonedb_find(zonedb, name) :
+	                             knot_zonedb_find_suffix(zonedb, name);
+
+	unsigned slot = batch->next;
+	knot_dname_to_wire(batch->lookups[slot].name, name, sizeof(knot_dname_storage_t));
+	batch->lookups[slot].exact = exact;
+	batch->lookups[slot].leaf = !exact && zone != NULL &&
+	                            !knot_zonedb_has_subzone(zonedb, zone->name);
+	batch->lookups[slot].zone = zone;
+	batch->next = (slot + 1) % PROCESS_QUERY_BATCH_ZONES;
+	if (batch->count < PROCESS_QUERY_BATCH_ZONES) {
+		batch->count++;
+	}
+
+	return zone;
+}
+
 /*! \brief Find zone for given question. */
-static const zone_t *answer_zone_find(const knot_pkt_t *query, knot_zonedb_t *zonedb)
+static const zone_t *answer_zone_find(const knot_dname_t *qname, uint16_t qtype,
+                                      uint16_t qclass, bool normal,
+                                      knot_zonedb_t *zonedb, process_query_batch_t *batch)
 {
-	uint16_t qtype = knot_pkt_qtype(query);
-	uint16_t qclass = knot_pkt_qclass(query);
-	const knot_dname_t *qname = knot_pkt_qname(query);
 	const zone_t *zone = NULL;
 
 	// search for zone only for IN and ANY classes
@@ -199,7 +245,7 @@ static const zone_t *answer_zone_find(const knot_pkt_t *query, knot_zonedb_t *zo
 	 */
 	if (qtype == KNOT_RRTYPE_DS) {
 		const knot_dname_t *parent = knot_wire_next_label(qname, NULL);
-		zone = knot_zonedb_find_suffix(zonedb, parent);
+		zone = zonedb_find(batch, zonedb, parent, false);
 		/* If zone does not exist, search for its parent zone,
 		   this will later result to NODATA answer. */
 		/*! \note This is not 100% right, it may lead to DS name for example
@@ -209,12 +255,8 @@ static const zone_t *answer_zone_find(const knot_pkt_t *query, knot_zonedb_t *zo
 	}
 
 	if (zone == NULL) {
-		if (query_type(query) == KNOTD_QUERY_TYPE_NORMAL) {
-			zone = knot_zonedb_find_suffix(zonedb, qname);
-		} else {
-			// Direct match required.
-			zone = knot_zonedb_find(zonedb, qname);
-		}
+		// Direct match required for other than normal queries.
+		zone = zonedb_find(batch, zonedb, qname, !normal);
 	}
 
 	return zone;
@@ -361,6 +403,18 @@ static int answer_edns_put(knot_pkt_t *resp, knotd_qdata_t *qdata)
 	return ret;
 }
 
+/*!
+ * \brief Check if the contents of a multi-message answer are still published.
+ *
+ * The contents aren't locked between the messages, so they may have been
+ * replaced (and freed) meanwhile.
+ */
+static bool contents_current(const knotd_qdata_extra_t *extra)
+{
+	return extra->zone != NULL && extra->zone->contents != NULL &&
+	       extra->zone->contents->gen == extra->contents_gen;
+}
+
 /*! \brief Initialize response, sizes and find zone from which we're going to answer. */
 static int prepare_answer(knot_pkt_t *query, knot_pkt_t *resp, knot_layer_t *ctx)
 {
@@ -426,9 +480,21 @@ static int prepare_answer(knot_pkt_t *query, knot_pkt_t *resp, knot_layer_t *ctx
 	process_query_qname_case_lower(query);
 
 	/* Find zone for QNAME. */
-	qdata->extra->zone = answer_zone_find(query, server->zone_db);
+	qdata->extra->zone = answer_zone_find(knot_pkt_qname(query),
+	                                      knot_pkt_qtype(query),
+	                                      knot_pkt_qclass(query),
+	                                      query_type(query) == KNOTD_QUERY_TYPE_NORMAL,
+	                                      server->zone_db, ctx->batch);
 	if (qdata->extra->zone != NULL && qdata->extra->contents == NULL) {
+		/* Cached answers from later contents must not be mixed up. */
+		qdata->extra->cache_gen = answer_cache_gen(qdata->extra->zone->answer_cache);
 		qdata->extra->contents = qdata->extra->zone->contents;
+		if (qdata->extra->contents != NULL) {
+			qdata->extra->contents_gen = qdata->extra->contents->gen;
+		}
+	} else if (qdata->extra->contents != NULL && !contents_current(qdata->extra)) {
+		/* Multi-message answer, the contents were replaced meanwhile. */
+		qdata->extra->contents = NULL;
 	}
 
 	/* Allow normal queries to catalog only over TCP and if allowed by ACL. */
@@ -507,6 +573,102 @@ static int process_query_err(knot_layer_t *ctx, knot_pkt_t *pkt)
 	return KNOT_STATE_DONE;
 }
 
+/*! \brief Fill the answer cache key if the answer may be cached. */
+static bool answer_cache_key(knotd_qdata_t *qdata, const knot_pkt_t *resp,
+                             answer_cache_key_t *key)
+{
+	const zone_t *zone = qdata->extra->zone;
+	const knot_pkt_t *query = qdata->query;
+
+	/* Only plain queries answered from the zone without any module. */
+	if (zone == NULL || zone->answer_cache == NULL || zone->is_catalog_flag ||
+	    zone->query_plan != NULL || qdata->extra->contents == NULL ||
+	    conf()->query_plan != NULL || conf()->cache.srv_ans_rotate ||
+	    qdata->type != KNOTD_QUERY_TYPE_NORMAL || qdata->rcode != KNOT_RCODE_NOERROR ||
+	    query->tsig_rr != NULL || resp->max_size > UINT16_MAX) {
+		return false;
+	}
+
+	/* No other records than OPT without options. */
+	const uint8_t *wire = query->wire;
+	if (knot_wire_get_qdcount(wire) != 1 || knot_wire_get_ancount(wire) != 0 ||
+	    knot_wire_get_nscount(wire) != 0 ||
+	    knot_wire_get_arcount(wire) != (query->opt_rr != NULL ? 1 : 0)) {
+		return false;
+	}
+
+	key->flags = 0;
+	if (query->opt_rr != NULL) {
+		if (query->opt_rr->rrs.rdata->len > 0) {
+			return false;
+		}
+		key->flags |= ANSWER_CACHE_EDNS;
+		if (knot_pkt_has_dnssec(query)) {
+			key->flags |= ANSWER_CACHE_DO;
+		}
+	}
+
+	key->qname = knot_pkt_qname(query);
+	key->qtype = knot_pkt_qtype(query);
+	key->qclass = knot_pkt_qclass(query);
+	key->max_size = resp->max_size;
+
+	return true;
+}
+
+/*!
+ * \brief Answer from the answer cache.
+ *
+ * ID, RD and CD flags are taken from the prepared response header (i.e. as
+ * without the cache), the QNAME case is restored from the query.
+ */
+static bool answer_cache_answer(knotd_qdata_t *qdata, knot_pkt_t *resp,
+                                const answer_cache_key_t *key)
+{
+	const zone_t *zone = qdata->extra->zone;
+
+	uint16_t id = knot_wire_get_id(resp->wire);
+	bool rd = knot_wire_get_rd(resp->wire);
+	bool cd = knot_wire_get_cd(resp->wire);
+
+	size_t size = answer_cache_get(zone->answer_cache, qdata->extra->cache_gen,
+	                               key, resp->wire, resp->max_size);
+	if (size == 0) {
+		return false;
+	}
+	resp->size = size;
+
+	knot_wire_set_id(resp->wire, id);
+	if (rd) {
+		knot_wire_set_rd(resp->wire);
+	} else {
+		knot_wire_clear_rd(resp->wire);
+	}
+	if (cd) {
+		knot_wire_set_cd(resp->wire);
+	} else {
+		knot_wire_clear_cd(resp->wire);
+	}
+	process_query_qname_case_restore(resp, qdata);
+
+	return true;
+}
+
+/*! \brief Offer the finished answer to the answer cache. */
+static void answer_cache_store(knotd_qdata_t *qdata, const knot_pkt_t *resp,
+                               const answer_cache_key_t *key)
+{
+	const uint8_t *wire = resp->wire;
+	uint8_t rcode = knot_wire_get_rcode(wire);
+	if ((rcode != KNOT_RCODE_NOERROR && rcode != KNOT_RCODE_NXDOMAIN) ||
+	    knot_wire_get_tc(wire) || resp->tsig_wire.pos != NULL) {
+		return;
+	}
+
+	answer_cache_put(qdata->extra->zone->answer_cache, qdata->extra->cache_gen,
+	                 key, wire, resp->size);
+}
+
 #define PROCESS_BEGIN(plan, step, next_state, qdata) \
 	if (plan != NULL) { \
 		WALK_LIST(step, plan->stage[KNOTD_STAGE_BEGIN]) { \
@@ -539,6 +701,7 @@ static int process_query_out(knot_layer_t *ctx, knot_pkt_t *pkt)
 	struct query_step *step;
 
 	int next_state = KNOT_STATE_PRODUCE;
+	bool cacheable = false;
 
 	/* Check parse state. */
 	knot_pkt_t *query = qdata->query;
@@ -554,6 +717,15 @@ static int process_query_out(knot_layer_t *ctx, knot_pkt_t *pkt)
 		goto finish;
 	}
 
+	/* Answer from the answer cache if possible. */
+	answer_cache_key_t cache_key;
+	cacheable = answer_cache_key(qdata, pkt, &cache_key);
+	if (cacheable && answer_cache_answer(qdata, pkt, &cache_key)) {
+		cacheable = false;
+		next_state = KNOT_STATE_FINAL;
+		goto finish;
+	}
+
 	if (qdata->extra->zone != NULL && qdata->extra->zone->query_plan != NULL) {
 		zone_plan = qdata->extra->zone->query_plan;
 	}
@@ -617,6 +789,9 @@ finish:
 		break;
 	default:
 		set_rcode_to_packet(pkt, qdata);
+		if (cacheable && next_state == KNOT_STATE_DONE) {
+			answer_cache_store(qdata, pkt, &cache_key);
+		}
 	}
 
 	/* After query processing code. */
@@ -628,6 +803,26 @@ finish:
 	return next_state;
 }
 
+int process_query_find_dname(knotd_qdata_t *qdata, const knot_dname_t *name)
+{
+	knotd_qdata_extra_t *extra = qdata->extra;
+	process_query_batch_t *batch = extra->batch;
+
+	/* The prefetched lookup is valid within the batch RCU section only. */
+	if (batch != NULL && batch->prefetch.contents != NULL &&
+	    batch->prefetch.contents == extra->contents &&
+	    knot_dname_is_equal(batch->prefetch.name, name)) {
+		batch->prefetch.contents = NULL;
+		extra->node = batch->prefetch.node;
+		extra->encloser = batch->prefetch.encloser;
+		extra->previous = batch->prefetch.previous;
+		return batch->prefetch.ret;
+	}
+
+	return zone_contents_find_dname(extra->contents, name, &extra->node,
+	                                &extra->encloser, &extra->previous);
+}
+
 bool process_query_acl_check(conf_t *conf, acl_action_t action,
                              knotd_qdata_t *qdata)
 {
@@ -914,7 +1109,112 @@ int process_query_put_rr(knot_pkt_t *pkt, knotd_qdata_t *qdata,
 	return ret;
 }
 
+size_t *process_query_defer(knotd_qdata_t *qdata, process_query_resume_cb_t cb,
+                            void *ctx)
+{
+	process_query_batch_t *batch = qdata->extra->batch;
+	if (batch == NULL || batch->answer_size == NULL) {
+		return NULL;
+	}
+
+	unsigned i = 0;
+	while (i < batch->resume_count &&
+	       (batch->resume[i].cb != cb || batch->resume[i].ctx != ctx)) {
+		i++;
+	}
+	if (i == batch->resume_count) {
+		if (i == PROCESS_QUERY_BATCH_RESUME) {
+			return NULL;
+		}
+		batch->resume[i].cb = cb;
+		batch->resume[i].ctx = ctx;
+		batch->resume_count++;
+	}
+
+	/* Only one deferral of the answer. */
+	size_t *size = batch->answer_size;
+	batch->answer_size = NULL;
+	return size;
+}
+
+void process_query_resume(process_query_batch_t *batch)
+{
+	for (unsigned i = 0; i < batch->resume_count; i++) {
+		batch->resume[i].cb(batch->resume[i].ctx);
+	}
+	batch->resume_count = 0;
+}
+
 /*! \brief Module implementation. */
+static void process_query_batch_begin(knot_layer_t *ctx, void *batch)
+{
+	UNUSED(ctx);
+	UNUSED(batch);
+
+	/* Zones found within the batch must stay valid until its end. */
+	rcu_read_lock();
+}
+
+static void process_query_batch_prefetch(knot_layer_t *ctx, const uint8_t *wire,
+                                         size_t size)
+{
+	process_query_batch_t *batch = ctx->batch;
+	batch->prefetch.contents = NULL;
+
+	/* Only a single question normal query is considered. */
+	if (size <= KNOT_WIRE_HEADER_SIZE || knot_wire_get_qr(wire) ||
+	    knot_wire_get_opcode(wire) != KNOT_OPCODE_QUERY ||
+	    knot_wire_get_qdcount(wire) != 1) {
+		return;
+	}
+
+	const uint8_t *pos = wire + KNOT_WIRE_HEADER_SIZE;
+	const uint8_t *end = wire + size;
+	int qname_size = knot_dname_wire_check(pos, end, NULL);
+	if (qname_size <= 0 || pos + qname_size + 2 * sizeof(uint16_t) > end) {
+		return;
+	}
+
+	uint16_t qtype = knot_wire_read_u16(pos + qname_size);
+	uint16_t qclass = knot_wire_read_u16(pos + qname_size + sizeof(uint16_t));
+	if (qtype == 0 || qtype == KNOT_RRTYPE_AXFR || qtype == KNOT_RRTYPE_IXFR) {
+		return;
+	}
+
+	knot_dname_t *qname = batch->prefetch.name;
+	memcpy(qname, pos, qname_size);
+	knot_dname_to_lower(qname);
+
+	const zone_t *zone = answer_zone_find(qname, qtype, qclass, true,
+	                                      batch->server->zone_db, batch);
+	if (zone == NULL || zone->contents == NULL) {
+		return;
+	}
+
+	/* Look up the node once, it's used when answering the query. */
+	batch->prefetch.ret = zone_contents_find_dname(zone->contents, qname,
+	                                               &batch->prefetch.node,
+	                                               &batch->prefetch.encloser,
+	                                               &batch->prefetch.previous);
+	batch->prefetch.contents = zone->contents;
+
+	/* Fetch the node data meanwhile the current query is answered. */
+	if (batch->prefetch.ret == ZONE_NAME_FOUND) {
+		__builtin_prefetch(batch->prefetch.node->rrs);
+	}
+}
+
+static void process_query_batch_end(knot_layer_t *ctx)
+{
+	process_query_batch_t *batch = ctx->batch;
+
+	/* Don't keep the lookups outside of the RCU section. */
+	batch->zonedb = NULL;
+	batch->prefetch.contents = NULL;
+
+	rcu_read_unlock();
+}
+
 const knot_layer_api_t *process_query_layer(void)
 {
 	static const knot_layer_api_t api = {
@@ -923,6 +1223,9 @@ const knot_layer_api_t *process_query_layer(void)
 		.finish  = &process_query_finish,
 		.consume = &process_query_in,
 		.produce = &process_query_out,
+		.batch_begin    = &process_query_batch_begin,
+		.batch_prefetch = &process_query_batch_prefetch,
+		.batch_end      = &process_query_batch_end,
 	};
 	return &api;
 }
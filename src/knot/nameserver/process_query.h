@@ -24,10 +24,90 @@
 /* Query processing module implementation. */
 const knot_layer_api_t *process_query_layer(void);
 
+/*! \brief Number of remembered zone lookups within a batch. */
+#define PROCESS_QUERY_BATCH_ZONES 8
+
+/*! \brief Number of callbacks completing deferred answers within a batch. */
+#define PROCESS_QUERY_BATCH_RESUME 4
+
+/*! \brief Callback completing the answers deferred within a batch. */
+typedef void (*process_query_resume_cb_t)(void *ctx);
+
+/*!
+ * \brief Query batch processing context.
+ *
+ * The whole batch is processed within one RCU read-side critical section,
+ * so the zone lookups remain valid until the end of the batch. The node of
+ * the next query is looked up in advance, while the current one is answered.
+ */
+typedef struct {
+	struct server *server;  /*!< Server with the zone database. */
+	knot_zonedb_t *zonedb;  /*!< Zone database the remembered lookups are valid for. */
+	unsigned count;         /*!< Number of remembered lookups. */
+	unsigned next;          /*!< Next lookup to be replaced. */
+	struct {
+		knot_dname_storage_t name; /*!< Looked up name. */
+		bool exact;                /*!< Direct match required. */
+		bool leaf;                 /*!< No zone below the found zone. */
+		const zone_t *zone;        /*!< Lookup result. */
+	} lookups[PROCESS_QUERY_BATCH_ZONES];
+	struct {
+		knot_dname_storage_t name;       /*!< Query name of the next query. */
+		const zone_contents_t *contents; /*!< Contents looked up in (NULL if none). */
+		int ret;                         /*!< zone_contents_find_dname() result. */
+		const zone_node_t *node, *encloser, *previous;
+	} prefetch;
+	size_t *answer_size;    /*!< Size of the current answer if it can be deferred. */
+	unsigned resume_count;  /*!< Number of callbacks completing deferred answers. */
+	struct {
+		process_query_resume_cb_t cb;
+		void *ctx;
+	} resume[PROCESS_QUERY_BATCH_RESUME];
+} process_query_batch_t;
+
+/*!
+ * \brief Initializes the batch context for the layer batch processing.
+ *
+ * \see knot_layer_batch_begin()
+ */
+inline static void process_query_batch_init(process_query_batch_t *batch,
+                                            struct server *server)
+{
+	batch->server = server;
+	batch->zonedb = NULL;
+	batch->count = 0;
+	batch->next = 0;
+	batch->prefetch.contents = NULL;
+	batch->answer_size = NULL;
+	batch->resume_count = 0;
+}
+
+/*!
+ * \brief Leave the current answer to be completed at the end of the batch.
+ *
+ * The answer wire stays valid until the batch is sent. The callback is called
+ * once for all the answers it deferred, it may rewrite them and their sizes.
+ * The answer as processed now is sent unless rewritten.
+ *
+ * \param qdata  Query data.
+ * \param cb     Callback completing the deferred answers.
+ * \param ctx    Callback context.
+ *
+ * \return Where to store the final answer size, NULL if the answer can't be deferred.
+ */
+size_t *process_query_defer(knotd_qdata_t *qdata, process_query_resume_cb_t cb,
+                            void *ctx);
+
+/*!
+ * \brief Complete the answers deferred within the batch, to be called before sending it.
+ */
+void process_query_resume(process_query_batch_t *batch);
+
 /*! \brief Query processing intermediate data. */
 typedef struct knotd_qdata_extra {
 	const zone_t *zone;  /*!< Zone from which is answered. */
 	const zone_contents_t *contents; /*!< Zone contents from which is answered. */
+	process_query_batch_t *batch; /*!< Batch being processed (optional). */
 	list_t wildcards;    /*!< Visited wildcards. */
 	list_t rrsigs;       /*!< Section RRSIGs. */
 	uint8_t *opt_rr_pos; /*!< Place of the OPT RR in wire. */
@@ -38,6 +118,8 @@ typedef struct knotd_qdata_extra {
 	/* Original QNAME case. */
 	knot_dname_storage_t orig_qname;
 	uint8_t cname_chain; /*!< Length of the CNAME chain so far. */
+	uint32_t cache_gen;  /*!< Answer cache generation at the contents lookup. */
+	uint64_t contents_gen; /*!< Generation of the contents from which is answered. */
 
 	/* Extensions. */
 	void *ext;
@@ -59,6 +141,15 @@ struct rrsig_info {
 	knot_rrinfo_t *rrinfo;    /* RR info. */
 };
 
+/*!
+ * \brief Find the node of the name in the zone contents from which is answered.
+ *
+ * The lookup done in advance within the batch is used if it matches.
+ *
+ * \see zone_contents_find_dname()
+ */
+int process_query_find_dname(knotd_qdata_t *qdata, const knot_dname_t *name);
+
 /*!
  * \brief Check current query against ACL.
  *
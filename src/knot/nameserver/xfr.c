@@ -27,7 +27,7 @@ int xfr_process_list(knot_pkt_t *pkt, xfr_put_cb put, knotd_qdata_t *qdata)
 	knot_mm_t *mm = qdata->mm;
 	struct xfr_proc *xfer = qdata->extra->ext;
 
-	/* Check if the zone wasn't expired during multi-message transfer. */
+	/* Check if the zone wasn't expired or replaced during multi-message transfer. */
 	const zone_contents_t *contents = qdata->extra->contents;
 	if (contents == NULL) {
 		return KNOT_ENOZONE;
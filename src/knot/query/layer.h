@@ -46,6 +46,7 @@ typedef struct {
 	void *data;                   //!< Module specific.
 	tsig_ctx_t *tsig;             //!< TODO: remove
 	unsigned flags;               //!< Custom flags.
+	void *batch;                  //!< Batch processing context (optional).
 } knot_layer_t;
 
 /*! \brief Packet processing module API. */
@@ -55,6 +56,11 @@ struct knot_layer_api {
 	int (*finish)(knot_layer_t *ctx);
 	int (*consume)(knot_layer_t *ctx, knot_pkt_t *pkt);
 	int (*produce)(knot_layer_t *ctx, knot_pkt_t *pkt);
+
+	/* Optional batch processing, see knot_layer_batch_begin(). */
+	void (*batch_begin)(knot_layer_t *ctx, void *batch);
+	void (*batch_prefetch)(knot_layer_t *ctx, const uint8_t *wire, size_t size);
+	void (*batch_end)(knot_layer_t *ctx);
 };
 
 /*! \brief Helper for conditional layer call. */
@@ -133,3 +139,51 @@ inline static void knot_layer_produce(knot_layer_t *ctx, knot_pkt_t *pkt)
 {
 	LAYER_CALL(ctx, produce, pkt);
 }
+
+/*!
+ * \brief Start processing of a batch of packets.
+ *
+ * Packets processed (begin ... finish) until knot_layer_batch_end() share
+ * the batch context, which allows the layer to share state among them.
+ *
+ * \param ctx   Layer context.
+ * \param batch Layer specific batch context.
+ */
+inline static void knot_layer_batch_begin(knot_layer_t *ctx, void *batch)
+{
+	assert(ctx->api);
+	ctx->batch = batch;
+	if (ctx->api->batch_begin) {
+		ctx->api->batch_begin(ctx, batch);
+	}
+}
+
+/*!
+ * \brief Hint the layer which packet of the batch will be processed next.
+ *
+ * \param ctx  Layer context.
+ * \param wire Wire format of the next packet.
+ * \param size Size of the next packet.
+ */
+inline static void knot_layer_batch_prefetch(knot_layer_t *ctx, const uint8_t *wire,
+                                             size_t size)
+{
+	assert(ctx->api);
+	if (ctx->batch != NULL && ctx->api->batch_prefetch) {
+		ctx->api->batch_prefetch(ctx, wire, size);
+	}
+}
+
+/*!
+ * \brief Finish processing of a batch of packets.
+ *
+ * \param ctx Layer context.
+ */
+inline static void knot_layer_batch_end(knot_layer_t *ctx)
+{
+	assert(ctx->api);
+	if (ctx->batch != NULL && ctx->api->batch_end) {
+		ctx->api->batch_end(ctx);
+	}
+	ctx->batch = NULL;
+}
@@ -0,0 +1,299 @@
+/*  Copyright (C) 2020 CZ.NIC, z.s.p.o. <knot-dns@labs.nic.cz>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <dirent.h>
+#include <ifaddrs.h>
+#include <net/if.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "knot/server/affinity.h"
+#include "knot/server/dthreads.h"
+#include "libknot/errcode.h"
+#include "contrib/sockaddr.h"
+
+#define SYSFS_NET	"/sys/class/net"
+#define SYSFS_NODE	"/sys/devices/system/node"
+#define PROC_IRQ	"/proc/irq"
+
+/*! \brief CPU preference (higher is better). */
+enum {
+	CPU_REMOTE = 0, /*!< Not related to the listening interfaces. */
+	CPU_LOCAL  = 1, /*!< On the NUMA node of some listening interface. */
+	CPU_IRQ    = 2, /*!< Serving interrupts of some listening interface. */
+	CPU_PRIO_COUNT = 4
+};
+
+/*! \brief Marks CPUs from a kernel cpulist file (e.g. "0-3,8,10-11"). */
+static void read_cpulist(const char *path, bool *mask, unsigned cpus)
+{
+	FILE *file = fopen(path, "r");
+	if (file == NULL) {
+		return;
+	}
+
+	char buf[1024];
+	char *pos = fgets(buf, sizeof(buf), file);
+	fclose(file);
+
+	while (pos != NULL && *pos != '\0' && *pos != '\n') {
+		char *end = NULL;
+		unsigned long first = strtoul(pos, &end, 10);
+		if (end == pos) {
+			break;
+		}
+		unsigned long last = first;
+		if (*end == '-') {
+			pos = end + 1;
+			last = strtoul(pos, &end, 10);
+			if (end == pos) {
+				break;
+			}
+		}
+		for (unsigned long cpu = first; cpu <= last && cpu < cpus; cpu++) {
+			mask[cpu] = true;
+		}
+		pos = (*end == ',') ? end + 1 : NULL;
+	}
+}
+
+/*! \brief Fills the NUMA node of each CPU, -1 if unknown. */
+static void read_nodes(int *node, unsigned cpus)
+{
+	for (unsigned i = 0; i < cpus; i++) {
+		node[i] = -1;
+	}
+
+	bool *mask = malloc(cpus * sizeof(bool));
+	DIR *dir = opendir(SYSFS_NODE);
+	if (mask == NULL || dir == NULL) {
+		free(mask);
+		if (dir != NULL) {
+			closedir(dir);
+		}
+		return;
+	}
+
+	struct dirent *ent;
+	while ((ent = readdir(dir)) != NULL) {
+		unsigned id;
+		if (sscanf(ent->d_name, "node%u", &id) != 1) {
+			continue;
+		}
+
+		char path[512];
+		(void)snprintf(path, sizeof(path), SYSFS_NODE "/%s/cpulist", ent->d_name);
+		memset(mask, 0, cpus * sizeof(bool));
+		read_cpulist(path, mask, cpus);
+		for (unsigned i = 0; i < cpus; i++) {
+			if (mask[i]) {
+				node[i] = id;
+			}
+		}
+	}
+
+	closedir(dir);
+	free(mask);
+}
+
+/*! \brief Marks CPUs local to the interface and CPUs serving its interrupts. */
+static void read_iface(const char *name, bool *local, bool *irq, unsigned cpus)
+{
+	char path[512];
+	(void)snprintf(path, sizeof(path), SYSFS_NET "/%s/device/local_cpulist", name);
+	read_cpulist(path, local, cpus);
+
+	(void)snprintf(path, sizeof(path), SYSFS_NET "/%s/device/msi_irqs", name);
+	DIR *dir = opendir(path);
+	if (dir == NULL) {
+		return;
+	}
+
+	struct dirent *ent;
+	while ((ent = readdir(dir)) != NULL) {
+		unsigned num;
+		if (sscanf(ent->d_name, "%u", &num) != 1) {
+			continue;
+		}
+
+		char irq_path[64];
+		(void)snprintf(irq_path, sizeof(irq_path), PROC_IRQ "/%u/smp_affinity_list", num);
+		read_cpulist(irq_path, irq, cpus);
+	}
+
+	closedir(dir);
+}
+
+/*! \brief Checks if the interface address is used for listening. */
+static bool iface_listens(const struct ifaddrs *ifa,
+                          const struct sockaddr_storage *addrs, size_t naddrs)
+{
+	if (ifa->ifa_addr == NULL || (ifa->ifa_flags & IFF_LOOPBACK)) {
+		return false;
+	}
+
+	const struct sockaddr_storage *ifa_addr = (struct sockaddr_storage *)ifa->ifa_addr;
+	for (size_t i = 0; i < naddrs; i++) {
+		if (addrs[i].ss_family != ifa_addr->ss_family) {
+			continue;
+		}
+		if (sockaddr_is_any(&addrs[i]) ||
+		    sockaddr_cmp(&addrs[i], ifa_addr, true) == 0) {
+			return true;
+		}
+	}
+
+	return false;
+}
+
+/*! \brief Computes the preference of each CPU according to the listening interfaces. */
+static void read_prio(unsigned *prio, unsigned cpus,
+                      const struct sockaddr_storage *addrs, size_t naddrs)
+{
+	bool *local = calloc(cpus, sizeof(bool));
+	bool *irq = calloc(cpus, sizeof(bool));
+	struct ifaddrs *ifaces = NULL;
+	if (local == NULL || irq == NULL || getifaddrs(&ifaces) != 0) {
+		goto finish;
+	}
+
+	for (struct ifaddrs *ifa = ifaces; ifa != NULL; ifa = ifa->ifa_next) {
+		if (iface_listens(ifa, addrs, naddrs)) {
+			read_iface(ifa->ifa_name, local, irq, cpus);
+		}
+	}
+
+	for (unsigned i = 0; i < cpus; i++) {
+		prio[i] = (irq[i] ? CPU_IRQ : 0) + (local[i] ? CPU_LOCAL : 0);
+	}
+
+	freeifaddrs(ifaces);
+finish:
+	free(local);
+	free(irq);
+}
+
+/*! \brief Assigns workers to CPUs in order of preference and fills the steering table. */
+static void place_workers(udp_affinity_t *aff, const unsigned *prio, const int *node)
+{
+	const unsigned cpus = aff->cpus;
+
+	/* Order CPUs by preference, stable with respect to the CPU id. */
+	unsigned order[cpus];
+	unsigned count = 0;
+	for (int p = CPU_PRIO_COUNT - 1; p >= 0; p--) {
+		for (unsigned i = 0; i < cpus; i++) {
+			if (prio[i] == p) {
+				order[count++] = i;
+			}
+		}
+	}
+
+	for (unsigned i = 0; i < aff->workers; i++) {
+		aff->cpu[i] = order[i % cpus];
+	}
+
+	/* Steer each CPU to its own worker, or to a worker on the same node. */
+	unsigned same_node[aff->workers];
+	for (unsigned i = 0; i < cpus; i++) {
+		aff->steer[i] = i % aff->workers;
+
+		unsigned n = 0;
+		bool own = false;
+		for (unsigned w = 0; w < aff->workers; w++) {
+			if (aff->cpu[w] == i) {
+				aff->steer[i] = w;
+				own = true;
+				break;
+			}
+			if (node[i] >= 0 && node[aff->cpu[w]] == node[i]) {
+				same_node[n++] = w;
+			}
+		}
+		if (!own && n > 0) {
+			aff->steer[i] = same_node[i % n];
+		}
+	}
+}
+
+int udp_affinity_init(udp_affinity_t *aff, unsigned workers, bool topology,
+                      const struct sockaddr_storage *addrs, size_t naddrs)
+{
+	if (aff == NULL) {
+		return KNOT_EINVAL;
+	}
+
+	memset(aff, 0, sizeof(*aff));
+
+	int online = dt_online_cpus();
+	if (online <= 1 || workers == 0) {
+		return KNOT_EOK;
+	}
+
+	aff->workers = workers;
+	aff->cpus = online;
+	aff->cpu = malloc(workers * sizeof(unsigned));
+	if (aff->cpu == NULL) {
+		return KNOT_ENOMEM;
+	}
+
+	if (!topology) {
+		for (unsigned i = 0; i < workers; i++) {
+			aff->cpu[i] = i % aff->cpus;
+		}
+		return KNOT_EOK;
+	}
+
+	aff->steer = malloc(aff->cpus * sizeof(unsigned));
+	unsigned *prio = calloc(aff->cpus, sizeof(unsigned));
+	int *node = malloc(aff->cpus * sizeof(int));
+	if (aff->steer == NULL || prio == NULL || node == NULL) {
+		free(prio);
+		free(node);
+		udp_affinity_deinit(aff);
+		return KNOT_ENOMEM;
+	}
+
+	read_prio(prio, aff->cpus, addrs, naddrs);
+	read_nodes(node, aff->cpus);
+	place_workers(aff, prio, node);
+
+	free(prio);
+	free(node);
+
+	return KNOT_EOK;
+}
+
+void udp_affinity_deinit(udp_affinity_t *aff)
+{
+	if (aff == NULL) {
+		return;
+	}
+
+	free(aff->cpu);
+	free(aff->steer);
+	memset(aff, 0, sizeof(*aff));
+}
+
+int udp_affinity_cpu(const udp_affinity_t *aff, unsigned worker)
+{
+	if (aff == NULL || worker >= aff->workers) {
+		return -1;
+	}
+
+	return aff->cpu[worker];
+}
@@ -0,0 +1,68 @@
+/*  Copyright (C) 2020 CZ.NIC, z.s.p.o. <knot-dns@labs.nic.cz>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/*!
+ * \brief CPU placement of UDP workers.
+ *
+ * Each UDP worker is pinned to one CPU. With topology awareness, the CPUs
+ * serving the receive interrupts of the listening network interfaces are
+ * preferred, followed by the CPUs on the NUMA node of the interfaces. The
+ * steering table maps each CPU to the reuseport socket (worker) which should
+ * process the packets received on that CPU, preferring the worker on the same
+ * CPU and then a worker on the same NUMA node.
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <sys/socket.h>
+
+/*! \brief UDP workers placement. */
+typedef struct {
+	unsigned workers;  /*!< Number of UDP workers. */
+	unsigned *cpu;     /*!< CPU assigned to each worker. */
+	unsigned cpus;     /*!< Number of CPUs in the steering table. */
+	unsigned *steer;   /*!< Worker for each CPU (optional). */
+} udp_affinity_t;
+
+/*!
+ * \brief Computes the placement of UDP workers.
+ *
+ * Without topology awareness, worker N is assigned to CPU N % online_cpus
+ * and no steering table is created.
+ *
+ * \param aff       Placement to be initialized.
+ * \param workers   Number of UDP workers.
+ * \param topology  Consider the NIC interrupt affinity and NUMA topology.
+ * \param addrs     Listening addresses (used to find the interfaces).
+ * \param naddrs    Number of listening addresses.
+ *
+ * \retval KNOT_EOK if success.
+ * \retval KNOT_ENOMEM if out of memory.
+ */
+int udp_affinity_init(udp_affinity_t *aff, unsigned workers, bool topology,
+                      const struct sockaddr_storage *addrs, size_t naddrs);
+
+/*!
+ * \brief Deinitializes the placement.
+ */
+void udp_affinity_deinit(udp_affinity_t *aff);
+
+/*!
+ * \brief Returns the CPU for the given worker, or -1 if not assigned.
+ */
+int udp_affinity_cpu(const udp_affinity_t *aff, unsigned worker);
@@ -111,20 +111,41 @@ static void server_deinit_iface_list(iface_t *ifaces, size_t n)
  * \param sock        Socket where to attach the CBPF filter to.
  * \param sock_count  Number of sockets.
  */
-static bool server_attach_reuseport_bpf(const int sock, const int sock_count)
+static bool server_attach_reuseport_bpf(const int sock, const int sock_count,
+                                        const unsigned *steer, unsigned steer_count)
 {
 #ifdef SO_ATTACH_REUSEPORT_CBPF
-	struct sock_filter code[] = {
-		/* A = raw_smp_processor_id(). */
-		{ BPF_LD  | BPF_W | BPF_ABS, 0, 0, SKF_AD_OFF + SKF_AD_CPU },
-		/* Adjust the CPUID to socket group size. */
-		{ BPF_ALU | BPF_MOD | BPF_K, 0, 0, sock_count },
-		/* Return A. */
-		{ BPF_RET | BPF_A, 0, 0, 0 },
-	};
+	/* Explicit steering only for CPUs not matching the default mapping. */
+	unsigned explicit = 0;
+	for (unsigned i = 0; steer != NULL && i < steer_count; i++) {
+		if (steer[i] != i % sock_count) {
+			explicit++;
+		}
+	}
+	if (2 * explicit + 3 > BPF_MAXINSNS) {
+		explicit = 0;
+		steer_count = 0;
+	}
+
+	struct sock_filter code[2 * explicit + 3];
+	unsigned len = 0;
+
+	/* A = raw_smp_processor_id(). */
+	code[len++] = (struct sock_filter){ BPF_LD  | BPF_W | BPF_ABS, 0, 0, SKF_AD_OFF + SKF_AD_CPU };
+	for (unsigned i = 0; explicit > 0 && i < steer_count; i++) {
+		if (steer[i] != i % sock_count) {
+			/* If A == CPU, return the socket of the steered worker. */
+			code[len++] = (struct sock_filter){ BPF_JMP | BPF_JEQ | BPF_K, 0, 1, i };
+			code[len++] = (struct sock_filter){ BPF_RET | BPF_K, 0, 0, steer[i] };
+		}
+	}
+	/* Adjust the CPUID to socket group size. */
+	code[len++] = (struct sock_filter){ BPF_ALU | BPF_MOD | BPF_K, 0, 0, sock_count };
+	/* Return A. */
+	code[len++] = (struct sock_filter){ BPF_RET | BPF_A, 0, 0, 0 };
 
 	struct sock_fprog prog = { 0 };
-	prog.len = sizeof(code) / sizeof(*code);
+	prog.len = len;
 	prog.filter = code;
 
 	return setsockopt(sock, SOL_SOCKET, SO_ATTACH_REUSEPORT_CBPF, &prog, sizeof(prog)) == 0;
@@ -191,6 +212,16 @@ static bool enable_pktinfo(int sock, int family)
 	return setsockopt(sock, level, option, &on, sizeof(on)) == 0;
 }
 
+/*! \brief Enable busy polling of the device queue when receiving. */
+static bool enable_busy_poll(int sock, int usecs)
+{
+#ifdef SO_BUSY_POLL
+	return setsockopt(sock, SOL_SOCKET, SO_BUSY_POLL, &usecs, sizeof(usecs)) == 0;
+#else
+	return false;
+#endif
+}
+
 /*!
  * Linux 3.15 has IP_PMTUDISC_OMIT which makes sockets
  * ignore PMTU information and send packets with DF=0.
@@ -234,12 +265,34 @@ static int enable_fastopen(int sock, int backlog)
 	return KNOT_EOK;
 }
 
-static iface_t *server_init_xdp_iface(struct sockaddr_storage *addr, unsigned *thread_id_start)
+#ifdef ENABLE_XDP
+static void xdp_config(conf_t *conf, knot_xdp_config_t *out)
+{
+	conf_val_t val = conf_get(conf, C_SRV, C_XDP_RX_FRAMES);
+	out->frame_count_rx = conf_int(&val);
+	val = conf_get(conf, C_SRV, C_XDP_TX_FRAMES);
+	out->frame_count_tx = conf_int(&val);
+	val = conf_get(conf, C_SRV, C_XDP_FILL_RING);
+	out->ring_size_fill = conf_int(&val);
+	val = conf_get(conf, C_SRV, C_XDP_COMP_RING);
+	out->ring_size_comp = conf_int(&val);
+	val = conf_get(conf, C_SRV, C_XDP_RX_RING);
+	out->ring_size_rx = conf_int(&val);
+	val = conf_get(conf, C_SRV, C_XDP_TX_RING);
+	out->ring_size_tx = conf_int(&val);
+}
+#endif
+
+static iface_t *server_init_xdp_iface(conf_t *conf, struct sockaddr_storage *addr,
+                                      unsigned *thread_id_start)
 {
 #ifndef ENABLE_XDP
 	assert(0);
 	return NULL;
 #else
+	knot_xdp_config_t xdp_conf;
+	xdp_config(conf, &xdp_conf);
+
 	conf_xdp_iface_t iface;
 	int ret = conf_xdp_iface(addr, &iface);
 	if (ret != KNOT_EOK) {
@@ -268,13 +321,14 @@ static iface_t *server_init_xdp_iface(struct sockaddr_storage *addr, unsigned *t
 	for (int i = 0; i < iface.queues; i++) {
 		knot_xdp_load_bpf_t mode =
 			(i == 0 ? KNOT_XDP_LOAD_BPF_ALWAYS : KNOT_XDP_LOAD_BPF_NEVER);
-		ret = knot_xdp_init(new_if->xdp_sockets + i, iface.name, i,
-		                    iface.port, mode);
+		ret = knot_xdp_init2(new_if->xdp_sockets + i, iface.name, i,
+		                     iface.port, mode, &xdp_conf);
 		if (ret == -EBUSY && i == 0) {
 			log_notice("XDP interface %s@%u is busy, retrying initializaion",
 			           iface.name, iface.port);
-			ret = knot_xdp_init(new_if->xdp_sockets + i, iface.name, i,
-			                    iface.port, KNOT_XDP_LOAD_BPF_ALWAYS_UNLOAD);
+			ret = knot_xdp_init2(new_if->xdp_sockets + i, iface.name, i,
+			                     iface.port, KNOT_XDP_LOAD_BPF_ALWAYS_UNLOAD,
+			                     &xdp_conf);
 		}
 		if (ret != KNOT_EOK) {
 			log_warning("failed to initialize XDP interface %s@%u, queue %d (%s)",
@@ -289,8 +343,9 @@ static iface_t *server_init_xdp_iface(struct sockaddr_storage *addr, unsigned *t
 
 	if (ret == KNOT_EOK) {
 		knot_xdp_mode_t mode = knot_eth_xdp_mode(if_nametoindex(iface.name));
-		log_debug("initialized XDP interface %s@%u, queues %d, %s mode",
-		          iface.name, iface.port, iface.queues,
+		log_debug("initialized XDP interface %s@%u, queues %d, frames %u/%u "
+		          "per queue, %s mode", iface.name, iface.port, iface.queues,
+		          xdp_conf.frame_count_rx, xdp_conf.frame_count_tx,
 		          (mode == KNOT_XDP_MODE_FULL ? "native" : "emulated"));
 	}
 
@@ -308,13 +363,17 @@ static iface_t *server_init_xdp_iface(struct sockaddr_storage *addr, unsigned *t
  * \param tcp_thread_count  Number of created TCP workers.
  * \param tcp_reuseport     Indication if reuseport on TCP is enabled.
  * \param socket_affinity   Indication if CBPF should be attached.
+ * \param affinity          Placement of UDP workers.
+ * \param udp_busy_poll     Busy polling time for UDP sockets (0 to disable).
  *
  * \retval Pointer to a new initialized inteface.
  * \retval NULL if error.
  */
 static iface_t *server_init_iface(struct sockaddr_storage *addr,
                                   int udp_thread_count, int tcp_thread_count,
-                                  bool tcp_reuseport, bool socket_affinity)
+                                  bool tcp_reuseport, bool socket_affinity,
+                                  const udp_affinity_t *affinity,
+                                  int udp_busy_poll)
 {
 	iface_t *new_if = calloc(1, sizeof(*new_if));
 	if (new_if == NULL) {
@@ -354,6 +413,7 @@ static iface_t *server_init_iface(struct sockaddr_storage *addr,
 	bool warn_cbpf = true;
 	bool warn_bufsize = true;
 	bool warn_pktinfo = true;
+	bool warn_busy_poll = true;
 	bool warn_flag_misc = true;
 
 	/* Create bound UDP sockets. */
@@ -376,7 +436,8 @@ static iface_t *server_init_iface(struct sockaddr_storage *addr,
 		}
 
 		if ((udp_bind_flags & NET_BIND_MULTIPLE) && socket_affinity) {
-			if (!server_attach_reuseport_bpf(sock, udp_socket_count) &&
+			if (!server_attach_reuseport_bpf(sock, udp_socket_count,
+			                                 affinity->steer, affinity->cpus) &&
 			    warn_cbpf) {
 				log_warning("cannot ensure optimal CPU locality for UDP");
 				warn_cbpf = false;
@@ -389,6 +450,12 @@ static iface_t *server_init_iface(struct sockaddr_storage *addr,
 			warn_bufsize = false;
 		}
 
+		if (udp_busy_poll > 0 && !enable_busy_poll(sock, udp_busy_poll) &&
+		    warn_busy_poll) {
+			log_warning("failed to enable busy polling for UDP");
+			warn_busy_poll = false;
+		}
+
 		if (sockaddr_is_any(addr) && !enable_pktinfo(sock, addr->ss_family) &&
 		    warn_pktinfo) {
 			log_warning("failed to enable received packet information retrieval");
@@ -448,7 +515,7 @@ static iface_t *server_init_iface(struct sockaddr_storage *addr,
 		}
 
 		if ((tcp_bind_flags & NET_BIND_MULTIPLE) && socket_affinity) {
-			if (!server_attach_reuseport_bpf(sock, tcp_socket_count) &&
+			if (!server_attach_reuseport_bpf(sock, tcp_socket_count, NULL, 0) &&
 			    warn_cbpf) {
 				log_warning("cannot ensure optimal CPU locality for TCP");
 				warn_cbpf = false;
@@ -467,6 +534,32 @@ static iface_t *server_init_iface(struct sockaddr_storage *addr,
 	return new_if;
 }
 
+/*! \brief Compute placement of UDP workers according to configuration. */
+static int configure_affinity(conf_t *conf, server_t *s)
+{
+	unsigned size_udp = s->handlers[IO_UDP].handler.unit->size;
+	bool topology = conf->cache.srv_topology_affinity;
+
+	conf_val_t listen_val = conf_get(conf, C_SRV, C_LISTEN);
+	size_t naddrs = conf_val_count(&listen_val);
+	struct sockaddr_storage *addrs = calloc(naddrs + 1, sizeof(*addrs));
+	if (addrs == NULL) {
+		return KNOT_ENOMEM;
+	}
+	for (size_t i = 0; listen_val.code == KNOT_EOK; i++) {
+		addrs[i] = conf_addr(&listen_val, NULL);
+		conf_val_next(&listen_val);
+	}
+
+	int ret = udp_affinity_init(&s->udp_affinity, size_udp, topology, addrs, naddrs);
+	free(addrs);
+	if (ret == KNOT_EOK && s->udp_affinity.steer != NULL) {
+		log_info("using topology-aware placement of UDP workers");
+	}
+
+	return ret;
+}
+
 /*! \brief Initialize bound sockets according to configuration. */
 static int configure_sockets(conf_t *conf, server_t *s)
 {
@@ -481,6 +574,12 @@ static int configure_sockets(conf_t *conf, server_t *s)
 	         conf->cache.srv_tcp_reuseport ? " and TCP" : "");
 #endif
 
+	int ret = configure_affinity(conf, s);
+	if (ret != KNOT_EOK) {
+		log_error("failed to configure CPU affinity (%s)", knot_strerror(ret));
+		return ret;
+	}
+
 	/* Update bound interfaces. */
 	conf_val_t listen_val = conf_get(conf, C_SRV, C_LISTEN);
 	conf_val_t lisxdp_val = conf_get(conf, C_SRV, C_LISTEN_XDP);
@@ -493,7 +592,7 @@ static int configure_sockets(conf_t *conf, server_t *s)
 		if (getrlimit(RLIMIT_MEMLOCK, &cur_limit) != 0 ||
 		    cur_limit.rlim_cur < min_limit.rlim_cur ||
 		    cur_limit.rlim_max < min_limit.rlim_max) {
-			int ret = setrlimit(RLIMIT_MEMLOCK, &min_limit);
+			ret = setrlimit(RLIMIT_MEMLOCK, &min_limit);
 			if (ret != 0) {
 				log_error("failed to increase RLIMIT_MEMLOCK (%s)",
 				          knot_strerror(errno));
@@ -524,7 +623,9 @@ static int configure_sockets(conf_t *conf, server_t *s)
 		log_info("binding to interface %s", addr_str);
 
 		iface_t *new_if = server_init_iface(&addr, size_udp, size_tcp,
-		                                    tcp_reuseport, socket_affinity);
+		                                    tcp_reuseport, socket_affinity,
+		                                    &s->udp_affinity,
+		                                    conf->cache.srv_udp_busy_poll);
 		if (new_if == NULL) {
 			server_deinit_iface_list(newlist, nifs);
 			free(rundir);
@@ -546,7 +647,7 @@ static int configure_sockets(conf_t *conf, server_t *s)
 		sockaddr_tostr(addr_str, sizeof(addr_str), &addr);
 		log_info("binding to XDP interface %s", addr_str);
 
-		iface_t *new_if = server_init_xdp_iface(&addr, &thread_id);
+		iface_t *new_if = server_init_xdp_iface(conf, &addr, &thread_id);
 		if (new_if == NULL) {
 			server_deinit_iface_list(newlist, nifs);
 			return KNOT_ERROR;
@@ -612,6 +713,8 @@ int server_init(server_t *server, int bg_workers)
 	conf_val_t journal_size = conf_db_param(conf(), C_JOURNAL_DB_MAX_SIZE, C_MAX_JOURNAL_DB_SIZE);
 	conf_val_t journal_mode = conf_db_param(conf(), C_JOURNAL_DB_MODE, C_JOURNAL_DB_MODE);
 	knot_lmdb_init(&server->journaldb, journal_dir, conf_int(&journal_size), journal_env_flags(conf_opt(&journal_mode), false), NULL);
+	conf_val_t journal_delay = conf_db_param(conf(), C_JOURNAL_DB_DELAY, NULL);
+	knot_lmdb_set_commit_delay(&server->journaldb, conf_int(&journal_delay));
 	free(journal_dir);
 
 	kasp_db_ensure_init(&server->kaspdb, conf());
@@ -643,6 +746,10 @@ void server_deinit(server_t *server)
 	/* Free remaining interfaces. */
 	server_deinit_iface_list(server->ifaces, server->n_ifaces);
 
+	/* Free placement of UDP workers. */
+	udp_affinity_deinit(&server->udp_affinity);
+	free(server->udp_stats);
+
 	/* Free threads and event handlers. */
 	worker_pool_destroy(server->workers);
 
@@ -873,6 +980,11 @@ static void warn_server_reconfigure(conf_t *conf, server_t *server)
 
 	static bool warn_tcp_reuseport = true;
 	static bool warn_socket_affinity = true;
+	static bool warn_topology_affinity = true;
+	static bool warn_udp_gso = true;
+	static bool warn_udp_batch_size = true;
+	static bool warn_udp_busy_poll = true;
+	static bool warn_xdp_inplace_reply = true;
 	static bool warn_udp = true;
 	static bool warn_tcp = true;
 	static bool warn_bg = true;
@@ -888,6 +1000,32 @@ static void warn_server_reconfigure(conf_t *conf, server_t *server)
 		warn_socket_affinity = false;
 	}
 
+	if (warn_topology_affinity && conf->cache.srv_topology_affinity != conf_topology_affinity(conf)) {
+		log_warning(msg, &C_TOPOLOGY_AFFINITY[1]);
+		warn_topology_affinity = false;
+	}
+
+	if (warn_udp_gso && conf->cache.srv_udp_gso != conf_udp_gso(conf)) {
+		log_warning(msg, &C_UDP_GSO[1]);
+		warn_udp_gso = false;
+	}
+
+	if (warn_udp_batch_size && conf->cache.srv_udp_batch_size != conf_udp_batch_size(conf)) {
+		log_warning(msg, &C_UDP_BATCH_SIZE[1]);
+		warn_udp_batch_size = false;
+	}
+
+	if (warn_udp_busy_poll && conf->cache.srv_udp_busy_poll != conf_udp_busy_poll(conf)) {
+		log_warning(msg, &C_UDP_BUSY_POLL[1]);
+		warn_udp_busy_poll = false;
+	}
+
+	if (warn_xdp_inplace_reply &&
+	    conf->cache.srv_xdp_inplace_reply != conf_xdp_inplace_reply(conf)) {
+		log_warning(msg, &C_XDP_INPLACE_REPLY[1]);
+		warn_xdp_inplace_reply = false;
+	}
+
 	if (warn_udp && server->handlers[IO_UDP].size != conf_udp_threads(conf)) {
 		log_warning(msg, &C_UDP_WORKERS[1]);
 		warn_udp = false;
@@ -1018,6 +1156,11 @@ static int configure_threads(conf_t *conf, server_t *server)
 		return ret;
 	}
 
+	server->udp_stats = calloc(conf->cache.srv_udp_threads, sizeof(udp_stats_t));
+	if (server->udp_stats == NULL) {
+		return KNOT_ENOMEM;
+	}
+
 	if (conf->cache.srv_xdp_threads > 0) {
 		ret = set_handler(server, IO_XDP, conf->cache.srv_xdp_threads, udp_master);
 		if (ret != KNOT_EOK) {
@@ -1040,6 +1183,9 @@ static int reconfigure_journal_db(conf_t *conf, server_t *server)
 	}
 	free(journal_dir);
 
+	conf_val_t journal_delay = conf_db_param(conf, C_JOURNAL_DB_DELAY, NULL);
+	knot_lmdb_set_commit_delay(&server->journaldb, conf_int(&journal_delay));
+
 	return KNOT_EOK; // not "ret"
 }
 
@@ -20,6 +20,7 @@
 #include "knot/common/evsched.h"
 #include "knot/common/fdset.h"
 #include "knot/journal/knot_lmdb.h"
+#include "knot/server/affinity.h"
 #include "knot/server/dthreads.h"
 #include "knot/worker/pool.h"
 #include "knot/zone/catalog.h"
@@ -38,6 +39,15 @@ typedef struct {
 	unsigned *thread_id;    /*!< Thread identifiers per all handlers. */
 } iohandler_t;
 
+/*!
+ * \brief Statistics of received batches of one UDP worker.
+ */
+typedef struct {
+	uint64_t batches; /*!< Number of received batches. */
+	uint64_t msgs;    /*!< Number of received messages. */
+	uint64_t full;    /*!< Number of batches filled up to the current size. */
+} udp_stats_t;
+
 /*!
  * \brief Server state flags.
  */
@@ -101,6 +111,12 @@ typedef struct server {
 	iface_t *ifaces;
 	size_t n_ifaces;
 
+	/*! \brief Placement of UDP workers. */
+	udp_affinity_t udp_affinity;
+
+	/*! \brief Receive batch statistics of each UDP worker. */
+	udp_stats_t *udp_stats;
+
 	/*! \brief Pending changes to catalog member zones. */
 	catalog_update_t catalog_upd;
 } server_t;
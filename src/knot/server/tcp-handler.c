@@ -54,9 +54,47 @@ typedef struct tcp_context {
 	unsigned max_worker_fds;         /*!< Max TCP clients per worker configuration + no. of ifaces. */
 	int idle_timeout;                /*!< [s] TCP idle timeout configuration. */
 	int io_timeout;                  /*!< [ms] TCP send/recv timeout configuration. */
+	unsigned xfr_peer_limit;         /*!< Max outgoing transfers per remote address. */
+	unsigned xfr_refused;            /*!< Transfers refused since the last notice. */
+	struct timespec xfr_refused_log; /*!< Time of the last refused transfer notice. */
 } tcp_context_t;
 
+/*! \brief Outgoing zone transfer in progress. */
+typedef struct {
+	knot_layer_t layer;                 /*!< Transfer processing layer. */
+	knot_mm_t mm;                       /*!< Transfer memory context. */
+	knotd_qdata_params_t params;        /*!< Query processing parameters. */
+	knot_pkt_t *ans;                    /*!< Answer packet. */
+	unsigned peer;                      /*!< Remote address slot. */
+	bool counted;                       /*!< Counted in the remote address slot. */
+} tcp_xfr_t;
+
+/*! \brief TCP connection state kept across poll rounds. */
+typedef struct {
+	struct sockaddr_storage addr;       /*!< Remote address. */
+	struct sockaddr_storage local;      /*!< Local address. */
+	uint8_t *rx_buf;                    /*!< Incomplete received data. */
+	size_t rx_len;                      /*!< Length of incomplete received data. */
+	uint8_t *tx_buf;                    /*!< Pending output data. */
+	size_t tx_len;                      /*!< Length of pending output data. */
+	size_t tx_done;                     /*!< Already sent part of pending output data. */
+	size_t tx_size;                     /*!< Allocated size of the output buffer. */
+	tcp_xfr_t *xfr;                     /*!< Outgoing zone transfer in progress. */
+} tcp_conn_t;
+
 #define TCP_SWEEP_INTERVAL 2 /*!< [secs] granularity of connection sweeping. */
+#define TCP_MSG_MAX (KNOT_WIRE_MAX_PKTSIZE + sizeof(uint16_t)) /*!< Message incl. size prefix. */
+#define TCP_RX_BUF_SIZE (2 * TCP_MSG_MAX) /*!< RX buffer for possibly more pipelined messages. */
+#define TCP_CONN_TX_MAX (2 * TCP_MSG_MAX) /*!< Pending output limit. */
+#define TCP_XFR_BURST 16 /*!< Max transfer messages generated per poll round. */
+#define TCP_XFR_PEERS 1024 /*!< Number of remote address slots for transfer limiting. */
+#define TCP_XFR_LOG_INTERVAL 10 /*!< [secs] min interval of refused transfer notices. */
+
+/*! \brief Outgoing transfers in progress per remote address slot (all workers). */
+static uint32_t xfr_peers[TCP_XFR_PEERS];
+#ifndef HAVE_ATOMIC
+static pthread_mutex_t xfr_peers_lock = PTHREAD_MUTEX_INITIALIZER;
+#endif
 
 static void update_sweep_timer(struct timespec *timer)
 {
@@ -71,26 +109,87 @@ static void update_tcp_conf(tcp_context_t *tcp)
 		MAX(conf()->cache.srv_tcp_max_clients / conf()->cache.srv_tcp_threads, 1);
 	tcp->idle_timeout = conf()->cache.srv_tcp_idle_timeout;
 	tcp->io_timeout = conf()->cache.srv_tcp_io_timeout;
+	tcp->xfr_peer_limit = conf()->cache.srv_tcp_xfr_peer_limit;
 	rcu_read_unlock();
 }
 
+static unsigned xfr_peer_slot(const struct sockaddr_storage *addr)
+{
+	size_t len = 0;
+	const uint8_t *raw = sockaddr_raw(addr, &len);
+
+	/* FNV-1a of the address without port. */
+	uint32_t hash = 2166136261u;
+	for (size_t i = 0; i < len; i++) {
+		hash = (hash ^ raw[i]) * 16777619u;
+	}
+
+	return hash % TCP_XFR_PEERS;
+}
+
+/*! \brief Adds to the transfers count of the remote address slot, returns the result. */
+static uint32_t xfr_peer_add(unsigned peer, int32_t val)
+{
+#ifdef HAVE_ATOMIC
+	return __atomic_add_fetch(&xfr_peers[peer], val, __ATOMIC_RELAXED);
+#else
+	pthread_mutex_lock(&xfr_peers_lock);
+	uint32_t count = (xfr_peers[peer] += val);
+	pthread_mutex_unlock(&xfr_peers_lock);
+	return count;
+#endif
+}
+
+static void tcp_xfr_free(tcp_xfr_t *xfr)
+{
+	knot_layer_finish(&xfr->layer);
+	mp_delete(xfr->mm.ctx);
+	if (xfr->counted) {
+		(void)xfr_peer_add(xfr->peer, -1);
+	}
+	free(xfr);
+}
+
+static void tcp_conn_free(tcp_conn_t *conn)
+{
+	if (conn != NULL) {
+		if (conn->xfr != NULL) {
+			tcp_xfr_free(conn->xfr);
+		}
+		free(conn->rx_buf);
+		free(conn->tx_buf);
+		free(conn);
+	}
+}
+
+static bool tcp_conn_pending(const tcp_conn_t *conn)
+{
+	return conn->tx_done < conn->tx_len;
+}
+
+/*!
+ * \brief Check if another message wouldn't fit in the pending output limit.
+ */
+static bool tcp_conn_tx_full(const tcp_conn_t *conn)
+{
+	return conn->tx_len - conn->tx_done + TCP_MSG_MAX > TCP_CONN_TX_MAX;
+}
+
 /*! \brief Sweep TCP connection. */
 static enum fdset_sweep_state tcp_sweep(fdset_t *set, int i, void *data)
 {
 	UNUSED(data);
 	assert(set && i < set->n && i >= 0);
-	int fd = set->pfd[i].fd;
+	int fd = fdset_get_fd(set, i);
+	tcp_conn_t *conn = fdset_get_ctx(set, i);
 
 	/* Best-effort, name and shame. */
-	struct sockaddr_storage ss;
-	socklen_t len = sizeof(struct sockaddr_storage);
-	if (getpeername(fd, (struct sockaddr*)&ss, &len) == 0) {
-		char addr_str[SOCKADDR_STRLEN] = {0};
-		sockaddr_tostr(addr_str, sizeof(addr_str), &ss);
-		log_notice("TCP, terminated inactive client, address %s", addr_str);
-	}
+	char addr_str[SOCKADDR_STRLEN] = {0};
+	sockaddr_tostr(addr_str, sizeof(addr_str), &conn->addr);
+	log_notice("TCP, terminated inactive client, address %s", addr_str);
 
 	close(fd);
+	tcp_conn_free(conn);
 
 	return FDSET_SWEEP;
 }
@@ -123,7 +222,6 @@ static unsigned tcp_set_ifaces(const iface_t *ifaces, size_t n_ifaces,
 		return 0;
 	}
 
-	fdset_clear(fds);
 	for (const iface_t *i = ifaces; i != ifaces + n_ifaces; i++) {
 		if (i->fd_tcp_count == 0) { // Ignore XDP interface.
 			assert(i->fd_xdp_count > 0);
@@ -140,64 +238,333 @@ static unsigned tcp_set_ifaces(const iface_t *ifaces, size_t n_ifaces,
 			tcp_id = thread_id - i->fd_udp_count;
 		}
 #endif
-		fdset_add(fds, i->fd_tcp[tcp_id], POLLIN, NULL);
+		fdset_add(fds, i->fd_tcp[tcp_id], FDSET_POLLIN, NULL);
 	}
 
 	return fds->n;
 }
 
-static int tcp_handle(tcp_context_t *tcp, int fd, struct iovec *rx, struct iovec *tx)
+static bool tcp_would_block(int error)
+{
+	return (error == EAGAIN || error == EWOULDBLOCK || error == EINTR);
+}
+
+/*!
+ * \brief Check if the kept received data contain a complete message.
+ */
+static bool tcp_conn_postponed(const tcp_conn_t *conn)
+{
+	return conn->rx_len >= sizeof(uint16_t) &&
+	       conn->rx_len >= sizeof(uint16_t) + knot_wire_read_u16(conn->rx_buf);
+}
+
+/*!
+ * \brief Receive available data without blocking.
+ *
+ * The kept data from the previous poll rounds are prepended, so that
+ * the RX buffer starts with a message size prefix. If they contain
+ * a complete (postponed) message, nothing is received so that the kept data
+ * never exceed the RX buffer.
+ *
+ * \retval KNOT_EOK if some data is in the RX buffer.
+ * \retval KNOT_EAGAIN if no data is available.
+ * \retval KNOT_EOF if the connection should be closed.
+ */
+static int tcp_conn_recv(tcp_conn_t *conn, int fd, struct iovec *rx)
+{
+	uint8_t *buf = rx->iov_base;
+	size_t len = conn->rx_len;
+	bool postponed = tcp_conn_postponed(conn);
+	assert(len <= TCP_RX_BUF_SIZE && (postponed || len < TCP_MSG_MAX));
+
+	if (len > 0) {
+		memcpy(buf, conn->rx_buf, len);
+		free(conn->rx_buf);
+		conn->rx_buf = NULL;
+		conn->rx_len = 0;
+	}
+
+	if (postponed) {
+		rx->iov_len = len;
+		return KNOT_EOK;
+	}
+
+	ssize_t ret = recv(fd, buf + len, TCP_RX_BUF_SIZE - len, MSG_DONTWAIT | MSG_NOSIGNAL);
+	if (ret < 0 && tcp_would_block(errno)) {
+		ret = 0;
+	} else if (ret <= 0) {
+		return KNOT_EOF;
+	}
+
+	rx->iov_len = len + ret;
+
+	return (rx->iov_len > 0) ? KNOT_EOK : KNOT_EAGAIN;
+}
+
+/*!
+ * \brief Keep the incomplete message, the RX buffer is shared by all connections.
+ */
+static int tcp_conn_keep(tcp_conn_t *conn, const uint8_t *data, size_t len)
+{
+	assert(conn->rx_buf == NULL);
+
+	conn->rx_buf = malloc(len);
+	if (conn->rx_buf == NULL) {
+		return KNOT_ENOMEM;
+	}
+	memcpy(conn->rx_buf, data, len);
+	conn->rx_len = len;
+
+	return KNOT_EOK;
+}
+
+/*!
+ * \brief Send pending output data without blocking.
+ */
+static int tcp_conn_flush(tcp_conn_t *conn, int fd)
+{
+	while (tcp_conn_pending(conn)) {
+		ssize_t ret = send(fd, conn->tx_buf + conn->tx_done,
+		                   conn->tx_len - conn->tx_done, MSG_DONTWAIT | MSG_NOSIGNAL);
+		if (ret < 0) {
+			return tcp_would_block(errno) ? KNOT_EOK : KNOT_ECONN;
+		}
+		conn->tx_done += ret;
+	}
+
+	conn->tx_len = 0;
+	conn->tx_done = 0;
+
+	return KNOT_EOK;
+}
+
+static int tcp_conn_queue(tcp_conn_t *conn, const struct iovec *iov, int iovcnt)
+{
+	size_t total = 0;
+	for (int i = 0; i < iovcnt; i++) {
+		total += iov[i].iov_len;
+	}
+
+	/* Reuse the space of already sent data. */
+	if (conn->tx_done > 0) {
+		memmove(conn->tx_buf, conn->tx_buf + conn->tx_done,
+		        conn->tx_len - conn->tx_done);
+		conn->tx_len -= conn->tx_done;
+		conn->tx_done = 0;
+	}
+
+	size_t needed = conn->tx_len + total;
+	if (needed > conn->tx_size) {
+		uint8_t *buf = realloc(conn->tx_buf, needed);
+		if (buf == NULL) {
+			return KNOT_ENOMEM;
+		}
+		conn->tx_buf = buf;
+		conn->tx_size = needed;
+	}
+
+	for (int i = 0; i < iovcnt; i++) {
+		memcpy(conn->tx_buf + conn->tx_len, iov[i].iov_base, iov[i].iov_len);
+		conn->tx_len += iov[i].iov_len;
+	}
+
+	return KNOT_EOK;
+}
+
+/*!
+ * \brief Queue a DNS message for sending.
+ *
+ * The queued messages are sent at once after the received messages
+ * are processed. The processing stops once the pending output reaches
+ * the limit (see tcp_conn_tx_full()), so the queue remains bounded.
+ */
+static int tcp_conn_queue_msg(tcp_conn_t *conn, const uint8_t *wire, size_t size)
 {
-	/* Get peer name. */
-	struct sockaddr_storage ss;
-	socklen_t addrlen = sizeof(struct sockaddr_storage);
-	if (getpeername(fd, (struct sockaddr *)&ss, &addrlen) != 0) {
-		return KNOT_EADDRNOTAVAIL;
+	uint16_t pktsize = htons(size);
+	struct iovec iov[2] = {
+		{ .iov_base = &pktsize,      .iov_len = sizeof(pktsize) },
+		{ .iov_base = (void *)wire,  .iov_len = size }
+	};
+
+	return tcp_conn_queue(conn, iov, 2);
+}
+
+static bool tcp_xfr_query(const knot_pkt_t *query)
+{
+	if (query->parsed < KNOT_WIRE_HEADER_SIZE || knot_wire_get_qr(query->wire) ||
+	    knot_wire_get_opcode(query->wire) != KNOT_OPCODE_QUERY) {
+		return false;
 	}
 
+	uint16_t qtype = knot_pkt_qtype(query);
+	return (qtype == KNOT_RRTYPE_AXFR || qtype == KNOT_RRTYPE_IXFR);
+}
+
+/*!
+ * \brief Generate next messages of the outgoing zone transfer.
+ *
+ * The messages are generated only while the pending output is below the limit
+ * and at most TCP_XFR_BURST of them in one poll round, so that a slow remote
+ * slows down the transfer only and other clients of the worker are served
+ * meanwhile. The transfer is released once finished.
+ */
+static int tcp_xfr_continue(tcp_conn_t *conn, int fd)
+{
+	tcp_xfr_t *xfr = conn->xfr;
+	assert(xfr != NULL);
+
+	int ret = KNOT_EOK;
+	for (unsigned i = 0; i < TCP_XFR_BURST; i++) {
+		if (!tcp_active_state(xfr->layer.state) || tcp_conn_tx_full(conn)) {
+			break;
+		}
+
+		knot_layer_produce(&xfr->layer, xfr->ans);
+		if (xfr->ans->size > 0 && tcp_send_state(xfr->layer.state)) {
+			ret = tcp_conn_queue_msg(conn, xfr->ans->wire, xfr->ans->size);
+			if (ret == KNOT_EOK) {
+				ret = tcp_conn_flush(conn, fd);
+			}
+			if (ret != KNOT_EOK) {
+				tcp_log_error(&conn->addr, "send", ret);
+				return KNOT_EOF;
+			}
+		}
+	}
+
+	if (!tcp_active_state(xfr->layer.state)) {
+		tcp_xfr_free(xfr);
+		conn->xfr = NULL;
+	}
+
+	return ret;
+}
+
+/*!
+ * \brief Check if the remote has too many outgoing transfers in progress.
+ *
+ * The refusals are logged at most once per TCP_XFR_LOG_INTERVAL in a worker,
+ * so that a misbehaving remote can't flood the log.
+ */
+static bool tcp_xfr_over_limit(tcp_context_t *tcp, const tcp_conn_t *conn,
+                               unsigned peer)
+{
+	if (tcp->xfr_peer_limit == 0 || xfr_peer_add(peer, 0) < tcp->xfr_peer_limit) {
+		return false;
+	}
+
+	tcp->xfr_refused++;
+	struct timespec now = time_now();
+	if (now.tv_sec - tcp->xfr_refused_log.tv_sec >= TCP_XFR_LOG_INTERVAL) {
+		char addr_str[SOCKADDR_STRLEN] = { 0 };
+		sockaddr_tostr(addr_str, sizeof(addr_str), &conn->addr);
+		log_notice("TCP, refused %u zone transfer(s) over the limit, last address %s",
+		           tcp->xfr_refused, addr_str);
+		tcp->xfr_refused = 0;
+		tcp->xfr_refused_log = now;
+	}
+
+	return true;
+}
+
+/*!
+ * \brief Start an outgoing zone transfer with its own processing context.
+ *
+ * The transfer is counted for the remote only once its first messages
+ * were generated (i.e. it passed the ACL) and it continues.
+ */
+static int tcp_xfr_start(int fd, tcp_conn_t *conn, unsigned peer,
+                         const knotd_qdata_params_t *params, const knot_pkt_t *query)
+{
+	assert(conn->xfr == NULL);
+
+	tcp_xfr_t *xfr = calloc(1, sizeof(*xfr));
+	if (xfr == NULL) {
+		return KNOT_EOF;
+	}
+	xfr->peer = peer;
+	xfr->params = *params;
+	mm_ctx_mempool(&xfr->mm, MM_DEFAULT_BLKSIZE);
+	knot_layer_init(&xfr->layer, &xfr->mm, process_query_layer());
+	knot_layer_begin(&xfr->layer, &xfr->params);
+	conn->xfr = xfr;
+
+	/* The query must outlive the shared RX buffer. */
+	knot_pkt_t *copy = knot_pkt_new(NULL, query->size, &xfr->mm);
+	xfr->ans = knot_pkt_new(NULL, KNOT_WIRE_MAX_PKTSIZE, &xfr->mm);
+	if (copy == NULL || xfr->ans == NULL) {
+		tcp_xfr_free(xfr);
+		conn->xfr = NULL;
+		return KNOT_EOF;
+	}
+	memcpy(copy->wire, query->wire, query->size);
+	copy->size = query->size;
+
+	int ret = knot_pkt_parse(copy, 0);
+	if (ret != KNOT_EOK && copy->parsed > 0) { // parsing failed (e.g. 2x OPT)
+		copy->parsed--; // artificially decreasing "parsed" leads to FORMERR
+	}
+	knot_layer_consume(&xfr->layer, copy);
+
+	ret = tcp_xfr_continue(conn, fd);
+	if (conn->xfr != NULL) {
+		xfr->counted = true;
+		(void)xfr_peer_add(peer, 1);
+	}
+
+	return ret;
+}
+
+static int tcp_handle(tcp_context_t *tcp, int fd, tcp_conn_t *conn,
+                      uint8_t *msg, size_t msg_len, struct iovec *tx)
+{
 	/* Create query processing parameter. */
 	knotd_qdata_params_t params = {
-		.remote = &ss,
+		.remote = &conn->addr,
+		.local = &conn->local,
 		.socket = fd,
 		.server = tcp->server,
 		.thread_id = tcp->thread_id
 	};
 
-	rx->iov_len = KNOT_WIRE_MAX_PKTSIZE;
 	tx->iov_len = KNOT_WIRE_MAX_PKTSIZE;
 
-	/* Receive data. */
-	int recv = net_dns_tcp_recv(fd, rx->iov_base, rx->iov_len, tcp->io_timeout);
-	if (recv > 0) {
-		rx->iov_len = recv;
-	} else {
-		tcp_log_error(&ss, "receive", recv);
-		return KNOT_EOF;
+	/* Input packet. */
+	knot_pkt_t *query = knot_pkt_new(msg, msg_len, tcp->layer.mm);
+	int ret = knot_pkt_parse(query, 0);
+	if (ret != KNOT_EOK && query->parsed > 0) { // parsing failed (e.g. 2x OPT)
+		query->parsed--; // artificially decreasing "parsed" leads to FORMERR
+	}
+
+	/* Outgoing zone transfers are streamed across poll rounds. */
+	if (tcp_xfr_query(query)) {
+		unsigned peer = xfr_peer_slot(&conn->addr);
+		if (!tcp_xfr_over_limit(tcp, conn, peer)) {
+			ret = tcp_xfr_start(fd, conn, peer, &params, query);
+			mp_flush(tcp->layer.mm->ctx);
+			return ret;
+		}
+		/* Refused (and signed) in the transfer processing once authorized. */
+		params.flags |= KNOTD_QUERY_FLAG_XFR_LIMIT;
 	}
 
 	/* Initialize processing layer. */
 	knot_layer_begin(&tcp->layer, &params);
 
-	/* Create packets. */
+	/* Create answer packet. */
 	knot_pkt_t *ans = knot_pkt_new(tx->iov_base, tx->iov_len, tcp->layer.mm);
-	knot_pkt_t *query = knot_pkt_new(rx->iov_base, rx->iov_len, tcp->layer.mm);
 
-	/* Input packet. */
-	int ret = knot_pkt_parse(query, 0);
-	if (ret != KNOT_EOK && query->parsed > 0) { // parsing failed (e.g. 2x OPT)
-		query->parsed--; // artificially decreasing "parsed" leads to FORMERR
-	}
 	knot_layer_consume(&tcp->layer, query);
 
 	/* Resolve until NOOP or finished. */
+	ret = KNOT_EOK;
 	while (tcp_active_state(tcp->layer.state)) {
 		knot_layer_produce(&tcp->layer, ans);
 		/* Send, if response generation passed and wasn't ignored. */
 		if (ans->size > 0 && tcp_send_state(tcp->layer.state)) {
-			int sent = net_dns_tcp_send(fd, ans->wire, ans->size,
-			                            tcp->io_timeout);
-			if (sent != ans->size) {
-				tcp_log_error(&ss, "send", sent);
+			int sent = tcp_conn_queue_msg(conn, ans->wire, ans->size);
+			if (sent != KNOT_EOK) {
+				tcp_log_error(&conn->addr, "send", sent);
 				ret = KNOT_EOF;
 				break;
 			}
@@ -216,12 +583,29 @@ static int tcp_handle(tcp_context_t *tcp, int fd, struct iovec *rx, struct iovec
 static void tcp_event_accept(tcp_context_t *tcp, unsigned i)
 {
 	/* Accept client. */
-	int fd = tcp->set.pfd[i].fd;
-	int client = net_accept(fd, NULL);
+	int fd = fdset_get_fd(&tcp->set, i);
+	struct sockaddr_storage addr;
+	int client = net_accept(fd, &addr);
 	if (client >= 0) {
+		tcp_conn_t *conn = calloc(1, sizeof(*conn));
+		if (conn == NULL) {
+			close(client);
+			return;
+		}
+		conn->addr = addr;
+
+		/* Local address is needed by some modules, get it only once. */
+		socklen_t local_len = sizeof(conn->local);
+		if (getsockname(client, (struct sockaddr *)&conn->local, &local_len) != 0) {
+			tcp_conn_free(conn);
+			close(client);
+			return;
+		}
+
 		/* Assign to fdset. */
-		int next_id = fdset_add(&tcp->set, client, POLLIN, NULL);
+		int next_id = fdset_add(&tcp->set, client, FDSET_POLLIN, conn);
 		if (next_id < 0) {
+			tcp_conn_free(conn);
 			close(client);
 			return;
 		}
@@ -231,14 +615,137 @@ static void tcp_event_accept(tcp_context_t *tcp, unsigned i)
 	}
 }
 
+static void tcp_conn_update_events(tcp_context_t *tcp, unsigned i)
+{
+	tcp_conn_t *conn = fdset_get_ctx(&tcp->set, i);
+	if (conn->xfr != NULL || tcp_conn_postponed(conn)) {
+		/* Don't read further queries until the transfer or output is finished. */
+		fdset_set_events(&tcp->set, i, FDSET_POLLOUT);
+		return;
+	}
+	fdset_set_events(&tcp->set, i, FDSET_POLLIN |
+	                 (tcp_conn_pending(conn) ? FDSET_POLLOUT : 0));
+}
+
+/*! \brief Watchdog timeout [s] of a connection waiting for the remote to receive. */
+static int tcp_tx_timeout(tcp_context_t *tcp)
+{
+	if (tcp->io_timeout > 0) {
+		return MIN((tcp->io_timeout + 999) / 1000, tcp->idle_timeout);
+	}
+
+	return tcp->idle_timeout;
+}
+
 static int tcp_event_serve(tcp_context_t *tcp, unsigned i)
 {
-	int fd = tcp->set.pfd[i].fd;
-	int ret = tcp_handle(tcp, fd, &tcp->iov[0], &tcp->iov[1]);
-	if (ret == KNOT_EOK) {
+	int fd = fdset_get_fd(&tcp->set, i);
+	tcp_conn_t *conn = fdset_get_ctx(&tcp->set, i);
+	bool was_incomplete = (conn->rx_len > 0 && !tcp_conn_postponed(conn));
+
+	struct iovec *rx = &tcp->iov[0];
+	int ret = tcp_conn_recv(conn, fd, rx);
+	if (ret == KNOT_EAGAIN) {
+		return KNOT_EOK;
+	} else if (ret != KNOT_EOK) {
+		return ret;
+	}
+
+	/* Process all complete (pipelined) messages. */
+	uint8_t *pos = rx->iov_base;
+	size_t avail = rx->iov_len;
+	unsigned processed = 0;
+	while (avail >= sizeof(uint16_t)) {
+		size_t msg_len = knot_wire_read_u16(pos);
+		if (msg_len == 0) {
+			return KNOT_EOF;
+		}
+		if (avail < sizeof(uint16_t) + msg_len) {
+			break;
+		}
+
+		/* Postpone the remaining queries until the pending output is sent. */
+		if (tcp_conn_tx_full(conn)) {
+			ret = tcp_conn_flush(conn, fd);
+			if (ret != KNOT_EOK) {
+				return ret;
+			}
+			if (tcp_conn_tx_full(conn)) {
+				break;
+			}
+		}
+
+		ret = tcp_handle(tcp, fd, conn, pos + sizeof(uint16_t), msg_len,
+		                 &tcp->iov[1]);
+		if (ret != KNOT_EOK) {
+			return ret;
+		}
+
+		pos += sizeof(uint16_t) + msg_len;
+		avail -= sizeof(uint16_t) + msg_len;
+		processed++;
+
+		/* Postpone the remaining queries after the transfer. */
+		if (conn->xfr != NULL) {
+			break;
+		}
+	}
+
+	/* Send all the responses at once. */
+	ret = tcp_conn_flush(conn, fd);
+	if (ret != KNOT_EOK) {
+		return ret;
+	}
+
+	if (avail > 0 && tcp_conn_keep(conn, pos, avail) != KNOT_EOK) {
+		return KNOT_EOF;
+	}
+
+	if (processed > 0) {
 		/* Update socket activity timer. */
 		fdset_set_watchdog(&tcp->set, i, tcp->idle_timeout);
 	}
+	if (avail > 0 && !tcp_conn_postponed(conn) && (processed > 0 || !was_incomplete) &&
+	    tcp->io_timeout > 0) {
+		/* New incomplete message, the rest must come within the I/O timeout. */
+		int timeout = (tcp->io_timeout + 999) / 1000;
+		fdset_set_watchdog(&tcp->set, i, MIN(timeout, tcp->idle_timeout));
+	}
+	if (conn->xfr != NULL || tcp_conn_postponed(conn)) {
+		fdset_set_watchdog(&tcp->set, i, tcp_tx_timeout(tcp));
+	}
+
+	tcp_conn_update_events(tcp, i);
+
+	return KNOT_EOK;
+}
+
+static int tcp_event_flush(tcp_context_t *tcp, unsigned i)
+{
+	int fd = fdset_get_fd(&tcp->set, i);
+	tcp_conn_t *conn = fdset_get_ctx(&tcp->set, i);
+
+	int ret = tcp_conn_flush(conn, fd);
+	if (ret == KNOT_EOK && conn->xfr != NULL) {
+		ret = tcp_xfr_continue(conn, fd);
+		if (ret != KNOT_EOK) {
+			return ret;
+		}
+
+		if (conn->xfr != NULL) {
+			/* The remote keeps receiving, update the transfer timer. */
+			fdset_set_watchdog(&tcp->set, i, tcp_tx_timeout(tcp));
+		} else {
+			fdset_set_watchdog(&tcp->set, i, tcp->idle_timeout);
+		}
+	}
+	if (ret == KNOT_EOK && conn->xfr == NULL && tcp_conn_postponed(conn)) {
+		/* Serve the queries postponed after the transfer or the pending output. */
+		return tcp_event_serve(tcp, i);
+	}
+	if (ret == KNOT_EOK) {
+		tcp_conn_update_events(tcp, i);
+	}
 
 	return ret;
 }
@@ -252,43 +759,51 @@ static void tcp_wait_for_events(tcp_context_t *tcp)
 	tcp->is_throttled = set->n == tcp->max_worker_fds;
 
 	/* If throttled, temporarily ignore new TCP connections. */
-	unsigned i = tcp->is_throttled ? tcp->client_threshold : 0;
+	unsigned offset = tcp->is_throttled ? tcp->client_threshold : 0;
 
 	/* Wait for events. */
-	int nfds = poll(&(set->pfd[i]), set->n - i, TCP_SWEEP_INTERVAL * 1000);
+	fdset_it_t it;
+	(void)fdset_poll(set, &it, offset, TCP_SWEEP_INTERVAL * 1000);
 
 	/* Mark the time of last poll call. */
 	tcp->last_poll_time = time_now();
 
 	/* Process events. */
-	while (nfds > 0 && i < set->n) {
+	for (; !fdset_it_done(&it); fdset_it_next(&it)) {
 		bool should_close = false;
-		if (set->pfd[i].revents & (POLLERR|POLLHUP|POLLNVAL)) {
+		unsigned i = fdset_it_get_idx(&it);
+		if (fdset_it_is_error(&it)) {
 			should_close = (i >= tcp->client_threshold);
-			--nfds;
-		} else if (set->pfd[i].revents & (POLLIN)) {
+		} else if (i < tcp->client_threshold) {
 			/* Master sockets - new connection to accept. */
-			if (i < tcp->client_threshold) {
+			if (fdset_it_is_pollin(&it)) {
 				/* Don't accept more clients than configured. */
 				if (set->n < tcp->max_worker_fds) {
 					tcp_event_accept(tcp, i);
 				}
+			}
+		} else {
+			/* Client sockets - pending output to send. */
+			if (fdset_it_is_pollout(&it)) {
+				should_close = (tcp_event_flush(tcp, i) != KNOT_EOK);
+			}
 			/* Client sockets - already accepted connection or
 			   closed connection :-( */
-			} else if (tcp_event_serve(tcp, i) != KNOT_EOK) {
-				should_close = true;
+			if (!should_close && fdset_it_is_pollin(&it)) {
+				should_close = (tcp_event_serve(tcp, i) != KNOT_EOK);
 			}
-			--nfds;
 		}
 
 		/* Evaluate. */
 		if (should_close) {
-			close(set->pfd[i].fd);
-			fdset_remove(set, i);
-		} else {
-			++i;
+			int fd = fdset_it_get_fd(&it);
+			tcp_conn_t *conn = fdset_it_get_ctx(&it);
+			fdset_it_remove(&it);
+			close(fd);
+			tcp_conn_free(conn);
 		}
 	}
+	fdset_it_commit(&it);
 }
 
 int tcp_master(dthread_t *thread)
@@ -330,7 +845,7 @@ int tcp_master(dthread_t *thread)
 
 	/* Create iovec abstraction. */
 	for (unsigned i = 0; i < 2; ++i) {
-		tcp.iov[i].iov_len = KNOT_WIRE_MAX_PKTSIZE;
+		tcp.iov[i].iov_len = (i == 0) ? TCP_RX_BUF_SIZE : KNOT_WIRE_MAX_PKTSIZE;
 		tcp.iov[i].iov_base = malloc(tcp.iov[i].iov_len);
 		if (tcp.iov[i].iov_base == NULL) {
 			ret = KNOT_ENOMEM;
@@ -369,6 +884,10 @@ int tcp_master(dthread_t *thread)
 	}
 
 finish:
+	for (unsigned i = tcp.client_threshold; i < tcp.set.n; i++) {
+		close(fdset_get_fd(&tcp.set, i));
+		tcp_conn_free(fdset_get_ctx(&tcp.set, i));
+	}
 	free(tcp.iov[0].iov_base);
 	free(tcp.iov[1].iov_base);
 	mp_delete(mm.ctx);
@@ -26,6 +26,9 @@
 #include <string.h>
 #include <assert.h>
 #include <sys/param.h>
+#ifdef __linux__
+#include <netinet/udp.h>
+#endif
 #ifdef HAVE_SYS_UIO_H	// struct iovec (OpenBSD)
 #include <sys/uio.h>
 #endif /* HAVE_SYS_UIO_H */
@@ -35,6 +38,7 @@
 #include "contrib/sockaddr.h"
 #include "contrib/ucw/mempool.h"
 #include "knot/nameserver/process_query.h"
+#include "knot/nameserver/query_module.h"
 #include "knot/query/layer.h"
 #include "knot/server/server.h"
 #include "knot/server/udp-handler.h"
@@ -48,11 +52,31 @@ enum {
 
 /*! \brief UDP context data. */
 typedef struct {
-	knot_layer_t layer; /*!< Query processing layer. */
-	server_t *server;   /*!< Name server structure. */
-	unsigned thread_id; /*!< Thread identifier. */
+	knot_layer_t layer;  /*!< Query processing layer. */
+	server_t *server;    /*!< Name server structure. */
+	unsigned thread_id;  /*!< Thread identifier. */
+	bool gso;            /*!< Use UDP generic segmentation offload. */
+	unsigned batch_size; /*!< Maximum size of received batches. */
+	bool busy_poll;      /*!< Receive again without polling if the batch was full. */
+	bool xdp_inplace;    /*!< Reply to XDP queries in the received frames. */
+	bool batch_full;     /*!< Indication that the last received batch was full. */
+	udp_stats_t *stats;  /*!< Receive batch statistics (optional). */
+	process_query_batch_t batch; /*!< Query batch processing context. */
 } udp_context_t;
 
+static void udp_stats_update(udp_stats_t *stats, int rcvd, bool full)
+{
+	if (stats == NULL) {
+		return;
+	}
+
+	ATOMIC_ADD(stats->batches, 1);
+	ATOMIC_ADD(stats->msgs, rcvd);
+	if (full) {
+		ATOMIC_ADD(stats->full, 1);
+	}
+}
+
 static bool udp_state_active(int state)
 {
 	return (state == KNOT_STATE_PRODUCE || state == KNOT_STATE_FAIL);
@@ -71,6 +95,11 @@ static void udp_handle(udp_context_t *udp, int fd, struct sockaddr_storage *ss,
 		.xdp_msg = xdp_msg,
 		.thread_id = udp->thread_id
 	};
+#ifdef ENABLE_XDP
+	if (xdp_msg != NULL) {
+		params.local = (struct sockaddr_storage *)&xdp_msg->ip_to;
+	}
+#endif
 
 	/* Start query processing. */
 	knot_layer_begin(&udp->layer, &params);
@@ -106,9 +135,9 @@ static void udp_handle(udp_context_t *udp, int fd, struct sockaddr_storage *ss,
 }
 
 typedef struct {
-	void* (*udp_init)(void);
+	void* (*udp_init)(udp_context_t *);
 	void (*udp_deinit)(void *);
-	int (*udp_recv)(int, void *, void *);
+	int (*udp_recv)(udp_context_t *, int, void *, void *);
 	int (*udp_handle)(udp_context_t *, void *, void *);
 	int (*udp_send)(void *, void *);
 } udp_api_t;
@@ -157,8 +186,9 @@ struct udp_recvfrom {
 	cmsg_pktinfo_t pktinfo;
 };
 
-static void *udp_recvfrom_init(void)
+static void *udp_recvfrom_init(udp_context_t *ctx)
 {
+	UNUSED(ctx);
 	struct udp_recvfrom *rq = malloc(sizeof(struct udp_recvfrom));
 	if (rq == NULL) {
 		return NULL;
@@ -184,9 +214,10 @@ static void udp_recvfrom_deinit(void *d)
 	free(rq);
 }
 
-static int udp_recvfrom_recv(int fd, void *d, void *unused)
+static int udp_recvfrom_recv(udp_context_t *ctx, int fd, void *d, void *unused)
 {
 	UNUSED(unused);
+	ctx->batch_full = false;
 	/* Reset max lengths. */
 	struct udp_recvfrom *rq = (struct udp_recvfrom *)d;
 	rq->iov[RX].iov_len = KNOT_WIRE_MAX_PKTSIZE;
@@ -197,6 +228,7 @@ static int udp_recvfrom_recv(int fd, void *d, void *unused)
 	if (ret > 0) {
 		rq->fd = fd;
 		rq->iov[RX].iov_len = ret;
+		ctx->batch_full = true;
 		return 1;
 	}
 
@@ -247,19 +279,43 @@ static udp_api_t udp_recvfrom_api = {
 };
 
 #ifdef ENABLE_RECVMMSG
+#ifdef UDP_SEGMENT
+/*! \brief Limits of one UDP GSO super-packet. */
+enum {
+	UDP_GSO_MAX_SEGS = 64,
+	UDP_GSO_MAX_SIZE = UINT16_MAX - 64, /* Minus IP and UDP headers. */
+	UDP_GSO_MAX_SEG_SIZE = 1232,        /* Fits the minimum IPv6 MTU. */
+};
+
+/*! \brief Control message to fit packet info and UDP GSO segment size. */
+typedef union {
+	struct cmsghdr cmsg;
+	uint8_t buf[sizeof(cmsg_pktinfo_t) + CMSG_SPACE(sizeof(uint16_t))];
+} cmsg_gso_t;
+#endif
+
 /* UDP recvmmsg() request struct. */
 struct udp_recvmmsg {
 	int fd;
-	struct sockaddr_storage addrs[RECVMMSG_BATCHLEN];
+	struct sockaddr_storage addrs[RECVMMSG_BATCHMAX];
 	char *iobuf[NBUFS];
 	struct iovec *iov[NBUFS];
 	struct mmsghdr *msgs[NBUFS];
 	unsigned rcvd;
 	knot_mm_t mm;
-	cmsg_pktinfo_t pktinfo[RECVMMSG_BATCHLEN];
+	cmsg_pktinfo_t pktinfo[RECVMMSG_BATCHMAX];
+	unsigned batch;
+	unsigned batch_max;
+#ifdef UDP_SEGMENT
+	bool gso;
+	struct mmsghdr gso_msgs[RECVMMSG_BATCHMAX];
+	struct iovec gso_iov[RECVMMSG_BATCHMAX];
+	cmsg_gso_t gso_cmsg[RECVMMSG_BATCHMAX];
+	unsigned gso_group[RECVMMSG_BATCHMAX]; /*!< Super-packet of each response. */
+#endif
 };
 
-static void *udp_recvmmsg_init(void)
+static void *udp_recvmmsg_init(udp_context_t *ctx)
 {
 	knot_mm_t mm;
 	mm_ctx_mempool(&mm, sizeof(struct udp_recvmmsg));
@@ -267,14 +323,20 @@ static void *udp_recvmmsg_init(void)
 	struct udp_recvmmsg *rq = mm_alloc(&mm, sizeof(struct udp_recvmmsg));
 	memset(rq, 0, sizeof(*rq));
 	memcpy(&rq->mm, &mm, sizeof(knot_mm_t));
+	rq->batch_max = MIN(MAX(ctx->batch_size, 1), RECVMMSG_BATCHMAX);
+	rq->batch = rq->batch_max;
+#ifdef UDP_SEGMENT
+	rq->gso = ctx->gso;
+#endif
 
 	/* Initialize buffers. */
+	const unsigned batch = rq->batch_max;
 	for (unsigned i = 0; i < NBUFS; ++i) {
-		rq->iobuf[i] = mm_alloc(&mm, KNOT_WIRE_MAX_PKTSIZE * RECVMMSG_BATCHLEN);
-		rq->iov[i] = mm_alloc(&mm, sizeof(struct iovec) * RECVMMSG_BATCHLEN);
-		rq->msgs[i] = mm_alloc(&mm, sizeof(struct mmsghdr) * RECVMMSG_BATCHLEN);
-		memset(rq->msgs[i], 0, sizeof(struct mmsghdr) * RECVMMSG_BATCHLEN);
-		for (unsigned k = 0; k < RECVMMSG_BATCHLEN; ++k) {
+		rq->iobuf[i] = mm_alloc(&mm, KNOT_WIRE_MAX_PKTSIZE * batch);
+		rq->iov[i] = mm_alloc(&mm, sizeof(struct iovec) * batch);
+		rq->msgs[i] = mm_alloc(&mm, sizeof(struct mmsghdr) * batch);
+		memset(rq->msgs[i], 0, sizeof(struct mmsghdr) * batch);
+		for (unsigned k = 0; k < batch; ++k) {
 			rq->iov[i][k].iov_base = rq->iobuf[i] + k * KNOT_WIRE_MAX_PKTSIZE;
 			rq->iov[i][k].iov_len = KNOT_WIRE_MAX_PKTSIZE;
 			rq->msgs[i][k].msg_hdr.msg_iov = rq->iov[i] + k;
@@ -297,16 +359,25 @@ static void udp_recvmmsg_deinit(void *d)
 	}
 }
 
-static int udp_recvmmsg_recv(int fd, void *d, void *unused)
+static int udp_recvmmsg_recv(udp_context_t *ctx, int fd, void *d, void *unused)
 {
 	UNUSED(unused);
 	struct udp_recvmmsg *rq = d;
 
-	int n = recvmmsg(fd, rq->msgs[RX], RECVMMSG_BATCHLEN, MSG_DONTWAIT, NULL);
+	int n = recvmmsg(fd, rq->msgs[RX], rq->batch, MSG_DONTWAIT, NULL);
 	if (n > 0) {
 		rq->fd = fd;
 		rq->rcvd = n;
 	}
+
+	/* Adapt the batch size to the load. */
+	ctx->batch_full = (n == rq->batch);
+	if (ctx->batch_full) {
+		rq->batch = MIN(2 * rq->batch, rq->batch_max);
+	} else if (n > 0 && n <= rq->batch / 4) {
+		rq->batch = MAX(rq->batch / 2, 1);
+	}
+
 	return n;
 }
 
@@ -315,15 +386,35 @@ static int udp_recvmmsg_handle(udp_context_t *ctx, void *d, void *unused)
 	UNUSED(unused);
 	struct udp_recvmmsg *rq = d;
 
+	knot_layer_batch_begin(&ctx->layer, &ctx->batch);
+
 	/* Handle each received msg. */
 	for (unsigned i = 0; i < rq->rcvd; ++i) {
 		struct iovec *rx = rq->msgs[RX][i].msg_hdr.msg_iov;
 		struct iovec *tx = rq->msgs[TX][i].msg_hdr.msg_iov;
 		rx->iov_len = rq->msgs[RX][i].msg_len; /* Received bytes. */
 
+		if (i + 1 < rq->rcvd) {
+			struct iovec *next = rq->msgs[RX][i + 1].msg_hdr.msg_iov;
+			knot_layer_batch_prefetch(&ctx->layer, next->iov_base,
+			                          rq->msgs[RX][i + 1].msg_len);
+		}
+
 		udp_pktinfo_handle(&rq->msgs[RX][i].msg_hdr, &rq->msgs[TX][i].msg_hdr);
 
+		/* The answer may be completed at the end of the batch. */
+		ctx->batch.answer_size = &tx->iov_len;
 		udp_handle(ctx, rq->fd, rq->addrs + i, rx, tx, NULL);
+		ctx->batch.answer_size = NULL;
+	}
+
+	/* Still within the batch, the deferring modules must stay loaded. */
+	process_query_resume(&ctx->batch);
+
+	knot_layer_batch_end(&ctx->layer);
+
+	for (unsigned i = 0; i < rq->rcvd; ++i) {
+		struct iovec *tx = rq->msgs[TX][i].msg_hdr.msg_iov;
 		rq->msgs[TX][i].msg_len = tx->iov_len;
 		rq->msgs[TX][i].msg_hdr.msg_namelen = 0;
 		if (tx->iov_len > 0) {
@@ -335,11 +426,142 @@ static int udp_recvmmsg_handle(udp_context_t *ctx, void *d, void *unused)
 	return KNOT_EOK;
 }
 
+#ifdef UDP_SEGMENT
+static bool udp_gso_match(const struct msghdr *a, const struct msghdr *b)
+{
+	return a->msg_iov->iov_len == b->msg_iov->iov_len &&
+	       a->msg_namelen == b->msg_namelen &&
+	       a->msg_controllen == b->msg_controllen &&
+	       sockaddr_cmp(a->msg_name, b->msg_name, false) == 0 &&
+	       (a->msg_controllen == 0 ||
+	        memcmp(a->msg_control, b->msg_control, a->msg_controllen) == 0);
+}
+
+/*!
+ * \brief Send the responses with UDP GSO.
+ *
+ * Responses of the same size for the same destination (and source) are
+ * sent as one super-packet, which is segmented by the kernel or the NIC.
+ * Responses larger than a segment safely below the MTU are sent alone.
+ *
+ * \return Number of sent messages (super-packets), or -1 on error.
+ */
+static int udp_recvmmsg_send_gso(struct udp_recvmmsg *rq)
+{
+	bool used[RECVMMSG_BATCHMAX] = { false };
+	unsigned out = 0;
+	unsigned niov = 0;
+
+	for (unsigned i = 0; i < rq->rcvd; ++i) {
+		const struct msghdr *first = &rq->msgs[TX][i].msg_hdr;
+		size_t size = first->msg_iov->iov_len;
+		if (used[i] || size == 0) {
+			continue;
+		}
+
+		/* Collect matching responses. */
+		struct msghdr *hdr = &rq->gso_msgs[out].msg_hdr;
+		hdr->msg_name = first->msg_name;
+		hdr->msg_namelen = first->msg_namelen;
+		hdr->msg_iov = rq->gso_iov + niov;
+		hdr->msg_iovlen = 0;
+		for (unsigned k = i; k < rq->rcvd; ++k) {
+			const struct msghdr *next = &rq->msgs[TX][k].msg_hdr;
+			if (used[k] || !udp_gso_match(first, next)) {
+				continue;
+			}
+			rq->gso_iov[niov++] = *next->msg_iov;
+			rq->gso_group[k] = out;
+			used[k] = true;
+			if (++hdr->msg_iovlen == UDP_GSO_MAX_SEGS || size > UDP_GSO_MAX_SEG_SIZE ||
+			    (hdr->msg_iovlen + 1) * size > UDP_GSO_MAX_SIZE) {
+				break;
+			}
+		}
+
+		/* Copy the packet info and append the segment size. */
+		cmsg_gso_t *cmsg = &rq->gso_cmsg[out];
+		memset(cmsg, 0, sizeof(*cmsg));
+		if (first->msg_controllen > 0) {
+			memcpy(cmsg->buf, first->msg_control, first->msg_controllen);
+		}
+		hdr->msg_control = cmsg->buf;
+		hdr->msg_controllen = first->msg_controllen;
+		if (hdr->msg_iovlen > 1) {
+			hdr->msg_controllen += CMSG_SPACE(sizeof(uint16_t));
+			struct cmsghdr *seg = (struct cmsghdr *)(cmsg->buf + first->msg_controllen);
+			seg->cmsg_level = SOL_UDP;
+			seg->cmsg_type = UDP_SEGMENT;
+			seg->cmsg_len = CMSG_LEN(sizeof(uint16_t));
+			uint16_t seg_size = size;
+			memcpy(CMSG_DATA(seg), &seg_size, sizeof(seg_size));
+		} else if (hdr->msg_controllen == 0) {
+			hdr->msg_control = NULL;
+		}
+		out++;
+	}
+
+	if (out == 0) {
+		return 0;
+	}
+
+	return sendmmsg(rq->fd, rq->gso_msgs, out, 0);
+}
+
+/*!
+ * \brief Send the responses of the super-packets that weren't sent, one by one.
+ *
+ * \param sent  Number of super-packets sent by udp_recvmmsg_send_gso().
+ *
+ * \return Number of sent responses.
+ */
+static int udp_recvmmsg_send_rest(struct udp_recvmmsg *rq, unsigned sent)
+{
+	unsigned count = 0;
+	for (unsigned i = 0; i < rq->rcvd; ++i) {
+		if (rq->msgs[TX][i].msg_hdr.msg_iov->iov_len > 0 && rq->gso_group[i] >= sent) {
+			rq->gso_msgs[count++] = rq->msgs[TX][i];
+		}
+	}
+
+	unsigned done = 0, ok = 0;
+	while (done < count) {
+		int ret = sendmmsg(rq->fd, rq->gso_msgs + done, count - done, 0);
+		if (ret > 0) {
+			done += ret;
+			ok += ret;
+		} else if (errno == EAGAIN || errno == EWOULDBLOCK || errno == ENOBUFS) {
+			break;
+		} else {
+			done++; /* Skip the response which failed to be sent. */
+		}
+	}
+
+	return ok;
+}
+#endif
+
 static int udp_recvmmsg_send(void *d, void *unused)
 {
 	UNUSED(unused);
 	struct udp_recvmmsg *rq = d;
-	int rc = sendmmsg(rq->fd, rq->msgs[TX], rq->rcvd, 0);
+	int rc = -1;
+#ifdef UDP_SEGMENT
+	if (rq->gso && rq->rcvd > 1) {
+		rc = udp_recvmmsg_send_gso(rq);
+		if (rc < 0 && (errno == EIO || errno == ENOPROTOOPT)) {
+			/* Not supported by the interface or the kernel. */
+			rq->gso = false;
+		}
+		/* Resend the rest if the sending stopped at a failed super-packet. */
+		rc = MAX(rc, 0);
+		rc += udp_recvmmsg_send_rest(rq, rc);
+	}
+#endif
+	if (rc < 0) {
+		rc = sendmmsg(rq->fd, rq->msgs[TX], rq->rcvd, 0);
+	}
+
 	for (unsigned i = 0; i < rq->rcvd; ++i) {
 		/* Reset buffer size and address len. */
 		struct iovec *rx = rq->msgs[RX][i].msg_hdr.msg_iov;
@@ -369,10 +591,12 @@ struct xdp_recvmmsg {
 	knot_xdp_msg_t msgs_rx[XDP_BATCHLEN];
 	knot_xdp_msg_t msgs_tx[XDP_BATCHLEN];
 	uint32_t rcvd;
+	uint8_t query[KNOT_WIRE_MAX_PKTSIZE]; /*!< Copy of the in-place replied query. */
 };
 
-static void *xdp_recvmmsg_init(void)
+static void *xdp_recvmmsg_init(udp_context_t *ctx)
 {
+	UNUSED(ctx);
 	struct xdp_recvmmsg *rq = malloc(sizeof(*rq));
 	if (rq != NULL) {
 		memset(rq, 0, sizeof(*rq));
@@ -386,12 +610,13 @@ static void xdp_recvmmsg_deinit(void *d)
 	free(rq);
 }
 
-static int xdp_recvmmsg_recv(int fd, void *d, void *xdp_sock)
+static int xdp_recvmmsg_recv(udp_context_t *ctx, int fd, void *d, void *xdp_sock)
 {
 	UNUSED(fd);
 	struct xdp_recvmmsg *rq = d;
 
 	int ret = knot_xdp_recv(xdp_sock, rq->msgs_rx, XDP_BATCHLEN, &rq->rcvd, NULL);
+	ctx->batch_full = (ret == KNOT_EOK && rq->rcvd == XDP_BATCHLEN);
 
 	return ret == KNOT_EOK ? rq->rcvd : ret;
 }
@@ -402,16 +627,35 @@ static int xdp_recvmmsg_handle(udp_context_t *ctx, void *d, void *xdp_sock)
 
 	knot_xdp_send_prepare(xdp_sock);
 
+	knot_layer_batch_begin(&ctx->layer, &ctx->batch);
+
 	uint32_t responses = 0;
 	for (uint32_t i = 0; i < rq->rcvd; ++i) {
 		if (rq->msgs_rx[i].payload.iov_len == 0) {
 			continue; // Skip marked (zero length) messages.
 		}
-		int ret = knot_xdp_reply_alloc(xdp_sock, &rq->msgs_rx[i], &rq->msgs_tx[i]);
+		int ret;
+		if (ctx->xdp_inplace) {
+			ret = knot_xdp_reply_inplace(xdp_sock, &rq->msgs_rx[i], &rq->msgs_tx[i]);
+			if (ret == KNOT_EOK) {
+				// The reply overwrites the query, process its copy.
+				struct iovec *payload = &rq->msgs_rx[i].payload;
+				assert(payload->iov_len <= sizeof(rq->query));
+				memcpy(rq->query, payload->iov_base, payload->iov_len);
+				payload->iov_base = rq->query;
+			}
+		} else {
+			ret = knot_xdp_reply_alloc(xdp_sock, &rq->msgs_rx[i], &rq->msgs_tx[i]);
+		}
 		if (ret != KNOT_EOK) {
 			break; // Still free all RX buffers.
 		}
 
+		if (i + 1 < rq->rcvd) {
+			knot_layer_batch_prefetch(&ctx->layer, rq->msgs_rx[i + 1].payload.iov_base,
+			                          rq->msgs_rx[i + 1].payload.iov_len);
+		}
+
 		// udp_pktinfo_handle not needed for XDP as one worker is bound
 		// to one interface only.
 
@@ -422,6 +666,8 @@ static int xdp_recvmmsg_handle(udp_context_t *ctx, void *d, void *xdp_sock)
 		responses++;
 	}
 
+	knot_layer_batch_end(&ctx->layer);
+
 	knot_xdp_recv_finish(xdp_sock, rq->msgs_rx, rq->rcvd);
 	rq->rcvd = responses;
 
@@ -436,7 +682,8 @@ static int xdp_recvmmsg_send(void *d, void *xdp_sock)
 	int ret = knot_xdp_send(xdp_sock, rq->msgs_tx, sent, &sent);
 	knot_xdp_send_finish(xdp_sock);
 
-	memset(rq, 0, sizeof(*rq));
+	// The query copy needn't be cleared.
+	memset(rq, 0, offsetof(struct xdp_recvmmsg, query));
 
 	return ret == KNOT_EOK ? sent : ret;
 }
@@ -538,16 +785,23 @@ int udp_master(dthread_t *thread)
 		return KNOT_EOK;
 	}
 
-	/* Set thread affinity to CPU core (same for UDP and XDP). */
+	/* Set thread affinity to CPU core (same for UDP and XDP). The topology
+	 * placement is for UDP workers only, XDP workers are left unpinned then. */
+	bool xdp_thread = is_xdp_thread(handler->server->ifaces, thread_id);
+	const udp_affinity_t *affinity = &handler->server->udp_affinity;
+	int cpu_id = xdp_thread ? -1 : udp_affinity_cpu(affinity, dt_get_id(thread));
 	unsigned cpu = dt_online_cpus();
-	if (cpu > 1) {
+	if (cpu_id >= 0) {
+		unsigned cpu_mask = cpu_id;
+		dt_setaffinity(thread, &cpu_mask, 1);
+	} else if (cpu > 1 && !(xdp_thread && affinity->steer != NULL)) {
 		unsigned cpu_mask = (dt_get_id(thread) % cpu);
 		dt_setaffinity(thread, &cpu_mask, 1);
 	}
 
 	/* Choose processing API. */
 	udp_api_t *api = NULL;
-	if (is_xdp_thread(handler->server->ifaces, thread_id)) {
+	if (xdp_thread) {
 #ifdef ENABLE_XDP
 		api = &xdp_recvmmsg_api;
 #else
@@ -560,7 +814,6 @@ int udp_master(dthread_t *thread)
 		api = &udp_recvfrom_api;
 #endif
 	}
-	void *rq = api->udp_init();
 
 	/* Create big enough memory cushion. */
 	knot_mm_t mm;
@@ -570,8 +823,18 @@ int udp_master(dthread_t *thread)
 	udp_context_t udp = {
 		.server = handler->server,
 		.thread_id = thread_id,
+		.gso = conf()->cache.srv_udp_gso,
+		.batch_size = conf()->cache.srv_udp_batch_size,
+		.busy_poll = conf()->cache.srv_udp_busy_poll > 0,
+		.xdp_inplace = conf()->cache.srv_xdp_inplace_reply,
 	};
+	if (handler == &handler->server->handlers[IO_UDP].handler) {
+		udp.stats = &handler->server->udp_stats[dt_get_id(thread)];
+	}
 	knot_layer_init(&udp.layer, &mm, process_query_layer());
+	process_query_batch_init(&udp.batch, handler->server);
+
+	void *rq = api->udp_init(&udp);
 
 	/* Allocate descriptors for the configured interfaces. */
 	void *xdp_socket = NULL;
@@ -605,10 +868,16 @@ int udp_master(dthread_t *thread)
 				continue;
 			}
 			events -= 1;
-			if (api->udp_recv(fds[i].fd, rq, xdp_socket) > 0) {
+			/* In busy-poll mode, receive while the batches are full. */
+			do {
+				int rcvd = api->udp_recv(&udp, fds[i].fd, rq, xdp_socket);
+				if (rcvd <= 0) {
+					break;
+				}
+				udp_stats_update(udp.stats, rcvd, udp.batch_full);
 				api->udp_handle(&udp, rq, xdp_socket);
 				api->udp_send(rq, xdp_socket);
-			}
+			} while (udp.busy_poll && udp.batch_full && !dt_is_cancelled(thread));
 		}
 	}
 
@@ -682,6 +682,12 @@ static int commit_journal(conf_t *conf, zone_update_t *update)
 		}
 	} else {
 		if (content == JOURNAL_CONTENT_ALL) {
+			if (update->zij_stream != NULL &&
+			    journal_zone_stream_publish(update->zij_stream, update->new_cont) == KNOT_EOK) {
+				log_zone_info(update->zone->name, "zone stored to journal, serial %u",
+				              zone_contents_serial(update->new_cont));
+				return KNOT_EOK;
+			}
 			return zone_in_journal_store(conf, update->zone, update->new_cont);
 		} else if (content != JOURNAL_CONTENT_NONE) { // zone_in_journal_store does this automatically
 			return zone_changes_clear(conf, update->zone);
@@ -829,18 +835,20 @@ int zone_update_semcheck(zone_update_t *update)
 	                         update->a_ctx->node_ptrs : NULL;
 
 	// adjust_cb_nsec3_pointer not needed as we don't check DNSSEC here
-	int ret = zone_adjust_contents(update->new_cont, adjust_cb_flags, NULL,
-	                               false, false, 1, node_ptrs);
-	if (ret != KNOT_EOK) {
-		return ret;
+	if (!(update->flags & UPDATE_ADJUSTED)) {
+		int ret = zone_adjust_contents(update->new_cont, adjust_cb_flags, NULL,
+		                               false, false, 1, node_ptrs);
+		if (ret != KNOT_EOK) {
+			return ret;
+		}
 	}
 
 	sem_handler_t handler = {
 		.cb = err_handler_logger
 	};
 
-	ret = sem_checks_process(update->new_cont, SEMCHECK_MANDATORY_ONLY,
-	                         &handler, time(NULL));
+	int ret = sem_checks_process(update->new_cont, SEMCHECK_MANDATORY_ONLY,
+	                             &handler, time(NULL), 1);
 	if (ret != KNOT_EOK) {
 		// error is logged by the error handler
 		return ret;
@@ -878,7 +886,9 @@ int zone_update_commit(conf_t *conf, zone_update_t *update)
 	}
 
 	conf_val_t thr = conf_zone_get(conf, C_ADJUST_THR, update->zone->name);
-	if ((update->flags & (UPDATE_HYBRID | UPDATE_FULL))) {
+	if ((update->flags & UPDATE_ADJUSTED)) {
+		ret = zone_adjust_pointers(update->new_cont, conf_int(&thr));
+	} else if ((update->flags & (UPDATE_HYBRID | UPDATE_FULL))) {
 		ret = zone_adjust_full(update->new_cont, conf_int(&thr));
 	} else {
 		ret = zone_adjust_incremental_update(update, conf_int(&thr));
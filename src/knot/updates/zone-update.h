@@ -18,6 +18,7 @@
 
 #include "knot/updates/apply.h"
 #include "knot/conf/conf.h"
+#include "knot/journal/journal_write.h"
 #include "knot/updates/changesets.h"
 #include "knot/zone/contents.h"
 #include "knot/zone/zone.h"
@@ -37,6 +38,7 @@ typedef struct zone_update {
 	changeset_t extra_ch;        /*!< Extra changeset to store just diff btwn zonefile and result. */
 	apply_ctx_t *a_ctx;          /*!< Context for applying changesets. */
 	uint32_t flags;              /*!< Zone update flags. */
+	journal_zone_stream_t *zij_stream; /*!< Zone-in-journal written while receiving new_cont. */
 	dnssec_validation_hint_t validation_hint;
 } zone_update_t;
 
@@ -55,6 +57,7 @@ typedef enum {
 	// Additional flags
 	UPDATE_SIGN           = 1 << 3, /*!< Sign the resulting zone. */
 	UPDATE_STRICT         = 1 << 4, /*!< Apply changes strictly, i.e. fail when removing nonexistent RR. */
+	UPDATE_ADJUSTED       = 1 << 5, /*!< Node flags, prev pointers and size of new_cont already adjusted. */
 	UPDATE_EXTRA_CHSET    = 1 << 6, /*!< Extra changeset in use, to store diff btwn zonefile and final contents. */
 	UPDATE_CHANGED_NSEC   = 1 << 7, /*!< This incremental update affects NSEC or NSEC3 nodes in zone. */
 } zone_update_flags_t;
@@ -306,9 +306,7 @@ typedef struct {
 	measure_t *m;
 
 	// just for parallel
-	unsigned threads;
-	unsigned thr_id;
-	size_t i;
+	trie_parts_t *parts;
 	pthread_t thread;
 	int ret;
 	zone_tree_t *tree;
@@ -321,13 +319,6 @@ static int adjust_single(zone_node_t *node, void *data)
 
 	zone_adjust_arg_t *args = (zone_adjust_arg_t *)data;
 
-	// parallel adjust support
-	if (args->threads > 1) {
-		if (args->i++ % args->threads != args->thr_id) {
-			return KNOT_EOK;
-		}
-	}
-
 	if (args->m != NULL) {
 		knot_measure_node(node, args->m);
 	}
@@ -387,7 +378,7 @@ static void *adjust_tree_thread(void *ctx)
 {
 	zone_adjust_arg_t *arg = ctx;
 
-	arg->ret = zone_tree_apply(arg->tree, adjust_single, ctx);
+	arg->ret = zone_tree_parts_apply(arg->tree, arg->parts, adjust_single, ctx);
 
 	return NULL;
 }
@@ -399,6 +390,11 @@ static int zone_adjust_tree_parallel(zone_tree_t *tree, adjust_ctx_t *ctx,
 		return KNOT_EOK;
 	}
 
+	trie_parts_t *parts = zone_tree_parts_new(tree, threads);
+	if (parts == NULL) {
+		return KNOT_ENOMEM;
+	}
+
 	zone_adjust_arg_t args[threads];
 	memset(args, 0, sizeof(args));
 	int ret = KNOT_EOK;
@@ -410,9 +406,7 @@ static int zone_adjust_tree_parallel(zone_tree_t *tree, adjust_ctx_t *ctx,
 		args[i].adjust_prevs = false;
 		args[i].m = NULL;
 		args[i].tree = tree;
-		args[i].threads = threads;
-		args[i].i = 0;
-		args[i].thr_id = i;
+		args[i].parts = parts;
 		args[i].ret = -1;
 		if (ctx->changed_nodes != NULL) {
 			args[i].ctx.changed_nodes = zone_tree_create(true);
@@ -427,6 +421,7 @@ static int zone_adjust_tree_parallel(zone_tree_t *tree, adjust_ctx_t *ctx,
 		for (unsigned i = 0; i < threads; i++) {
 			zone_tree_free(&args[i].ctx.changed_nodes);
 		}
+		trie_parts_free(parts);
 		return ret;
 	}
 
@@ -447,6 +442,8 @@ static int zone_adjust_tree_parallel(zone_tree_t *tree, adjust_ctx_t *ctx,
 		zone_tree_free(&args[i].ctx.changed_nodes);
 	}
 
+	trie_parts_free(parts);
+
 	return ret;
 }
 
@@ -516,9 +513,15 @@ int zone_adjust_full(zone_contents_t *zone, unsigned threads)
 	int ret = zone_adjust_contents(zone, adjust_cb_flags, adjust_cb_nsec3_flags,
 	                               true, true, 1, NULL);
 	if (ret == KNOT_EOK) {
-		ret = zone_adjust_contents(zone, adjust_cb_nsec3_and_additionals, NULL,
-		                           false, false, threads, NULL);
+		ret = zone_adjust_pointers(zone, threads);
 	}
+	return ret;
+}
+
+int zone_adjust_pointers(zone_contents_t *zone, unsigned threads)
+{
+	int ret = zone_adjust_contents(zone, adjust_cb_nsec3_and_additionals, NULL,
+	                               false, false, threads, NULL);
 	if (ret == KNOT_EOK) {
 		additionals_tree_free(zone->adds_tree);
 		ret = additionals_tree_from_zone(&zone->adds_tree, zone);
@@ -526,6 +529,132 @@ int zone_adjust_full(zone_contents_t *zone, unsigned threads)
 	return ret;
 }
 
+void zone_adjust_stream_init(zone_adjust_stream_t *ctx, zone_contents_t *zone)
+{
+	memset(ctx, 0, sizeof(*ctx));
+	ctx->zone = zone;
+	ctx->m = knot_measure_init(true, false);
+	ctx->trees[0].last = zone->apex;
+	ctx->valid = true;
+}
+
+/*! \brief Same as adjust_single() in the first phase of zone_adjust_full(). */
+static void stream_adjust_node(zone_adjust_stream_t *ctx, zone_node_t *node, bool nsec3)
+{
+	struct zone_adjust_stream_tree *tree = &ctx->trees[nsec3];
+	adjust_ctx_t actx = { ctx->zone, NULL, true };
+
+	knot_measure_node(node, &ctx->m);
+
+	if (tree->first == NULL) {
+		tree->first = node;
+	} else {
+		node->prev = tree->previous;
+	}
+
+	int ret = nsec3 ? adjust_cb_nsec3_flags(node, &actx) : adjust_cb_flags(node, &actx);
+	if (ret != KNOT_EOK) {
+		ctx->valid = false;
+	}
+
+	if (!(node->flags & NODE_FLAGS_NONAUTH) && node->rrset_count > 0) {
+		tree->previous = node;
+	}
+}
+
+static void stream_adjust_apex(zone_adjust_stream_t *ctx)
+{
+	stream_adjust_node(ctx, ctx->zone->apex, false);
+	if (zone_contents_load_nsec3param(ctx->zone) != KNOT_EOK) {
+		ctx->valid = false;
+	}
+	ctx->apex_done = true;
+}
+
+/*! \brief Adjust the node being filled so far, unless already done. */
+static void stream_close_last(zone_adjust_stream_t *ctx, bool nsec3)
+{
+	zone_node_t *last = ctx->trees[nsec3].last;
+	if (last == NULL) {
+		return;
+	} else if (last == ctx->zone->apex) {
+		if (!ctx->apex_done) {
+			stream_adjust_apex(ctx);
+		}
+	} else {
+		stream_adjust_node(ctx, last, nsec3);
+	}
+}
+
+void zone_adjust_stream_node(zone_adjust_stream_t *ctx, zone_node_t *node, bool nsec3)
+{
+	if (!ctx->valid) {
+		return;
+	}
+
+	// NSEC3 nodes can't be adjusted without the NSEC3 parameters from apex.
+	if (nsec3 && !ctx->apex_done) {
+		if (ctx->trees[0].last != ctx->zone->apex) {
+			ctx->valid = false;
+			return;
+		}
+		stream_adjust_apex(ctx);
+	}
+
+	zone_node_t *last = ctx->trees[nsec3].last;
+	if (node == last) {
+		// Records of the apex after it's been adjusted due to NSEC3.
+		if (node == ctx->zone->apex && ctx->apex_done) {
+			ctx->valid = false;
+		}
+		return;
+	} else if (last != NULL && knot_dname_cmp(node->owner, last->owner) <= 0) {
+		ctx->valid = false;
+		return;
+	}
+
+	stream_close_last(ctx, nsec3);
+
+	if (!nsec3) {
+		// Empty non-terminals created together with the node, parents first.
+		zone_node_t *ents[KNOT_DNAME_MAXLABELS];
+		size_t count = 0;
+		for (zone_node_t *parent = node_parent(node);
+		     parent != NULL && knot_dname_cmp(parent->owner, last->owner) > 0;
+		     parent = node_parent(parent)) {
+			assert(count < KNOT_DNAME_MAXLABELS);
+			ents[count++] = parent;
+		}
+		while (count > 0) {
+			stream_adjust_node(ctx, ents[--count], false);
+		}
+	}
+
+	ctx->trees[nsec3].last = node;
+}
+
+int zone_adjust_stream_finish(zone_adjust_stream_t *ctx)
+{
+	if (ctx->valid) {
+		stream_close_last(ctx, false);
+		stream_close_last(ctx, true);
+	}
+	if (!ctx->valid) {
+		return KNOT_ENOTSUP;
+	}
+
+	for (int i = 0; i < 2; i++) {
+		if (ctx->trees[i].first != NULL) {
+			ctx->trees[i].first->prev = ctx->trees[i].previous;
+		}
+	}
+
+	ctx->zone->dnssec = node_rrtype_is_signed(ctx->zone->apex, KNOT_RRTYPE_SOA);
+	knot_measure_finish_zone(&ctx->m, ctx->zone);
+
+	return KNOT_EOK;
+}
+
 static int adjust_additionals_cb(zone_node_t *node, void *ctx)
 {
 	adjust_ctx_t *actx = ctx;
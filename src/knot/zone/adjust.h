@@ -17,6 +17,7 @@
 #pragma once
 
 #include "knot/zone/contents.h"
+#include "knot/zone/measure.h"
 #include "knot/updates/zone-update.h"
 
 typedef struct {
@@ -112,6 +113,74 @@ int zone_adjust_update(zone_update_t *update, adjust_cb_t nodes_cb, adjust_cb_t
  */
 int zone_adjust_full(zone_contents_t *zone, unsigned threads);
 
+/*!
+ * \brief Do the second phase of full adjust: nsec3-related pointers and additionals.
+ *
+ * \note The first phase (node flags, prev pointers, zone measurement) must have
+ *       been done before, e.g. by zone_adjust_stream_finish().
+ *
+ * \param zone     Zone to be adjusted.
+ * \param threads  Parallelize some adjusting using specified threads.
+ *
+ * \return KNOT_E*
+ */
+int zone_adjust_pointers(zone_contents_t *zone, unsigned threads);
+
+/*!
+ * \brief Context of the first adjust phase done while the zone is being filled.
+ */
+typedef struct {
+	zone_contents_t *zone;
+	measure_t m;
+	struct zone_adjust_stream_tree {
+		zone_node_t *first;     //!< First adjusted node of the tree.
+		zone_node_t *last;      //!< Node still being filled with records.
+		zone_node_t *previous;  //!< Last adjusted authoritative node.
+	} trees[2];                     //!< Normal and NSEC3 nodes.
+	bool apex_done;                 //!< Apex adjusted and NSEC3 parameters loaded.
+	bool valid;                     //!< Records came in canonical order so far.
+} zone_adjust_stream_t;
+
+/*!
+ * \brief Start adjusting an empty zone while it's being filled.
+ *
+ * \param ctx    Context to be initialized.
+ * \param zone   Zone contents with just the apex.
+ */
+void zone_adjust_stream_init(zone_adjust_stream_t *ctx, zone_contents_t *zone);
+
+/*!
+ * \brief Note a node which a record has just been added to.
+ *
+ * Once the records move to a following node, the previous one is complete
+ * and its flags and prev pointer get adjusted. Records not in canonical
+ * order invalidate the context.
+ *
+ * \param ctx     Adjusting context.
+ * \param node    Node the record has been added to.
+ * \param nsec3   The node is in the NSEC3 tree.
+ */
+void zone_adjust_stream_node(zone_adjust_stream_t *ctx, zone_node_t *node, bool nsec3);
+
+/*!
+ * \brief Stop adjusting, the zone is going to be adjusted at once later.
+ */
+inline static void zone_adjust_stream_cancel(zone_adjust_stream_t *ctx)
+{
+	ctx->valid = false;
+}
+
+/*!
+ * \brief Adjust the last nodes and finish the first adjust phase.
+ *
+ * \param ctx   Adjusting context.
+ *
+ * \retval KNOT_EOK if the first phase of full adjust is done.
+ * \retval KNOT_ENOTSUP if the zone hasn't been adjusted while filled.
+ * \return KNOT_E*
+ */
+int zone_adjust_stream_finish(zone_adjust_stream_t *ctx);
+
 /*!
  * \brief Do a generally approved adjust after incremental update.
  *
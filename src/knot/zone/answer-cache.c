@@ -0,0 +1,251 @@
+/*  Copyright (C) 2020 CZ.NIC, z.s.p.o. <knot-dns@labs.nic.cz>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "knot/zone/answer-cache.h"
+#include "contrib/openbsd/siphash.h"
+#include "libdnssec/error.h"
+#include "libdnssec/random.h"
+#include "libknot/packet/wire.h"
+
+/*! \brief Cached answer. */
+typedef struct {
+	uint32_t seq;       /*!< Sequence lock, odd while being written. */
+	uint32_t candidate; /*!< Hash of the last key missed in this slot. */
+	uint32_t gen;       /*!< Cache generation of the answer. */
+	uint32_t hash;      /*!< Hash of the answer key. */
+	uint16_t qtype;
+	uint16_t qclass;
+	uint16_t max_size;
+	uint8_t flags;
+	uint16_t size;      /*!< Answer size. */
+	uint8_t wire[ANSWER_CACHE_MAX_SIZE]; /*!< Answer with lower-case QNAME. */
+} answer_slot_t;
+
+struct answer_cache {
+	SIPHASH_KEY key;      /*!< Hashing secret. */
+	uint32_t gen;         /*!< Current generation. */
+	size_t size;          /*!< Number of slots. */
+	answer_slot_t *slots; /*!< Cached answers. */
+#ifndef HAVE_ATOMIC
+	pthread_mutex_t lock; /*!< Cache lock if no atomic operations. */
+#endif
+};
+
+static uint32_t key_hash(const answer_cache_t *cache, const answer_cache_key_t *key)
+{
+	uint16_t fields[] = { key->qtype, key->qclass, key->max_size, key->flags };
+
+	SIPHASH_CTX ctx;
+	SipHash24_Init(&ctx, &cache->key);
+	SipHash24_Update(&ctx, key->qname, knot_dname_size(key->qname));
+	SipHash24_Update(&ctx, fields, sizeof(fields));
+
+	return SipHash24_End(&ctx);
+}
+
+static bool slot_match(const answer_slot_t *slot, uint32_t gen, uint32_t hash,
+                       const answer_cache_key_t *key, size_t qname_size)
+{
+	return slot->gen == gen && slot->hash == hash &&
+	       slot->qtype == key->qtype && slot->qclass == key->qclass &&
+	       slot->max_size == key->max_size && slot->flags == key->flags &&
+	       slot->size >= KNOT_WIRE_HEADER_SIZE + qname_size &&
+	       slot->size <= ANSWER_CACHE_MAX_SIZE &&
+	       memcmp(slot->wire + KNOT_WIRE_HEADER_SIZE, key->qname, qname_size) == 0;
+}
+
+answer_cache_t *answer_cache_new(size_t size)
+{
+	if (size == 0) {
+		return NULL;
+	}
+
+	answer_cache_t *cache = calloc(1, sizeof(*cache));
+	if (cache == NULL) {
+		return NULL;
+	}
+#ifndef HAVE_ATOMIC
+	pthread_mutex_init(&cache->lock, NULL);
+#endif
+
+	/* Untouched slots are not allocated physically. */
+	cache->slots = calloc(size, sizeof(answer_slot_t));
+	if (cache->slots == NULL ||
+	    dnssec_random_buffer((uint8_t *)&cache->key, sizeof(cache->key)) != DNSSEC_EOK) {
+		answer_cache_free(cache);
+		return NULL;
+	}
+
+	cache->size = size;
+	cache->gen = 1; // Empty slots have generation 0.
+
+	return cache;
+}
+
+void answer_cache_free(answer_cache_t *cache)
+{
+	if (cache == NULL) {
+		return;
+	}
+
+#ifndef HAVE_ATOMIC
+	pthread_mutex_destroy(&cache->lock);
+#endif
+	free(cache->slots);
+	free(cache);
+}
+
+uint32_t answer_cache_gen(answer_cache_t *cache)
+{
+	if (cache == NULL) {
+		return 0;
+	}
+
+#ifdef HAVE_ATOMIC
+	return __atomic_load_n(&cache->gen, __ATOMIC_ACQUIRE);
+#else
+	pthread_mutex_lock(&cache->lock);
+	uint32_t gen = cache->gen;
+	pthread_mutex_unlock(&cache->lock);
+	return gen;
+#endif
+}
+
+void answer_cache_invalidate(answer_cache_t *cache)
+{
+	if (cache == NULL) {
+		return;
+	}
+
+#ifdef HAVE_ATOMIC
+	uint32_t gen = __atomic_add_fetch(&cache->gen, 1, __ATOMIC_RELEASE);
+	if (gen == 0) { // Skip the generation of empty slots.
+		__atomic_add_fetch(&cache->gen, 1, __ATOMIC_RELEASE);
+	}
+#else
+	pthread_mutex_lock(&cache->lock);
+	if (++cache->gen == 0) { // Skip the generation of empty slots.
+		cache->gen++;
+	}
+	pthread_mutex_unlock(&cache->lock);
+#endif
+}
+
+static void slot_store(answer_slot_t *slot, uint32_t gen, uint32_t hash,
+                       const answer_cache_key_t *key, const uint8_t *wire, size_t size)
+{
+	slot->gen = gen;
+	slot->hash = hash;
+	slot->qtype = key->qtype;
+	slot->qclass = key->qclass;
+	slot->max_size = key->max_size;
+	slot->flags = key->flags;
+	slot->size = size;
+	memcpy(slot->wire, wire, size);
+	knot_dname_to_lower(slot->wire + KNOT_WIRE_HEADER_SIZE);
+}
+
+size_t answer_cache_get(answer_cache_t *cache, uint32_t gen,
+                        const answer_cache_key_t *key, uint8_t *wire, size_t max_size)
+{
+	if (cache == NULL || key == NULL || wire == NULL) {
+		return 0;
+	}
+
+	uint32_t hash = key_hash(cache, key);
+	answer_slot_t *slot = &cache->slots[hash % cache->size];
+	size_t qname_size = knot_dname_size(key->qname);
+
+#ifndef HAVE_ATOMIC
+	pthread_mutex_lock(&cache->lock);
+	size_t size = slot->size;
+	bool found = slot_match(slot, gen, hash, key, qname_size) && size <= max_size;
+	if (found) {
+		memcpy(wire, slot->wire, size);
+	}
+	pthread_mutex_unlock(&cache->lock);
+
+	return found ? size : 0;
+#else
+	uint32_t seq = __atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE);
+	if (seq & 1) {
+		return 0;
+	}
+
+	/* Copy to a temporary buffer as the slot may be rewritten meanwhile. */
+	uint8_t buf[ANSWER_CACHE_MAX_SIZE];
+	size_t size = slot->size;
+	if (!slot_match(slot, gen, hash, key, qname_size) ||
+	    size > max_size || size > sizeof(buf)) {
+		return 0;
+	}
+	memcpy(buf, slot->wire, size);
+
+	__atomic_thread_fence(__ATOMIC_ACQUIRE);
+	if (__atomic_load_n(&slot->seq, __ATOMIC_RELAXED) != seq) {
+		return 0;
+	}
+
+	memcpy(wire, buf, size);
+
+	return size;
+#endif
+}
+
+void answer_cache_put(answer_cache_t *cache, uint32_t gen,
+                      const answer_cache_key_t *key, const uint8_t *wire, size_t size)
+{
+	if (cache == NULL || key == NULL || wire == NULL ||
+	    size > ANSWER_CACHE_MAX_SIZE || size < KNOT_WIRE_HEADER_SIZE) {
+		return;
+	}
+
+	uint32_t hash = key_hash(cache, key);
+	answer_slot_t *slot = &cache->slots[hash % cache->size];
+
+#ifndef HAVE_ATOMIC
+	pthread_mutex_lock(&cache->lock);
+	/* Admit the key on the second consecutive miss. */
+	if (slot->candidate != hash) {
+		slot->candidate = hash;
+	} else {
+		slot_store(slot, gen, hash, key, wire, size);
+	}
+	pthread_mutex_unlock(&cache->lock);
+#else
+	/* Admit the key on the second consecutive miss. */
+	if (__atomic_load_n(&slot->candidate, __ATOMIC_RELAXED) != hash) {
+		__atomic_store_n(&slot->candidate, hash, __ATOMIC_RELAXED);
+		return;
+	}
+
+	/* Give up if another store is in progress. */
+	uint32_t seq = __atomic_load_n(&slot->seq, __ATOMIC_RELAXED);
+	if ((seq & 1) || !__atomic_compare_exchange_n(&slot->seq, &seq, seq + 1, false,
+	                                              __ATOMIC_ACQ_REL, __ATOMIC_RELAXED)) {
+		return;
+	}
+
+	slot_store(slot, gen, hash, key, wire, size);
+
+	__atomic_store_n(&slot->seq, seq + 2, __ATOMIC_RELEASE);
+#endif
+}
@@ -0,0 +1,110 @@
+/*  Copyright (C) 2020 CZ.NIC, z.s.p.o. <knot-dns@labs.nic.cz>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/*!
+ * \brief Cache of pre-rendered zone answers.
+ *
+ * The cache is a direct-mapped table of complete response messages. Each slot
+ * is protected by a sequence lock, so lookups never block and a concurrent
+ * store only causes a miss. A key is stored only if it missed twice in a row
+ * in its slot, which protects hot entries from one-off queries.
+ *
+ * The stored answers belong to a cache generation. Incrementing the generation
+ * (when the zone contents change) invalidates all of them at once.
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "libknot/dname.h"
+
+/*! \brief Maximum size of a cached answer. */
+#define ANSWER_CACHE_MAX_SIZE 1232
+
+/*! \brief Answer key flags. */
+enum {
+	ANSWER_CACHE_EDNS = 1 << 0, /*!< Query with EDNS. */
+	ANSWER_CACHE_DO   = 1 << 1, /*!< Query with DO bit. */
+};
+
+/*! \brief Answer key (query properties the answer depends on). */
+typedef struct {
+	const knot_dname_t *qname; /*!< Lower-case QNAME. */
+	uint16_t qtype;            /*!< QTYPE. */
+	uint16_t qclass;           /*!< QCLASS. */
+	uint16_t max_size;         /*!< Maximum answer size. */
+	uint8_t flags;             /*!< Answer key flags. */
+} answer_cache_key_t;
+
+typedef struct answer_cache answer_cache_t;
+
+/*!
+ * \brief Creates a new answer cache.
+ *
+ * \param size  Number of cached answers.
+ *
+ * \return Answer cache or NULL.
+ */
+answer_cache_t *answer_cache_new(size_t size);
+
+/*!
+ * \brief Frees the answer cache.
+ */
+void answer_cache_free(answer_cache_t *cache);
+
+/*!
+ * \brief Returns the current cache generation.
+ *
+ * \note The generation must be obtained before the zone contents are read.
+ */
+uint32_t answer_cache_gen(answer_cache_t *cache);
+
+/*!
+ * \brief Invalidates all cached answers.
+ */
+void answer_cache_invalidate(answer_cache_t *cache);
+
+/*!
+ * \brief Copies the cached answer for the key.
+ *
+ * The message ID, the RD and CD flags, and the QNAME case are the ones of
+ * the query which stored the answer, the caller is responsible for patching
+ * them.
+ *
+ * \param cache     Answer cache.
+ * \param gen       Cache generation.
+ * \param key       Answer key.
+ * \param wire      Output buffer.
+ * \param max_size  Output buffer size.
+ *
+ * \return Answer size, 0 if not found.
+ */
+size_t answer_cache_get(answer_cache_t *cache, uint32_t gen,
+                        const answer_cache_key_t *key, uint8_t *wire, size_t max_size);
+
+/*!
+ * \brief Stores the answer for the key (if admitted).
+ *
+ * \param cache  Answer cache.
+ * \param gen    Cache generation obtained before the answer was created.
+ * \param key    Answer key.
+ * \param wire   Answer.
+ * \param size   Answer size.
+ */
+void answer_cache_put(answer_cache_t *cache, uint32_t gen,
+                      const answer_cache_key_t *key, const uint8_t *wire, size_t size);
@@ -0,0 +1,197 @@
+/*  Copyright (C) 2020 CZ.NIC, z.s.p.o. <knot-dns@labs.nic.cz>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <assert.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "knot/zone/axfr-cache.h"
+#include "contrib/macros.h"
+#include "libknot/errcode.h"
+#include "libknot/wire.h"
+
+/*! \brief Message header in the cache (ANCOUNT and answer section size). */
+#define MSG_HDR_SIZE (2 * sizeof(uint16_t))
+
+struct axfr_cache {
+	uint8_t *data;    /*!< Stored messages (header and answer section). */
+	size_t size;      /*!< Size of the stored messages. */
+	size_t alloc;     /*!< Allocated size. */
+	size_t limit;     /*!< Maximum size. */
+	uint16_t max_msg; /*!< Largest answer section. */
+};
+
+/*! \brief Cache markers of the zone contents. */
+static axfr_cache_t cache_building;
+static axfr_cache_t cache_failed;
+
+#ifndef HAVE_ATOMIC
+/*! \brief Lock of the caches of the zone contents if no atomic operations. */
+static pthread_mutex_t contents_lock = PTHREAD_MUTEX_INITIALIZER;
+#endif
+
+axfr_cache_t *axfr_cache_new(size_t limit)
+{
+	axfr_cache_t *cache = calloc(1, sizeof(*cache));
+	if (cache == NULL) {
+		return NULL;
+	}
+
+	cache->limit = limit;
+
+	return cache;
+}
+
+void axfr_cache_free(axfr_cache_t *cache)
+{
+	if (cache == NULL || cache == &cache_building || cache == &cache_failed) {
+		return;
+	}
+
+	free(cache->data);
+	free(cache);
+}
+
+int axfr_cache_add(axfr_cache_t *cache, const uint8_t *data, uint16_t size,
+                   uint16_t ancount)
+{
+	if (cache == NULL || data == NULL) {
+		return KNOT_EINVAL;
+	}
+
+	size_t needed = cache->size + MSG_HDR_SIZE + size;
+	if (needed > cache->limit) {
+		return KNOT_ESPACE;
+	}
+
+	if (needed > cache->alloc) {
+		size_t alloc = MAX(2 * cache->alloc, needed);
+		alloc = MIN(alloc, cache->limit);
+		uint8_t *new_data = realloc(cache->data, alloc);
+		if (new_data == NULL) {
+			return KNOT_ENOMEM;
+		}
+		cache->data = new_data;
+		cache->alloc = alloc;
+	}
+
+	uint8_t *pos = cache->data + cache->size;
+	knot_wire_write_u16(pos, ancount);
+	knot_wire_write_u16(pos + sizeof(uint16_t), size);
+	memcpy(pos + MSG_HDR_SIZE, data, size);
+	cache->size = needed;
+	cache->max_msg = MAX(cache->max_msg, size);
+
+	return KNOT_EOK;
+}
+
+uint16_t axfr_cache_max_msg(const axfr_cache_t *cache)
+{
+	return (cache != NULL) ? cache->max_msg : 0;
+}
+
+size_t axfr_cache_size(const axfr_cache_t *cache)
+{
+	return (cache != NULL) ? cache->size : 0;
+}
+
+bool axfr_cache_next(const axfr_cache_t *cache, size_t *pos, const uint8_t **data,
+                     uint16_t *size, uint16_t *ancount)
+{
+	assert(cache && pos && data && size && ancount);
+	assert(*pos + MSG_HDR_SIZE <= cache->size);
+
+	const uint8_t *msg = cache->data + *pos;
+	*ancount = knot_wire_read_u16(msg);
+	*size = knot_wire_read_u16(msg + sizeof(uint16_t));
+	*data = msg + MSG_HDR_SIZE;
+	*pos += MSG_HDR_SIZE + *size;
+
+	return *pos < cache->size;
+}
+
+static axfr_cache_t **contents_cache(const zone_contents_t *contents)
+{
+	/* The cache is the only part of the contents modified after publishing. */
+	return &((zone_contents_t *)contents)->axfr_cache;
+}
+
+const axfr_cache_t *axfr_cache_get(const zone_contents_t *contents)
+{
+	if (contents == NULL) {
+		return NULL;
+	}
+
+#ifdef HAVE_ATOMIC
+	axfr_cache_t *cache = __atomic_load_n(contents_cache(contents), __ATOMIC_ACQUIRE);
+#else
+	pthread_mutex_lock(&contents_lock);
+	axfr_cache_t *cache = *contents_cache(contents);
+	pthread_mutex_unlock(&contents_lock);
+#endif
+	if (cache == &cache_building || cache == &cache_failed) {
+		return NULL;
+	}
+
+	return cache;
+}
+
+bool axfr_cache_claim(const zone_contents_t *contents)
+{
+	if (contents == NULL) {
+		return false;
+	}
+
+#ifdef HAVE_ATOMIC
+	axfr_cache_t *expected = NULL;
+	return __atomic_compare_exchange_n(contents_cache(contents), &expected,
+	                                   &cache_building, false,
+	                                   __ATOMIC_ACQ_REL, __ATOMIC_RELAXED);
+#else
+	pthread_mutex_lock(&contents_lock);
+	bool claimed = (*contents_cache(contents) == NULL);
+	if (claimed) {
+		*contents_cache(contents) = &cache_building;
+	}
+	pthread_mutex_unlock(&contents_lock);
+	return claimed;
+#endif
+}
+
+static void cache_set(const zone_contents_t *contents, axfr_cache_t *cache)
+{
+	assert(contents);
+	assert(*contents_cache(contents) == &cache_building);
+
+#ifdef HAVE_ATOMIC
+	__atomic_store_n(contents_cache(contents), cache, __ATOMIC_RELEASE);
+#else
+	pthread_mutex_lock(&contents_lock);
+	*contents_cache(contents) = cache;
+	pthread_mutex_unlock(&contents_lock);
+#endif
+}
+
+void axfr_cache_publish(const zone_contents_t *contents, axfr_cache_t *cache)
+{
+	cache_set(contents, (cache != NULL) ? cache : &cache_failed);
+}
+
+void axfr_cache_release(const zone_contents_t *contents)
+{
+	cache_set(contents, NULL);
+}
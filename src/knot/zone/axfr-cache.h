@@ -0,0 +1,112 @@
+/*  Copyright (C) 2020 CZ.NIC, z.s.p.o. <knot-dns@labs.nic.cz>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/*!
+ * \brief Pre-rendered AXFR message stream.
+ *
+ * The cache contains the answer sections of all the AXFR messages for one
+ * zone contents. The messages are rendered once, after the question section
+ * of the zone name, so they can be reused for any AXFR query of the zone as
+ * the question always has the same length.
+ *
+ * The cache is attached to the zone contents and freed with them. It's built
+ * from the messages sent by the first transfer which claims it, the concurrent
+ * transfers meanwhile render the messages themselves. A building over the size
+ * limit isn't repeated for the same contents, the claim is released if the
+ * building failed otherwise or was interrupted.
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "knot/zone/contents.h"
+
+typedef struct axfr_cache axfr_cache_t;
+
+/*!
+ * \brief Creates an empty cache.
+ *
+ * \param limit  Maximum size of the stored messages.
+ */
+axfr_cache_t *axfr_cache_new(size_t limit);
+
+/*!
+ * \brief Frees the cache.
+ */
+void axfr_cache_free(axfr_cache_t *cache);
+
+/*!
+ * \brief Appends a message.
+ *
+ * \param cache    Cache.
+ * \param data     Answer section of the message.
+ * \param size     Size of the answer section.
+ * \param ancount  Number of records in the answer section.
+ *
+ * \retval KNOT_ESPACE if the cache size limit would be exceeded.
+ * \return KNOT_E*
+ */
+int axfr_cache_add(axfr_cache_t *cache, const uint8_t *data, uint16_t size,
+                   uint16_t ancount);
+
+/*!
+ * \brief Returns the size of the largest stored answer section.
+ */
+uint16_t axfr_cache_max_msg(const axfr_cache_t *cache);
+
+/*!
+ * \brief Returns the total size of the stored messages.
+ */
+size_t axfr_cache_size(const axfr_cache_t *cache);
+
+/*!
+ * \brief Reads the next message.
+ *
+ * \param cache    Cache.
+ * \param pos      Reading position (0 for the first message), updated.
+ * \param data     Output answer section.
+ * \param size     Output size of the answer section.
+ * \param ancount  Output number of records in the answer section.
+ *
+ * \return True if there are more messages after this one.
+ */
+bool axfr_cache_next(const axfr_cache_t *cache, size_t *pos, const uint8_t **data,
+                     uint16_t *size, uint16_t *ancount);
+
+/*!
+ * \brief Returns the cache of the zone contents if it's ready.
+ */
+const axfr_cache_t *axfr_cache_get(const zone_contents_t *contents);
+
+/*!
+ * \brief Claims building of the cache for the zone contents.
+ *
+ * \return True if the caller is supposed to build and publish the cache.
+ */
+bool axfr_cache_claim(const zone_contents_t *contents);
+
+/*!
+ * \brief Publishes the built cache (NULL if it's not to be built again).
+ */
+void axfr_cache_publish(const zone_contents_t *contents, axfr_cache_t *cache);
+
+/*!
+ * \brief Releases the claim of the cache, so it can be built later.
+ */
+void axfr_cache_release(const zone_contents_t *contents);
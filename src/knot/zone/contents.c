@@ -19,6 +19,7 @@
 #include "libdnssec/error.h"
 #include "knot/zone/adds_tree.h"
 #include "knot/zone/adjust.h"
+#include "knot/zone/axfr-cache.h"
 #include "knot/zone/contents.h"
 #include "knot/common/log.h"
 #include "knot/dnssec/zone-nsec.h"
@@ -517,6 +518,7 @@ void zone_contents_free(zone_contents_t *contents)
 
 	dnssec_nsec3_params_free(&contents->nsec3_params);
 	additionals_tree_free(contents->adds_tree);
+	axfr_cache_free(contents->axfr_cache);
 
 	free(contents);
 }
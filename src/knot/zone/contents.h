@@ -38,6 +38,9 @@ typedef struct zone_contents {
 	size_t size;
 	uint32_t max_ttl;
 	bool dnssec;
+
+	struct axfr_cache *axfr_cache; /*!< Pre-rendered AXFR, see axfr-cache.h */
+	uint64_t gen;            /*!< Unique generation assigned when published. */
 } zone_contents_t;
 
 /*!
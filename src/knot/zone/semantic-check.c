@@ -14,6 +14,7 @@
     along with this program.  If not, see <https://www.gnu.org/licenses/>.
  */
 
+#include <pthread.h>
 #include <stdio.h>
 #include <sys/types.h>
 #include <sys/socket.h>
@@ -22,6 +23,7 @@
 
 #include "libdnssec/error.h"
 #include "contrib/base32hex.h"
+#include "contrib/macros.h"
 #include "contrib/string.h"
 #include "libknot/libknot.h"
 #include "knot/zone/semantic-check.h"
@@ -153,10 +155,30 @@ typedef struct {
 	zone_contents_t *zone;
 	sem_handler_t *handler;
 	const zone_node_t *next_nsec;
+	bool next_nsec_unknown; /*!< Previous NSEC link is in another tree part. */
 	check_level_t level;
 	time_t time;
 } semchecks_data_t;
 
+/*! \brief Semantic error reported in a tree part. */
+typedef struct {
+	const zone_node_t *node;
+	sem_error_t code;
+	bool error;       /*!< Handler error flag set by the check. */
+	bool chain_check; /*!< NSEC chain link from the previous part to be checked. */
+	char *data;
+} sem_record_t;
+
+/*! \brief Checks of a tree part, the errors are reported after all parts are done. */
+typedef struct {
+	sem_handler_t handler; /*!< Recording handler (must be the first member). */
+	semchecks_data_t data;
+	sem_record_t *records;
+	size_t count;
+	size_t max;
+	int ret;
+} sem_part_t;
+
 static int check_cname(const zone_node_t *node, semchecks_data_t *data);
 static int check_dname(const zone_node_t *node, semchecks_data_t *data);
 static int check_delegation(const zone_node_t *node, semchecks_data_t *data);
@@ -194,6 +216,36 @@ static const struct check_function CHECK_FUNCTIONS[] = {
 static const int CHECK_FUNCTIONS_LEN = sizeof(CHECK_FUNCTIONS)
                                      / sizeof(struct check_function);
 
+static void part_record(sem_part_t *part, const zone_node_t *node, sem_error_t code,
+                        const char *data, bool chain_check)
+{
+	if (part->count == part->max) {
+		size_t max = (part->max > 0) ? 2 * part->max : 16;
+		sem_record_t *records = realloc(part->records, max * sizeof(*records));
+		if (records == NULL) {
+			part->ret = KNOT_ENOMEM;
+			return;
+		}
+		part->records = records;
+		part->max = max;
+	}
+
+	sem_record_t *rec = &part->records[part->count++];
+	rec->node = node;
+	rec->code = code;
+	rec->error = part->handler.error;
+	rec->chain_check = chain_check;
+	rec->data = (data != NULL) ? strdup(data) : NULL;
+
+	part->handler.error = false;
+}
+
+static void part_record_cb(sem_handler_t *handler, const zone_contents_t *zone,
+                           const zone_node_t *node, sem_error_t error, const char *data)
+{
+	part_record((sem_part_t *)handler, node, error, data, false);
+}
+
 static int check_signature(const knot_rdata_t *rrsig, const dnssec_key_t *key,
                            const knot_rrset_t *covered)
 {
@@ -812,7 +864,12 @@ static int check_nsec(const zone_node_t *node, semchecks_data_t *data)
 		                  SEM_ERR_NSEC_RDATA_MULTIPLE, NULL);
 	}
 
-	if (data->next_nsec != node) {
+	if (data->next_nsec_unknown) {
+		/* The link is checked when the results of the parts are merged. */
+		sem_part_t *part = (sem_part_t *)data->handler;
+		part->data.next_nsec_unknown = false;
+		part_record(part, node, SEM_ERR_NSEC_RDATA_CHAIN, NULL, true);
+	} else if (data->next_nsec != node) {
 		data->handler->cb(data->handler, data->zone, node,
 		                  SEM_ERR_NSEC_RDATA_CHAIN, NULL);
 	}
@@ -1150,6 +1207,143 @@ static int do_checks_in_tree(zone_node_t *node, void *data)
 	return ret;
 }
 
+typedef struct {
+	zone_tree_t *tree;
+	trie_parts_t *tree_parts;
+	sem_part_t *parts;
+	size_t next; /*!< Next unclaimed part. */
+#ifndef HAVE_ATOMIC
+	pthread_mutex_t lock;
+#endif
+} sem_parallel_t;
+
+static size_t claim_part(sem_parallel_t *par)
+{
+#ifdef HAVE_ATOMIC
+	return __atomic_fetch_add(&par->next, 1, __ATOMIC_RELAXED);
+#else
+	pthread_mutex_lock(&par->lock);
+	size_t i = par->next++;
+	pthread_mutex_unlock(&par->lock);
+	return i;
+#endif
+}
+
+static void *check_parts_thread(void *arg)
+{
+	sem_parallel_t *par = arg;
+	size_t count = trie_parts_count(par->tree_parts);
+
+	size_t i;
+	while ((i = claim_part(par)) < count) {
+		sem_part_t *part = &par->parts[i];
+		int ret = zone_tree_parts_apply_part(par->tree, par->tree_parts, i,
+		                                     do_checks_in_tree, &part->data);
+		if (part->ret == KNOT_EOK) {
+			part->ret = ret;
+		}
+	}
+
+	return NULL;
+}
+
+/*!
+ * \brief Reports the errors of the parts in the tree order.
+ *
+ * The result is the same as if the checks were run over the whole tree.
+ */
+static int merge_parts(semchecks_data_t *data, sem_part_t *parts, size_t count)
+{
+	sem_handler_t *handler = data->handler;
+	int ret = KNOT_EOK;
+
+	for (size_t i = 0; i < count; i++) {
+		sem_part_t *part = &parts[i];
+		for (size_t j = 0; j < part->count; j++) {
+			sem_record_t *rec = &part->records[j];
+			if (ret != KNOT_EOK) {
+				// Skip.
+			} else if (rec->chain_check) {
+				if (data->next_nsec != rec->node) {
+					handler->cb(handler, data->zone, rec->node,
+					            SEM_ERR_NSEC_RDATA_CHAIN, NULL);
+				}
+			} else {
+				if (rec->error) {
+					handler->error = true;
+				}
+				handler->cb(handler, data->zone, rec->node, rec->code, rec->data);
+			}
+			free(rec->data);
+		}
+		free(part->records);
+
+		if (ret == KNOT_EOK) {
+			if (!part->data.next_nsec_unknown) {
+				data->next_nsec = part->data.next_nsec;
+			}
+			ret = part->ret;
+		}
+	}
+
+	return ret;
+}
+
+static int check_parallel(semchecks_data_t *data, unsigned threads)
+{
+	zone_tree_t *tree = data->zone->nodes;
+	trie_parts_t *tree_parts = zone_tree_parts_new(tree, threads);
+	if (tree_parts == NULL) {
+		return KNOT_ENOMEM;
+	}
+
+	size_t count = trie_parts_count(tree_parts);
+	sem_part_t *parts = calloc(MAX(count, 1), sizeof(*parts));
+	if (parts == NULL) {
+		trie_parts_free(tree_parts);
+		return KNOT_ENOMEM;
+	}
+
+	for (size_t i = 0; i < count; i++) {
+		parts[i].handler.cb = part_record_cb;
+		parts[i].data = *data;
+		parts[i].data.handler = &parts[i].handler;
+		parts[i].data.next_nsec_unknown = true;
+	}
+
+	sem_parallel_t par = {
+		.tree = tree,
+		.tree_parts = tree_parts,
+		.parts = parts,
+	};
+#ifndef HAVE_ATOMIC
+	pthread_mutex_init(&par.lock, NULL);
+#endif
+
+	/* This thread is one of the workers. */
+	pthread_t thread[threads - 1];
+	unsigned created = 0;
+	while (created < threads - 1 &&
+	       pthread_create(&thread[created], NULL, check_parts_thread, &par) == 0) {
+		created++;
+	}
+	(void)check_parts_thread(&par);
+	for (unsigned i = 0; i < created; i++) {
+		pthread_join(thread[i], NULL);
+	}
+
+#ifndef HAVE_ATOMIC
+	pthread_mutex_destroy(&par.lock);
+#endif
+
+	int ret = merge_parts(data, parts, count);
+
+	free(parts);
+	trie_parts_free(tree_parts);
+
+	return ret;
+}
+
 static void check_nsec3param(knot_rdataset_t *nsec3param, zone_contents_t *zone,
                              sem_handler_t *handler, semchecks_data_t *data)
 {
@@ -1203,7 +1397,7 @@ static void check_dnskey(zone_contents_t *zone, sem_handler_t *handler)
 }
 
 int sem_checks_process(zone_contents_t *zone, semcheck_optional_t optional, sem_handler_t *handler,
-                       time_t time)
+                       time_t time, unsigned threads)
 {
 	if (zone == NULL || handler == NULL) {
 		return KNOT_EINVAL;
@@ -1233,7 +1427,12 @@ int sem_checks_process(zone_contents_t *zone, semcheck_optional_t optional, sem_
 		}
 	}
 
-	int ret = zone_contents_apply(zone, do_checks_in_tree, &data);
+	int ret;
+	if (threads > 1) {
+		ret = check_parallel(&data, threads);
+	} else {
+		ret = zone_contents_apply(zone, do_checks_in_tree, &data);
+	}
 	if (ret != KNOT_EOK) {
 		return ret;
 	}
@@ -119,16 +119,18 @@ struct sem_handler {
 /*!
  * \brief Check zone for semantic errors.
  *
- * Errors are logged in error handler.
+ * Errors are logged in error handler. With more threads, the errors are
+ * reported after all the nodes are checked, in the same order as with one thread.
  *
  * \param zone      Zone to be searched / checked.
  * \param optional  To do also optional check.
  * \param handler   Semantic error handler.
  * \param time      Check zone at given time (rrsig expiration).
+ * \param threads   Number of threads checking the nodes.
  *
  * \retval KNOT_EOK no error found
  * \retval KNOT_ESEMCHECK found semantic error
  * \retval KNOT_EINVAL or other error
  */
 int sem_checks_process(zone_contents_t *zone, semcheck_optional_t optional, sem_handler_t *handler,
-                       time_t time);
+                       time_t time, unsigned threads);
@@ -0,0 +1,378 @@
+/*  Copyright (C) 2020 CZ.NIC, z.s.p.o. <knot-dns@labs.nic.cz>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <assert.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "knot/zone/adjust.h"
+#include "knot/zone/snapshot.h"
+#include "contrib/files.h"
+#include "contrib/string.h"
+#include "contrib/wire_ctx.h"
+#include "libknot/libknot.h"
+
+/*
+ * Snapshot layout (integers in network byte order):
+ *
+ *   header: magic[8] version(16) byte_order(16) mtime_sec(64) mtime_nsec(32)
+ *           file_size(64) file_inode(64) rrset_count(64) zone_name padding
+ *   rrset:  type(16) rr_count(16) ttl(32) rdata_size(32) rdata owner padding
+ *
+ * The RDATA array is stored in the native knot_rdata_t layout, the byte order
+ * field is the native representation of 0x0102. Everything is 4-byte aligned.
+ */
+
+#define SNAPSHOT_SUFFIX		".snap"
+#define SNAPSHOT_MAGIC		"KNOTZSNP"
+#define SNAPSHOT_VERSION	2
+#define SNAPSHOT_BYTE_ORDER	0x0102
+#define SNAPSHOT_HDR_SIZE	(8 + 2 + 2 + 8 + 4 + 8 + 8 + 8)
+#define SNAPSHOT_RR_HDR_SIZE	(2 + 2 + 4 + 4)
+
+#define PAD4(size)		((4 - ((size) & 3)) & 3)
+
+typedef struct {
+	FILE *file;
+	uint64_t count;
+	int ret;
+} snapshot_writer_t;
+
+static int write_data(snapshot_writer_t *w, const void *data, size_t size)
+{
+	static const uint8_t zeros[4] = { 0 };
+	if (data == NULL) {
+		data = zeros;
+	}
+
+	if (size > 0 && fwrite(data, size, 1, w->file) != 1) {
+		return KNOT_EFILE;
+	}
+
+	return KNOT_EOK;
+}
+
+static int write_rrset(snapshot_writer_t *w, const knot_rrset_t *rr)
+{
+	uint8_t hdr[SNAPSHOT_RR_HDR_SIZE];
+	wire_ctx_t ctx = wire_ctx_init(hdr, sizeof(hdr));
+	wire_ctx_write_u16(&ctx, rr->type);
+	wire_ctx_write_u16(&ctx, rr->rrs.count);
+	wire_ctx_write_u32(&ctx, rr->ttl);
+	wire_ctx_write_u32(&ctx, rr->rrs.size);
+	assert(ctx.error == KNOT_EOK);
+
+	size_t owner_size = knot_dname_size(rr->owner);
+	int ret = write_data(w, hdr, sizeof(hdr));
+	if (ret == KNOT_EOK) {
+		ret = write_data(w, rr->rrs.rdata, rr->rrs.size);
+	}
+	if (ret == KNOT_EOK) {
+		ret = write_data(w, rr->owner, owner_size);
+	}
+	if (ret == KNOT_EOK) {
+		ret = write_data(w, NULL, PAD4(rr->rrs.size + owner_size));
+	}
+
+	w->count++;
+
+	return ret;
+}
+
+static int write_node(zone_node_t *node, void *data)
+{
+	snapshot_writer_t *w = data;
+
+	for (uint16_t i = 0; i < node->rrset_count; i++) {
+		knot_rrset_t rr = node_rrset_at(node, i);
+		w->ret = write_rrset(w, &rr);
+		if (w->ret != KNOT_EOK) {
+			return w->ret;
+		}
+	}
+
+	return KNOT_EOK;
+}
+
+static int write_header(snapshot_writer_t *w, const knot_dname_t *zone,
+                        const struct stat *st)
+{
+	uint8_t hdr[SNAPSHOT_HDR_SIZE];
+	uint16_t byte_order = SNAPSHOT_BYTE_ORDER;
+
+	wire_ctx_t ctx = wire_ctx_init(hdr, sizeof(hdr));
+	wire_ctx_write(&ctx, SNAPSHOT_MAGIC, 8);
+	wire_ctx_write_u16(&ctx, SNAPSHOT_VERSION);
+	wire_ctx_write(&ctx, &byte_order, sizeof(byte_order));
+	wire_ctx_write_u64(&ctx, st->st_mtim.tv_sec);
+	wire_ctx_write_u32(&ctx, st->st_mtim.tv_nsec);
+	wire_ctx_write_u64(&ctx, st->st_size);
+	wire_ctx_write_u64(&ctx, st->st_ino);
+	wire_ctx_write_u64(&ctx, w->count);
+	assert(ctx.error == KNOT_EOK);
+
+	size_t zone_size = knot_dname_size(zone);
+	int ret = write_data(w, hdr, sizeof(hdr));
+	if (ret == KNOT_EOK) {
+		ret = write_data(w, zone, zone_size);
+	}
+	if (ret == KNOT_EOK) {
+		ret = write_data(w, NULL, PAD4(zone_size));
+	}
+
+	return ret;
+}
+
+char *zone_snapshot_path(const char *zonefile)
+{
+	if (zonefile == NULL) {
+		return NULL;
+	}
+
+	return sprintf_alloc("%s" SNAPSHOT_SUFFIX, zonefile);
+}
+
+int zone_snapshot_write(const char *path, zone_contents_t *contents,
+                        const struct stat *st)
+{
+	if (path == NULL || contents == NULL || st == NULL) {
+		return KNOT_EINVAL;
+	}
+
+	snapshot_writer_t w = { 0 };
+	char *tmp_name = NULL;
+	int ret = open_tmp_file(path, &tmp_name, &w.file, S_IRUSR|S_IWUSR|S_IRGRP|S_IWGRP);
+	if (ret != KNOT_EOK) {
+		return ret;
+	}
+
+	/* The header is rewritten with the final RRSet count at the end. */
+	ret = write_header(&w, contents->apex->owner, st);
+	if (ret == KNOT_EOK) {
+		ret = zone_contents_apply(contents, write_node, &w);
+	}
+	if (ret == KNOT_EOK) {
+		ret = zone_contents_nsec3_apply(contents, write_node, &w);
+	}
+	if (ret == KNOT_EOK && w.ret != KNOT_EOK) {
+		ret = w.ret;
+	}
+	if (ret == KNOT_EOK) {
+		ret = (fseek(w.file, 0, SEEK_SET) == 0) ?
+		      write_header(&w, contents->apex->owner, st) : KNOT_EFILE;
+	}
+	if (fclose(w.file) != 0 && ret == KNOT_EOK) {
+		ret = KNOT_EFILE;
+	}
+
+	if (ret == KNOT_EOK && rename(tmp_name, path) != 0) {
+		ret = knot_map_errno();
+	}
+	if (ret != KNOT_EOK) {
+		unlink(tmp_name);
+	}
+	free(tmp_name);
+
+	return ret;
+}
+
+static int read_header(wire_ctx_t *ctx, const knot_dname_t *zone,
+                       const struct stat *st, uint64_t *count)
+{
+	uint8_t magic[8];
+	uint16_t byte_order = 0;
+	wire_ctx_read(ctx, magic, sizeof(magic));
+	uint16_t version = wire_ctx_read_u16(ctx);
+	wire_ctx_read(ctx, &byte_order, sizeof(byte_order));
+	uint64_t sec = wire_ctx_read_u64(ctx);
+	uint32_t nsec = wire_ctx_read_u32(ctx);
+	uint64_t size = wire_ctx_read_u64(ctx);
+	uint64_t inode = wire_ctx_read_u64(ctx);
+	*count = wire_ctx_read_u64(ctx);
+	if (ctx->error != KNOT_EOK || memcmp(magic, SNAPSHOT_MAGIC, sizeof(magic)) != 0) {
+		return KNOT_EMALF;
+	}
+
+	if (version != SNAPSHOT_VERSION || byte_order != SNAPSHOT_BYTE_ORDER) {
+		return KNOT_ENOTSUP;
+	}
+
+	if (sec != (uint64_t)st->st_mtim.tv_sec || nsec != (uint32_t)st->st_mtim.tv_nsec ||
+	    size != (uint64_t)st->st_size || inode != (uint64_t)st->st_ino) {
+		return KNOT_ENOENT;
+	}
+
+	size_t zone_size = knot_dname_size(zone);
+	if (wire_ctx_available(ctx) < zone_size ||
+	    !knot_dname_is_equal(ctx->position, zone)) {
+		return KNOT_EMALF;
+	}
+	wire_ctx_skip(ctx, zone_size + PAD4(zone_size));
+
+	return ctx->error;
+}
+
+static bool rdataset_valid(const knot_rdataset_t *rrs)
+{
+	const uint8_t *pos = (const uint8_t *)rrs->rdata;
+	const uint8_t *end = pos + rrs->size;
+
+	for (uint16_t i = 0; i < rrs->count; i++) {
+		if (end - pos < sizeof(uint16_t)) {
+			return false;
+		}
+		size_t size = knot_rdata_size(((const knot_rdata_t *)pos)->len);
+		if (end - pos < size) {
+			return false;
+		}
+		pos += size;
+	}
+
+	return rrs->count > 0 && pos == end;
+}
+
+static int read_rrset(wire_ctx_t *ctx, knot_rrset_t *rr)
+{
+	knot_rrset_init_empty(rr);
+	rr->type = wire_ctx_read_u16(ctx);
+	rr->rrs.count = wire_ctx_read_u16(ctx);
+	rr->ttl = wire_ctx_read_u32(ctx);
+	rr->rrs.size = wire_ctx_read_u32(ctx);
+	rr->rclass = KNOT_CLASS_IN;
+	if (ctx->error != KNOT_EOK || wire_ctx_available(ctx) < rr->rrs.size) {
+		return KNOT_EMALF;
+	}
+
+	rr->rrs.rdata = (knot_rdata_t *)ctx->position;
+	if (!rdataset_valid(&rr->rrs)) {
+		return KNOT_EMALF;
+	}
+	wire_ctx_skip(ctx, rr->rrs.size);
+
+	int owner_size = knot_dname_wire_check(ctx->position, ctx->wire + ctx->size, NULL);
+	if (owner_size <= 0) {
+		return KNOT_EMALF;
+	}
+	rr->owner = (knot_dname_t *)ctx->position;
+	wire_ctx_skip(ctx, owner_size + PAD4(rr->rrs.size + owner_size));
+
+	return ctx->error;
+}
+
+static int load_rrsets(wire_ctx_t *ctx, uint64_t count, zone_contents_t *contents)
+{
+	zone_node_t *node = NULL;
+	const knot_dname_t *owner = NULL;
+
+	for (uint64_t i = 0; i < count; i++) {
+		knot_rrset_t rr;
+		int ret = read_rrset(ctx, &rr);
+		if (ret != KNOT_EOK) {
+			return ret;
+		}
+
+		/* RRSets of a node are stored together, reuse the node. */
+		if (owner == NULL || !knot_dname_is_equal(owner, rr.owner)) {
+			node = NULL;
+			owner = rr.owner;
+		}
+
+		ret = zone_contents_add_rr(contents, &rr, &node);
+		if (ret != KNOT_EOK) {
+			return (ret == KNOT_ENOMEM) ? ret : KNOT_EMALF;
+		}
+	}
+
+	if (wire_ctx_available(ctx) != 0) {
+		return KNOT_EMALF;
+	}
+
+	return KNOT_EOK;
+}
+
+int zone_snapshot_load(const char *path, const knot_dname_t *zone,
+                       const struct stat *st, zone_contents_t **contents)
+{
+	if (path == NULL || zone == NULL || st == NULL || contents == NULL) {
+		return KNOT_EINVAL;
+	}
+
+	int fd = open(path, O_RDONLY);
+	if (fd < 0) {
+		return (errno == ENOENT) ? KNOT_ENOENT : knot_map_errno();
+	}
+
+	struct stat snap_st;
+	if (fstat(fd, &snap_st) != 0) {
+		int ret = knot_map_errno();
+		close(fd);
+		return ret;
+	}
+	if (snap_st.st_size < SNAPSHOT_HDR_SIZE) {
+		close(fd);
+		return KNOT_EMALF;
+	}
+
+	void *map = mmap(NULL, snap_st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (map == MAP_FAILED) {
+		return knot_map_errno();
+	}
+	(void)madvise(map, snap_st.st_size, MADV_SEQUENTIAL);
+
+	wire_ctx_t ctx = wire_ctx_init_const(map, snap_st.st_size);
+	uint64_t count = 0;
+	int ret = read_header(&ctx, zone, st, &count);
+	if (ret != KNOT_EOK) {
+		munmap(map, snap_st.st_size);
+		return ret;
+	}
+
+	zone_contents_t *loaded = zone_contents_new(zone, true);
+	if (loaded == NULL) {
+		munmap(map, snap_st.st_size);
+		return KNOT_ENOMEM;
+	}
+
+	ret = load_rrsets(&ctx, count, loaded);
+	munmap(map, snap_st.st_size);
+	if (ret == KNOT_EOK && !node_rrtype_exists(loaded->apex, KNOT_RRTYPE_SOA)) {
+		ret = KNOT_EMALF;
+	}
+	/* Same adjusting as in zonefile_load(), semantic checks aside. */
+	if (ret == KNOT_EOK) {
+		ret = zone_adjust_contents(loaded, adjust_cb_flags_and_nsec3,
+		                           adjust_cb_nsec3_flags, true, true, 1, NULL);
+	}
+	if (ret == KNOT_EOK) {
+		ret = zone_adjust_contents(loaded, unadjust_cb_point_to_nsec3, NULL,
+		                           false, false, 1, NULL);
+	}
+	if (ret != KNOT_EOK) {
+		zone_contents_deep_free(loaded);
+		return ret;
+	}
+
+	*contents = loaded;
+
+	return KNOT_EOK;
+}
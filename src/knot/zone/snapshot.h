@@ -0,0 +1,66 @@
+/*  Copyright (C) 2020 CZ.NIC, z.s.p.o. <knot-dns@labs.nic.cz>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/*!
+ * \brief Binary zone snapshot.
+ *
+ * The snapshot contains the zone records in canonical order, grouped into
+ * RRSets with the RDATA already in the in-memory format, so loading it
+ * involves neither text parsing nor RDATA sorting. The snapshot is bound to
+ * the modification time, size, and inode of the zone file it was created
+ * with and is ignored once the zone file changes.
+ */
+
+#pragma once
+
+#include <sys/stat.h>
+
+#include "knot/zone/contents.h"
+
+/*!
+ * \brief Returns the snapshot file name for the zone file (to be freed).
+ */
+char *zone_snapshot_path(const char *zonefile);
+
+/*!
+ * \brief Writes the zone contents snapshot.
+ *
+ * \param path      Snapshot file name.
+ * \param contents  Zone contents.
+ * \param st        Attributes of the corresponding zone file.
+ *
+ * \return KNOT_E*
+ */
+int zone_snapshot_write(const char *path, zone_contents_t *contents,
+                        const struct stat *st);
+
+/*!
+ * \brief Loads the zone contents from the snapshot.
+ *
+ * The contents are adjusted the same way as after zone file parsing.
+ *
+ * \param path      Snapshot file name.
+ * \param zone      Zone name.
+ * \param st        Attributes of the current zone file.
+ * \param contents  Output zone contents.
+ *
+ * \retval KNOT_ENOENT   if there is no snapshot or it's outdated.
+ * \retval KNOT_ENOTSUP  if the snapshot format is not supported.
+ * \retval KNOT_EMALF    if the snapshot is malformed.
+ * \return KNOT_E*
+ */
+int zone_snapshot_load(const char *path, const knot_dname_t *zone,
+                       const struct stat *st, zone_contents_t **contents);
@@ -14,31 +14,58 @@
     along with this program.  If not, see <https://www.gnu.org/licenses/>.
  */
 
+#include <sys/stat.h>
+
 #include "knot/common/log.h"
 #include "knot/journal/journal_metadata.h"
 #include "knot/journal/journal_read.h"
 #include "knot/zone/zone-diff.h"
 #include "knot/zone/zone-load.h"
+#include "knot/zone/snapshot.h"
 #include "knot/zone/zonefile.h"
 #include "knot/dnssec/key-events.h"
 #include "knot/dnssec/zone-events.h"
 #include "libknot/libknot.h"
 
 int zone_load_contents(conf_t *conf, const knot_dname_t *zone_name,
-                       zone_contents_t **contents, bool fail_on_warning)
+                       zone_contents_t **contents, bool fail_on_warning,
+                       bool use_snapshot)
 {
 	if (conf == NULL || zone_name == NULL || contents == NULL) {
 		return KNOT_EINVAL;
 	}
 
 	char *zonefile = conf_zonefile(conf, zone_name);
+
 	conf_val_t val = conf_zone_get(conf, C_SEM_CHECKS, zone_name);
+	bool semchecks = conf_bool(&val);
+
+	/* Try the zone snapshot matching the current zone file. The snapshot
+	 * skips the semantic checks, which aren't only content dependent. */
+	struct stat st;
+	val = conf_zone_get(conf, C_ZONEFILE_SNAP, zone_name);
+	char *snapshot = NULL;
+	if (use_snapshot && conf_bool(&val) && !semchecks && !fail_on_warning &&
+	    stat(zonefile, &st) == 0) {
+		snapshot = zone_snapshot_path(zonefile);
+		int ret = zone_snapshot_load(snapshot, zone_name, &st, contents);
+		if (ret == KNOT_EOK) {
+			log_zone_info(zone_name, "zone snapshot loaded");
+			free(snapshot);
+			free(zonefile);
+			return KNOT_EOK;
+		} else if (ret != KNOT_ENOENT && ret != KNOT_ENOTSUP) {
+			log_zone_warning(zone_name, "failed to load zone snapshot (%s)",
+			                 knot_strerror(ret));
+		}
+	}
 
 	zloader_t zl;
 	int ret = zonefile_open(&zl, zonefile, zone_name,
-				conf_bool(&val) ? SEMCHECK_AUTO_DNSSEC : SEMCHECK_MANDATORY_ONLY, time(NULL));
+				semchecks ? SEMCHECK_AUTO_DNSSEC : SEMCHECK_MANDATORY_ONLY, time(NULL));
 	free(zonefile);
 	if (ret != KNOT_EOK) {
+		free(snapshot);
 		return ret;
 	}
 
@@ -49,15 +76,32 @@ int zone_load_contents(conf_t *conf, const knot_dname_t *zone_name,
 	zl.err_handler = &handler;
 	zl.creator->master = !zone_load_can_bootstrap(conf, zone_name);
 
+	val = conf_zone_get(conf, C_ZONEFILE_THR, zone_name);
+	zl.threads = conf_int(&val);
+	val = conf_zone_get(conf, C_ADJUST_THR, zone_name);
+	zl.adjust_threads = conf_int(&val);
+
 	*contents = zonefile_load(&zl);
 	zonefile_close(&zl);
 	if (*contents == NULL) {
+		free(snapshot);
 		return KNOT_ERROR;
 	}
 	if (handler.warning && fail_on_warning) {
+		free(snapshot);
 		return KNOT_ESEMCHECK;
 	}
 
+	/* Store the parsed zone file for the next load. */
+	if (snapshot != NULL) {
+		ret = zone_snapshot_write(snapshot, *contents, &st);
+		if (ret != KNOT_EOK) {
+			log_zone_warning(zone_name, "failed to update zone snapshot (%s)",
+			                 knot_strerror(ret));
+		}
+		free(snapshot);
+	}
+
 	return KNOT_EOK;
 }
 
@@ -27,13 +27,15 @@
  * \param zone_name
  * \param contents
  * \param fail_on_warning
+ * \param use_snapshot     Use and update the zone snapshot if configured.
  *
  * \retval KNOT_EOK        if success.
  * \retval KNOT_ESEMCHECK  if any semantic check warning.
  * \retval KNOT_E*         if error.
  */
 int zone_load_contents(conf_t *conf, const knot_dname_t *zone_name,
-                       zone_contents_t **contents, bool fail_on_warning);
+                       zone_contents_t **contents, bool fail_on_warning,
+                       bool use_snapshot);
 
 /*!
  * \brief Update zone contents from the journal.
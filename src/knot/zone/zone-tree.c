@@ -283,6 +283,50 @@ int zone_tree_apply(zone_tree_t *tree, zone_tree_apply_cb_t function, void *data
 	return trie_apply(tree->trie, tree_apply_cb, &f);
 }
 
+/*! \brief Parts per thread, so that threads finishing early can help others. */
+#define PARTS_PER_THREAD 16
+
+trie_parts_t *zone_tree_parts_new(zone_tree_t *tree, unsigned threads)
+{
+	return trie_parts_new(tree != NULL ? tree->trie : NULL, threads * PARTS_PER_THREAD);
+}
+
+int zone_tree_parts_apply(zone_tree_t *tree, trie_parts_t *parts,
+                          zone_tree_apply_cb_t function, void *data)
+{
+	if (parts == NULL || function == NULL) {
+		return KNOT_EINVAL;
+	}
+
+	if (zone_tree_is_empty(tree)) {
+		return KNOT_EOK;
+	}
+
+	zone_tree_func_t f = {
+		.func = function,
+		.data = data,
+		.binode_second = ((tree->flags & ZONE_TREE_BINO_SECOND) ? 1 : 0),
+	};
+
+	return trie_parts_apply(parts, tree_apply_cb, &f);
+}
+
+int zone_tree_parts_apply_part(zone_tree_t *tree, trie_parts_t *parts, size_t part,
+                               zone_tree_apply_cb_t function, void *data)
+{
+	if (parts == NULL || function == NULL || part >= trie_parts_count(parts)) {
+		return KNOT_EINVAL;
+	}
+
+	zone_tree_func_t f = {
+		.func = function,
+		.data = data,
+		.binode_second = ((tree->flags & ZONE_TREE_BINO_SECOND) ? 1 : 0),
+	};
+
+	return trie_parts_apply_part(parts, part, tree_apply_cb, &f);
+}
+
 int zone_tree_sub_apply(zone_tree_t *tree, const knot_dname_t *sub_root,
                         bool excl_root, zone_tree_apply_cb_t function, void *data)
 {
@@ -212,6 +212,46 @@ int zone_tree_del_node(zone_tree_t *tree, zone_node_t *node, bool free_deleted);
  */
 int zone_tree_apply(zone_tree_t *tree, zone_tree_apply_cb_t function, void *data);
 
+/*!
+ * \brief Splits the zone tree into contiguous parts for parallel processing.
+ *
+ * \param tree     Zone tree to be split.
+ * \param threads  Number of threads which will process the parts.
+ *
+ * \return Tree parts (to be freed by trie_parts_free()) or NULL if out of memory.
+ */
+trie_parts_t *zone_tree_parts_new(zone_tree_t *tree, unsigned threads);
+
+/*!
+ * \brief Applies the given function to each node of the tree parts not yet
+ *        claimed by another thread.
+ *
+ * \param tree      Zone tree the parts belong to.
+ * \param parts     Tree parts.
+ * \param function  Function to be applied to each node.
+ * \param data      Arbitrary data to be passed to the function.
+ *
+ * \retval KNOT_EOK
+ * \retval KNOT_EINVAL
+ */
+int zone_tree_parts_apply(zone_tree_t *tree, trie_parts_t *parts,
+                          zone_tree_apply_cb_t function, void *data);
+
+/*!
+ * \brief Applies the given function to each node of the given tree part.
+ *
+ * \param tree      Zone tree the parts belong to.
+ * \param parts     Tree parts.
+ * \param part      Index of the part (less than trie_parts_count()).
+ * \param function  Function to be applied to each node.
+ * \param data      Arbitrary data to be passed to the function.
+ *
+ * \retval KNOT_EOK
+ * \retval KNOT_EINVAL
+ */
+int zone_tree_parts_apply_part(zone_tree_t *tree, trie_parts_t *parts, size_t part,
+                               zone_tree_apply_cb_t function, void *data);
+
 /*!
  * \brief Applies given function to each node in a subtree.
  *
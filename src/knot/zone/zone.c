@@ -22,6 +22,7 @@
 #include "knot/common/log.h"
 #include "knot/conf/module.h"
 #include "knot/dnssec/kasp/kasp_db.h"
+#include "knot/dnssec/nsec3-cache.h"
 #include "knot/events/replan.h"
 #include "knot/journal/journal_read.h"
 #include "knot/journal/journal_write.h"
@@ -30,6 +31,7 @@
 #include "knot/updates/zone-update.h"
 #include "knot/zone/contents.h"
 #include "knot/zone/serial.h"
+#include "knot/zone/snapshot.h"
 #include "knot/zone/zone.h"
 #include "knot/zone/zonefile.h"
 #include "libknot/libknot.h"
@@ -42,6 +44,24 @@
 #define JOURNAL_LOCK_RW pthread_mutex_lock(JOURNAL_LOCK_MUTEX);
 #define JOURNAL_UNLOCK_RW pthread_mutex_unlock(JOURNAL_LOCK_MUTEX);
 
+/*! \brief Last generation assigned to published zone contents (all zones). */
+static uint64_t contents_gen_last = 0;
+#ifndef HAVE_ATOMIC
+static pthread_mutex_t contents_gen_lock = PTHREAD_MUTEX_INITIALIZER;
+#endif
+
+static uint64_t contents_gen_next(void)
+{
+#ifdef HAVE_ATOMIC
+	return __atomic_add_fetch(&contents_gen_last, 1, __ATOMIC_RELAXED);
+#else
+	pthread_mutex_lock(&contents_gen_lock);
+	uint64_t gen = ++contents_gen_last;
+	pthread_mutex_unlock(&contents_gen_lock);
+	return gen;
+#endif
+}
+
 static void free_ddns_queue(zone_t *zone)
 {
 	ptrnode_t *node, *nxt;
@@ -126,6 +146,19 @@ static int flush_journal(conf_t *conf, zone_t *zone, bool allow_empty_zone, bool
 		goto flush_journal_replan;
 	}
 
+	/* Update zone snapshot (not used with semantic checks). */
+	val = conf_zone_get(conf, C_ZONEFILE_SNAP, zone->name);
+	conf_val_t semchecks = conf_zone_get(conf, C_SEM_CHECKS, zone->name);
+	if (conf_bool(&val) && !conf_bool(&semchecks)) {
+		char *snapshot = zone_snapshot_path(zonefile);
+		int snap_ret = zone_snapshot_write(snapshot, contents, &st);
+		if (snap_ret != KNOT_EOK) {
+			log_zone_warning(zone->name, "failed to update zone snapshot (%s)",
+			                 knot_strerror(snap_ret));
+		}
+		free(snapshot);
+	}
+
 	free(zonefile);
 
 	/* Update zone file attributes. */
@@ -185,6 +218,9 @@ zone_t* zone_new(const knot_dname_t *name)
 	// Initialize query modules list.
 	init_list(&zone->query_modules);
 
+	// NSEC3 owner names cache (optional, hashing works without it).
+	zone->nsec3_cache = nsec3_cache_new(NSEC3_CACHE_SIZE);
+
 	return zone;
 }
 
@@ -231,6 +267,9 @@ void zone_free(zone_t **zone_ptr)
 
 	conf_deactivate_modules(&zone->query_modules, &zone->query_plan);
 
+	answer_cache_free(zone->answer_cache);
+	nsec3_cache_free(zone->nsec3_cache);
+
 	free(zone);
 	*zone_ptr = NULL;
 }
@@ -317,10 +356,18 @@ zone_contents_t *zone_switch_contents(zone_t *zone, zone_contents_t *new_content
 		return NULL;
 	}
 
+	/* Multi-message answers detect replaced contents by the generation. */
+	if (new_contents != NULL && new_contents != zone->contents) {
+		new_contents->gen = contents_gen_next();
+	}
+
 	zone_contents_t *old_contents;
 	zone_contents_t **current_contents = &zone->contents;
 	old_contents = rcu_xchg_pointer(current_contents, new_contents);
 
+	/* Cached answers belong to the previous contents. */
+	answer_cache_invalidate(zone->answer_cache);
+
 	return old_contents;
 }
 
@@ -22,12 +22,14 @@
 #include "knot/journal/journal_basic.h"
 #include "knot/events/events.h"
 #include "knot/updates/changesets.h"
+#include "knot/zone/answer-cache.h"
 #include "knot/zone/catalog.h"
 #include "knot/zone/contents.h"
 #include "knot/zone/timers.h"
 #include "libknot/dname.h"
 #include "libknot/packet/pkt.h"
 
+struct nsec3_cache;
 struct zone_update;
 struct zone_backup_ctx;
 
@@ -106,6 +108,12 @@ typedef struct zone
 	/*! \brief Query modules. */
 	list_t query_modules;
 	struct query_plan *query_plan;
+
+	/*! \brief Pre-rendered answers (optional), invalidated on contents switch. */
+	answer_cache_t *answer_cache;
+
+	/*! \brief NSEC3 owner names hashed by incremental signing (internally locked). */
+	struct nsec3_cache *nsec3_cache;
 } zone_t;
 
 /*!
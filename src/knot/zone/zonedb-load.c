@@ -55,13 +55,23 @@ static bool zone_file_updated(conf_t *conf, const zone_t *old_zone,
 	}
 }
 
-static zone_t *create_zone_from(const knot_dname_t *name, server_t *server)
+static zone_t *create_zone_from(conf_t *conf, const knot_dname_t *name,
+                                server_t *server)
 {
 	zone_t *zone = zone_new(name);
 	if (!zone) {
 		return NULL;
 	}
 
+	conf_val_t val = conf_zone_get(conf, C_ANSWER_CACHE, name);
+	int64_t answers = conf_int(&val);
+	if (answers > 0) {
+		zone->answer_cache = answer_cache_new(answers);
+		if (zone->answer_cache == NULL) {
+			log_zone_warning(name, "failed to initialize answer cache");
+		}
+	}
+
 	zone->journaldb = &server->journaldb;
 	zone->kaspdb = &server->kaspdb;
 	zone->catalog = &server->catalog;
@@ -180,7 +190,7 @@ static void timers_sanitize(conf_t *conf, zone_t *zone)
 static zone_t *create_zone_reload(conf_t *conf, const knot_dname_t *name,
                                   server_t *server, zone_t *old_zone)
 {
-	zone_t *zone = create_zone_from(name, server);
+	zone_t *zone = create_zone_from(conf, name, server);
 	if (!zone) {
 		return NULL;
 	}
@@ -217,7 +227,7 @@ static zone_t *create_zone_reload(conf_t *conf, const knot_dname_t *name,
 static zone_t *create_zone_new(conf_t *conf, const knot_dname_t *name,
                                server_t *server)
 {
-	zone_t *zone = create_zone_from(name, server);
+	zone_t *zone = create_zone_from(conf, name, server);
 	if (!zone) {
 		return NULL;
 	}
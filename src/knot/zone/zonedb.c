@@ -16,6 +16,7 @@
 
 #include <assert.h>
 #include <stdlib.h>
+#include <string.h>
 
 #include "knot/journal/journal_metadata.h"
 #include "knot/zone/zonedb.h"
@@ -159,6 +160,30 @@ zone_t *knot_zonedb_find_suffix(knot_zonedb_t *db, const knot_dname_t *zone_name
 	}
 }
 
+bool knot_zonedb_has_subzone(knot_zonedb_t *db, const knot_dname_t *zone_name)
+{
+	if (db == NULL || zone_name == NULL) {
+		return false;
+	}
+
+	/* Subzone keys are prefixed with the zone key, so the greatest one
+	 * lies just below the zone key padded with the maximum bytes. */
+	uint8_t key[KNOT_DNAME_MAXLEN];
+	knot_dname_storage_t lf_storage;
+	uint8_t *lf = knot_dname_lf(zone_name, lf_storage);
+	assert(lf);
+	memcpy(key, lf + 1, *lf);
+	memset(key + *lf, 0xff, sizeof(key) - *lf);
+
+	trie_val_t *val = NULL;
+	if (trie_get_leq(db->trie, key, sizeof(key), &val) < 0 || val == NULL) {
+		return false;
+	}
+
+	const zone_t *zone = *val;
+	return knot_dname_in_bailiwick(zone->name, zone_name) > 0;
+}
+
 size_t knot_zonedb_size(const knot_zonedb_t *db)
 {
 	if (db == NULL) {
@@ -116,6 +116,16 @@ zone_t **knot_zonedb_find_ptr(knot_zonedb_t *db, const knot_dname_t *zone_name);
  */
 zone_t *knot_zonedb_find_suffix(knot_zonedb_t *db, const knot_dname_t *zone_name);
 
+/*!
+ * \brief Checks if there is a zone below the given zone name.
+ *
+ * \param db Zone database to search in.
+ * \param zone_name Zone name.
+ *
+ * \retval True if some zone in the database is a subdomain of \a zone_name.
+ */
+bool knot_zonedb_has_subzone(knot_zonedb_t *db, const knot_dname_t *zone_name);
+
 size_t knot_zonedb_size(const knot_zonedb_t *db);
 
 /*!
@@ -15,9 +15,11 @@
  */
 
 #include <assert.h>
+#include <pthread.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <strings.h>
 #include <errno.h>
 #include <sys/types.h>
 #include <sys/stat.h>
@@ -27,6 +29,7 @@
 
 #include "libknot/libknot.h"
 #include "contrib/files.h"
+#include "contrib/macros.h"
 #include "knot/common/log.h"
 #include "knot/dnssec/zone-nsec.h"
 #include "knot/zone/semantic-check.h"
@@ -39,17 +42,26 @@
 #define WARNING(zone, fmt, ...) log_zone_warning(zone, "zone loader, " fmt, ##__VA_ARGS__)
 #define NOTICE(zone, fmt, ...) log_zone_notice(zone, "zone loader, " fmt, ##__VA_ARGS__)
 
-static void process_error(zs_scanner_t *s)
-{
-	zcreator_t *zc = s->process.data;
-	const knot_dname_t *zname = zc->z->apex->owner;
+#define DEFAULT_TTL		3600
+#define CHUNK_MIN_SIZE		(1024 * 1024)	/*!< Minimum zone file chunk size. */
+#define CHUNKS_PER_THREAD	16		/*!< Chunks per parsing thread. */
+#define CHUNKS_AHEAD		2		/*!< Parsed chunks per thread waiting for merge. */
 
+static void log_scanner_error(const knot_dname_t *zname, zs_scanner_t *s)
+{
 	ERROR(zname, "%s in zone, file '%s', line %"PRIu64" (%s)",
 	      s->error.fatal ? "fatal error" : "error",
 	      s->file.name, s->line_counter,
 	      zs_strerror(s->error.code));
 }
 
+static void process_error(zs_scanner_t *s)
+{
+	zcreator_t *zc = s->process.data;
+
+	log_scanner_error(zc->z->apex->owner, s);
+}
+
 static bool handle_err(zcreator_t *zc, const knot_rrset_t *rr, int ret, bool master)
 {
 	const knot_dname_t *zname = zc->z->apex->owner;
@@ -84,11 +96,13 @@ int zcreator_step(zcreator_t *zc, const knot_rrset_t *rr)
 	if (rr->type == KNOT_RRTYPE_SOA &&
 	    node_rrtype_exists(zc->z->apex, KNOT_RRTYPE_SOA)) {
 		// Ignore extra SOA
+		zc->node = NULL;
 		return KNOT_EOK;
 	}
 
 	zone_node_t *node = NULL;
 	int ret = zone_contents_add_rr(zc->z, rr, &node);
+	zc->node = (ret == KNOT_EOK) ? node : NULL;
 	if (ret != KNOT_EOK) {
 		if (!handle_err(zc, rr, ret, zc->master)) {
 			// Fatal error
@@ -136,6 +150,449 @@ static void process_data(zs_scanner_t *scanner)
 	knot_rrset_clear(&rr, NULL);
 }
 
+/*! \brief Parsed record stored in a chunk batch (followed by rdata and owner). */
+typedef struct {
+	uint32_t size;    /*!< Size of the record including padding. */
+	uint32_t ttl;
+	uint16_t type;
+	uint16_t rclass;
+} batch_rr_t;
+
+struct zparallel;
+
+/*! \brief Zone file chunk starting with an explicit owner. */
+typedef struct {
+	struct zparallel *par;
+	const char *start;     /*!< Chunk data. */
+	size_t size;           /*!< Chunk data size. */
+	uint64_t line;         /*!< Line number of the chunk start. */
+	char *origin;          /*!< Origin in effect at the chunk start. */
+	uint32_t ttl;          /*!< Default TTL in effect at the chunk start. */
+	uint8_t *batch;        /*!< Parsed records in canonical form. */
+	size_t batch_size;     /*!< Size of the parsed records. */
+	size_t batch_max;      /*!< Allocated batch size. */
+	uint64_t errors;       /*!< Number of parsing errors. */
+	int ret;               /*!< Processing result. */
+	bool done;             /*!< Parsing finished. */
+} zchunk_t;
+
+/*! \brief Parallel zone file parsing context. */
+typedef struct zparallel {
+	zloader_t *loader;
+	zchunk_t *chunks;
+	size_t count;          /*!< Number of chunks. */
+	size_t next;           /*!< Next chunk to be parsed. */
+	size_t merged;         /*!< Number of merged chunks. */
+	size_t ahead;          /*!< Maximum number of chunks waiting for merge. */
+	bool stop;             /*!< Parsing interrupted. */
+	pthread_mutex_t lock;
+	pthread_cond_t cond;
+} zparallel_t;
+
+static bool is_owner_start(char c)
+{
+	switch (c) {
+	case ' ': case '\t': case '\r': case '\n':
+	case ';': case '$': case '(': case ')':
+		return false;
+	default:
+		return true;
+	}
+}
+
+static bool is_directive(const char *pos, const char *end, const char *name)
+{
+	size_t len = strlen(name);
+	return end - pos > len && strncasecmp(pos, name, len) == 0 &&
+	       (pos[len] == ' ' || pos[len] == '\t');
+}
+
+/*!
+ * \brief Splits the zone file into chunks starting with an explicit owner.
+ *
+ * Split points are searched outside of comments, quoted strings and
+ * parentheses. The $ORIGIN and $TTL directives are evaluated so that each
+ * chunk can be parsed separately. Files with other directives are not split.
+ */
+static int split_chunks(zparallel_t *par, size_t count)
+{
+	zs_scanner_t *zs = &par->loader->scanner;
+	const char *start = zs->input.start;
+	const char *end = zs->input.end;
+	const size_t target = (end - start) / count;
+
+	par->chunks = calloc(count, sizeof(zchunk_t));
+	zs_scanner_t *dir = malloc(sizeof(zs_scanner_t));
+	char *origin = knot_dname_to_str_alloc(par->loader->creator->z->apex->owner);
+	if (par->chunks == NULL || dir == NULL || origin == NULL) {
+		free(dir);
+		free(origin);
+		return KNOT_ENOMEM;
+	}
+	if (zs_init(dir, origin, KNOT_CLASS_IN, DEFAULT_TTL) != 0) {
+		zs_deinit(dir);
+		free(dir);
+		free(origin);
+		return KNOT_ENOMEM;
+	}
+
+	par->count = 1;
+	par->chunks[0].start = start;
+	par->chunks[0].line = 1;
+	par->chunks[0].origin = origin;
+	par->chunks[0].ttl = DEFAULT_TTL;
+
+	int ret = KNOT_EOK;
+	uint64_t line = 1;
+	unsigned depth = 0;
+	bool quoted = false, comment = false;
+	const char *directive = NULL;
+	const char *line_start = start;
+
+	for (const char *pos = start; pos <= end && ret == KNOT_EOK; pos++) {
+		if (pos == line_start) {
+			if (pos == end) {
+				break;
+			}
+			if (*pos == '$') {
+				if (!is_directive(pos, end, "$ORIGIN") &&
+				    !is_directive(pos, end, "$TTL")) {
+					ret = KNOT_ENOTSUP;
+					break;
+				}
+				directive = pos;
+			} else if (par->count < count && (size_t)(pos - start) >= par->count * target &&
+			           is_owner_start(*pos)) {
+				zchunk_t *chunk = &par->chunks[par->count];
+				chunk->start = pos;
+				chunk->line = line;
+				chunk->origin = knot_dname_to_str_alloc(dir->zone_origin);
+				chunk->ttl = dir->default_ttl;
+				par->count++;
+				if (chunk->origin == NULL) {
+					ret = KNOT_ENOMEM;
+					break;
+				}
+			}
+		}
+		if (pos == end) {
+			break;
+		}
+
+		char c = *pos;
+		if (c == '\n') {
+			line++;
+			comment = false;
+			if (depth > 0 || quoted) {
+				continue;
+			}
+			line_start = pos + 1;
+			if (directive != NULL) {
+				/* Evaluate the directive to track the current origin and TTL. */
+				if (zs_set_input_string(dir, directive, line_start - directive) != 0 ||
+				    zs_parse_all(dir) != 0 || dir->error.counter > 0) {
+					ret = KNOT_ENOTSUP;
+				}
+				directive = NULL;
+			}
+		} else if (comment) {
+			continue;
+		} else if (c == '\\') {
+			if (pos + 1 < end && *(++pos) == '\n') {
+				line++;
+			}
+		} else if (quoted) {
+			quoted = (c != '"');
+		} else if (c == '"') {
+			quoted = true;
+		} else if (c == ';') {
+			comment = true;
+		} else if (c == '(') {
+			depth++;
+		} else if (c == ')' && depth > 0) {
+			depth--;
+		}
+	}
+
+	zs_deinit(dir);
+	free(dir);
+
+	for (size_t i = 0; i < par->count; i++) {
+		zchunk_t *chunk = &par->chunks[i];
+		const char *chunk_end = (i + 1 < par->count) ? par->chunks[i + 1].start : end;
+		chunk->par = par;
+		chunk->size = chunk_end - chunk->start;
+	}
+
+	if (ret == KNOT_EOK && par->count < 2) {
+		ret = KNOT_ENOTSUP;
+	}
+
+	return ret;
+}
+
+/*!
+ * \brief Checks if parsing was interrupted while a chunk is being parsed.
+ *
+ * Without atomic operations, the chunk is always parsed to the end, as it's
+ * not worth locking for each record.
+ */
+static bool parsing_stopped(zparallel_t *par)
+{
+#ifdef HAVE_ATOMIC
+	return __atomic_load_n(&par->stop, __ATOMIC_RELAXED);
+#else
+	(void)par;
+	return false;
+#endif
+}
+
+/*! \brief Claims the next chunk to be parsed. */
+static size_t claim_chunk(zparallel_t *par)
+{
+#ifdef HAVE_ATOMIC
+	return __atomic_fetch_add(&par->next, 1, __ATOMIC_RELAXED);
+#else
+	pthread_mutex_lock(&par->lock);
+	size_t i = par->next++;
+	pthread_mutex_unlock(&par->lock);
+	return i;
+#endif
+}
+
+/*! \brief Stores the parsed record in the chunk batch in canonical form. */
+static void chunk_data(zs_scanner_t *s)
+{
+	zchunk_t *chunk = s->process.data;
+	if (chunk->ret != KNOT_EOK || parsing_stopped(chunk->par)) {
+		s->state = ZS_STATE_STOP;
+		return;
+	}
+
+	size_t rdata_size = knot_rdata_size(s->r_data_length);
+	size_t size = sizeof(batch_rr_t) + rdata_size + s->r_owner_length;
+	size = (size + 3) & ~(size_t)3;
+
+	if (chunk->batch_size + size > chunk->batch_max) {
+		size_t max = MAX(2 * chunk->batch_max, chunk->batch_size + size);
+		uint8_t *batch = realloc(chunk->batch, max);
+		if (batch == NULL) {
+			chunk->ret = KNOT_ENOMEM;
+			s->state = ZS_STATE_STOP;
+			return;
+		}
+		chunk->batch = batch;
+		chunk->batch_max = max;
+	}
+
+	batch_rr_t *rr = (batch_rr_t *)(chunk->batch + chunk->batch_size);
+	rr->size = size;
+	rr->ttl = s->r_ttl;
+	rr->type = s->r_type;
+	rr->rclass = s->r_class;
+
+	knot_rdata_t *rdata = (knot_rdata_t *)(rr + 1);
+	knot_rdata_init(rdata, s->r_data_length, s->r_data);
+	knot_dname_t *owner = (uint8_t *)rdata + rdata_size;
+	memcpy(owner, s->r_owner, s->r_owner_length);
+
+	/* Convert the owner and RDATA dnames to lowercase in place. */
+	knot_rrset_t rrset;
+	knot_rrset_init(&rrset, owner, rr->type, rr->rclass, rr->ttl);
+	rrset.rrs = (knot_rdataset_t) { .count = 1, .size = rdata_size, .rdata = rdata };
+	int ret = knot_rrset_rr_to_canonical(&rrset);
+	if (ret != KNOT_EOK) {
+		chunk->ret = ret;
+		s->state = ZS_STATE_STOP;
+		return;
+	}
+
+	chunk->batch_size += size;
+}
+
+static void chunk_error(zs_scanner_t *s)
+{
+	zchunk_t *chunk = s->process.data;
+
+	log_scanner_error(chunk->par->loader->creator->z->apex->owner, s);
+}
+
+static void chunk_parse(zchunk_t *chunk)
+{
+	zloader_t *loader = chunk->par->loader;
+
+	zs_scanner_t *s = malloc(sizeof(zs_scanner_t));
+	if (s == NULL) {
+		chunk->ret = KNOT_ENOMEM;
+		return;
+	}
+
+	if (zs_init(s, chunk->origin, KNOT_CLASS_IN, chunk->ttl) != 0 ||
+	    zs_set_input_string(s, chunk->start, chunk->size) != 0 ||
+	    zs_set_processing(s, chunk_data, chunk_error, chunk) != 0 ||
+	    (s->file.name = strdup(loader->source)) == NULL) {
+		chunk->ret = KNOT_ENOMEM;
+		zs_deinit(s);
+		free(s);
+		return;
+	}
+	s->line_counter = chunk->line;
+
+	if (zs_parse_all(s) != 0 && s->error.counter == 0) {
+		ERROR(loader->creator->z->apex->owner,
+		      "failed to load zone, file '%s' (%s)",
+		      loader->source, zs_strerror(s->error.code));
+		chunk->errors = 1;
+	} else {
+		chunk->errors = s->error.counter;
+	}
+
+	zs_deinit(s);
+	free(s);
+}
+
+static void *parse_thread(void *arg)
+{
+	zparallel_t *par = arg;
+
+	size_t i;
+	while ((i = claim_chunk(par)) < par->count) {
+		zchunk_t *chunk = &par->chunks[i];
+
+		/* Limit the number of parsed chunks waiting for merge. */
+		pthread_mutex_lock(&par->lock);
+		while (i >= par->merged + par->ahead && !par->stop) {
+			pthread_cond_wait(&par->cond, &par->lock);
+		}
+		bool stop = par->stop;
+		pthread_mutex_unlock(&par->lock);
+
+		if (!stop) {
+			chunk_parse(chunk);
+		}
+
+		pthread_mutex_lock(&par->lock);
+		chunk->done = true;
+		pthread_cond_broadcast(&par->cond);
+		pthread_mutex_unlock(&par->lock);
+	}
+
+	return NULL;
+}
+
+static int chunk_merge(zcreator_t *zc, zchunk_t *chunk)
+{
+	for (size_t pos = 0; pos < chunk->batch_size; ) {
+		batch_rr_t *rr = (batch_rr_t *)(chunk->batch + pos);
+		knot_rdata_t *rdata = (knot_rdata_t *)(rr + 1);
+		size_t rdata_size = knot_rdata_size(rdata->len);
+		knot_dname_t *owner = (uint8_t *)rdata + rdata_size;
+
+		knot_rrset_t rrset;
+		knot_rrset_init(&rrset, owner, rr->type, rr->rclass, rr->ttl);
+		rrset.rrs = (knot_rdataset_t) { .count = 1, .size = rdata_size, .rdata = rdata };
+		int ret = zcreator_step(zc, &rrset);
+		if (ret != KNOT_EOK) {
+			return ret;
+		}
+
+		pos += rr->size;
+	}
+
+	return KNOT_EOK;
+}
+
+/*! \brief Parses the chunks in parallel and merges the records in the file order. */
+static int parse_chunks(zparallel_t *par, uint64_t *errors)
+{
+	unsigned threads = MIN(par->loader->threads, par->count);
+	pthread_t thread[threads];
+	unsigned created = 0;
+	while (created < threads &&
+	       pthread_create(&thread[created], NULL, parse_thread, par) == 0) {
+		created++;
+	}
+	if (created == 0) {
+		par->ahead = par->count;
+		(void)parse_thread(par);
+	}
+
+	int ret = KNOT_EOK;
+	zcreator_t *zc = par->loader->creator;
+	for (size_t i = 0; i < par->count && ret == KNOT_EOK && zc->ret == KNOT_EOK; i++) {
+		zchunk_t *chunk = &par->chunks[i];
+
+		pthread_mutex_lock(&par->lock);
+		while (!chunk->done) {
+			pthread_cond_wait(&par->cond, &par->lock);
+		}
+		pthread_mutex_unlock(&par->lock);
+
+		/* Keep parsing after a syntax error to report all of them. */
+		*errors += chunk->errors;
+		ret = chunk->ret;
+		if (ret == KNOT_EOK && *errors == 0) {
+			zc->ret = chunk_merge(zc, chunk);
+		}
+
+		free(chunk->batch);
+		chunk->batch = NULL;
+
+		pthread_mutex_lock(&par->lock);
+		par->merged++;
+		pthread_cond_broadcast(&par->cond);
+		pthread_mutex_unlock(&par->lock);
+	}
+
+	pthread_mutex_lock(&par->lock);
+	par->stop = true;
+	pthread_cond_broadcast(&par->cond);
+	pthread_mutex_unlock(&par->lock);
+
+	for (unsigned i = 0; i < created; i++) {
+		pthread_join(thread[i], NULL);
+	}
+
+	return ret;
+}
+
+/*!
+ * \brief Parses the zone file split into chunks using multiple threads.
+ *
+ * \retval KNOT_ENOTSUP if the zone file is not suitable for parallel parsing.
+ */
+static int parse_parallel(zloader_t *loader, uint64_t *errors)
+{
+	zs_scanner_t *zs = &loader->scanner;
+	size_t size = zs->input.end - zs->input.start;
+	size_t count = MIN(size / CHUNK_MIN_SIZE, (size_t)loader->threads * CHUNKS_PER_THREAD);
+	if (zs->input.start == NULL || count < 2) {
+		return KNOT_ENOTSUP;
+	}
+
+	zparallel_t par = {
+		.loader = loader,
+		.ahead = loader->threads * CHUNKS_AHEAD,
+	};
+
+	int ret = split_chunks(&par, count);
+	if (ret == KNOT_EOK) {
+		pthread_mutex_init(&par.lock, NULL);
+		pthread_cond_init(&par.cond, NULL);
+		ret = parse_chunks(&par, errors);
+		pthread_cond_destroy(&par.cond);
+		pthread_mutex_destroy(&par.lock);
+	}
+
+	for (size_t i = 0; i < par.count; i++) {
+		free(par.chunks[i].origin);
+		free(par.chunks[i].batch);
+	}
+	free(par.chunks);
+
+	return ret;
+}
+
 int zonefile_open(zloader_t *loader, const char *source,
                   const knot_dname_t *origin, semcheck_optional_t semantic_checks, time_t time)
 {
@@ -171,7 +628,7 @@ int zonefile_open(zloader_t *loader, const char *source,
 		return KNOT_ENOMEM;
 	}
 
-	if (zs_init(&loader->scanner, origin_str, KNOT_CLASS_IN, 3600) != 0 ||
+	if (zs_init(&loader->scanner, origin_str, KNOT_CLASS_IN, DEFAULT_TTL) != 0 ||
 	    zs_set_input_file(&loader->scanner, source) != 0 ||
 	    zs_set_processing(&loader->scanner, process_data, process_error, zc) != 0) {
 		zs_deinit(&loader->scanner);
@@ -200,11 +657,24 @@ zone_contents_t *zonefile_load(zloader_t *loader)
 	const knot_dname_t *zname = zc->z->apex->owner;
 
 	assert(zc);
-	int ret = zs_parse_all(&loader->scanner);
-	if (ret != 0 && loader->scanner.error.counter == 0) {
-		ERROR(zname, "failed to load zone, file '%s' (%s)",
-		      loader->source, zs_strerror(loader->scanner.error.code));
-		goto fail;
+	uint64_t errors = 0;
+	int ret = KNOT_ENOTSUP;
+	if (loader->threads > 1) {
+		ret = parse_parallel(loader, &errors);
+		if (ret != KNOT_EOK && ret != KNOT_ENOTSUP) {
+			ERROR(zname, "failed to load zone, file '%s' (%s)",
+			      loader->source, knot_strerror(ret));
+			goto fail;
+		}
+	}
+	if (ret == KNOT_ENOTSUP) {
+		ret = zs_parse_all(&loader->scanner);
+		if (ret != 0 && loader->scanner.error.counter == 0) {
+			ERROR(zname, "failed to load zone, file '%s' (%s)",
+			      loader->source, zs_strerror(loader->scanner.error.code));
+			goto fail;
+		}
+		errors = loader->scanner.error.counter;
 	}
 
 	if (zc->ret != KNOT_EOK) {
@@ -213,9 +683,9 @@ zone_contents_t *zonefile_load(zloader_t *loader)
 		goto fail;
 	}
 
-	if (loader->scanner.error.counter > 0) {
+	if (errors > 0) {
 		ERROR(zname, "failed to load zone, file '%s', %"PRIu64" errors",
-		      loader->source, loader->scanner.error.counter);
+		      loader->source, errors);
 		goto fail;
 	}
 
@@ -234,8 +704,9 @@ zone_contents_t *zonefile_load(zloader_t *loader)
 		goto fail;
 	}
 
+	unsigned threads = MAX(loader->adjust_threads, 1);
 	ret = sem_checks_process(zc->z, loader->semantic_checks,
-	                         loader->err_handler, loader->time);
+	                         loader->err_handler, loader->time, threads);
 
 	if (ret != KNOT_EOK) {
 		ERROR(zname, "failed to load zone, file '%s' (%s)",
@@ -246,7 +717,7 @@ zone_contents_t *zonefile_load(zloader_t *loader)
 	/* The contents will now change possibly messing up NSEC3 tree, it will
 	   be adjusted again at zone_update_commit. */
 	ret = zone_adjust_contents(zc->z, unadjust_cb_point_to_nsec3, NULL,
-	                           false, false, 1, NULL);
+	                           false, false, threads, NULL);
 	if (ret != KNOT_EOK) {
 		ERROR(zname, "failed to finalize zone contents (%s)",
 		      knot_strerror(ret));
@@ -29,6 +29,7 @@ typedef struct zcreator {
 	zone_contents_t *z;  /*!< Created zone. */
 	bool master;         /*!< True if server is a primary master for the zone. */
 	int ret;             /*!< Return value. */
+	zone_node_t *node;   /*!< Node of the last record, NULL unless added without issues. */
 } zcreator_t;
 
 /*!
@@ -41,6 +42,8 @@ typedef struct {
 	zcreator_t *creator;         /*!< Loader context. */
 	zs_scanner_t scanner;        /*!< Zone scanner. */
 	time_t time;                 /*!< time for zone check. */
+	unsigned threads;            /*!< Number of parsing threads. */
+	unsigned adjust_threads;     /*!< Number of adjusting and checking threads. */
 } zloader_t;
 
 void err_handler_logger(sem_handler_t *handler, const zone_contents_t *zone,
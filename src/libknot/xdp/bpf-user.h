@@ -47,6 +47,12 @@ struct kxsk_umem {
 
 	/*! The memory frames. */
 	struct umem_frame *frames;
+	/*! The number of frames for receiving (following the TX ones). */
+	uint32_t frame_count_rx;
+	/*! The number of frames for sending. */
+	uint32_t frame_count_tx;
+	/*! The number of RX frames being sent back as in-place replies. */
+	uint32_t rx_inplace_count;
 	/*! The number of free frames (for TX). */
 	uint32_t tx_free_count;
 	/*! Stack of indices of the free frames (for TX). */
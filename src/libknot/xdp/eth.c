@@ -24,6 +24,7 @@
 #include <sys/ioctl.h>
 #include <unistd.h>
 
+#include "contrib/macros.h"
 #include "contrib/openbsd/strlcpy.h"
 #include "contrib/sockaddr.h"
 #include "libknot/attribute.h"
@@ -58,10 +59,13 @@ int knot_eth_queues(const char *devname)
 			ret = knot_map_errno();
 		}
 	} else {
-		if (ch.combined_count == 0) {
+		/* Separate RX and TX channels pair up into queues like the combined
+		   ones, unpaired ones can't be used for both receiving and sending. */
+		uint32_t queues = ch.combined_count + MIN(ch.rx_count, ch.tx_count);
+		if (queues == 0) {
 			ret = 1;
 		} else {
-			ret = ch.combined_count;
+			ret = queues;
 		}
 	}
 
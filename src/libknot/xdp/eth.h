@@ -19,7 +19,8 @@
 #include <stddef.h>
 
 /*!
- * \brief Get number of combined queues of a network interface.
+ * \brief Get number of queues (combined or paired RX and TX channels) of
+ *        a network interface.
  *
  * \param devname  Name of the ethdev (e.g. eth1).
  *
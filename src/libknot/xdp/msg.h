@@ -30,6 +30,7 @@ typedef enum {
 	KNOT_XDP_MSG_FIN   = (1 << 4), /*!< FIN flag set (TCP only). */
 	KNOT_XDP_MSG_RST   = (1 << 5), /*!< RST flag set (TCP only). */
 	KNOT_XDP_MSG_MSS   = (1 << 6), /*!< MSS option in TCP header (TCP only). */
+	KNOT_XDP_MSG_INPLACE = (1 << 7), /*!< The frame is reused for the reply (received packets only). */
 } knot_xdp_msg_flag_t;
 
 /*! \brief Packet description with src & dst MAC & IP addrs + DNS payload. */
@@ -37,53 +37,111 @@
 #define FRAME_SIZE 2048
 #define UMEM_FRAME_COUNT_RX 4096
 #define UMEM_FRAME_COUNT_TX UMEM_FRAME_COUNT_RX // No reason to differ so far.
-#define UMEM_RING_LEN_RX (UMEM_FRAME_COUNT_RX * 2)
-#define UMEM_RING_LEN_TX (UMEM_FRAME_COUNT_TX * 2)
-#define UMEM_FRAME_COUNT (UMEM_FRAME_COUNT_RX + UMEM_FRAME_COUNT_TX)
+#define UMEM_FRAME_COUNT_RX_MAX (1 << 20)
+#define UMEM_FRAME_COUNT_TX_MAX (1 << 16) // See tx_free_indices.
+
+#define IS_POWER_OF_2(n) (((n) & (n - 1)) == 0)
 
 /* With recent compilers we statically check #defines for settings that
  * get refused by AF_XDP drivers (in current versions, at least). */
 #if (__STDC_VERSION__ >= 201112L)
-#define IS_POWER_OF_2(n) (((n) & (n - 1)) == 0)
 _Static_assert((FRAME_SIZE == 4096 || FRAME_SIZE == 2048)
-	&& IS_POWER_OF_2(UMEM_FRAME_COUNT)
-	/* The following two inequalities aren't required by drivers, but they allow
-	 * our implementation assume that the rings can never get filled. */
-	&& IS_POWER_OF_2(UMEM_RING_LEN_RX) && UMEM_RING_LEN_RX > UMEM_FRAME_COUNT_RX
-	&& IS_POWER_OF_2(UMEM_RING_LEN_TX) && UMEM_RING_LEN_TX > UMEM_FRAME_COUNT_TX
-	&& UMEM_FRAME_COUNT_TX <= (1 << 16) /* see tx_free_indices */
+	&& UMEM_FRAME_COUNT_TX <= UMEM_FRAME_COUNT_TX_MAX
 	, "Incorrect #define combination for AF_XDP.");
 #endif
 
+static uint32_t ring_size(uint32_t min_size)
+{
+	uint32_t size = 1;
+	while (size < min_size) {
+		size <<= 1;
+	}
+	return size;
+}
+
+static int config_complete(const knot_xdp_config_t *config, knot_xdp_config_t *out)
+{
+	if (config != NULL) {
+		*out = *config;
+	} else {
+		memset(out, 0, sizeof(*out));
+	}
+
+	if (out->frame_count_rx == 0) {
+		out->frame_count_rx = UMEM_FRAME_COUNT_RX;
+	}
+	if (out->frame_count_tx == 0) {
+		out->frame_count_tx = UMEM_FRAME_COUNT_TX;
+	}
+	if (out->frame_count_rx > UMEM_FRAME_COUNT_RX_MAX ||
+	    out->frame_count_tx > UMEM_FRAME_COUNT_TX_MAX) {
+		return KNOT_EINVAL;
+	}
+
+	/* The completion and TX rings can hold all the frames as the RX ones
+	 * are sent too (in-place replies), the fill ring all the RX frames.
+	 * This allows our implementation to assume that they never get filled. */
+	uint32_t frame_count = out->frame_count_rx + out->frame_count_tx;
+	if (out->ring_size_fill == 0) {
+		out->ring_size_fill = ring_size(2 * out->frame_count_rx);
+	}
+	if (out->ring_size_rx == 0) {
+		out->ring_size_rx = ring_size(2 * out->frame_count_rx);
+	}
+	if (out->ring_size_comp == 0) {
+		out->ring_size_comp = ring_size(frame_count);
+	}
+	if (out->ring_size_tx == 0) {
+		out->ring_size_tx = ring_size(frame_count);
+	}
+
+	/* Ring sizes not being a power of 2 get refused by AF_XDP. */
+	if (!IS_POWER_OF_2(out->ring_size_fill) || out->ring_size_fill < out->frame_count_rx ||
+	    !IS_POWER_OF_2(out->ring_size_rx) ||
+	    !IS_POWER_OF_2(out->ring_size_comp) || out->ring_size_comp < frame_count ||
+	    !IS_POWER_OF_2(out->ring_size_tx) || out->ring_size_tx < frame_count) {
+		return KNOT_EINVAL;
+	}
+
+	return KNOT_EOK;
+}
+
 struct umem_frame {
 	uint8_t bytes[FRAME_SIZE];
 };
 
-static int configure_xsk_umem(struct kxsk_umem **out_umem)
+static int configure_xsk_umem(const knot_xdp_config_t *xdp_config,
+                              struct kxsk_umem **out_umem)
 {
+	const uint32_t frame_count_rx = xdp_config->frame_count_rx;
+	const uint32_t frame_count_tx = xdp_config->frame_count_tx;
+	const uint32_t frame_count = frame_count_rx + frame_count_tx;
+
 	/* Allocate memory and call driver to create the UMEM. */
 	struct kxsk_umem *umem = calloc(1,
 		offsetof(struct kxsk_umem, tx_free_indices)
-		+ sizeof(umem->tx_free_indices[0]) * UMEM_FRAME_COUNT_TX);
+		+ sizeof(umem->tx_free_indices[0]) * frame_count_tx);
 	if (umem == NULL) {
 		return KNOT_ENOMEM;
 	}
+	umem->frame_count_rx = frame_count_rx;
+	umem->frame_count_tx = frame_count_tx;
 
 	int ret = posix_memalign((void **)&umem->frames, getpagesize(),
-	                         FRAME_SIZE * UMEM_FRAME_COUNT);
+	                         (size_t)FRAME_SIZE * frame_count);
 	if (ret != 0) {
 		free(umem);
 		return KNOT_ENOMEM;
 	}
 
 	const struct xsk_umem_config config = {
-		.fill_size = UMEM_RING_LEN_RX,
-		.comp_size = UMEM_RING_LEN_TX,
+		.fill_size = xdp_config->ring_size_fill,
+		.comp_size = xdp_config->ring_size_comp,
 		.frame_size = FRAME_SIZE,
 		.frame_headroom = 0,
 	};
 
-	ret = xsk_umem__create(&umem->umem, umem->frames, FRAME_SIZE * UMEM_FRAME_COUNT,
+	ret = xsk_umem__create(&umem->umem, umem->frames, (uint64_t)FRAME_SIZE * frame_count,
 	                       &umem->fq, &umem->cq, &config);
 	if (ret != KNOT_EOK) {
 		free(umem->frames);
@@ -93,23 +151,23 @@ static int configure_xsk_umem(struct kxsk_umem **out_umem)
 	*out_umem = umem;
 
 	/* Designate the starting chunk of buffers for TX, and put them onto the stack. */
-	umem->tx_free_count = UMEM_FRAME_COUNT_TX;
-	for (uint32_t i = 0; i < UMEM_FRAME_COUNT_TX; ++i) {
+	umem->tx_free_count = frame_count_tx;
+	for (uint32_t i = 0; i < frame_count_tx; ++i) {
 		umem->tx_free_indices[i] = i;
 	}
 
 	/* Designate the rest of buffers for RX, and pass them to the driver. */
 	uint32_t idx = 0;
-	ret = xsk_ring_prod__reserve(&umem->fq, UMEM_FRAME_COUNT_RX, &idx);
-	if (ret != UMEM_FRAME_COUNT - UMEM_FRAME_COUNT_TX) {
+	ret = xsk_ring_prod__reserve(&umem->fq, frame_count_rx, &idx);
+	if (ret != frame_count - frame_count_tx) {
 		assert(0);
 		return KNOT_ERROR;
 	}
 	assert(idx == 0);
-	for (uint32_t i = UMEM_FRAME_COUNT_TX; i < UMEM_FRAME_COUNT; ++i) {
-		*xsk_ring_prod__fill_addr(&umem->fq, idx++) = i * FRAME_SIZE;
+	for (uint32_t i = frame_count_tx; i < frame_count; ++i) {
+		*xsk_ring_prod__fill_addr(&umem->fq, idx++) = (uint64_t)i * FRAME_SIZE;
 	}
-	xsk_ring_prod__submit(&umem->fq, UMEM_FRAME_COUNT_RX);
+	xsk_ring_prod__submit(&umem->fq, frame_count_rx);
 
 	return KNOT_EOK;
 }
@@ -123,6 +181,7 @@ static void deconfigure_xsk_umem(struct kxsk_umem *umem)
 
 static int configure_xsk_socket(struct kxsk_umem *umem,
                                 const struct kxsk_iface *iface,
+                                const knot_xdp_config_t *xdp_config,
                                 knot_xdp_socket_t **out_sock)
 {
 	knot_xdp_socket_t *xsk_info = calloc(1, sizeof(*xsk_info));
@@ -133,8 +192,8 @@ static int configure_xsk_socket(struct kxsk_umem *umem,
 	xsk_info->umem = umem;
 
 	const struct xsk_socket_config sock_conf = {
-		.tx_size = UMEM_RING_LEN_TX,
-		.rx_size = UMEM_RING_LEN_RX,
+		.tx_size = xdp_config->ring_size_tx,
+		.rx_size = xdp_config->ring_size_rx,
 		.libbpf_flags = XSK_LIBBPF_FLAGS__INHIBIT_PROG_LOAD,
 	};
 
@@ -153,26 +212,40 @@ static int configure_xsk_socket(struct kxsk_umem *umem,
 _public_
 int knot_xdp_init(knot_xdp_socket_t **socket, const char *if_name, int if_queue,
                   uint32_t listen_port, knot_xdp_load_bpf_t load_bpf)
+{
+	return knot_xdp_init2(socket, if_name, if_queue, listen_port, load_bpf, NULL);
+}
+
+_public_
+int knot_xdp_init2(knot_xdp_socket_t **socket, const char *if_name, int if_queue,
+                   uint32_t listen_port, knot_xdp_load_bpf_t load_bpf,
+                   const knot_xdp_config_t *config)
 {
 	if (socket == NULL || if_name == NULL) {
 		return KNOT_EINVAL;
 	}
 
+	knot_xdp_config_t xdp_config;
+	int ret = config_complete(config, &xdp_config);
+	if (ret != KNOT_EOK) {
+		return ret;
+	}
+
 	struct kxsk_iface *iface;
-	int ret = kxsk_iface_new(if_name, if_queue, load_bpf, &iface);
+	ret = kxsk_iface_new(if_name, if_queue, load_bpf, &iface);
 	if (ret != KNOT_EOK) {
 		return ret;
 	}
 
 	/* Initialize shared packet_buffer for umem usage. */
 	struct kxsk_umem *umem = NULL;
-	ret = configure_xsk_umem(&umem);
+	ret = configure_xsk_umem(&xdp_config, &umem);
 	if (ret != KNOT_EOK) {
 		kxsk_iface_free(iface);
 		return ret;
 	}
 
-	ret = configure_xsk_socket(umem, iface, socket);
+	ret = configure_xsk_socket(umem, iface, &xdp_config, socket);
 	if (ret != KNOT_EOK) {
 		deconfigure_xsk_umem(umem);
 		kxsk_iface_free(iface);
@@ -221,7 +294,18 @@ static void tx_free_relative(struct kxsk_umem *umem, uint64_t addr_relative)
 {
 	/* The address may not point to *start* of buffer, but `/` solves that. */
 	uint64_t index = addr_relative / FRAME_SIZE;
-	assert(index < UMEM_FRAME_COUNT);
+	assert(index < umem->frame_count_tx + umem->frame_count_rx);
+
+	if (index >= umem->frame_count_tx) {
+		/* An RX frame used for an in-place reply, pass it back to the driver. */
+		uint32_t idx = 0;
+		const uint32_t reserved = xsk_ring_prod__reserve(&umem->fq, 1, &idx);
+		assert(reserved == 1);
+		*xsk_ring_prod__fill_addr(&umem->fq, idx) = index * FRAME_SIZE;
+		xsk_ring_prod__submit(&umem->fq, reserved);
+		return;
+	}
+
 	umem->tx_free_indices[umem->tx_free_count++] = index;
 }
 
@@ -240,11 +324,33 @@ void knot_xdp_send_prepare(knot_xdp_socket_t *socket)
 	if (completed == 0) {
 		return;
 	}
-	assert(umem->tx_free_count + completed <= UMEM_FRAME_COUNT_TX);
 
+	/* Pass the completed in-place replies back to the fill queue at once. */
+	uint32_t rx_frames = 0;
 	for (uint32_t i = 0; i < completed; ++i) {
-		uint64_t addr_relative = *xsk_ring_cons__comp_addr(cq, idx++);
-		tx_free_relative(umem, addr_relative);
+		uint64_t addr_relative = *xsk_ring_cons__comp_addr(cq, idx + i);
+		if (addr_relative / FRAME_SIZE >= umem->frame_count_tx) {
+			rx_frames++;
+		} else {
+			tx_free_relative(umem, addr_relative);
+		}
+	}
+	assert(umem->tx_free_count <= umem->frame_count_tx);
+
+	if (rx_frames > 0) {
+		uint32_t fq_idx = 0;
+		const uint32_t reserved = xsk_ring_prod__reserve(&umem->fq, rx_frames, &fq_idx);
+		assert(reserved == rx_frames);
+		for (uint32_t i = 0; i < completed; ++i) {
+			uint64_t index = *xsk_ring_cons__comp_addr(cq, idx + i) / FRAME_SIZE;
+			if (index >= umem->frame_count_tx) {
+				*xsk_ring_prod__fill_addr(&umem->fq, fq_idx++) = index * FRAME_SIZE;
+			}
+		}
+		xsk_ring_prod__submit(&umem->fq, reserved);
+
+		assert(umem->rx_inplace_count >= rx_frames);
+		umem->rx_inplace_count -= rx_frames;
 	}
 
 	xsk_ring_cons__release(cq, completed);
@@ -305,6 +411,31 @@ int knot_xdp_reply_alloc(knot_xdp_socket_t *socket, const knot_xdp_msg_t *query,
 	return KNOT_EOK;
 }
 
+static uint8_t *msg_uframe_ptr(const knot_xdp_msg_t *msg)
+{
+	return NULL + ((msg->payload.iov_base - NULL) & ~(FRAME_SIZE - 1));
+}
+
+_public_
+int knot_xdp_reply_inplace(knot_xdp_socket_t *socket, knot_xdp_msg_t *query,
+                           knot_xdp_msg_t *out)
+{
+	if (socket == NULL || query == NULL || out == NULL) {
+		return KNOT_EINVAL;
+	}
+
+	uint8_t *uframe_p = msg_uframe_ptr(query);
+	assert(uframe_p >= socket->umem->frames[socket->umem->frame_count_tx].bytes);
+
+	msg_init_reply(out, query);
+	prepare_payload(out, uframe_p);
+
+	/* The frame is returned to the fill queue after sending the reply. */
+	query->flags |= KNOT_XDP_MSG_INPLACE;
+
+	return KNOT_EOK;
+}
+
 static void free_unsent(knot_xdp_socket_t *socket, const knot_xdp_msg_t *msg)
 {
 	uint64_t addr_relative = (uint8_t *)msg->payload.iov_base
@@ -325,9 +456,9 @@ int knot_xdp_send(knot_xdp_socket_t *socket, const knot_xdp_msg_t msgs[],
 	 * but we don't know in advance if we utilize *whole* `count`,
 	 * and the API doesn't allow "cancelling reservations".
 	 * Therefore we handle `socket->tx.cached_prod` by hand;
-	 * that's simplified by the fact that there is always free space.
+	 * that's simplified by the fact that there is always free space
+	 * (ensured by the ring sizes, see config_complete()).
 	 */
-	assert(UMEM_RING_LEN_TX > UMEM_FRAME_COUNT_TX);
 	uint32_t idx = socket->tx.cached_prod;
 
 	for (uint32_t i = 0; i < count; ++i) {
@@ -341,8 +472,13 @@ int knot_xdp_send(knot_xdp_socket_t *socket, const knot_xdp_msg_t msgs[],
 			uint8_t *msg_beg = msg->payload.iov_base - hdr_len;
 			prot_write_eth(msg_beg, msg, msg_beg + tot_len);
 
+			uint64_t addr_relative = msg_beg - socket->umem->frames->bytes;
+			if (addr_relative / FRAME_SIZE >= socket->umem->frame_count_tx) {
+				socket->umem->rx_inplace_count++;
+			}
+
 			*xsk_ring_prod__tx_desc(&socket->tx, idx++) = (struct xdp_desc) {
-				.addr = msg_beg - socket->umem->frames->bytes,
+				.addr = addr_relative,
 				.len = tot_len,
 			};
 		}
@@ -440,11 +576,6 @@ int knot_xdp_recv(knot_xdp_socket_t *socket, knot_xdp_msg_t msgs[],
 	return KNOT_EOK;
 }
 
-static uint8_t *msg_uframe_ptr(const knot_xdp_msg_t *msg)
-{
-	return NULL + ((msg->payload.iov_base - NULL) & ~(FRAME_SIZE - 1));
-}
-
 _public_
 void knot_xdp_recv_finish(knot_xdp_socket_t *socket, const knot_xdp_msg_t msgs[],
                           uint32_t count)
@@ -456,11 +587,25 @@ void knot_xdp_recv_finish(knot_xdp_socket_t *socket, const knot_xdp_msg_t msgs[]
 	struct kxsk_umem *const umem = socket->umem;
 	struct xsk_ring_prod *const fq = &umem->fq;
 
+	/* Frames reused for in-place replies are returned after sending. */
+	uint32_t to_free = 0;
+	for (uint32_t i = 0; i < count; ++i) {
+		if (!(msgs[i].flags & KNOT_XDP_MSG_INPLACE)) {
+			to_free++;
+		}
+	}
+	if (to_free == 0) {
+		return;
+	}
+
 	uint32_t idx = 0;
-	const uint32_t reserved = xsk_ring_prod__reserve(fq, count, &idx);
-	assert(reserved == count);
+	const uint32_t reserved = xsk_ring_prod__reserve(fq, to_free, &idx);
+	assert(reserved == to_free);
 
-	for (uint32_t i = 0; i < reserved; ++i) {
+	for (uint32_t i = 0; i < count; ++i) {
+		if (msgs[i].flags & KNOT_XDP_MSG_INPLACE) {
+			continue;
+		}
 		uint8_t *uframe_p = msg_uframe_ptr(&msgs[i]);
 		uint64_t offset = uframe_p - umem->frames->bytes;
 		*xsk_ring_prod__fill_addr(fq, idx++) = offset;
@@ -486,16 +631,18 @@ void knot_xdp_info(const knot_xdp_socket_t *socket, FILE *file)
 		        (unsigned)RING_BUSY((ring)), \
 		        (unsigned)*(ring)->producer, (unsigned)*(ring)->consumer)
 
-	const int rx_busyf = RING_BUSY(&socket->umem->fq) + RING_BUSY(&socket->rx);
-	fprintf(file, "\nLOST RX frames: %4d", (int)(UMEM_FRAME_COUNT_RX - rx_busyf));
+	const int inplacef = socket->umem->rx_inplace_count;
+	const int rx_busyf = RING_BUSY(&socket->umem->fq) + RING_BUSY(&socket->rx) + inplacef;
+	fprintf(file, "\nLOST RX frames: %4d", (int)(socket->umem->frame_count_rx - rx_busyf));
 
-	const int tx_busyf = RING_BUSY(&socket->umem->cq) + RING_BUSY(&socket->tx);
+	const int tx_busyf = RING_BUSY(&socket->umem->cq) + RING_BUSY(&socket->tx) - inplacef;
 	const int tx_freef = socket->umem->tx_free_count;
-	fprintf(file, "\nLOST TX frames: %4d\n", (int)(UMEM_FRAME_COUNT_TX - tx_busyf - tx_freef));
+	fprintf(file, "\nLOST TX frames: %4d\n", (int)(socket->umem->frame_count_tx - tx_busyf - tx_freef));
 
 	RING_PRINFO("FQ", &socket->umem->fq);
 	RING_PRINFO("RX", &socket->rx);
 	RING_PRINFO("TX", &socket->tx);
 	RING_PRINFO("CQ", &socket->umem->cq);
 	fprintf(file, "TX free frames: %4d\n", tx_freef);
+	fprintf(file, "In-place replies: %4d\n", inplacef);
 }
@@ -43,6 +43,23 @@ typedef enum {
 	 * libbpf: Kernel error message: XDP program already attached */
 } knot_xdp_load_bpf_t;
 
+/*!
+ * \brief Frame counts and ring sizes of an XDP socket.
+ *
+ * \note Zero values are replaced with the defaults: 4096 frames for each
+ *       direction, the fill and RX rings twice the number of RX frames,
+ *       the completion and TX rings the number of all the frames (rounded
+ *       up to a power of 2).
+ */
+typedef struct {
+	uint32_t frame_count_rx; /*!< Number of frames for receiving. */
+	uint32_t frame_count_tx; /*!< Number of frames for sending (at most 65536). */
+	uint32_t ring_size_fill; /*!< Fill ring size, at least the number of RX frames. */
+	uint32_t ring_size_comp; /*!< Completion ring size, at least the number of all frames. */
+	uint32_t ring_size_rx;   /*!< RX ring size. */
+	uint32_t ring_size_tx;   /*!< TX ring size, at least the number of all frames. */
+} knot_xdp_config_t;
+
 /*! \brief Context structure for one XDP socket. */
 typedef struct knot_xdp_socket knot_xdp_socket_t;
 
@@ -60,6 +77,24 @@ typedef struct knot_xdp_socket knot_xdp_socket_t;
 int knot_xdp_init(knot_xdp_socket_t **socket, const char *if_name, int if_queue,
                   uint32_t listen_port, knot_xdp_load_bpf_t load_bpf);
 
+/*!
+ * \brief Initialize XDP socket with given frame counts and ring sizes.
+ *
+ * \param socket       Socket ctx.
+ * \param if_name      Name of the net iface (e.g. eth0).
+ * \param if_queue     Network card queue to be used (normally 1 socket per each queue).
+ * \param listen_port  Port to listen on, or KNOT_XDP_LISTEN_PORT_* flag.
+ * \param load_bpf     Insert BPF program into packet processing.
+ * \param config       Frame counts and ring sizes (optional, NULL for defaults).
+ *
+ * \note The ring sizes must be powers of 2.
+ *
+ * \return KNOT_E* or -errno
+ */
+int knot_xdp_init2(knot_xdp_socket_t **socket, const char *if_name, int if_queue,
+                   uint32_t listen_port, knot_xdp_load_bpf_t load_bpf,
+                   const knot_xdp_config_t *config);
+
 /*!
  * \brief De-init XDP socket.
  *
@@ -107,10 +142,30 @@ int knot_xdp_send_alloc(knot_xdp_socket_t *socket, knot_xdp_msg_flag_t flags,
 int knot_xdp_reply_alloc(knot_xdp_socket_t *socket, const knot_xdp_msg_t *query,
                          knot_xdp_msg_t *out);
 
+/*!
+ * \brief Prepare a reply packet in the frame of the received query.
+ *
+ * The reply is sent by knot_xdp_send() as if it was allocated by
+ * knot_xdp_reply_alloc(), afterwards the frame is returned for receiving.
+ * The query is marked so that knot_xdp_recv_finish() skips its frame.
+ *
+ * \note The reply payload overlaps the query payload, which thus has to be
+ *       copied away before the reply is written.
+ *
+ * \param socket       XDP socket.
+ * \param query        The received packet to be replied to.
+ * \param out          Out: the reply packet buffer.
+ *
+ * \return KNOT_E*
+ */
+int knot_xdp_reply_inplace(knot_xdp_socket_t *socket, knot_xdp_msg_t *query,
+                           knot_xdp_msg_t *out);
+
 /*!
  * \brief Send multiple packets thru XDP.
  *
- * \note The packets all must have been allocated by knot_xdp_send_alloc()!
+ * \note The packets all must have been allocated by knot_xdp_send_alloc(),
+ *       knot_xdp_reply_alloc(), or knot_xdp_reply_inplace()!
  * \note Do not free the packet payloads afterwards.
  * \note Packets with zero length will be skipped.
  *
@@ -162,6 +217,8 @@ int knot_xdp_recv(knot_xdp_socket_t *socket, knot_xdp_msg_t msgs[],
 /*!
  * \brief Free buffers with received packets.
  *
+ * \note Buffers reused by knot_xdp_reply_inplace() are skipped.
+ *
  * \param socket  XDP socket.
  * \param msgs    Buffers with received packets.
  * \param count   Number of received packets to free.
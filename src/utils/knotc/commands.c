@@ -566,7 +566,7 @@ static int zone_check(const knot_dname_t *dname, void *data)
 	cmd_args_t *args = data;
 
 	zone_contents_t *contents = NULL;
-	int ret = zone_load_contents(conf(), dname, &contents, args->force);
+	int ret = zone_load_contents(conf(), dname, &contents, args->force, false);
 	zone_contents_deep_free(contents);
 	return ret;
 }
@@ -63,7 +63,8 @@ static void print_statistics(err_handler_stats_t *stats)
 }
 
 int zone_check(const char *zone_file, const knot_dname_t *zone_name,
-               FILE *outfile, semcheck_optional_t optional, time_t time)
+               FILE *outfile, semcheck_optional_t optional, time_t time,
+               unsigned threads)
 {
 	err_handler_stats_t stats = {
 		.handler = { .cb = err_callback },
@@ -77,6 +78,8 @@ int zone_check(const char *zone_file, const knot_dname_t *zone_name,
 	}
 	zl.err_handler = (sem_handler_t *)&stats;
 	zl.creator->master = true;
+	zl.threads = threads;
+	zl.adjust_threads = threads;
 
 	zone_contents_t *contents = zonefile_load(&zl);
 	zonefile_close(&zl);
@@ -159,7 +159,7 @@ int main(int argc, char *argv[])
 		goto fail;
 	}
 
-	ret = zone_load_contents(conf(), zone_name, &unsigned_conts, false);
+	ret = zone_load_contents(conf(), zone_name, &unsigned_conts, false, false);
 	if (ret != KNOT_EOK) {
 		printf("Failed to load zone contents (%s)\n", knot_strerror(ret));
 		goto fail;
@@ -33,9 +33,11 @@ iso_codes = ['AD', 'AE', 'AF', 'AG', 'AI', 'AL', 'AM', 'AO', 'AQ', 'AR', 'AS', '
 
 t = Test(address=4, stress=False)
 knot = t.server("knot")
+knot6 = t.server("knot", address=6)
 
 zone = t.zone("example.com.", storage=".")
 t.link(zone, knot)
+t.link(zone, knot6)
 
 # Generate configuration files for geoip module.
 geodb_filename = knot.dir + "geo.conf"
@@ -63,13 +65,75 @@ geo_conf.close()
 net_conf.close()
 net2_conf.close()
 
+# Generate nested, overlapping, and non-aligned subnets of both address families.
+ranges_filename = knot.dir + "ranges.conf"
+ranges_conf = open(ranges_filename, "w")
+print('''nest.example.com:
+  - net: 127.1.2.128/25
+    A: 10.0.0.25
+  - net: 127.0.0.0/8
+    A: 10.0.0.8
+  - net: 127.1.2.0/24
+    A: 10.0.0.24
+  - net: 127.1.0.0/16
+    A: 10.0.0.16
+overlap.example.com:
+  - net: 127.0.0.0/9
+    A: 10.2.0.9
+  - net: 127.64.0.0/10
+    A: 10.2.0.10
+  - net: 127.80.0.0/12
+    A: 10.2.0.12
+  - net: 127.128.0.0/10
+    A: 10.2.1.10
+unaligned.example.com:
+  - net: 127.1.2.3/16
+    A: 10.1.0.16
+  - net: 127.9.8.7/24
+    A: 10.1.0.24
+  - net: 127.9.8.7/32
+    A: 10.1.0.32
+v6.example.com:
+  - net: ::1/128
+    A: 10.6.0.128
+  - net: ::/0
+    A: 10.6.0.0
+  - net: ::1:2:3/96
+    A: 10.6.0.96
+  - net: ::/64
+    A: 10.6.0.64
+  - net: 127.0.0.0/8
+    A: 10.4.0.8
+v6-nest.example.com:
+  - net: ::/64
+    A: 10.6.0.64
+  - net: ::1:2:3/96
+    A: 10.6.0.96
+  - net: ::/0
+    A: 10.6.0.0
+v6-sibling.example.com:
+  - net: ::/0
+    A: 10.6.0.0
+  - net: ::2/127
+    A: 10.6.0.127
+  - net: 2001:db8::/32
+    A: 10.6.1.32
+v6-only.example.com:
+  - net: ::2/128
+    A: 10.6.0.128
+  - net: 2001:db8::1/32
+    A: 10.6.1.32''', file=ranges_conf)
+ranges_conf.close()
+
 ModGeoip.check()
 
 mod_geoip = ModGeoip(geodb_filename, "geodb", t.data_dir + "db.mmdb",
                      ["country/iso_code", "(id)city/geoname_id"])
 mod_subnet = ModGeoip(subnet_filename)
+mod_ranges = ModGeoip(ranges_filename)
 
 knot.add_module(zone, mod_geoip);
+knot6.add_module(zone, mod_ranges);
 
 t.start()
 
@@ -86,6 +150,15 @@ for i in range(1, 1000):
     resp = knot.dig("d" + str(random.randint(1, dname_count)) + ".example.com", "A", source=random_client)
     resp.check(rcode="NOERROR", rdata=random_client)
 
+# Test repeated clients, which are answered from the per-thread geodb cache.
+clients = ["127.255." + str(random.randint(1, iso_count)) + ".0" for i in range(8)]
+for i in range(1, 1000):
+    client = random.choice(clients)
+    resp = knot.dig("d" + str(random.randint(1, dname_count)) + ".example.com", "A", source=client)
+    resp.check(rcode="NOERROR", rdata=client)
+    resp = knot.dig("foo.example.com", "A", source=client)
+    resp.check(rcode="NOERROR", rdata="192.0.2.4")
+
 # Restart with subnet module.
 knot.clear_modules(zone)
 knot.add_module(zone, mod_subnet);
@@ -115,3 +188,59 @@ for i in range(1, 1000):
     expected_rdata = "126.255." + middle + ".0"
     resp = knot.dig("d" + str(random.randint(1, dname_count)) + ".example.com", "A", source=random_client)
     resp.check(rcode="NOERROR", rdata=expected_rdata, nordata=random_client)
+
+def check_range(server, name, source, rdata):
+    resp = server.dig(name, "A", source=source)
+    if rdata:
+        resp.check(rcode="NOERROR", rdata=rdata)
+    else:
+        resp.check(rcode="NXDOMAIN")
+
+# Restart with nested, overlapping, and non-aligned subnets.
+knot.clear_modules(zone)
+knot.add_module(zone, mod_ranges);
+knot.gen_confile()
+knot.reload()
+knot.zone_wait(zone)
+
+# Test the longest prefix match in the IPv4 table.
+check_range(knot, "nest.example.com", "127.1.2.200", "10.0.0.25")
+check_range(knot, "nest.example.com", "127.1.2.128", "10.0.0.25")
+check_range(knot, "nest.example.com", "127.1.2.127", "10.0.0.24")
+check_range(knot, "nest.example.com", "127.1.2.1", "10.0.0.24")
+check_range(knot, "nest.example.com", "127.1.3.1", "10.0.0.16")
+check_range(knot, "nest.example.com", "127.1.255.254", "10.0.0.16")
+check_range(knot, "nest.example.com", "127.2.0.1", "10.0.0.8")
+check_range(knot, "nest.example.com", "127.255.255.254", "10.0.0.8")
+
+check_range(knot, "overlap.example.com", "127.10.0.1", "10.2.0.9")
+check_range(knot, "overlap.example.com", "127.64.0.1", "10.2.0.10")
+check_range(knot, "overlap.example.com", "127.80.0.1", "10.2.0.12")
+check_range(knot, "overlap.example.com", "127.95.255.254", "10.2.0.12")
+check_range(knot, "overlap.example.com", "127.96.0.1", "10.2.0.10")
+check_range(knot, "overlap.example.com", "127.127.255.254", "10.2.0.10")
+check_range(knot, "overlap.example.com", "127.128.0.1", "10.2.1.10")
+check_range(knot, "overlap.example.com", "127.191.255.254", "10.2.1.10")
+check_range(knot, "overlap.example.com", "127.192.0.1", None)
+
+# Test that host bits of the configured subnets are ignored.
+check_range(knot, "unaligned.example.com", "127.1.200.1", "10.1.0.16")
+check_range(knot, "unaligned.example.com", "127.0.255.254", None)
+check_range(knot, "unaligned.example.com", "127.9.8.1", "10.1.0.24")
+check_range(knot, "unaligned.example.com", "127.9.8.7", "10.1.0.32")
+check_range(knot, "unaligned.example.com", "127.9.9.1", None)
+
+# Test that IPv4 clients don't match IPv6 subnets.
+check_range(knot, "v6.example.com", "127.0.0.1", "10.4.0.8")
+check_range(knot, "v6-nest.example.com", "127.0.0.1", None)
+
+# Test the longest prefix match in the IPv6 table.
+check_range(knot6, "v6.example.com", "::1", "10.6.0.128")
+check_range(knot6, "v6-nest.example.com", "::1", "10.6.0.96")
+check_range(knot6, "v6-sibling.example.com", "::1", "10.6.0.0")
+check_range(knot6, "v6-only.example.com", "::1", None)
+
+# Test that IPv6 clients don't match IPv4 subnets.
+check_range(knot6, "nest.example.com", "::1", None)
+
+t.end()
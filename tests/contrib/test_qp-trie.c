@@ -103,6 +103,24 @@ static bool str_key_get_leq(trie_t *trie, char **keys, size_t i, size_t size)
 
 }
 
+/* Check ascending order of the applied values. */
+static int check_order(trie_val_t *val, void *d)
+{
+	const char **prev = d;
+	if (*prev != NULL && strcmp(*prev, *val) >= 0) {
+		return KNOT_ERANGE;
+	}
+	*prev = *val;
+	return KNOT_EOK;
+}
+
+/* Count the applied values. */
+static int count_vals(trie_val_t *val, void *d)
+{
+	(*(size_t *)d)++;
+	return KNOT_EOK;
+}
+
 static void test_wildcards(void)
 {
 	/* Test zone. */
@@ -270,6 +288,29 @@ int main(int argc, char *argv[])
 	is_int(inserted, iterated, "trie: sorted iteration");
 	trie_it_free(it);
 
+	/* Parts applied in sequence keep the order. */
+	trie_parts_t *parts = trie_parts_new(trie, 64);
+	const char *prev = NULL;
+	ok(parts != NULL && trie_parts_apply(parts, check_order, &prev) == KNOT_EOK,
+	   "trie: parts in order");
+	size_t applied = 0;
+	ok(trie_parts_apply(parts, count_vals, &applied) == KNOT_EOK && applied == 0,
+	   "trie: parts claimed once");
+	trie_parts_free(parts);
+
+	/* Parts applied in turns cover all values. */
+	parts = trie_parts_new(trie, 1000);
+	applied = 0;
+	ok(parts != NULL && trie_parts_apply(parts, count_vals, &applied) == KNOT_EOK &&
+	   applied == inserted, "trie: parts cover all");
+	trie_parts_free(parts);
+
+	parts = trie_parts_new(NULL, 4);
+	applied = 0;
+	ok(parts != NULL && trie_parts_apply(parts, count_vals, &applied) == KNOT_EOK &&
+	   applied == 0, "trie: parts of empty trie");
+	trie_parts_free(parts);
+
 	/* Cleanup */
 	for (unsigned i = 0; i < key_count; ++i) {
 		free(keys[i]);
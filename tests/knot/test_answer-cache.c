@@ -0,0 +1,96 @@
+/*  Copyright (C) 2020 CZ.NIC, z.s.p.o. <knot-dns@labs.nic.cz>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <string.h>
+#include <tap/basic.h>
+
+#include "knot/zone/answer-cache.h"
+#include "libknot/packet/wire.h"
+
+#define QNAME "\x03""www""\x07""example""\x03""com"
+
+static size_t make_answer(uint8_t *wire, const char *qname, uint16_t id)
+{
+	memset(wire, 0, ANSWER_CACHE_MAX_SIZE);
+	knot_wire_set_id(wire, id);
+	knot_wire_set_qdcount(wire, 1);
+	size_t qname_size = knot_dname_size((const knot_dname_t *)qname);
+	memcpy(wire + KNOT_WIRE_HEADER_SIZE, qname, qname_size);
+
+	return KNOT_WIRE_HEADER_SIZE + qname_size + 4 + 100;
+}
+
+int main(int argc, char *argv[])
+{
+	plan_lazy();
+
+	ok(answer_cache_new(0) == NULL, "answer cache: disabled");
+
+	answer_cache_t *cache = answer_cache_new(16);
+	ok(cache != NULL, "answer cache: create");
+
+	uint8_t answer[ANSWER_CACHE_MAX_SIZE];
+	uint8_t out[ANSWER_CACHE_MAX_SIZE];
+	size_t size = make_answer(answer, "\x03""WwW""\x07""example""\x03""com", 1234);
+
+	answer_cache_key_t key = {
+		.qname = (const knot_dname_t *)QNAME,
+		.qtype = 1,
+		.qclass = 1,
+		.max_size = 1232,
+		.flags = ANSWER_CACHE_EDNS
+	};
+
+	uint32_t gen = answer_cache_gen(cache);
+	is_int(0, answer_cache_get(cache, gen, &key, out, sizeof(out)), "answer cache: empty");
+
+	answer_cache_put(cache, gen, &key, answer, size);
+	is_int(0, answer_cache_get(cache, gen, &key, out, sizeof(out)), "answer cache: not admitted");
+
+	answer_cache_put(cache, gen, &key, answer, size);
+	is_int(size, answer_cache_get(cache, gen, &key, out, sizeof(out)), "answer cache: hit");
+	ok(knot_wire_get_id(out) == 1234 &&
+	   memcmp(out + KNOT_WIRE_HEADER_SIZE, QNAME, sizeof(QNAME)) == 0,
+	   "answer cache: stored with lower-case QNAME");
+	is_int(0, answer_cache_get(cache, gen, &key, out, size - 1), "answer cache: small buffer");
+
+	answer_cache_key_t other = key;
+	other.flags |= ANSWER_CACHE_DO;
+	is_int(0, answer_cache_get(cache, gen, &other, out, sizeof(out)), "answer cache: other flags");
+	other = key;
+	other.max_size = 512;
+	is_int(0, answer_cache_get(cache, gen, &other, out, sizeof(out)), "answer cache: other size");
+	other = key;
+	other.qtype = 28;
+	is_int(0, answer_cache_get(cache, gen, &other, out, sizeof(out)), "answer cache: other type");
+
+	answer_cache_put(cache, gen, &key, answer, ANSWER_CACHE_MAX_SIZE + 1);
+	is_int(size, answer_cache_get(cache, gen, &key, out, sizeof(out)), "answer cache: too large");
+
+	answer_cache_invalidate(cache);
+	uint32_t new_gen = answer_cache_gen(cache);
+	ok(new_gen != gen, "answer cache: new generation");
+	is_int(0, answer_cache_get(cache, new_gen, &key, out, sizeof(out)), "answer cache: invalidated");
+
+	/* Answer created from previous contents. */
+	answer_cache_put(cache, gen, &key, answer, size);
+	answer_cache_put(cache, gen, &key, answer, size);
+	is_int(0, answer_cache_get(cache, new_gen, &key, out, sizeof(out)), "answer cache: stale answer");
+
+	answer_cache_free(cache);
+
+	return 0;
+}
@@ -0,0 +1,74 @@
+/*  Copyright (C) 2020 CZ.NIC, z.s.p.o. <knot-dns@labs.nic.cz>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <string.h>
+#include <tap/basic.h>
+
+#include "knot/zone/axfr-cache.h"
+#include "libknot/errcode.h"
+
+int main(int argc, char *argv[])
+{
+	plan_lazy();
+
+	uint8_t msg1[100], msg2[300];
+	memset(msg1, 1, sizeof(msg1));
+	memset(msg2, 2, sizeof(msg2));
+
+	axfr_cache_t *cache = axfr_cache_new(420);
+	ok(cache != NULL, "axfr cache: create");
+
+	ok(axfr_cache_add(cache, msg1, sizeof(msg1), 3) == KNOT_EOK, "axfr cache: add");
+	ok(axfr_cache_add(cache, msg2, sizeof(msg2), 7) == KNOT_EOK, "axfr cache: add more");
+	is_int(KNOT_ESPACE, axfr_cache_add(cache, msg1, sizeof(msg1), 3), "axfr cache: limit");
+	is_int(sizeof(msg2), axfr_cache_max_msg(cache), "axfr cache: largest message");
+
+	size_t pos = 0;
+	const uint8_t *data;
+	uint16_t size, ancount;
+	ok(axfr_cache_next(cache, &pos, &data, &size, &ancount) &&
+	   size == sizeof(msg1) && ancount == 3 && memcmp(data, msg1, size) == 0,
+	   "axfr cache: first message");
+	ok(!axfr_cache_next(cache, &pos, &data, &size, &ancount) &&
+	   size == sizeof(msg2) && ancount == 7 && memcmp(data, msg2, size) == 0,
+	   "axfr cache: last message");
+
+	zone_contents_t *contents = zone_contents_new((const knot_dname_t *)"\x03""com", false);
+	ok(axfr_cache_get(contents) == NULL, "axfr cache: no cache");
+	ok(axfr_cache_claim(contents), "axfr cache: claim");
+	ok(!axfr_cache_claim(contents), "axfr cache: already claimed");
+	ok(axfr_cache_get(contents) == NULL, "axfr cache: being built");
+	axfr_cache_publish(contents, cache);
+	ok(axfr_cache_get(contents) == cache, "axfr cache: published");
+	zone_contents_free(contents);
+
+	contents = zone_contents_new((const knot_dname_t *)"\x03""com", false);
+	ok(axfr_cache_claim(contents), "axfr cache: claim other");
+	axfr_cache_publish(contents, NULL);
+	ok(axfr_cache_get(contents) == NULL && !axfr_cache_claim(contents),
+	   "axfr cache: failed");
+	zone_contents_free(contents);
+
+	contents = zone_contents_new((const knot_dname_t *)"\x03""com", false);
+	ok(axfr_cache_claim(contents), "axfr cache: claim another");
+	axfr_cache_release(contents);
+	ok(axfr_cache_get(contents) == NULL && axfr_cache_claim(contents),
+	   "axfr cache: released");
+	axfr_cache_release(contents);
+	zone_contents_free(contents);
+
+	return 0;
+}
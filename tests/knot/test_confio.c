@@ -907,11 +907,17 @@ static void test_conf_io_list(void)
 	      "server.tcp-io-timeout\n"
 	      "server.tcp-remote-io-timeout\n"
 	      "server.tcp-max-clients\n"
+	      "server.tcp-xfr-peer-limit\n"
 	      "server.tcp-reuseport\n"
 	      "server.socket-affinity\n"
+	      "server.topology-affinity\n"
+	      "server.udp-gso\n"
+	      "server.udp-batch-size\n"
+	      "server.udp-busy-poll\n"
 	      "server.udp-workers\n"
 	      "server.tcp-workers\n"
 	      "server.background-workers\n"
+	      "server.xdp-inplace-reply\n"
 	      "server.udp-max-payload\n"
 	      "server.udp-max-payload-ipv4\n"
 	      "server.udp-max-payload-ipv6\n"
@@ -930,11 +936,17 @@ static const yp_item_t desc_server[] = {
 	{ C_TCP_IO_TIMEOUT,	  YP_TINT,  YP_VNONE },
 	{ C_TCP_RMT_IO_TIMEOUT,	  YP_TINT,  YP_VNONE },
 	{ C_TCP_MAX_CLIENTS,	  YP_TINT,  YP_VNONE },
+	{ C_TCP_XFR_PEER_LIMIT,	  YP_TINT,  YP_VNONE },
 	{ C_TCP_REUSEPORT,	  YP_TBOOL, YP_VNONE },
 	{ C_SOCKET_AFFINITY,	  YP_TBOOL, YP_VNONE },
+	{ C_TOPOLOGY_AFFINITY,	  YP_TBOOL, YP_VNONE },
+	{ C_UDP_GSO,		  YP_TBOOL, YP_VNONE },
+	{ C_UDP_BATCH_SIZE,	  YP_TINT,  YP_VNONE },
+	{ C_UDP_BUSY_POLL,	  YP_TINT,  YP_VNONE },
 	{ C_UDP_WORKERS,	  YP_TINT,  YP_VNONE },
 	{ C_TCP_WORKERS,	  YP_TINT,  YP_VNONE },
 	{ C_BG_WORKERS,		  YP_TINT,  YP_VNONE },
+	{ C_XDP_INPLACE_REPLY,	  YP_TBOOL, YP_VNONE },
 	{ C_UDP_MAX_PAYLOAD,      YP_TINT,  YP_VNONE },
 	{ C_UDP_MAX_PAYLOAD_IPV4, YP_TINT,  YP_VNONE },
 	{ C_UDP_MAX_PAYLOAD_IPV6, YP_TINT,  YP_VNONE },
@@ -79,9 +79,15 @@ void* thr_action(void *arg)
 	return NULL;
 }
 
+static enum fdset_sweep_state sweep_cb(fdset_t *set, int i, void *data)
+{
+	(*(int *)data)++;
+	return FDSET_SWEEP;
+}
+
 int main(int argc, char *argv[])
 {
-	plan(12);
+	plan(17);
 
 	/* 1. Create fdset. */
 	fdset_t set;
@@ -96,9 +102,9 @@ int main(int argc, char *argv[])
 	ok(ret >= 0, "fdset: 2nd pipe() works");
 
 	/* 3. Add fd to set. */
-	ret = fdset_add(&set, fds[0], POLLIN, NULL);
+	ret = fdset_add(&set, fds[0], FDSET_POLLIN, NULL);
 	is_int(0, ret, "fdset: add to set works");
-	fdset_add(&set, tmpfds[0], POLLIN, NULL);
+	fdset_add(&set, tmpfds[0], FDSET_POLLIN, NULL);
 
 	/* Schedule write. */
 	struct timeval ts, te;
@@ -107,19 +113,24 @@ int main(int argc, char *argv[])
 	pthread_create(&t, 0, thr_action, &fds[1]);
 
 	/* 4. Watch fdset. */
-	int nfds = poll(set.pfd, set.n, 60 * 1000);
+	fdset_it_t it;
+	int nfds = fdset_poll(&set, &it, 0, 60 * 1000);
 	gettimeofday(&te, 0);
 	size_t diff = timeval_diff(&ts, &te);
 
 	ok(nfds > 0, "fdset: poll returned %d events in %zu ms", nfds, diff);
 
 	/* 5. Prepare event set. */
-	ok(set.pfd[0].revents & POLLIN, "fdset: pipe is active");
+	ok(!fdset_it_done(&it) && fdset_it_get_idx(&it) == 0 &&
+	   fdset_it_is_pollin(&it), "fdset: pipe is active");
 
 	/* 6. Receive data. */
 	char buf = 0x00;
-	ret = read(set.pfd[0].fd, &buf, WRITE_PATTERN_LEN);
+	ret = read(fdset_it_get_fd(&it), &buf, WRITE_PATTERN_LEN);
 	ok(ret >= 0 && buf == WRITE_PATTERN, "fdset: contains valid data");
+	fdset_it_next(&it);
+	ok(fdset_it_done(&it), "fdset: no more events");
+	fdset_it_commit(&it);
 
 	/* 7-9. Remove from event set. */
 	ret = fdset_remove(&set, 0);
@@ -133,6 +144,30 @@ int main(int argc, char *argv[])
 	ret = fdset_remove(&set, 0);
 	ok(ret != 0, "fdset: removing nonexistent item");
 
+	/* Watchdogs, only the expired descriptors are sweeped. */
+	int wfds[2][2];
+	ret = pipe(wfds[0]) | pipe(wfds[1]);
+	fdset_add(&set, wfds[0][0], FDSET_POLLIN, NULL);
+	fdset_add(&set, wfds[0][1], FDSET_POLLOUT, NULL);
+	fdset_add(&set, wfds[1][0], FDSET_POLLIN, NULL);
+	fdset_set_watchdog(&set, 0, 0);
+	fdset_set_watchdog(&set, 1, 3600);
+	fdset_set_watchdog(&set, 2, 0);
+	int sweeped = 0;
+	ret = fdset_sweep(&set, sweep_cb, &sweeped);
+	ok(ret == 2 && sweeped == 2, "fdset: sweeped expired descriptors");
+	ok(set.n == 1 && fdset_get_fd(&set, 0) == wfds[0][1],
+	   "fdset: kept active descriptor");
+	fdset_set_watchdog(&set, 0, -1);
+	ret = fdset_sweep(&set, sweep_cb, &sweeped);
+	ok(ret == 0 && set.n == 1, "fdset: disabled watchdog");
+	ret = fdset_remove(&set, 0);
+	is_int(0, ret, "fdset: remove from fdset works (3)");
+	for (int i = 0; i < 2; i++) {
+		close(wfds[i][0]);
+		close(wfds[i][1]);
+	}
+
 	/* 10. Crash test. */
 	fdset_init(0, 0);
 	fdset_add(0, 1, 1, 0);
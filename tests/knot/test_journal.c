@@ -19,6 +19,7 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include <limits.h>
+#include <pthread.h>
 #include <unistd.h>
 #include <sys/stat.h>
 #include <tap/basic.h>
@@ -456,6 +457,147 @@ static void test_store_load(const knot_dname_t *apex)
 	unset_conf();
 }
 
+static void set_conf_compression(bool compression, const knot_dname_t *apex)
+{
+	char conf_str[512];
+	snprintf(conf_str, sizeof(conf_str),
+	         "zone:\n"
+	         " - domain: %s\n"
+	         "   zonefile-sync: 1000\n"
+	         "   journal-compression: %s\n",
+	         (const char *)(apex + 1), compression ? "on" : "off");
+	int ret = test_conf(conf_str, NULL);
+	(void)ret;
+	assert(ret == KNOT_EOK);
+}
+
+static bool first_chunk_compressed(uint32_t serial, const knot_dname_t *apex)
+{
+	knot_lmdb_txn_t txn = { 0 };
+	knot_lmdb_begin(&jdb, &txn, false);
+	MDB_val prefix = journal_changeset_id_to_key(false, serial, apex);
+	bool compressed = knot_lmdb_find_prefix(&txn, &prefix) &&
+	                  (journal_chunk_flags(&txn.cur_val) & JOURNAL_CHUNK_COMPRESSED);
+	free(prefix.mv_data);
+	knot_lmdb_abort(&txn);
+	return compressed;
+}
+
+/*! \brief Test storing compressed and uncompressed changesets together. */
+static void test_compression(const knot_dname_t *apex)
+{
+	list_t l;
+	journal_read_t *read = NULL;
+	changeset_t ch1, ch2;
+	changeset_init(&ch1, apex);
+	changeset_init(&ch2, apex);
+	init_random_changeset(&ch1, 0, 1, 2000, apex, false);
+	init_random_changeset(&ch2, 1, 2, 2000, apex, false);
+
+	set_conf_compression(true, apex);
+	int ret = journal_scrape_with_md(jj, false);
+	is_int(KNOT_EOK, ret, "journal: compression scrape (%s)", knot_strerror(ret));
+	ret = journal_insert(jj, &ch1, NULL);
+	is_int(KNOT_EOK, ret, "journal: store compressed changeset (%s)", knot_strerror(ret));
+#ifdef HAVE_ZLIB
+	ok(first_chunk_compressed(0, apex), "journal: changeset compressed");
+#else
+	ok(!first_chunk_compressed(0, apex), "journal: changeset not compressed");
+#endif
+
+	set_conf_compression(false, apex);
+	ret = journal_insert(jj, &ch2, NULL);
+	is_int(KNOT_EOK, ret, "journal: store uncompressed changeset (%s)", knot_strerror(ret));
+	ok(!first_chunk_compressed(1, apex), "journal: changeset not compressed");
+
+	ret = load_j_list(&jj, false, 0, &read, &l);
+	is_int(KNOT_EOK, ret, "journal: read mixed changesets (%s)", knot_strerror(ret));
+	ok(list_size(&l) == 2 && changesets_eq(&ch1, HEAD(l)) && changesets_eq(&ch2, TAIL(l)),
+	   "journal: mixed changesets equal after read");
+	changesets_free(&l);
+	journal_read_end(read);
+
+	ret = journal_scrape_with_md(jj, false);
+	is_int(KNOT_EOK, ret, "journal: compression scrape (%s)", knot_strerror(ret));
+
+	changeset_clear(&ch1);
+	changeset_clear(&ch2);
+	unset_conf();
+}
+
+static bool stream_staged(const knot_dname_t *apex)
+{
+	knot_lmdb_txn_t txn = { 0 };
+	knot_lmdb_begin(&jdb, &txn, false);
+	MDB_val prefix = knot_lmdb_make_key("NIS", apex, (uint32_t)0, "incoming");
+	bool found = knot_lmdb_find_prefix(&txn, &prefix);
+	free(prefix.mv_data);
+	knot_lmdb_abort(&txn);
+	return found;
+}
+
+/*! \brief Test writing zone-in-journal while the zone is received. */
+static void test_zone_stream(const knot_dname_t *apex)
+{
+	list_t l;
+	journal_read_t *read = NULL;
+	journal_zone_stream_t *stream = NULL;
+	changeset_t e_ch;
+	changeset_init(&e_ch, apex);
+	init_random_changeset(&e_ch, 0, 1, 40000, apex, true);
+
+	set_conf_compression(true, apex);
+	int ret = journal_scrape_with_md(jj, false);
+	is_int(KNOT_EOK, ret, "journal: stream scrape (%s)", knot_strerror(ret));
+
+	ret = journal_zone_stream_begin(jj, &stream);
+	is_int(KNOT_EOK, ret, "journal: stream begin (%s)", knot_strerror(ret));
+	ret = journal_zone_stream_add(stream, e_ch.soa_to);
+	changeset_iter_t it;
+	changeset_iter_add(&it, &e_ch);
+	knot_rrset_t rr = changeset_iter_next(&it);
+	while (ret == KNOT_EOK && !knot_rrset_empty(&rr)) {
+		ret = journal_zone_stream_add(stream, &rr);
+		rr = changeset_iter_next(&it);
+	}
+	changeset_iter_clear(&it);
+	is_int(KNOT_EOK, ret, "journal: stream records (%s)", knot_strerror(ret));
+	ok(stream_staged(apex), "journal: stream records written in batches");
+	ret = journal_read_begin(jj, true, 0, &read);
+	is_int(KNOT_ENOENT, ret, "journal: stream not visible before published");
+
+	zone_node_t *n = NULL;
+	zone_contents_add_rr(e_ch.add, e_ch.soa_to, &n);
+	ret = journal_zone_stream_publish(stream, e_ch.add);
+	zone_contents_remove_rr(e_ch.add, e_ch.soa_to, &n);
+	is_int(KNOT_EOK, ret, "journal: stream publish (%s)", knot_strerror(ret));
+	journal_zone_stream_free(stream);
+	ok(!stream_staged(apex), "journal: stream leaves no records aside");
+
+	ret = load_j_list(&jj, true, 0, &read, &l);
+	is_int(KNOT_EOK, ret, "journal: load streamed zone-in-journal (%s)", knot_strerror(ret));
+	ok(list_size(&l) == 1 && changesets_eq(&e_ch, HEAD(l)),
+	   "journal: streamed zone-in-journal unmalformed");
+	changesets_free(&l);
+	journal_read_end(read);
+
+	ret = journal_zone_stream_begin(jj, &stream);
+	is_int(KNOT_EOK, ret, "journal: stream begin again (%s)", knot_strerror(ret));
+	ret = journal_zone_stream_add(stream, e_ch.soa_to);
+	is_int(KNOT_EOK, ret, "journal: stream SOA (%s)", knot_strerror(ret));
+	journal_zone_stream_free(stream);
+	ret = load_j_list(&jj, true, 0, &read, &l);
+	ok(ret == KNOT_EOK && list_size(&l) == 1, "journal: unpublished stream keeps zone-in-journal");
+	changesets_free(&l);
+	journal_read_end(read);
+
+	ret = journal_scrape_with_md(jj, false);
+	is_int(KNOT_EOK, ret, "journal: stream scrape (%s)", knot_strerror(ret));
+
+	changeset_clear(&e_ch);
+	unset_conf();
+}
+
 const uint8_t *rdA = (const uint8_t *) "\x01\x02\x03\x04";
 const uint8_t *rdB = (const uint8_t *) "\x01\x02\x03\x05";
 const uint8_t *rdC = (const uint8_t *) "\x01\x02\x03\x06";
@@ -627,6 +769,80 @@ static void test_merge(const knot_dname_t *apex)
 	unset_conf();
 }
 
+#define GROUP_ZONES 8
+#define GROUP_INSERTS 20
+
+typedef struct {
+	zone_journal_t j;
+	changeset_t ch;
+	int ret;
+} group_ctx_t;
+
+static void *group_insert(void *arg)
+{
+	group_ctx_t *ctx = arg;
+	for (uint32_t serial = 0; ctx->ret == KNOT_EOK && serial < GROUP_INSERTS; serial++) {
+		changeset_set_soa_serials(&ctx->ch, serial, serial + 1, ctx->j.zone);
+		ctx->ret = journal_insert(ctx->j, &ctx->ch, NULL);
+	}
+	return NULL;
+}
+
+/*! \brief Test concurrent inserts into the journals of several zones. */
+static void test_group_commit(void)
+{
+	int ret = knot_lmdb_reconfigure(&jdb, test_dir_name, 4096 * 1024,
+	                                journal_env_flags(JOURNAL_MODE_ROBUST, false));
+	is_int(KNOT_EOK, ret, "journal: group commit reconfigure (%s)", knot_strerror(ret));
+	knot_lmdb_set_commit_delay(&jdb, 1000);
+
+	char conf_str[1024] = "zone:\n";
+	group_ctx_t ctx[GROUP_ZONES] = { { { 0 } } };
+	for (int i = 0; i < GROUP_ZONES; i++) {
+		char name[16];
+		(void)snprintf(name, sizeof(name), "zone%d.", i);
+		size_t len = strlen(conf_str);
+		(void)snprintf(conf_str + len, sizeof(conf_str) - len,
+		               " - domain: %s\n   zonefile-sync: 1000\n", name);
+		ctx[i].j.db = &jdb;
+		ctx[i].j.zone = knot_dname_from_str_alloc(name);
+		changeset_init(&ctx[i].ch, ctx[i].j.zone);
+		init_random_changeset(&ctx[i].ch, 0, 1, 20, ctx[i].j.zone, false);
+	}
+	ret = test_conf(conf_str, NULL);
+	is_int(KNOT_EOK, ret, "journal: group commit configuration");
+
+	pthread_t threads[GROUP_ZONES];
+	for (int i = 0; i < GROUP_ZONES; i++) {
+		pthread_create(&threads[i], NULL, group_insert, &ctx[i]);
+	}
+	bool success = true;
+	for (int i = 0; i < GROUP_ZONES; i++) {
+		pthread_join(threads[i], NULL);
+		success = success && ctx[i].ret == KNOT_EOK;
+	}
+	ok(success, "journal: concurrent inserts");
+
+	success = true;
+	for (int i = 0; i < GROUP_ZONES; i++) {
+		list_t l;
+		journal_read_t *read = NULL;
+		ret = load_j_list(&ctx[i].j, false, 0, &read, &l);
+		success = success && ret == KNOT_EOK && list_size(&l) == GROUP_INSERTS &&
+		          changesets_eq(&ctx[i].ch, TAIL(l)) &&
+		          journal_sem_check(ctx[i].j) == KNOT_EOK;
+		changesets_free(&l);
+		journal_read_end(read);
+		(void)journal_scrape_with_md(ctx[i].j, false);
+		changeset_clear(&ctx[i].ch);
+		knot_dname_free((knot_dname_t *)ctx[i].j.zone, NULL);
+	}
+	ok(success, "journal: concurrently inserted changesets read");
+
+	knot_lmdb_set_commit_delay(&jdb, 0);
+	unset_conf();
+}
+
 static void test_stress_base(const knot_dname_t *apex,
                              size_t update_size, size_t file_size)
 {
@@ -693,8 +909,14 @@ int main(int argc, char *argv[])
 
 	test_store_load(apex);
 
+	test_compression(apex);
+
+	test_zone_stream(apex);
+
 	test_merge(apex);
 
+	test_group_commit();
+
 	test_stress(apex);
 
 	knot_lmdb_deinit(&jdb);
@@ -0,0 +1,83 @@
+/*  Copyright (C) 2020 CZ.NIC, z.s.p.o. <knot-dns@labs.nic.cz>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <string.h>
+#include <tap/basic.h>
+
+#include "knot/dnssec/nsec3-cache.h"
+#include "knot/dnssec/zone-nsec.h"
+#include "libknot/errcode.h"
+
+static bool same_owner(nsec3_cache_t *cache, const knot_dname_t *owner,
+                       const knot_dname_t *apex, const dnssec_nsec3_params_t *params)
+{
+	knot_dname_storage_t cached, hashed;
+	return nsec3_cache_owner(cache, cached, sizeof(cached), owner, apex, params) == KNOT_EOK &&
+	       knot_create_nsec3_owner(hashed, sizeof(hashed), owner, apex, params) == KNOT_EOK &&
+	       knot_dname_is_equal(cached, hashed);
+}
+
+int main(int argc, char *argv[])
+{
+	plan_lazy();
+
+	const knot_dname_t *apex = (const knot_dname_t *)"\x07""example""\x03""com";
+	const knot_dname_t *www = (const knot_dname_t *)"\x03""www""\x07""example""\x03""com";
+	const knot_dname_t *mail = (const knot_dname_t *)"\x04""mail""\x07""example""\x03""com";
+	const knot_dname_t *other = (const knot_dname_t *)"\x05""other";
+
+	uint8_t salt[] = { 0xab, 0xcd };
+	dnssec_nsec3_params_t params = {
+		.algorithm = DNSSEC_NSEC3_ALGORITHM_SHA1,
+		.iterations = 5,
+		.salt = { .data = salt, .size = sizeof(salt) }
+	};
+
+	ok(same_owner(NULL, www, apex, &params), "nsec3 cache: no cache");
+
+	nsec3_cache_t *cache = nsec3_cache_new(2);
+	ok(cache != NULL, "nsec3 cache: create");
+
+	ok(same_owner(cache, www, apex, &params), "nsec3 cache: miss");
+	is_int(1, nsec3_cache_size(cache), "nsec3 cache: stored on miss");
+
+	/* The apex isn't a part of the key, a hit keeps the originally hashed apex. */
+	knot_dname_storage_t cached, hashed;
+	ok(nsec3_cache_owner(cache, cached, sizeof(cached), www, other, &params) == KNOT_EOK &&
+	   knot_create_nsec3_owner(hashed, sizeof(hashed), www, apex, &params) == KNOT_EOK &&
+	   knot_dname_is_equal(cached, hashed), "nsec3 cache: hit");
+	is_int(1, nsec3_cache_size(cache), "nsec3 cache: not stored on hit");
+
+	ok(same_owner(cache, apex, apex, &params), "nsec3 cache: apex");
+	is_int(2, nsec3_cache_size(cache), "nsec3 cache: size");
+
+	ok(same_owner(cache, mail, apex, &params), "nsec3 cache: full");
+	is_int(1, nsec3_cache_size(cache), "nsec3 cache: emptied when full");
+
+	params.iterations = 10;
+	ok(same_owner(cache, mail, apex, &params), "nsec3 cache: other iterations");
+	salt[0] = 0;
+	ok(same_owner(cache, mail, apex, &params), "nsec3 cache: other salt");
+	is_int(1, nsec3_cache_size(cache), "nsec3 cache: emptied on params change");
+
+	knot_dname_storage_t out;
+	is_int(KNOT_ESPACE, nsec3_cache_owner(cache, out, 10, mail, apex, &params),
+	       "nsec3 cache: small buffer");
+
+	nsec3_cache_free(cache);
+
+	return 0;
+}
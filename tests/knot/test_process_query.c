@@ -22,6 +22,7 @@
 #include "libknot/descriptor.h"
 #include "libknot/packet/wire.h"
 #include "knot/nameserver/process_query.h"
+#include "knot/zone/answer-cache.h"
 #include "test_server.h"
 #include "contrib/sockaddr.h"
 #include "contrib/ucw/mempool.h"
@@ -71,6 +72,32 @@ static void exec_query(knot_layer_t *layer, const char *name,
 	knot_pkt_free(answer);
 }
 
+/* Resolve query and return the answer CD flag, check the MSGID (1 TAP test). */
+static bool exec_cd_query(knot_layer_t *layer, const char *name,
+                          knot_pkt_t *query, uint16_t id, bool cd)
+{
+	knot_pkt_t *answer = knot_pkt_new(NULL, KNOT_WIRE_MAX_PKTSIZE, NULL);
+	assert(answer);
+
+	knot_layer_reset(layer);
+	knot_wire_set_id(query->wire, id);
+	if (cd) {
+		knot_wire_set_cd(query->wire);
+	} else {
+		knot_wire_clear_cd(query->wire);
+	}
+	knot_pkt_parse(query, 0);
+	knot_layer_consume(layer, query);
+	knot_layer_produce(layer, answer);
+
+	is_int(id, knot_wire_get_id(answer->wire), "ns: %s MSGID match", name);
+	bool answer_cd = knot_wire_get_cd(answer->wire);
+
+	knot_pkt_free(answer);
+
+	return answer_cd;
+}
+
 /* \internal Helpers */
 #define WIRE_COPY(dst, dst_len, src, src_len) \
 	memcpy(dst, src, src_len); \
@@ -177,6 +204,54 @@ int main(int argc, char *argv[])
 	knot_layer_consume(&proc, query);
 	ok(proc.state == KNOT_STATE_NOOP, "ns: IN/less-than-header query ignored");
 
+	/* Query processor (batch, zone lookup shared with the prefetch). */
+	process_query_batch_t batch;
+	process_query_batch_init(&batch, &server);
+	knot_layer_batch_begin(&proc, &batch);
+	knot_pkt_clear(query);
+	knot_pkt_put_question(query, ROOT_DNAME, KNOT_CLASS_IN, KNOT_RRTYPE_SOA);
+	knot_layer_batch_prefetch(&proc, query->wire, query->size);
+	ok(batch.count == 1 && batch.lookups[0].zone == zone &&
+	   batch.lookups[0].leaf, "ns: batch prefetch zone lookup");
+	ok(batch.prefetch.contents == zone->contents &&
+	   batch.prefetch.node == zone->contents->apex, "ns: batch prefetch node lookup");
+	knot_layer_reset(&proc);
+	exec_query(&proc, "IN/batch", query, KNOT_RCODE_NOERROR);
+	ok(batch.prefetch.contents == NULL, "ns: batch prefetched node used");
+	knot_pkt_clear(query);
+	knot_pkt_put_question(query, (const knot_dname_t *)"\x03""com",
+	                      KNOT_CLASS_IN, KNOT_RRTYPE_SOA);
+	knot_layer_reset(&proc);
+	exec_query(&proc, "IN/batch-below", query, KNOT_RCODE_NXDOMAIN);
+	ok(batch.count == 1, "ns: batch zone lookup reused");
+	knot_layer_batch_end(&proc);
+	ok(proc.batch == NULL, "ns: batch end");
+
+	/* Query processor (answer cache, flags taken from the current query). */
+	zone->answer_cache = answer_cache_new(16);
+	knot_pkt_clear(query);
+	knot_pkt_put_question(query, ROOT_DNAME, KNOT_CLASS_IN, KNOT_RRTYPE_SOA);
+	bool cd_uncached = exec_cd_query(&proc, "IN/cache-cd-miss", query, 0x1234, true);
+	exec_cd_query(&proc, "IN/cache-cd-store", query, 0x2345, true);
+	answer_cache_key_t cache_key = {
+		.qname = ROOT_DNAME,
+		.qtype = KNOT_RRTYPE_SOA,
+		.qclass = KNOT_CLASS_IN,
+		.max_size = KNOT_WIRE_MAX_PKTSIZE,
+	};
+	uint8_t cached[ANSWER_CACHE_MAX_SIZE];
+	uint32_t cache_gen = answer_cache_gen(zone->answer_cache);
+	size_t cached_size = answer_cache_get(zone->answer_cache, cache_gen, &cache_key,
+	                                      cached, sizeof(cached));
+	ok(cached_size > 0, "ns: answer cached");
+	/* Pretend the stored answer has CD set. */
+	knot_wire_set_cd(cached);
+	answer_cache_put(zone->answer_cache, cache_gen, &cache_key, cached, cached_size);
+	ok(!exec_cd_query(&proc, "IN/cache-cd-0", query, 0x3456, false),
+	   "ns: cached answer CD=0");
+	ok(exec_cd_query(&proc, "IN/cache-cd-1", query, 0x4567, true) == cd_uncached,
+	   "ns: cached answer CD as uncached");
+
 	/* Finish. */
 	knot_layer_finish(&proc);
 	ok(proc.state == KNOT_STATE_NOOP, "ns: processing end" );
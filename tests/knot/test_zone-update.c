@@ -36,6 +36,17 @@ static const char *del_str   = "test. 600 IN TXT \"test\"\n";
 static const char *node_str1 = "node.test. 601 IN TXT \"abc\"\n";
 static const char *node_str2 = "node.test. 601 IN TXT \"def\"\n";
 
+static const char *stream_strs[] = {
+	"test. 600 IN SOA ns.test. m.test. 1 900 300 4800 900\n",
+	"test. 600 IN NS ns.test.\n",
+	"a.b.test. 600 IN A 192.0.2.1\n",
+	"ns.test. 600 IN A 192.0.2.2\n",
+	"ns.test. 700 IN AAAA 2001:db8::2\n",
+	"sub.test. 600 IN NS ns.sub.test.\n",
+	"ns.sub.test. 800 IN A 192.0.2.3\n",
+	"z.test. 600 IN TXT \"z\"\n",
+};
+
 knot_rrset_t rrset;
 
 /*!< \brief Returns true if node contains given RR in its RRSets. */
@@ -286,6 +297,69 @@ void test_incremental(zone_t *zone, zs_scanner_t *sc)
 	// TODO test more things after re-adjust, search for non-unified bi-nodes
 }
 
+static void stream_add(zone_contents_t *z, zone_adjust_stream_t *ctx,
+                       zs_scanner_t *sc, const char *str)
+{
+	if (zs_set_input_string(sc, str, strlen(str)) != 0 ||
+	    zs_parse_all(sc) != 0) {
+		assert(0);
+	}
+	zone_node_t *node = NULL;
+	int ret = zone_contents_add_rr(z, &rrset, &node);
+	(void)ret;
+	assert(ret == KNOT_EOK);
+	knot_rdataset_clear(&rrset.rrs, NULL);
+	if (ctx != NULL) {
+		zone_adjust_stream_node(ctx, node, false);
+	}
+}
+
+static int test_node_adjusted(zone_node_t *node, void *data)
+{
+	const zone_node_t *other = zone_contents_find_node(data, node->owner);
+	ok(other != NULL && other->flags == node->flags &&
+	   knot_dname_is_equal(other->prev->owner, node->prev->owner),
+	   "adjust while filled: node %s adjusted the same", node->owner);
+	return KNOT_EOK;
+}
+
+static void test_adjust_stream(const knot_dname_t *apex, zs_scanner_t *sc)
+{
+	zone_contents_t *streamed = zone_contents_new(apex, true);
+	zone_contents_t *full = zone_contents_new(apex, true);
+	assert(streamed && full);
+
+	zone_adjust_stream_t ctx;
+	zone_adjust_stream_init(&ctx, streamed);
+	for (size_t i = 0; i < sizeof(stream_strs) / sizeof(*stream_strs); i++) {
+		stream_add(streamed, &ctx, sc, stream_strs[i]);
+		stream_add(full, NULL, sc, stream_strs[i]);
+	}
+	int ret = zone_adjust_stream_finish(&ctx);
+	if (ret == KNOT_EOK) {
+		ret = zone_adjust_pointers(streamed, 1);
+	}
+	is_int(KNOT_EOK, ret, "adjust while filled: finish");
+	ret = zone_adjust_full(full, 1);
+	is_int(KNOT_EOK, ret, "adjust while filled: full adjust");
+	ok(streamed->size == full->size && streamed->max_ttl == full->max_ttl,
+	   "adjust while filled: zone measured the same");
+	zone_tree_apply(streamed->nodes, test_node_adjusted, full);
+	zone_contents_deep_free(streamed);
+
+	// Records out of canonical order.
+	streamed = zone_contents_new(apex, true);
+	assert(streamed);
+	zone_adjust_stream_init(&ctx, streamed);
+	stream_add(streamed, &ctx, sc, stream_strs[0]);
+	stream_add(streamed, &ctx, sc, stream_strs[7]);
+	stream_add(streamed, &ctx, sc, stream_strs[2]);
+	ret = zone_adjust_stream_finish(&ctx);
+	is_int(KNOT_ENOTSUP, ret, "adjust while filled: refused out of order");
+	zone_contents_deep_free(streamed);
+	zone_contents_deep_free(full);
+}
+
 int main(int argc, char *argv[])
 {
 	plan_lazy();
@@ -327,6 +401,7 @@ int main(int argc, char *argv[])
 	/* Test FULL update, commit it and use the result to test the INCREMENTAL update */
 	test_full(zone, &sc);
 	test_incremental(zone, &sc);
+	test_adjust_stream(apex, &sc);
 
 	zs_deinit(&sc);
 	zone_free(&zone);
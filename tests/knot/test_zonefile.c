@@ -0,0 +1,310 @@
+/*  Copyright (C) 2020 CZ.NIC, z.s.p.o. <knot-dns@labs.nic.cz>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <tap/basic.h>
+#include <tap/files.h>
+
+#include "knot/zone/snapshot.h"
+#include "knot/zone/zone-diff.h"
+#include "knot/zone/zonefile.h"
+#include "libknot/libknot.h"
+
+#define ZONE		"example.com."
+#define RECORDS		50000
+#define SIGNED_NODES	5000
+
+static const char *SUBS[] = { "sub." ZONE, "a.b." ZONE, ZONE };
+
+/*! \brief Writes a zone file exercising the zone file chunk boundaries. */
+static int write_zone(const char *path, bool syntax_error)
+{
+	FILE *f = fopen(path, "w");
+	if (f == NULL) {
+		return -1;
+	}
+
+	fprintf(f, "$ORIGIN " ZONE "\n"
+	           "$TTL 600\n"
+	           "@ SOA ns hostmaster ( 1 ; serial\n"
+	           "      3600 900 86400 ; refresh, retry, expire\n"
+	           "      300 )\n"
+	           "  NS ns\n"
+	           "ns A 192.0.2.1\n");
+
+	for (int i = 0; i < RECORDS; i++) {
+		switch (i % 10) {
+		case 0:
+			fprintf(f, "$ORIGIN %s\n", SUBS[(i / 10) % 3]);
+			break;
+		case 1:
+			fprintf(f, "$TTL %d ; default TTL\n", 60 + i % 7);
+			break;
+		case 2:
+			fprintf(f, "txt%d TXT \"quoted ( ; \\\" text\" (\n"
+			           "n%d\n"
+			           "\"multi-line\" ) ; comment\n", i, i);
+			break;
+		case 3:
+			fprintf(f, "; txt%d TXT \"commented\n", i);
+			break;
+		case 4:
+			if (syntax_error && i > RECORDS / 2 && i < RECORDS / 2 + 10) {
+				fprintf(f, "host%d A 192.0.2\n", i);
+				break;
+			}
+			// FALLTHROUGH
+		default:
+			fprintf(f, "Host%d 300 A 192.0.2.%d\n"
+			           "\tAAAA 2001:db8::%x\n"
+			           "mx%d MX 10 Host%d\n", i, i % 256, i, i, i);
+			break;
+		}
+	}
+
+	fclose(f);
+
+	return 0;
+}
+
+/*! \brief Writes an NSEC-signed zone with broken links in the NSEC chain. */
+static int write_signed_zone(const char *path)
+{
+	FILE *f = fopen(path, "w");
+	if (f == NULL) {
+		return -1;
+	}
+
+	fprintf(f, "$ORIGIN " ZONE "\n"
+	           "$TTL 600\n"
+	           "@ SOA h00000 hostmaster 1 3600 900 86400 300\n"
+	           "  NS h00000\n"
+	           "  NSEC h00000 SOA NS NSEC\n");
+
+	for (int i = 0; i < SIGNED_NODES; i++) {
+		fprintf(f, "h%05d A 192.0.2.1\n", i);
+		if (i == SIGNED_NODES - 1) {
+			fprintf(f, "  NSEC @ A NSEC\n");
+		} else if (i % 50 == 0) {
+			fprintf(f, "  NSEC h%05d A NSEC\n", i + 2);
+		} else {
+			fprintf(f, "  NSEC h%05d A NSEC\n", i + 1);
+		}
+	}
+
+	fclose(f);
+
+	return 0;
+}
+
+typedef struct {
+	sem_handler_t handler;
+	char *log;
+	size_t size;
+	size_t chain_errors;
+} sem_log_t;
+
+static void sem_log_cb(sem_handler_t *handler, const zone_contents_t *zone,
+                       const zone_node_t *node, sem_error_t error, const char *data)
+{
+	sem_log_t *log = (sem_log_t *)handler;
+
+	knot_dname_txt_storage_t owner = "";
+	if (node != NULL) {
+		(void)knot_dname_to_str(owner, node->owner, sizeof(owner));
+	}
+
+	char line[512];
+	int len = snprintf(line, sizeof(line), "%s %u %d %s\n", owner, error,
+	                   handler->error, (data != NULL ? data : ""));
+
+	log->log = realloc(log->log, log->size + len + 1);
+	memcpy(log->log + log->size, line, len + 1);
+	log->size += len;
+	if (error == SEM_ERR_NSEC_RDATA_CHAIN) {
+		log->chain_errors++;
+	}
+
+	handler->error = false;
+}
+
+static zone_contents_t *load_checked_zone(const char *path, unsigned threads,
+                                          sem_log_t *log)
+{
+	zloader_t zl;
+	knot_dname_t *zone = knot_dname_from_str_alloc(ZONE);
+	int ret = zonefile_open(&zl, path, zone, SEMCHECK_DNSSEC, time(NULL));
+	free(zone);
+	if (ret != KNOT_EOK) {
+		return NULL;
+	}
+
+	memset(log, 0, sizeof(*log));
+	log->handler.cb = sem_log_cb;
+	zl.err_handler = &log->handler;
+	zl.creator->master = true;
+	zl.adjust_threads = threads;
+
+	zone_contents_t *contents = zonefile_load(&zl);
+	zonefile_close(&zl);
+
+	return contents;
+}
+
+static void test_semchecks(const char *path)
+{
+	ok(write_signed_zone(path) == 0, "semchecks: write zone file");
+
+	sem_log_t serial, parallel;
+	zone_contents_t *serial_zone = load_checked_zone(path, 1, &serial);
+	ok(serial_zone != NULL, "semchecks: check with one thread");
+	zone_contents_t *parallel_zone = load_checked_zone(path, 4, &parallel);
+	ok(parallel_zone != NULL, "semchecks: check with more threads");
+
+	is_int(SIGNED_NODES / 50, serial.chain_errors,
+	       "semchecks: broken NSEC chain");
+	ok(serial.log != NULL && parallel.log != NULL &&
+	   strcmp(serial.log, parallel.log) == 0,
+	   "semchecks: same errors in the same order");
+
+	zone_contents_deep_free(serial_zone);
+	zone_contents_deep_free(parallel_zone);
+	free(serial.log);
+	free(parallel.log);
+}
+
+static void test_snapshot(const char *path, zone_contents_t *contents)
+{
+	char *snapshot = zone_snapshot_path(path);
+	struct stat st = { .st_mtim = { 1000, 1 }, .st_size = 2000, .st_ino = 3000 };
+	ok(zone_snapshot_write(snapshot, contents, &st) == KNOT_EOK,
+	   "snapshot: write");
+
+	zone_contents_t *loaded = NULL;
+	ok(zone_snapshot_load(snapshot, contents->apex->owner, &st, &loaded) == KNOT_EOK,
+	   "snapshot: load");
+	if (loaded != NULL) {
+		changeset_t ch;
+		changeset_init(&ch, contents->apex->owner);
+		is_int(KNOT_ENODIFF, zone_contents_diff(contents, loaded, &ch, false),
+		       "snapshot: same zone contents");
+		is_int(contents->apex->flags, loaded->apex->flags,
+		       "snapshot: adjusted zone contents");
+		changeset_clear(&ch);
+		zone_contents_deep_free(loaded);
+	}
+
+	struct stat other = st;
+	other.st_mtim.tv_nsec++;
+	is_int(KNOT_ENOENT, zone_snapshot_load(snapshot, contents->apex->owner,
+	                                       &other, &loaded),
+	       "snapshot: zone file mtime changed");
+	other = st;
+	other.st_size++;
+	is_int(KNOT_ENOENT, zone_snapshot_load(snapshot, contents->apex->owner,
+	                                       &other, &loaded),
+	       "snapshot: zone file size changed");
+	other = st;
+	other.st_ino++;
+	is_int(KNOT_ENOENT, zone_snapshot_load(snapshot, contents->apex->owner,
+	                                       &other, &loaded),
+	       "snapshot: zone file replaced");
+
+	knot_dname_t *other_zone = knot_dname_from_str_alloc("example.net.");
+	is_int(KNOT_EMALF, zone_snapshot_load(snapshot, other_zone, &st, &loaded),
+	       "snapshot: other zone");
+	free(other_zone);
+
+	ok(truncate(snapshot, 1000) == 0, "snapshot: truncate");
+	is_int(KNOT_EMALF, zone_snapshot_load(snapshot, contents->apex->owner,
+	                                      &st, &loaded),
+	       "snapshot: truncated");
+
+	unlink(snapshot);
+	is_int(KNOT_ENOENT, zone_snapshot_load(snapshot, contents->apex->owner,
+	                                       &st, &loaded),
+	       "snapshot: missing");
+	free(snapshot);
+}
+
+static zone_contents_t *load_zone(const char *path, unsigned threads)
+{
+	zloader_t zl;
+	knot_dname_t *zone = knot_dname_from_str_alloc(ZONE);
+	int ret = zonefile_open(&zl, path, zone, SEMCHECK_MANDATORY_ONLY, time(NULL));
+	free(zone);
+	if (ret != KNOT_EOK) {
+		return NULL;
+	}
+
+	sem_handler_t handler = {
+		.cb = err_handler_logger
+	};
+	zl.err_handler = &handler;
+	zl.creator->master = true;
+	zl.threads = threads;
+
+	zone_contents_t *contents = zonefile_load(&zl);
+	zonefile_close(&zl);
+
+	return contents;
+}
+
+int main(int argc, char *argv[])
+{
+	plan_lazy();
+
+	char *dir = test_mkdtemp();
+	ok(dir != NULL, "create temporary directory");
+
+	char path[1024];
+	(void)snprintf(path, sizeof(path), "%s/zone", dir);
+	ok(write_zone(path, false) == 0, "write zone file");
+
+	zone_contents_t *serial = load_zone(path, 1);
+	ok(serial != NULL, "load zone with one thread");
+
+	zone_contents_t *parallel = load_zone(path, 4);
+	ok(parallel != NULL, "load zone with more threads");
+
+	if (serial != NULL && parallel != NULL) {
+		changeset_t ch;
+		ok(changeset_init(&ch, serial->apex->owner) == KNOT_EOK, "init changeset");
+		is_int(KNOT_ENODIFF, zone_contents_diff(serial, parallel, &ch, false),
+		       "same zone contents");
+		changeset_clear(&ch);
+	}
+
+	if (serial != NULL) {
+		test_snapshot(path, serial);
+	}
+
+	zone_contents_deep_free(serial);
+	zone_contents_deep_free(parallel);
+
+	test_semchecks(path);
+
+	ok(write_zone(path, true) == 0, "write zone file with errors");
+	ok(load_zone(path, 4) == NULL, "parallel load fails on syntax error");
+
+	test_rm_rf(dir);
+	free(dir);
+
+	return 0;
+}
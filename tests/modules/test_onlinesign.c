@@ -18,9 +18,12 @@
 #include <assert.h>
 
 #include "knot/modules/onlinesign/nsec_next.h"
+#include "knot/modules/onlinesign/rrsig_cache.h"
 #include "libknot/consts.h"
 #include "libknot/dname.h"
 #include "libknot/errcode.h"
+#include "libknot/rrtype/rrsig.h"
+#include "libknot/wire.h"
 
 /*!
  * \brief Assert that a domain name in a static buffer is valid.
@@ -39,6 +42,60 @@ static void _test_nsec_next(const char *msg,
 	knot_dname_free(next, NULL);
 }
 
+static void test_rrsig_cache(void)
+{
+	const uint32_t now = 1000000;
+
+	knot_rrset_t *rrset = knot_rrset_new((const knot_dname_t *)"\x03""www""\x07""example",
+	                                     KNOT_RRTYPE_A, KNOT_CLASS_IN, 3600, NULL);
+	uint8_t addr[4] = { 192, 0, 2, 1 };
+	knot_rrset_add_rdata(rrset, addr, sizeof(addr), NULL);
+
+	// type covered, algorithm, labels, original TTL, expiration, ...
+	uint8_t sig[] = { 0, 1, 13, 2, 0, 0, 0x0e, 0x10, 0, 0, 0, 0, 0, 0, 0, 0,
+	                  0, 1, 7, 'e', 'x', 'a', 'm', 'p', 'l', 'e', 0, 0xaa, 0xbb };
+	knot_wire_write_u32(sig + 8, now + 100);
+	knot_rrset_t *rrsig = knot_rrset_new(rrset->owner, KNOT_RRTYPE_RRSIG,
+	                                     KNOT_CLASS_IN, 3600, NULL);
+	knot_rrset_add_rdata(rrsig, sig, sizeof(sig), NULL);
+
+	rrsig_cache_t *cache = rrsig_cache_new(10);
+	ok(cache != NULL, "rrsig cache: create");
+
+	knot_rdataset_t out;
+	knot_rdataset_init(&out);
+	is_int(KNOT_ENOENT, rrsig_cache_get(cache, 1, now, rrset, &out, NULL),
+	       "rrsig cache: empty");
+
+	rrsig_cache_put(cache, 1, rrset, &rrsig->rrs, 50);
+	ok(rrsig_cache_get(cache, 1, now, rrset, &out, NULL) == KNOT_EOK &&
+	   knot_rdataset_eq(&out, &rrsig->rrs), "rrsig cache: hit");
+	knot_rdataset_clear(&out, NULL);
+
+	is_int(KNOT_ENOENT, rrsig_cache_get(cache, 2, now, rrset, &out, NULL),
+	       "rrsig cache: other keys");
+	is_int(KNOT_ENOENT, rrsig_cache_get(cache, 1, now + 50, rrset, &out, NULL),
+	       "rrsig cache: refresh");
+
+	rrset->ttl = 60;
+	is_int(KNOT_ENOENT, rrsig_cache_get(cache, 1, now, rrset, &out, NULL),
+	       "rrsig cache: other TTL");
+	rrset->ttl = 3600;
+
+	addr[3] = 2;
+	knot_rrset_add_rdata(rrset, addr, sizeof(addr), NULL);
+	is_int(KNOT_ENOENT, rrsig_cache_get(cache, 1, now, rrset, &out, NULL),
+	       "rrsig cache: other records");
+
+	rrsig_cache_put(cache, 1, rrset, &rrsig->rrs, 100);
+	is_int(KNOT_ENOENT, rrsig_cache_get(cache, 1, now, rrset, &out, NULL),
+	       "rrsig cache: to be refreshed right away");
+
+	rrsig_cache_free(cache);
+	knot_rrset_free(rrset, NULL);
+	knot_rrset_free(rrsig, NULL);
+}
+
 /*!
  * \brief Check \a online_nsec_next.
  *
@@ -199,5 +256,7 @@ int main(int argc, char *argv[])
 		APEX
 	);
 
+	test_rrsig_cache();
+
 	return 0;
 }
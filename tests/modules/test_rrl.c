@@ -14,6 +14,7 @@
     along with this program.  If not, see <https://www.gnu.org/licenses/>.
  */
 
+#include <pthread.h>
 #include <tap/basic.h>
 
 #include "libdnssec/crypto.h"
@@ -29,17 +30,6 @@
 #define RRL_THREADS 8
 #define RRL_INSERTS (RRL_SIZE/(5*RRL_THREADS)) /* lf = 1/5 */
 
-/* Disabled as default as it depends on random input.
- * Table may be consistent even if some collision occur (and they may occur).
- * Note: Disabled due to reported problems when running on VMs due to time
- * flow inconsistencies. Should work alright on a host machine.
- */
-#ifdef ENABLE_TIMED_TESTS
-struct bucketmap {
-	unsigned i;
-	uint64_t x;
-};
-
 /*! \brief Unit runnable. */
 struct runnable_data {
 	int passed;
@@ -49,44 +39,63 @@ struct runnable_data {
 	knot_dname_t *zone;
 };
 
-static void* rrl_runnable(void *arg)
+static pthread_mutex_t passed_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static void* rrl_runnable_same(void *arg)
 {
 	struct runnable_data *d = (struct runnable_data *)arg;
-	struct sockaddr_storage addr;
-	memcpy(&addr, d->addr, sizeof(struct sockaddr_storage));
-	int lock = -1;
-	uint32_t now = time(NULL);
-	struct bucketmap *m = malloc(RRL_INSERTS * sizeof(struct bucketmap));
-	for (unsigned i = 0; i < RRL_INSERTS; ++i) {
-		m[i].i = dnssec_random_uint32_t();
-		((struct sockaddr_in *) &addr)->sin_addr.s_addr = m[i].i;
-		rrl_item_t *b = rrl_hash(d->rrl, &addr, d->rq, d->zone, now, &lock);
-		rrl_unlock(d->rrl, lock);
-		m[i].x = b->netblk;
-	}
-	for (unsigned i = 0; i < RRL_INSERTS; ++i) {
-		((struct sockaddr_in *) &addr)->sin_addr.s_addr = m[i].i;
-		rrl_item_t *b = rrl_hash(d->rrl, &addr, d->rq, d->zone, now, &lock);
-		rrl_unlock(d->rrl, lock);
-		if (b->netblk != m[i].x) {
-			d->passed = 0;
+	int passed = 0;
+	for (unsigned i = 0; i < d->rrl->rate * RRL_CAPACITY; ++i) {
+		if (rrl_query(d->rrl, d->addr, d->rq, d->zone, NULL) == KNOT_EOK) {
+			passed++;
 		}
 	}
-	free(m);
+	pthread_mutex_lock(&passed_lock);
+	d->passed += passed;
+	pthread_mutex_unlock(&passed_lock);
 	return NULL;
 }
 
-static void rrl_hopscotch(struct runnable_data* rd)
+static void rrl_threads(struct runnable_data* rd, void *(*runnable)(void *))
 {
-	rd->passed = 1;
 	pthread_t thr[RRL_THREADS];
 	for (unsigned i = 0; i < RRL_THREADS; ++i) {
-		pthread_create(thr + i, NULL, &rrl_runnable, rd);
+		pthread_create(thr + i, NULL, runnable, rd);
 	}
 	for (unsigned i = 0; i < RRL_THREADS; ++i) {
 		pthread_join(thr[i], NULL);
 	}
 }
+
+/* Disabled as default as it depends on random input.
+ * Table may be consistent even if some collision occur (and they may occur).
+ * Note: Disabled due to reported problems when running on VMs due to time
+ * flow inconsistencies. Should work alright on a host machine.
+ */
+#ifdef ENABLE_TIMED_TESTS
+static void* rrl_runnable(void *arg)
+{
+	struct runnable_data *d = (struct runnable_data *)arg;
+	struct sockaddr_storage addr;
+	memcpy(&addr, d->addr, sizeof(struct sockaddr_storage));
+	uint32_t *m = malloc(RRL_INSERTS * sizeof(uint32_t));
+	for (unsigned i = 0; i < RRL_INSERTS; ++i) {
+		m[i] = dnssec_random_uint32_t();
+		((struct sockaddr_in *) &addr)->sin_addr.s_addr = m[i];
+		(void)rrl_query(d->rrl, &addr, d->rq, d->zone, NULL);
+	}
+	uint32_t now = time(NULL);
+	for (unsigned i = 0; i < RRL_INSERTS; ++i) {
+		((struct sockaddr_in *) &addr)->sin_addr.s_addr = m[i];
+		rrl_item_t old, b;
+		(void)rrl_hash(d->rrl, &addr, d->rq, d->zone, now, &old, &b);
+		if (old.key != b.key) {
+			d->passed = 0;
+		}
+	}
+	free(m);
+	return NULL;
+}
 #endif
 
 int main(int argc, char *argv[])
@@ -125,6 +134,7 @@ int main(int argc, char *argv[])
 	const uint32_t rate = 10;
 	rrl_table_t *rrl = rrl_create(RRL_SIZE, rate);
 	ok(rrl != NULL, "rrl: create");
+	ok(rrl_create(RRL_SIZE, RRL_RATE_MAX + 1) == NULL, "rrl: create over maximum rate");
 
 	/* 2. N unlimited requests. */
 	knot_dname_t *zone = knot_dname_from_str_alloc("rrl.");
@@ -153,6 +163,20 @@ int main(int argc, char *argv[])
 	rrl_classify(buf, sizeof(buf), &addr6, &rq, qname);
 	is_int(0, memcmp(buf, expectedv6, sizeof(expectedv6)), "rrl: IPv6 hash input buffer");
 
+	/* 4. concurrent requests from one address */
+	struct sockaddr_storage addr_mt;
+	sockaddr_set(&addr_mt, AF_INET, "5.6.7.8", 0);
+	struct runnable_data rd = {
+		0, rrl, &addr_mt, &rq, zone
+	};
+	uint32_t start = time_now().tv_sec;
+	rrl_threads(&rd, rrl_runnable_same);
+	uint32_t elapsed = time_now().tv_sec - start;
+	// Exact if no token is added meanwhile.
+	ok(rd.passed >= rate * RRL_CAPACITY &&
+	   rd.passed <= rate * (RRL_CAPACITY + elapsed),
+	   "rrl: concurrent requests limited exactly");
+
 #ifdef ENABLE_TIMED_TESTS
 	/* 5. limited request */
 	ret = rrl_query(rrl, &addr, &rq, zone, NULL);
@@ -162,11 +186,10 @@ int main(int argc, char *argv[])
 	ret = rrl_query(rrl, &addr6, &rq, zone, NULL);
 	is_int(KNOT_ELIMIT, ret, "rrl: throttled IPv6 request");
 
-	/* 8. hopscotch test */
-	struct runnable_data rd = {
-		1, rrl, &addr, &rq, zone
-	};
-	rrl_hopscotch(&rd);
+	/* 7. consistency test */
+	rd.passed = 1;
+	rd.addr = &addr;
+	rrl_threads(&rd, rrl_runnable);
 	ok(rd.passed, "rrl: hashtable is ~ consistent");
 #endif
 